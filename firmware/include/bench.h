@@ -0,0 +1,44 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// === Benchmark Configuration ===
+// Hot paths timed in place, on the host by tests/bench/grow_bench.cpp
+// and on the board by the esp32dev-bench environment. Each case is
+// repeated until one batch runs BENCH_MIN_US.
+#ifndef BENCH_ON_BOOT
+#define BENCH_ON_BOOT 0 // Set 1 to run the suite from setup()
+#endif
+
+#define BENCH_MIN_US 100000 // Shortest timed batch
+#define BENCH_OPS_MAX 10000000 // Batch size cap
+#define BENCH_LINE_MAX 128 // One JSON result, fits a log line
+
+// === Result ===
+typedef struct {
+  const char *name;
+  uint32_t ops;          // Operations in the timed batch
+  double ns_per_op;      // Wall time
+  double cycles_per_op;  // CPU cycles at 240 MHz, derived on the host
+} bench_result_t;
+
+// Called once per case as it finishes
+typedef void (*bench_sink_t)(const bench_result_t *result, void *ctx);
+
+// === Function Prototypes ===
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t bench_run(const char *filter, bench_sink_t sink, void *ctx);
+size_t bench_format(const bench_result_t *result, const char *target, char *out, size_t size);
+void bench_console_sink(const bench_result_t *result, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BENCH_H
@@ -8,6 +8,9 @@
 #define WIFI_AP_TIMEOUT 180 // 3 mins 
 #define WIFI_STA_MAX_RETRY 15
 #define WIFI_STA_RETRY_DELAY 3*60*1000 // 3 mins
+#include "wifi_link.h"
+#include "wifi_portal.h"
+#include "wifi_signal.h"
 
 // === OTA Configuration ===
 #include <ESPmDNS.h>
@@ -15,14 +18,36 @@
 #define OTA_PORT 3232
 //#define OTA_PASSWORD "123456"
 
+// === Network API Configuration ===
+#include "vp_http.h"
+#include "vp_ws.h"
+#include "mqtt_bridge.h"
+
 // === NTP Configuration ===
 #include <WiFiUdp.h>
-#include <NTPClient.h>
-extern NTPClient timeClient;
+#include "ntp_sync.h"
 #define NTP_SERVER "asia.pool.ntp.org"
-#define NTP_OFFSET 19800 // UTC+5:30
+#define NTP_SERVER_2 "pool.ntp.org"
+#define NTP_SERVER_3 "time.google.com"
 #define NTP_UPDATE_INTERVAL 10*60*1000 // 10 mins
 
+// === Panel RTC Configuration ===
+#define RTC_READ_RETRY_MS 1000 // Boot read retry while time is invalid
+#define RTC_READ_MAX_TRIES 5
+#define RTC_WRITEBACK_INTERVAL 24*60*60 // Secs between NTP write-backs
+
+// === Scheduler Configuration ===
+#include "esp_time.h"
+#include "io_schedule.h"
+
+// === Growth Cycle Configuration ===
+#define GROWTH_START_KEY "gstart" // NVS key, epoch of day 1
+#define GROWTH_MAX_DAY 99 // Display cap
+#define VP_DERIVED_MAX 2 // VPs vp_apply_change() redraws, bar and its text
+
+// === Watering Configuration ===
+#define WATER_DURATION_MAX 99 // Seconds per spray, two panel digits
+
 // === Pin Mapping ===
 #define LIGHT_RELAY 23
 #define WATER_RELAY 22
@@ -36,31 +61,37 @@ extern "C" {
 
 void io_init();
 uint8_t io_pin_map(uint16_t address);
-void io_pin_trigger(
+void io_schedule_init(void);
+void io_schedule_update(uint16_t address);
+void io_pin_reconcile(
     uint8_t enable, uint8_t current_state,
-    uint8_t on_hr, uint8_t on_min,
-    uint8_t off_hr, uint8_t off_min,
-    uint16_t current_hr, uint16_t current_min,
-    uint16_t grace_min, bool on_boot,
+    const io_schedule_t *schedule,
+    const time_snapshot_t *now, io_reconcile_t *rec,
     uint16_t address, const char *relay_str
 );
 void io_pin_trigger_interval(
     uint8_t enable, uint8_t current_state,
-    uint8_t on_hr, uint8_t on_min,
-    uint8_t off_hr, uint8_t off_min,
-    uint16_t current_hr, uint16_t current_min,
-    uint16_t current_sec, uint16_t interval_hr,
+    const io_schedule_t *schedule,
+    const time_snapshot_t *now, uint16_t interval_hr,
     uint16_t duration_sec, uint16_t address, 
     const char *relay_str, uint32_t *last_spray
 );
+void io_automation_run(const time_snapshot_t *now);
 
 void ntp_client_init(void);
-void ntp_client_update(bool force = false);
-bool is_valid_time(int hours, int minutes, int seconds);
-void vp_growth_bar_update(void);
+void wifi_on_link_change(wifi_link_state_t state, wifi_link_state_t prev);
+bool vp_growth_bar_update(void);
+void growth_init(void);
+void growth_anchor(const time_snapshot_t *now);
+void growth_update(const time_snapshot_t *now);
 
 void hmi_init(void);
+void hmi_send_item(size_t index);
+void hmi_rtc_request(void);
+bool hmi_rtc_parse(const char *response, uint32_t *epoch);
+void hmi_rtc_write(void);
 void hmi_on_event(String address, int data, String message, String response);
+size_t vp_apply_change(uint16_t vp_addr, uint16_t *derived);
 
 // === OTA Functions ===
 void ota_init();
@@ -5,16 +5,31 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/semphr.h>
+#include <freertos/event_groups.h>
 
 // Task priorities
 #define TASK_PRIORITY_HMI 3
 #define TASK_PRIORITY_WIFI 2
 #define TASK_PRIORITY_SYNC 1
+#define TASK_PRIORITY_LOG 0 // Console output, runs when nothing else does
+#define TASK_PRIORITY_SUPERVISOR 4 // Above the tasks it watches
+
+// Loop periods and deadlines for the supervisor, see supervisor.h
+#define TASK_PERIOD_HMI_MS 1
+#define TASK_DEADLINE_HMI_MS 5000 // Beats per item sent, a full refresh too
+#define TASK_PERIOD_WIFI_MS 500 // WIFI_LOOP_MS, shorter while busy
+#define TASK_DEADLINE_WIFI_MS 5000 // Connects are polled, an MQTT CONNACK waits 2 s
+#define TASK_PERIOD_SYNC_MS 50
+#define TASK_DEADLINE_SYNC_MS 5000
+#define TASK_PERIOD_LOG_MS 20 // LOG_DRAIN_MS
+#define TASK_DEADLINE_LOG_MS 5000 // Priority 0, starved this long or stuck on flash
 
 // Task handles
 extern TaskHandle_t xHMITaskHandle;
 extern TaskHandle_t xWiFiTaskHandle;
 extern TaskHandle_t xSyncTaskHandle;
+extern TaskHandle_t xLogTaskHandle;
+extern TaskHandle_t xSupervisorTaskHandle;
 
 // Mutex for shared resources
 extern SemaphoreHandle_t xVPMutex;
@@ -22,9 +37,15 @@ extern SemaphoreHandle_t xVPMutex;
 // Queue for inter-task communication
 extern QueueHandle_t xHMIUpdateQueue;
 
+// Network readiness, set while the STA link has an IP
+extern EventGroupHandle_t eventGroup;
+#define WIFI_CONNECTED_BIT BIT0
+
 // Task functions
 void TaskHMI(void *pvParameters);
 void TaskWiFi(void *pvParameters);
 void TaskSync(void *pvParameters);
+void TaskLog(void *pvParameters);
+void TaskSupervisor(void *pvParameters);
 
 #endif // ESP_TASK_H
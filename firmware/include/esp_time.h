@@ -0,0 +1,82 @@
+#ifndef ESP_TIME_H
+#define ESP_TIME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// === Clock Configuration ===
+#define TIME_LOCAL_OFFSET 19800 // UTC+5:30, applied to local fields
+#define TIME_MIN_VALID_EPOCH 1704067200UL // 2024-01-01, sanity floor
+#define TIME_JUMP_LOG_SEC 2 // Resync steps at or above this are logged
+
+// === Clock Discipline Configuration ===
+#define TIME_STEP_US 128000 // Larger offsets step, smaller ones slew
+#define TIME_SLEW_PPM 500 // Max slew rate, 0.5 ms per second
+#define TIME_FREQ_MAX_PPB 500000 // Frequency correction limit, 500 ppm
+#define TIME_DRIFT_MIN_SAMPLE_US (60LL * 1000000) // Min spacing for a drift sample
+#define TIME_DRIFT_LOCK_PPB 5000 // Samples within 5 ppm count as stable (3 ms over 10 min)
+#define TIME_DRIFT_LOCK_SAMPLES 3 // Stable samples before drift is characterised
+
+// === Clock Snapshot ===
+// All fields are derived from one monotonic reading, so they can never
+// straddle a second or minute boundary.
+typedef struct {
+  bool valid;           // False until a time source has synced
+  uint32_t epoch;       // UTC seconds since 1970
+  int64_t mono_us;      // Monotonic timestamp of this snapshot
+  uint16_t year;
+  uint8_t month;        // 1-12
+  uint8_t day;          // 1-31
+  uint16_t yday;        // Day of year, 0-365
+  uint8_t hours;        // Local time fields
+  uint8_t minutes;
+  uint8_t seconds;
+  uint16_t minute_of_day;
+  uint32_t local_day;   // Local days since 1970, increments at midnight
+} time_snapshot_t;
+
+// === Time Sources ===
+// Ordered by quality, a source never overrides a better one.
+typedef enum {
+  TIME_SOURCE_NONE,
+  TIME_SOURCE_RTC,      // DWIN panel RTC, whole seconds, works offline
+  TIME_SOURCE_NTP
+} time_source_t;
+
+// === Discipline Metrics ===
+typedef struct {
+  int32_t freq_ppb;        // Learned frequency correction
+  int64_t offset_us;       // Residual offset at the last sample
+  int64_t slew_pending_us; // Correction still being slewed in
+  uint32_t samples;        // Drift samples taken
+  bool locked;             // Drift characterised, sync may back off
+} time_discipline_stats_t;
+
+// === Function Prototypes ===
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void time_set_epoch(uint32_t epoch);
+bool time_set_epoch_us(int64_t epoch_us);
+bool time_source_offer(time_source_t source, int64_t epoch_us);
+time_source_t time_source_get(void);
+const char *time_source_name(time_source_t source);
+uint32_t time_epoch_from_local(
+    uint16_t year, uint8_t month, uint8_t day,
+    uint8_t hours, uint8_t minutes, uint8_t seconds
+);
+bool time_adjust_us(int64_t offset_us);
+int64_t time_epoch_us(void);
+bool time_discipline(int64_t offset_us);
+void time_discipline_stats(time_discipline_stats_t *stats);
+bool time_drift_locked(void);
+bool time_now(time_snapshot_t *snap);
+bool time_is_valid(void);
+uint32_t time_jump_count_get(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ESP_TIME_H
@@ -5,6 +5,12 @@
 #include "vp_dwin.h"
 #include "esp_task.h"
 #include "esp_node.h"
+#include "metrics.h"
+#include "trace.h"
+#include "log_ring.h"
+#include "journal.h"
+#include "supervisor.h"
+#include "bench.h"
 
 // === Device Configuration ===
 #define UI_VERSION "v1.0.8"
@@ -12,18 +18,52 @@
 #define HW_VERSION "v1.0.0"
 
 // === Debugging Macros ===
+// Lines are queued in the log ring and written to Serial by TaskLog, a
+// call never waits on the UART. LOG_LEVEL in log_ring.h strips levels.
+#ifndef DEBUG_ENABLED
 #define DEBUG_ENABLED 1 // Set 0 for production
+#endif
+
+#if DEBUG_ENABLED
+  #define debug_flush()     log_ring_flush()
+#else
+  #define debug_flush()
+#endif
+
+// A binary build queues the format and raw arguments, see log_ring.h
+#if LOG_BINARY
+  #define debug_log(...) \
+    do { if (0) log_format_check(__VA_ARGS__); log_ring_record(__VA_ARGS__); } while (0)
+#else
+  #define debug_log(...) log_ring_write(__VA_ARGS__)
+#endif
+
+#if DEBUG_ENABLED && LOG_LEVEL >= LOG_LEVEL_ERROR
+  #define debug_errorf(...) debug_log(__VA_ARGS__)
+#else
+  #define debug_errorf(...) ((void)0)
+#endif
+
+#if DEBUG_ENABLED && LOG_LEVEL >= LOG_LEVEL_WARN
+  #define debug_warnf(...) debug_log(__VA_ARGS__)
+#else
+  #define debug_warnf(...) ((void)0)
+#endif
+
+#if DEBUG_ENABLED && LOG_LEVEL >= LOG_LEVEL_INFO
+  #define debug_print(x)    debug_log("%s", x)
+  #define debug_println(x)  debug_log("%s\n", x)
+  #define debug_printf(...) debug_log(__VA_ARGS__)
+#else
+  #define debug_print(x)    ((void)0)
+  #define debug_println(x)  ((void)0)
+  #define debug_printf(...) ((void)0)
+#endif
 
-#ifdef DEBUG_ENABLED
-  #define debug_begin(baud) Serial.begin(baud)
-  #define debug_print(x)    Serial.print(x)
-  #define debug_println(x)  Serial.println(x)
-  #define debug_printf(...) Serial.printf(__VA_ARGS__)
+#if DEBUG_ENABLED && LOG_LEVEL >= LOG_LEVEL_VERBOSE
+  #define debug_verbosef(...) debug_log(__VA_ARGS__)
 #else
-  #define debug_begin(baud)
-  #define debug_print(x)
-  #define debug_println(x)
-  #define debug_printf(...)
+  #define debug_verbosef(...) ((void)0)
 #endif
 
 #endif // GLOBAL_COMMON_H
@@ -0,0 +1,62 @@
+#ifndef IO_SCHEDULE_H
+#define IO_SCHEDULE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// === Day Bitmap Configuration ===
+#define SCHED_MINUTES_IN_DAY 1440
+#define SCHED_WORD_BITS 32
+#define SCHED_WORDS (SCHED_MINUTES_IN_DAY / SCHED_WORD_BITS) // 45 words
+#define SCHED_NO_EDGE UINT16_MAX
+#define SCHED_REPLAY_MAX_SEC (24UL * 60 * 60) // Longer gaps resync only
+
+// === Compiled Daily Schedule ===
+// One bit per minute of the day, MSB first: minute m lives in word
+// m / 32 at bit (31 - m % 32), so the next set bit is a clz away.
+typedef struct {
+  uint32_t bits[SCHED_WORDS];
+  bool empty; // ON == OFF, schedule has no edges
+} io_schedule_t;
+
+// === Catch-up Reconciler ===
+typedef struct {
+  uint32_t last_epoch; // Local epoch of the last evaluation, 0 = never
+} io_reconcile_t;
+
+typedef enum {
+  SCHED_RECONCILE_NONE,     // No edge since the last evaluation
+  SCHED_RECONCILE_REPLAYED, // Missed edges replayed in order
+  SCHED_RECONCILE_RESYNC    // Boot, clock step back or gap > 1 day
+} io_reconcile_result_t;
+
+// Called per replayed edge, `minute` counts local minutes since 1970
+typedef void (*io_schedule_edge_cb)(uint32_t minute, bool rising, void *ctx);
+
+// === Function Prototypes ===
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void io_schedule_compile(
+    io_schedule_t *schedule,
+    uint8_t on_hr, uint8_t on_min,
+    uint8_t off_hr, uint8_t off_min
+);
+bool io_schedule_active(const io_schedule_t *schedule, uint16_t minute);
+bool io_schedule_is_empty(const io_schedule_t *schedule);
+uint16_t io_schedule_next_edge(
+    const io_schedule_t *schedule, uint16_t minute, bool rising);
+uint16_t io_schedule_since_edge(
+    const io_schedule_t *schedule, uint16_t minute, bool rising);
+io_reconcile_result_t io_schedule_reconcile(
+    const io_schedule_t *schedule, io_reconcile_t *rec,
+    uint32_t local_epoch, uint8_t *state,
+    io_schedule_edge_cb on_edge, void *ctx
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IO_SCHEDULE_H
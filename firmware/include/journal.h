@@ -0,0 +1,78 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "metrics.h"
+
+// === Journal Configuration ===
+// Append-only event log in its own data partition, see partitions.csv.
+// Records are written oldest sector first; when the last sector is full
+// the oldest one is erased, so every sector takes the same wear.
+#define JOURNAL_LABEL "journal"
+#define JOURNAL_SUBTYPE 0x40 // Custom data subtype
+#define JOURNAL_QUEUE_LEN 16 // Records waiting for TaskLog
+#define JOURNAL_DETAIL_MAX 10 // Detail text, not terminated when full
+#define JOURNAL_LINE_MAX 96 // One dump line
+#define JOURNAL_CONSOLE_PAGE 16 // Serial dump records per TaskLog loop, ~140 ms of UART
+#define JOURNAL_HEADER "# seq boot uptime_ms epoch type event value detail\n"
+
+// === Record Types ===
+typedef enum {
+  JOURNAL_BOOT = 1, // code: esp_reset_reason_t, detail: FW version
+  JOURNAL_RELAY,    // code: level, value: pin, detail: relay
+  JOURNAL_WIFI,     // code: wifi_link_state_t, value: previous state
+  JOURNAL_OTA,      // code: journal_ota_t, value: ota_error_t, detail: target
+  JOURNAL_WATCHDOG  // value: ms since the task's last beat, detail: task
+} journal_type_t;
+
+typedef enum {
+  JOURNAL_OTA_START,
+  JOURNAL_OTA_DONE,
+  JOURNAL_OTA_FAILED
+} journal_ota_t;
+
+// One flash slot, erased slots read as all 0xFF
+typedef struct __attribute__((packed)) {
+  uint32_t seq;        // Increments across reboots
+  uint32_t uptime_ms;  // Since this boot
+  uint32_t epoch;      // UTC seconds, 0 while time is invalid
+  uint16_t boot;       // Boot count
+  uint8_t type;        // journal_type_t
+  uint8_t code;
+  int32_t value;
+  char detail[JOURNAL_DETAIL_MAX];
+  uint16_t crc;        // CRC-16/CCITT of the bytes above
+} journal_record_t;
+
+static_assert(sizeof(journal_record_t) == 32, "journal_record_t must stay 32 bytes");
+
+// Exposed by GET /metrics on the VP API port
+extern metric_counter_t metric_journal_records; // Written to flash
+extern metric_counter_t metric_journal_dropped; // Queue full or flash error
+
+// Output sink for dumped lines, `len` bytes without a terminator
+typedef void (*journal_sink_t)(const char *text, size_t len, void *ctx);
+
+// === Function Prototypes ===
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool journal_begin(void);
+bool journal_log(journal_type_t type, uint8_t code, int32_t value, const char *detail);
+void journal_relay(uint8_t pin, uint8_t level);
+size_t journal_flush(void);
+uint32_t journal_write(journal_sink_t sink, void *ctx, uint32_t since);
+uint32_t journal_write_records(journal_sink_t sink, void *ctx, uint32_t *since, uint32_t max);
+uint32_t journal_last_seq(void);
+uint32_t journal_dump(uint32_t since);
+void journal_console_poll(void);
+uint16_t journal_boot_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JOURNAL_H
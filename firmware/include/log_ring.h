@@ -0,0 +1,140 @@
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "metrics.h"
+
+// === Log Levels ===
+// Compile-time filter, debug_*() calls above LOG_LEVEL are removed
+// together with their arguments
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3 // debug_printf()
+#define LOG_LEVEL_VERBOSE 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// === Log Ring Configuration ===
+#define LOG_SLOTS 32 // Lines buffered, a power of two
+#define LOG_LINE_MAX 128 // Longer lines are cut, newline kept
+#define LOG_DRAIN_MS 20 // TaskLog poll period
+#define LOG_TASK_STACK 2048
+
+// === Binary Records ===
+// With LOG_BINARY set, debug_*() skip printf: the slot gets the format
+// string's offset from log_ring_anchor and the raw arguments, and the
+// console carries records that scripts/log_decode.py turns back into
+// text with the firmware ELF. Other console bytes pass through as text.
+//
+//   LOG_BIN_MARK, length, int32 format offset, arguments
+//
+// Each argument is a tag byte and its value, little endian. Strings are
+// copied, cut to what fits in the slot.
+#ifndef LOG_BINARY
+#define LOG_BINARY 0 // Set 1 for production builds
+#endif
+
+#define LOG_BIN_MARK 0x1E // Record separator, not in log text
+#define LOG_ARG_U32 'I'   // Integer up to 32 bits, sign from the format
+#define LOG_ARG_U64 'Q'   // 64-bit integer
+#define LOG_ARG_F64 'D'   // float or double
+#define LOG_ARG_STR 'S'   // Length byte and characters
+
+// Exposed by GET /metrics on the VP API port
+extern metric_counter_t metric_log_lines;    // Lines queued
+extern metric_counter_t metric_log_dropped;  // Lines lost to a full ring
+
+// Output sink for drained lines, `len` bytes without a terminator
+typedef void (*log_sink_t)(const char *text, size_t len, void *ctx);
+
+// A claimed slot being filled
+typedef struct {
+  char *data;
+  uint16_t len;
+  uint32_t pos;
+} log_record_t;
+
+// === Function Prototypes ===
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern const char log_ring_anchor[]; // Format offsets are relative to this
+
+void log_ring_write(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+size_t log_ring_drain(log_sink_t sink, void *ctx);
+size_t log_ring_flush(void);
+
+bool log_ring_claim(log_record_t *rec);
+void log_ring_publish(log_record_t *rec);
+void log_record_format(log_record_t *rec, const char *fmt);
+void log_record_u32(log_record_t *rec, uint32_t value);
+void log_record_u64(log_record_t *rec, uint64_t value);
+void log_record_f64(log_record_t *rec, double value);
+void log_record_str(log_record_t *rec, const char *value);
+
+// Never called, lets the compiler check formats of binary call sites
+static inline void log_format_check(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+static inline void log_format_check(const char *fmt, ...) {
+    (void)fmt;
+}
+
+#ifdef __cplusplus
+}
+
+// === Binary Call Sites ===
+// Argument encoders picked by type at compile time
+#include <type_traits>
+
+template <typename T>
+static inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+log_record_arg(log_record_t *rec, T value) {
+    if (sizeof(T) > sizeof(uint32_t)) {
+        log_record_u64(rec, (uint64_t)value);
+    } else {
+        log_record_u32(rec, (uint32_t)value);
+    }
+}
+
+template <typename T>
+static inline typename std::enable_if<std::is_floating_point<T>::value>::type
+log_record_arg(log_record_t *rec, T value) {
+    log_record_f64(rec, (double)value);
+}
+
+template <typename T>
+static inline void log_record_arg(log_record_t *rec, T *value) {
+    log_record_u64(rec, (uint64_t)(uintptr_t)value); // %p
+}
+
+static inline void log_record_arg(log_record_t *rec, const char *value) {
+    log_record_str(rec, value);
+}
+
+static inline void log_record_arg(log_record_t *rec, char *value) {
+    log_record_str(rec, value);
+}
+
+/**
+ * @brief Queues `fmt` and its arguments without formatting them.
+ * @note `fmt` must be a string literal, the decoder reads it from the ELF.
+ */
+template <typename... Args>
+static inline void log_ring_record(const char *fmt, Args... args) {
+    log_record_t rec;
+    if (!log_ring_claim(&rec)) {
+        return;
+    }
+    log_record_format(&rec, fmt);
+    int unpack[] = { 0, (log_record_arg(&rec, args), 0)... };
+    (void)unpack;
+    log_ring_publish(&rec);
+}
+#endif
+
+#endif // LOG_RING_H
@@ -0,0 +1,77 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// === Metrics Configuration ===
+#define METRICS_PREFIX "grow_" // Prepended to every metric name
+#define METRICS_TASKS_MAX 5 // Tasks with a stack gauge
+#define METRICS_BUCKETS_MAX 10 // Histogram bounds, +Inf is extra
+#define METRICS_LINE_MAX 160 // One exposition line
+
+// === Metric Types ===
+// Updated with relaxed atomics, so any task or core may bump them
+// without a lock. Histogram buckets are not cumulative in RAM, the
+// exposition adds them up.
+typedef struct {
+  uint32_t value;
+} metric_counter_t;
+
+typedef struct {
+  int32_t value;
+} metric_gauge_t;
+
+typedef struct {
+  const uint32_t *bounds;  // Upper bounds, ascending
+  uint8_t num_bounds;
+  uint32_t buckets[METRICS_BUCKETS_MAX + 1]; // Last one is +Inf
+  uint32_t sum;            // Wraps, read as a counter
+} metric_histogram_t;
+
+#define METRIC_HISTOGRAM(bounds) { bounds, sizeof(bounds) / sizeof(bounds[0]), { 0 }, 0 }
+
+// === Firmware Metrics ===
+// Exposed by GET /metrics on the VP API port
+extern metric_counter_t metric_hmi_frames_tx;  // Frames written to the panel
+extern metric_counter_t metric_hmi_frames_rx;  // Frames the panel sent
+extern metric_counter_t metric_hmi_updates;    // xHMIUpdateQueue items handled
+extern metric_counter_t metric_nvs_writes;     // Preferences puts
+extern metric_counter_t metric_sched_evals;    // io_automation_run() passes
+extern metric_gauge_t metric_sched_last_us;    // Duration of the last pass
+extern metric_histogram_t metric_vp_mutex_wait; // Microseconds in vp_lock()
+
+// Output sink for the exposition text, `len` bytes without a terminator
+typedef void (*metrics_sink_t)(const char *text, size_t len, void *ctx);
+
+// === Function Prototypes ===
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline void metric_inc(metric_counter_t *m) {
+    __atomic_fetch_add(&m->value, 1, __ATOMIC_RELAXED);
+}
+
+static inline void metric_add(metric_counter_t *m, uint32_t n) {
+    __atomic_fetch_add(&m->value, n, __ATOMIC_RELAXED);
+}
+
+static inline void metric_set(metric_gauge_t *m, int32_t value) {
+    __atomic_store_n(&m->value, value, __ATOMIC_RELAXED);
+}
+
+void metric_observe(metric_histogram_t *h, uint32_t value);
+uint32_t metric_count(const metric_histogram_t *h);
+void metrics_register_task(const char *name, TaskHandle_t handle);
+void metrics_write(metrics_sink_t sink, void *ctx);
+uint32_t metrics_write_lines(metrics_sink_t sink, void *ctx, uint32_t first, uint32_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // METRICS_H
@@ -0,0 +1,59 @@
+#ifndef MQTT_BRIDGE_H
+#define MQTT_BRIDGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// === MQTT Bridge Configuration ===
+#define MQTT_BROKER "mqtt.local"
+#define MQTT_BROKER_PORT 1883
+#define MQTT_TOPIC_ROOT "grow" // Topics are grow/<hostname>/...
+#define MQTT_PUBLISH_MS 5000 // Delta batch cadence, online or not
+#define MQTT_RETRY_MS 15000 // Between connect attempts
+#define MQTT_CONNECT_TIMEOUT_MS 5000 // Broker lookup plus TCP handshake, polled
+#define MQTT_TIMEOUT_S 2 // Socket timeout, bounds the CONNACK wait
+#define MQTT_POLL_MS 10 // TaskWiFi period while a backlog is sent
+#define MQTT_SEND_PER_POLL 16 // Backlog messages published per poll
+#define MQTT_MSG_MAX 512 // Payload bytes, larger batches are split
+#define MQTT_RING_BYTES 2048 // RAM backlog, 2-byte length per message
+#define MQTT_SPILL_BYTES 1024 // One flash segment
+#define MQTT_SPILL_SEGMENTS 4 // Flash backlog, the oldest is dropped past it
+#define MQTT_SPILL_KEY "mq_spill" // NVS key, (first slot << 8) | count
+#define MQTT_SPILL_SLOT_KEY "mq_s%u" // NVS key of a segment
+
+// === Topics ===
+// delta   {"seq":12,"t":1718000000,"d":{"1100":1,"1000":"06:30"}}
+//         "full":true when every VP is included, after boot or a loss
+// status  "online", retained, "offline" as the will
+// cmd     {"1120":6,"1130":30}, all or nothing as PUT /vp
+// ack     {"changed":n} or {"error":"..."} per command
+
+typedef struct {
+  uint32_t batches;     // Delta messages built
+  uint32_t published;   // Messages the broker accepted
+  uint32_t spilled;     // Messages moved to flash
+  uint32_t dropped;     // Messages lost past the flash backlog
+  uint32_t commands;    // Commands applied
+  uint32_t rejected;    // Commands refused
+  uint32_t ring_used;   // Bytes
+  uint32_t ring_peak;
+  uint8_t spill_count;  // Segments in flash
+  bool connected;
+} mqtt_stats_t;
+
+// === Function Prototypes ===
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void mqtt_bridge_begin(void);
+void mqtt_bridge_poll(uint32_t now_ms, bool link_up);
+bool mqtt_bridge_busy(void);
+void mqtt_bridge_stats(mqtt_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MQTT_BRIDGE_H
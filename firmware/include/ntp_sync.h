@@ -0,0 +1,55 @@
+#ifndef NTP_SYNC_H
+#define NTP_SYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// === SNTP Configuration ===
+#define NTP_PORT 123
+#define NTP_LOCAL_PORT 2390
+#define NTP_PACKET_SIZE 48
+#define NTP_UNIX_OFFSET 2208988800UL // Seconds from 1900 to 1970
+#define NTP_MAX_SERVERS 3
+#define NTP_REPLY_TIMEOUT_MS 1500 // Per request, then next server
+#define NTP_DNS_TIMEOUT_MS 3000 // Per name lookup, then next server
+#define NTP_POLL_MS 10 // Poll period while a lookup or request is in flight
+#define NTP_RETRY_MIN_MS 2000 // Backoff after a failed round
+#define NTP_RETRY_MAX_MS 60000
+#define NTP_INTERVAL_MAX_SHIFT 3 // Up to 8x the base interval once drift is known
+
+// === Sync Result ===
+typedef struct {
+  bool ok;              // False if every server failed this round
+  uint8_t server;       // Index of the server that won the round
+  uint8_t replies;      // Valid replies this round
+  bool stepped;         // Clock was stepped instead of slewed
+  int64_t offset_us;    // Measured offset of the winning reply
+  int64_t applied_us;   // Correction stepped or handed to the slew
+  uint32_t delay_us;    // Round-trip delay of the winning reply
+} ntp_sync_result_t;
+
+// Called from ntp_sync_poll() once per completed round
+typedef void (*ntp_sync_cb)(const ntp_sync_result_t *result);
+
+// === Function Prototypes ===
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void ntp_sync_begin(
+    const char *const *servers, uint8_t count,
+    uint32_t interval_ms, ntp_sync_cb on_complete
+);
+void ntp_sync_stop(void);
+void ntp_sync_request(void);
+void ntp_sync_poll(void);
+bool ntp_sync_busy(void);
+int64_t ntp_sync_offset_us(void);
+uint32_t ntp_sync_count_get(void);
+uint32_t ntp_sync_interval_get(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NTP_SYNC_H
@@ -0,0 +1,54 @@
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "metrics.h"
+
+// === Supervisor Configuration ===
+// Tasks declare a loop period and a deadline, then beat once per loop.
+// TaskSupervisor feeds the task watchdog only while every task beat
+// within its deadline; after a miss it logs the task and lets the
+// watchdog reset the chip.
+#define SUPERVISOR_TASKS_MAX 5
+#define SUPERVISOR_PERIOD_MS 500 // Deadline check and watchdog feed
+#define SUPERVISOR_WDT_S 5 // Watchdog timeout, reset this long after a miss
+#define SUPERVISOR_TASK_STACK 2048
+
+// === Supervised Task ===
+// Written by the task's own beats, read by the supervisor and /metrics
+typedef struct {
+  const char *name;
+  uint32_t period_ms;            // Expected loop period
+  uint32_t deadline_ms;          // Longest gap between beats
+  uint32_t last_ms;              // millis() of the last beat
+  uint32_t max_ms;               // Longest gap seen
+  metric_histogram_t jitter_ms;  // Gap past the period, per beat
+  metric_counter_t missed;       // Deadlines missed
+} supervisor_task_t;
+
+// Ids of the firmware tasks, -1 until the task registered
+extern int supervisor_hmi_id;
+extern int supervisor_wifi_id;
+extern int supervisor_sync_id;
+extern int supervisor_log_id;
+
+// === Function Prototypes ===
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int supervisor_register(const char *name, uint32_t period_ms, uint32_t deadline_ms);
+void supervisor_beat(int id);
+bool supervisor_check(uint32_t now_ms);
+bool supervisor_tripped(void);
+const supervisor_task_t *supervisor_tasks(size_t *count);
+void supervisor_begin(void);
+void supervisor_poll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SUPERVISOR_H
@@ -0,0 +1,49 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "metrics.h"
+
+// === Touch Trace Configuration ===
+#define TRACE_ENABLED 1 // Set 0 to compile the stamps out
+#define TRACE_SLOTS 8 // Touches in flight at once, older ones are dropped
+#define TRACE_PRINT_MS 60000 // Serial summary period, only after new touches
+
+// === Stages ===
+// A panel touch on a relay switch, in the order TaskHMI handles it. Each
+// stage histogram holds the time since the stage before, TRACE_RX holds
+// the whole path. The UART and DWIN library parsing before hmi_on_event()
+// are not covered, hmi.listen() runs every 10 ms.
+typedef enum {
+  TRACE_RX,        // hmi_on_event() called for a VP
+  TRACE_SYNCED,    // vp_sync_item() returned, NVS written
+  TRACE_QUEUED,    // vp_apply_change() done, echo queued for TaskHMI
+  TRACE_DEQUEUED,  // TaskHMI took it from xHMIUpdateQueue
+  TRACE_SENT,      // hmi.setVP() wrote the frame
+  TRACE_RELAY,     // digitalWrite() done
+  TRACE_NUM_STAGES
+} trace_stage_t;
+
+#define TRACE_NONE 0 // Untraced queue item
+
+// Microseconds per stage, TRACE_RX is RX to relay
+extern metric_histogram_t trace_stage_us[TRACE_NUM_STAGES];
+
+// === Function Prototypes ===
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint16_t trace_begin(void);
+void trace_mark(uint16_t id, trace_stage_t stage);
+const char *trace_stage_name(trace_stage_t stage);
+uint32_t trace_stage_max_us(trace_stage_t stage);
+void trace_print(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRACE_H
@@ -11,6 +11,10 @@
 #define NVS_NAMESPACE "vp-flash"
 #endif
 
+#ifndef VP_LOCK_BUDGET_US
+#define VP_LOCK_BUDGET_US 1000 // Longest xVPMutex hold before it is flagged
+#endif
+
 // === VP VALUE TYPES ===
 typedef enum {
   VP_UINT8,
@@ -143,6 +147,11 @@ typedef struct {
 #define VP_HOLDER_FW_VER      0x1550
 #define VP_HOLDER_HW_VER      0x1560
 
+// === PANEL SYSTEM REGISTERS (not in vp_items) ===
+#define VP_RTC                0x0010 // Read: YY MM DD WW HH MM SS 00, local time
+#define VP_RTC_WORDS          4
+#define VP_RTC_SET            0x009C // Write: 5A A5 YY MM DD HH MM SS
+
 // === VP ITEM TABLE ===
 static const vp_item_t vp_items[] = {
   VP_ITEM_STRING(VP_TIME, time_str),
@@ -198,19 +207,51 @@ static const vp_item_t vp_items[] = {
 // === COUNT ===
 static const size_t num_vp_items = sizeof(vp_items) / sizeof(vp_item_t);
 
+// === JSON ===
+// "XXXX": plus the longest VP string with every character escaped
+#define VP_JSON_ITEM_MAX 200
+
 // === HMI update types ===
 typedef enum {
   HMI_UPDATE_VALUE,
   HMI_UPDATE_STRING,
-  HMI_UPDATE_ALL
+  HMI_UPDATE_ALL,
+  HMI_UPDATE_RTC
 } hmi_update_type_t;
 
 // === HMI update structure ===
 typedef struct {
   hmi_update_type_t type;
   uint16_t address;
+  uint16_t trace_id;  // Touch trace, TRACE_NONE for most updates
 } hmi_update_item_t;
 
+// === VP LOCK CALL SITES ===
+// Every vp_lock() call site owns a static record, linked into the list
+// from vp_lock_sites() the first time it takes the mutex. It is only
+// written with xVPMutex held.
+typedef struct vp_lock_site {
+  const char *file;
+  const char *func;
+  uint16_t line;
+  bool linked;
+  uint32_t holds;
+  uint32_t wait_us;       // Totals, wrap like counters
+  uint32_t hold_us;
+  uint32_t wait_max_us;
+  uint32_t hold_max_us;
+  uint32_t over_budget;   // Holds longer than VP_LOCK_BUDGET_US
+  struct vp_lock_site *next;
+} vp_lock_site_t;
+
+// Takes xVPMutex, true once held. Pair with vp_unlock().
+#define vp_lock() __extension__ ({ \
+    static vp_lock_site_t vp_lock_site_ = { \
+      .file = __FILE__, .func = __func__, .line = __LINE__ \
+    }; \
+    vp_lock_at(&vp_lock_site_); \
+  })
+
 // === FUNCTION PROTOTYPES ===
 #ifdef __cplusplus
 extern "C" {
@@ -223,13 +264,34 @@ bool vp_set_value(uint16_t address, uint8_t value);
 const char* vp_get_string(uint16_t address);
 bool vp_set_string(uint16_t address, const char* value);
 bool vp_sync_item(uint16_t address, const void* new_value);
+void vp_save_items(const uint16_t* addresses, size_t count);
+uint32_t vp_load_u32(const char* key, uint32_t fallback);
+void vp_save_u32(const char* key, uint32_t value);
+bool vp_load_blob(const char* key, void* buf, size_t len);
+void vp_save_blob(const char* key, const void* buf, size_t len);
+bool vp_lock_at(vp_lock_site_t* site);
+void vp_unlock(void);
+vp_lock_site_t* vp_lock_sites(void);
+uint32_t vp_lock_overruns(void);
+
+size_t vp_json_item(const vp_item_t* item, const vp_values_t* values, char* out);
+void vp_mark_changed(uint16_t address);
+uint32_t vp_change_seq(void);
+uint32_t vp_item_seq(size_t index);
 
 void hmi_update_value(uint16_t address);
+void hmi_update_traced(uint16_t address, uint16_t trace_id);
 void hmi_update_string(uint16_t address);
+void hmi_update_item(uint16_t address);
 void hmi_update_all();
+void hmi_update_all_taken();
+bool hmi_update_all_deferred();
+void hmi_update_rtc();
 
 #ifdef __cplusplus
 }
+
+String hmi_pad_string(const char* str, size_t maxlen);
 #endif
 
 #endif // VP_DWIN_CONFIG_H
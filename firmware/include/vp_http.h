@@ -0,0 +1,51 @@
+#ifndef VP_HTTP_H
+#define VP_HTTP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// === HTTP API Configuration ===
+#define VP_HTTP_PORT 8080 // Port 80 belongs to the provisioning portal
+#define VP_HTTP_REQ_MAX 1024 // Request line, headers and body
+#define VP_HTTP_TX_CHUNK 512 // Responses are streamed through this buffer
+#define VP_HTTP_TIMEOUT_MS 2000 // Drop a client that stalls mid-request
+#define VP_HTTP_POLL_MS 10 // TaskWiFi period while a request is open
+#define VP_HTTP_PER_POLL 4 // Queued connections served per poll
+#define VP_HTTP_HMI_ALL_MIN 8 // Changed VPs that queue one full HMI refresh
+#define VP_HTTP_JOURNAL_PAGE 64 // Records per GET /journal, about 5 KB
+
+// === Endpoints ===
+// GET /vp          {"1000":"06:30","1020":3,...}, all readable VPs
+// GET /vp/{addr}   {"1100":1}, addr in hex as the NVS keys
+// PUT /vp/{addr}   body 1 or "text"
+// PUT /vp          body {"1120":6,"1130":30}, all or nothing
+// GET /metrics     Prometheus text, see metrics.h
+// GET /journal     Event journal as text, ?since=<seq> for newer records,
+//                  VP_HTTP_JOURNAL_PAGE at a time
+// PUT replies {"changed":n}, errors {"error":"..."} with 4xx.
+
+typedef struct {
+  uint32_t requests;
+  uint32_t errors;     // 4xx replies
+  uint32_t commits;    // PUTs that changed a VP
+  uint32_t bytes_out;
+} vp_http_stats_t;
+
+// === Function Prototypes ===
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void vp_http_begin(void);
+void vp_http_poll(void);
+bool vp_http_busy(void);
+void vp_http_stats(vp_http_stats_t *stats);
+int vp_http_apply_json(const char *json, size_t len, size_t *changed);
+const char *vp_http_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VP_HTTP_H
@@ -0,0 +1,50 @@
+#ifndef VP_WS_H
+#define VP_WS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// === WebSocket Stream Configuration ===
+#define VP_WS_PORT 8081 // Next to the VP API
+#define VP_WS_PATH "/vp"
+#define VP_WS_MAX_CLIENTS 4
+#define VP_WS_TX_MAX 512 // Per client, one frame in flight
+#define VP_WS_RX_MAX 132 // Per client, a control frame with its mask
+#define VP_WS_LINE_MAX 96 // Handshake header line, longer ones are skipped
+#define VP_WS_TIMEOUT_MS 2000 // Drop a client that stalls in the handshake
+#define VP_WS_POLL_MS 50 // TaskWiFi period while a client is open
+
+// === Stream ===
+// ws://<host>:8081/vp, text frames of VP members as the API formats them
+//   {"1000":"06:30","1020":3,...}   every readable VP on open
+//   {"1120":9,"1310":1}             VPs changed since the last frame
+// A client that reads slowly gets one frame at a time with the latest
+// values, never a backlog. Client data frames are ignored.
+
+typedef struct {
+  uint32_t accepted;
+  uint32_t rejected;   // Past VP_WS_MAX_CLIENTS or a bad handshake
+  uint32_t dropped;    // Timeouts and protocol errors
+  uint32_t frames;
+  uint32_t items;      // VP members sent
+  uint32_t coalesced;  // Changes superseded before they were sent
+  uint32_t bytes_out;
+  uint8_t open;        // Clients streaming now
+} vp_ws_stats_t;
+
+// === Function Prototypes ===
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void vp_ws_begin(void);
+void vp_ws_poll(uint32_t now_ms);
+bool vp_ws_busy(void);
+void vp_ws_stats(vp_ws_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VP_WS_H
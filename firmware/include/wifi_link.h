@@ -0,0 +1,80 @@
+#ifndef WIFI_LINK_H
+#define WIFI_LINK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// === WiFi Link Configuration ===
+#define WIFI_LOOP_MS 500 // TaskWiFi period when no event arrives
+#define WIFI_CONNECT_TIMEOUT_MS 15000 // Association plus DHCP
+#define WIFI_BACKOFF_MIN_MS 3000 // Random wait between attempts
+#define WIFI_BACKOFF_MAX_MS 10000
+#define WIFI_EVENT_QUEUE_LEN 8
+
+// === Fast Reconnect ===
+#define WIFI_FAST_TIMEOUT_MS 4000 // Direct association, then full scan
+#define WIFI_CACHE_KEY "wifi_fast" // NVS record next to the credentials
+#define WIFI_TIMING_SAMPLES 32 // Reconnect times kept per path
+
+// === Link States ===
+typedef enum {
+  WIFI_LINK_OFF,         // STA disabled or no SSID saved
+  WIFI_LINK_CONNECTING,  // WiFi.begin() issued, waiting for an IP
+  WIFI_LINK_UP,          // Got an IP, WIFI_CONNECTED_BIT set
+  WIFI_LINK_BACKOFF,     // Waiting for the next attempt
+  WIFI_LINK_HOLD         // Radio lent to the provisioning portal
+} wifi_link_state_t;
+
+// === Fast Reconnect Record ===
+// Last good AP and IP configuration, NVS blob under WIFI_CACHE_KEY
+typedef struct {
+  uint32_t ssid_hash;   // Stale after a credentials change, 0 = empty
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint8_t reserved;
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+  uint32_t lease_epoch; // Last DHCP confirmation, 0 if time was unknown
+  uint32_t lease_s;     // Lease granted then (option 51), reused for half
+} wifi_link_cache_t;
+
+// === Reconnect Timing ===
+// Outage start (link lost or first attempt) to IP, last samples per path
+typedef struct {
+  uint16_t samples;
+  uint32_t p50_ms;
+  uint32_t p90_ms;
+  uint32_t max_ms;
+} wifi_link_timing_t;
+
+typedef struct {
+  wifi_link_timing_t fast;  // Cached BSSID and channel, no scan
+  wifi_link_timing_t scan;  // Full scan, includes a missed fast try
+  uint32_t fast_misses;     // Fast attempts that fell back to a scan
+  uint32_t dhcp_skipped;    // Connects that reused the cached lease
+} wifi_link_stats_t;
+
+// Called from wifi_link_poll() on every state change
+typedef void (*wifi_link_cb)(wifi_link_state_t state, wifi_link_state_t prev);
+
+// === Function Prototypes ===
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void wifi_link_begin(wifi_link_cb on_change);
+void wifi_link_poll(uint32_t wait_ms);
+void wifi_link_hold(bool hold);
+wifi_link_state_t wifi_link_state(void);
+const char *wifi_link_state_name(wifi_link_state_t state);
+uint32_t wifi_link_attempts(void);
+void wifi_link_stats(wifi_link_stats_t *stats);
+void wifi_link_forget(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WIFI_LINK_H
@@ -0,0 +1,37 @@
+#ifndef WIFI_PORTAL_H
+#define WIFI_PORTAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// === Provisioning Portal Configuration ===
+#define WIFI_PORTAL_POLL_MS 20 // TaskWiFi period while the portal is open
+#define WIFI_CRED_KEY "wifi_cred" // NVS record, written before the VP keys
+
+// === Saved Credentials ===
+// Both fields in one NVS write, so a power cut never pairs a new SSID
+// with the old password. Sizes match the VP strings.
+typedef struct {
+  char ssid[32];
+  char pswd[32];
+} wifi_cred_t;
+
+// === Function Prototypes ===
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void wifi_portal_begin(void);
+void wifi_portal_poll(void);
+bool wifi_portal_active(void);
+bool wifi_portal_ssid_valid(const char *ssid);
+bool wifi_portal_pswd_valid(const char *pswd);
+bool wifi_portal_commit(const char *ssid, const char *pswd);
+void wifi_portal_recover(void);
+void wifi_portal_cred_sync(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WIFI_PORTAL_H
@@ -0,0 +1,48 @@
+#ifndef WIFI_SIGNAL_H
+#define WIFI_SIGNAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// === Signal Sampler Configuration ===
+#define WIFI_RSSI_SAMPLE_MS 2000 // WiFi.RSSI() period while the link is up
+#define WIFI_RSSI_EWMA_SHIFT 2 // Filter weight 1/4, ~90% of a step in 8 samples
+#define WIFI_RSSI_HYST_DB 3 // Past a band edge by this much to change level
+#define WIFI_RSSI_HISTORY_MS 60000 // One history entry per minute
+#define WIFI_RSSI_HISTORY_LEN 60 // One hour
+
+// === Quality Levels ===
+// Lower band edge in dBm, shown in VP_PSWD_AND_SIGNAL
+typedef enum {
+  WIFI_SIGNAL_POOR,      // Below -85
+  WIFI_SIGNAL_WEAK,      // -85
+  WIFI_SIGNAL_FAIR,      // -75
+  WIFI_SIGNAL_GOOD,      // -67
+  WIFI_SIGNAL_EXCELLENT  // -55
+} wifi_signal_level_t;
+
+typedef struct {
+  uint32_t samples;
+  uint32_t level_changes;  // HMI updates pushed
+  int8_t rssi_last;        // dBm, raw
+  int8_t rssi_avg;         // dBm, filtered
+  uint8_t level;           // wifi_signal_level_t
+} wifi_signal_stats_t;
+
+// === Function Prototypes ===
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void wifi_signal_reset(void);
+void wifi_signal_poll(uint32_t now_ms);
+const char *wifi_signal_level_name(wifi_signal_level_t level);
+void wifi_signal_stats(wifi_signal_stats_t *stats);
+size_t wifi_signal_history(int8_t *out, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WIFI_SIGNAL_H
@@ -0,0 +1,272 @@
+#include "global.h"
+#include "bench.h"
+#include <esp_timer.h>
+
+// === Benchmark State ===
+// Results are kept from the optimiser through a volatile sink. Cases
+// that change VPs leave them changed, bench_run() puts `vp` back.
+static volatile uint32_t bench_sink_u32;
+static vp_values_t bench_saved_vp;
+
+// Reply of the panel RTC read, 2025-03-10 17:30:00
+static const char bench_rtc_reply[] =
+    "5A A5 0C 83 00 10 04 19 03 0A 01 11 1E 00 00 ";
+
+// Last table entry of `type`, the longest linear lookup
+static uint16_t bench_last_address(vp_type_t type) {
+    uint16_t address = 0;
+    for (size_t i = 0; i < num_vp_items; i++) {
+        if (vp_items[i].type == type) {
+            address = vp_items[i].address;
+        }
+    }
+    return address;
+}
+
+static size_t bench_storage_size(uint16_t address) {
+    for (size_t i = 0; i < num_vp_items; i++) {
+        if (vp_items[i].address == address) {
+            return vp_items[i].storage_size;
+        }
+    }
+    return 0;
+}
+
+// Stands in for TaskHMI, cases that queue updates empty the queue
+static void bench_drain_hmi(void) {
+    hmi_update_item_t msg;
+    while (xQueueReceive(xHMIUpdateQueue, &msg, 0) == pdTRUE) {
+    }
+}
+
+// Fixed local noon, valid whatever the clock says
+static void bench_snapshot(time_snapshot_t *now) {
+    const uint32_t epoch = 1741608000; // 2025-03-10 12:00 UTC
+    time_t local = (time_t)epoch + TIME_LOCAL_OFFSET;
+    struct tm tm_local;
+    gmtime_r(&local, &tm_local);
+
+    memset(now, 0, sizeof(*now));
+    now->valid = true;
+    now->epoch = epoch;
+    now->mono_us = esp_timer_get_time();
+    now->year = tm_local.tm_year + 1900;
+    now->month = tm_local.tm_mon + 1;
+    now->day = tm_local.tm_mday;
+    now->yday = tm_local.tm_yday;
+    now->hours = tm_local.tm_hour;
+    now->minutes = tm_local.tm_min;
+    now->seconds = tm_local.tm_sec;
+    now->minute_of_day = tm_local.tm_hour * 60 + tm_local.tm_min;
+    now->local_day = (uint32_t)(local / 86400);
+}
+
+// === Cases ===
+static void bench_vp_get_value(uint32_t ops) {
+    uint16_t address = bench_last_address(VP_UINT8);
+    for (uint32_t i = 0; i < ops; i++) {
+        bench_sink_u32 = vp_get_value(address);
+    }
+}
+
+static void bench_vp_get_string(uint32_t ops) {
+    uint16_t address = bench_last_address(VP_STRING);
+    for (uint32_t i = 0; i < ops; i++) {
+        bench_sink_u32 = (uint32_t)(uintptr_t)vp_get_string(address);
+    }
+}
+
+static void bench_vp_sync_same(uint32_t ops) {
+    uint8_t value = vp.plant_id;
+    for (uint32_t i = 0; i < ops; i++) {
+        bench_sink_u32 = vp_sync_item(VP_PLANT_ID, &value);
+    }
+}
+
+// Every call is a change, so every call saves the item to NVS
+static void bench_vp_sync_changed(uint32_t ops) {
+    uint8_t value = vp.plant_id;
+    for (uint32_t i = 0; i < ops; i++) {
+        value ^= 1;
+        bench_sink_u32 = vp_sync_item(VP_PLANT_ID, &value);
+    }
+}
+
+static void bench_hmi_pad_string(uint32_t ops) {
+    size_t maxlen = bench_storage_size(VP_WIFI_SSID);
+    for (uint32_t i = 0; i < ops; i++) {
+        bench_sink_u32 = hmi_pad_string("GrowRoom", maxlen).length();
+    }
+}
+
+static void bench_hmi_set_text(uint32_t ops) {
+    size_t maxlen = bench_storage_size(VP_WIFI_SSID);
+    for (uint32_t i = 0; i < ops; i++) {
+        hmi.setText(VP_WIFI_SSID, hmi_pad_string("GrowRoom", maxlen));
+    }
+}
+
+static void bench_hmi_set_vp(uint32_t ops) {
+    for (uint32_t i = 0; i < ops; i++) {
+        hmi.setVP(VP_PLANT_ID, (uint8_t)i);
+    }
+}
+
+// Touch frame as the library reports it, light switch toggled
+static void bench_hmi_on_event(uint32_t ops) {
+    char address[8];
+    snprintf(address, sizeof(address), "%04X", VP_LIGHT_STATE);
+    uint8_t level = vp.light_state;
+    for (uint32_t i = 0; i < ops; i++) {
+        level ^= 1;
+        hmi_on_event(String(address), level, String(), String());
+        bench_drain_hmi();
+    }
+}
+
+static void bench_hmi_rtc_parse(uint32_t ops) {
+    uint32_t epoch = 0;
+    for (uint32_t i = 0; i < ops; i++) {
+        bench_sink_u32 = hmi_rtc_parse(bench_rtc_reply, &epoch);
+    }
+}
+
+static void bench_schedule_active(uint32_t ops) {
+    io_schedule_t schedule;
+    io_schedule_compile(&schedule, 21, 30, 6, 15); // Overnight
+    for (uint32_t i = 0; i < ops; i++) {
+        bench_sink_u32 = io_schedule_active(&schedule, i % SCHED_MINUTES_IN_DAY);
+    }
+}
+
+static void bench_automation_run(uint32_t ops) {
+    time_snapshot_t now;
+    bench_snapshot(&now);
+    for (uint32_t i = 0; i < ops; i++) {
+        io_automation_run(&now);
+        bench_drain_hmi();
+    }
+}
+
+// One HMI_UPDATE_ALL without the pacing delays
+static void bench_hmi_update_all(uint32_t ops) {
+    for (uint32_t i = 0; i < ops; i++) {
+        for (size_t n = 0; n < num_vp_items; n++) {
+            hmi_send_item(n);
+        }
+    }
+}
+
+static void bench_vp_save_item(uint32_t ops) {
+    for (uint32_t i = 0; i < ops; i++) {
+        vp_save_items(&vp_items[i % num_vp_items].address, 1);
+    }
+}
+
+static void bench_vp_save_values(uint32_t ops) {
+    for (uint32_t i = 0; i < ops; i++) {
+        vp_save_values();
+    }
+}
+
+typedef struct {
+  const char *name;
+  void (*run)(uint32_t ops);
+} bench_case_t;
+
+static const bench_case_t bench_cases[] = {
+    { "vp_get_value", bench_vp_get_value },
+    { "vp_get_string", bench_vp_get_string },
+    { "vp_sync_item_same", bench_vp_sync_same },
+    { "vp_sync_item_changed", bench_vp_sync_changed },
+    { "hmi_pad_string", bench_hmi_pad_string },
+    { "hmi_set_text", bench_hmi_set_text },
+    { "hmi_set_vp", bench_hmi_set_vp },
+    { "hmi_on_event", bench_hmi_on_event },
+    { "hmi_rtc_parse", bench_hmi_rtc_parse },
+    { "io_schedule_active", bench_schedule_active },
+    { "io_automation_run", bench_automation_run },
+    { "hmi_update_all", bench_hmi_update_all },
+    { "vp_save_item", bench_vp_save_item },
+    { "vp_save_values", bench_vp_save_values },
+};
+
+// === Run the suite ===
+/**
+ * @brief Times every case whose name contains `filter`, NULL for all,
+ * and hands each result to `sink`.
+ * @return Cases run.
+ * @note Needs xVPMutex and xHMIUpdateQueue, and TaskHMI not running:
+ * queued updates are dropped. Call from setup() before the tasks.
+ */
+uint32_t bench_run(const char *filter, bench_sink_t sink, void *ctx) {
+    uint32_t count = 0;
+    bench_saved_vp = vp;
+
+    for (size_t c = 0; c < sizeof(bench_cases) / sizeof(bench_cases[0]); c++) {
+        const bench_case_t *bc = &bench_cases[c];
+        if (filter && !strstr(bc->name, filter)) {
+            continue;
+        }
+
+        // Grow the batch until it runs long enough to time
+        uint32_t ops = 1;
+        int64_t elapsed_us;
+        uint32_t cycles;
+        for (;;) {
+            uint32_t start_cycles = ESP.getCycleCount();
+            int64_t start_us = esp_timer_get_time();
+            bc->run(ops);
+            elapsed_us = esp_timer_get_time() - start_us;
+            cycles = ESP.getCycleCount() - start_cycles;
+
+            if (elapsed_us >= BENCH_MIN_US || ops >= BENCH_OPS_MAX) {
+                break;
+            }
+            ops = elapsed_us < BENCH_MIN_US / 10 ? ops * 10 : ops * 2;
+        }
+
+        bench_result_t result = {
+            .name = bc->name,
+            .ops = ops,
+            .ns_per_op = elapsed_us * 1000.0 / ops,
+            .cycles_per_op = (double)cycles / ops
+        };
+        sink(&result, ctx);
+        count++;
+    }
+
+    // Panel, relays and NVS back to the state before the suite
+    vp = bench_saved_vp;
+    vp_save_values();
+    io_schedule_init();
+    for (size_t n = 0; n < num_vp_items; n++) {
+        hmi_send_item(n);
+    }
+    return count;
+}
+
+// === JSON result ===
+/**
+ * @brief One result as a JSON object on one line, the format read by
+ * grow_bench --baseline.
+ * @return Length written, without the terminator.
+ */
+size_t bench_format(const bench_result_t *result, const char *target, char *out, size_t size) {
+    int len = snprintf(out, size,
+                       "{\"bench\":\"%s\",\"target\":\"%s\",\"ops\":%lu,"
+                       "\"ns\":%.1f,\"cycles\":%.1f}\n",
+                       result->name, target, (unsigned long)result->ops,
+                       result->ns_per_op, result->cycles_per_op);
+    if (len < 0) {
+        return 0;
+    }
+    return (size_t)len < size ? (size_t)len : size - 1;
+}
+
+// Results on the console, for BENCH_ON_BOOT
+void bench_console_sink(const bench_result_t *result, void *ctx) {
+    char line[BENCH_LINE_MAX];
+    bench_format(result, "esp32", line, sizeof(line));
+    debug_printf("%s", line);
+}
@@ -1,8 +1,8 @@
 #include "global.h"
+#include <esp_timer.h>
+#include <time.h>
 
 extern DWIN hmi;
-WiFiUDP ntpUDP;
-NTPClient timeClient(ntpUDP, NTP_SERVER);
 
 // === Ordinal Suffix Helper ===
 const char *ordinal(uint16_t n) {
@@ -50,62 +50,114 @@ uint8_t io_pin_map(uint16_t address) {
     }
 }
 
+// === Compiled day schedules ===
+static io_schedule_t light_schedule;
+static io_schedule_t water_schedule;
+static io_schedule_t fan_schedule;
+
+// === Rebuild day bitmap for a schedule VP ===
+/**
+ * @brief Recompiles the day bitmap of the relay that owns `address`.
+ * @note Call with xVPMutex held whenever a schedule VP changes.
+ */
+void io_schedule_update(uint16_t address) {
+    switch (address) {
+        case VP_LIGHT_ON_HR:
+        case VP_LIGHT_ON_MIN:
+        case VP_LIGHT_OFF_HR:
+        case VP_LIGHT_OFF_MIN:
+            io_schedule_compile(
+                &light_schedule,
+                vp.light_on_hr, vp.light_on_min,
+                vp.light_off_hr, vp.light_off_min
+            );
+            break;
+
+        case VP_WATER_ON_HR:
+        case VP_WATER_ON_MIN:
+        case VP_WATER_OFF_HR:
+        case VP_WATER_OFF_MIN:
+            io_schedule_compile(
+                &water_schedule,
+                vp.water_on_hr, vp.water_on_min,
+                vp.water_off_hr, vp.water_off_min
+            );
+            break;
+
+        case VP_FAN_ON_HR:
+        case VP_FAN_ON_MIN:
+        case VP_FAN_OFF_HR:
+        case VP_FAN_OFF_MIN:
+            io_schedule_compile(
+                &fan_schedule,
+                vp.fan_on_hr, vp.fan_on_min,
+                vp.fan_off_hr, vp.fan_off_min
+            );
+            break;
+
+        default:
+            break;
+    }
+}
+
+// === Compile all day bitmaps ===
+void io_schedule_init(void) {
+    io_schedule_update(VP_LIGHT_ON_HR);
+    io_schedule_update(VP_WATER_ON_HR);
+    io_schedule_update(VP_FAN_ON_HR);
+}
+
+// === Replayed edge logging ===
+static void io_log_replayed_edge(uint32_t minute, bool rising, void *ctx) {
+    debug_printf("[SYNC] Catch-up auto %s %s (missed at %02lu:%02lu)\n",
+                (const char *)ctx, rising ? "ON" : "OFF",
+                (unsigned long)(minute / 60 % 24),
+                (unsigned long)(minute % 60));
+}
+
 // === Timer-based trigger handling ===
 /**
- * @brief Trigger relay based on current time and schedule and Only
- * updates if the state needs to change.
- * @note This function is stateless and determines the desired state
- * based on the current time. Only trigger if its inside the grace period.
- * @param on_boot If false, the function performs a robust, stateless
- * check to correct the relay's state.
+ * @brief Reconciles a relay with its schedule and Only updates if the
+ * state needs to change.
+ * @note Every edge since the last evaluated epoch is replayed in order,
+ * so a stalled task, long mutex wait or NTP step cannot skip a
+ * transition. Boot, a clock step back or a gap over one day fall back
+ * to the stateless desired state.
+ * @param rec Persistent per-relay reconciler state.
  */
-void io_pin_trigger(
+void io_pin_reconcile(
     uint8_t enable, uint8_t current_state,
-    uint8_t on_hr, uint8_t on_min,
-    uint8_t off_hr, uint8_t off_min,
-    uint16_t current_hr, uint16_t current_min,
-    uint16_t grace_min, bool on_boot,
+    const io_schedule_t *schedule,
+    const time_snapshot_t *now, io_reconcile_t *rec,
     uint16_t address, const char *relay_str
 ) {
+    uint32_t local_epoch = now->epoch + TIME_LOCAL_OFFSET;
+
     if (!enable) {
-        return; // Automation is disabled
+        // Automation is disabled, don't replay history once re-enabled
+        rec->last_epoch = local_epoch;
+        return;
     }
 
+    uint32_t gap = local_epoch - rec->last_epoch;
+    bool catch_up = rec->last_epoch != 0 &&
+                    local_epoch >= rec->last_epoch &&
+                    gap > 2 * 60;
     uint8_t desired_state = current_state;
-    const uint16_t MINUTES_IN_DAY = 24 * 60;
-    uint16_t on_total_mins = on_hr * 60 + on_min;
-    uint16_t off_total_mins = off_hr * 60 + off_min;
-    uint16_t total_mins = current_hr * 60 + current_min;
-    
-    if (on_total_mins == off_total_mins) {
-        return; // Skip if condition is invalid
-
-    } else if (!on_boot) {
-        // Normal operation mode - Check within grace period
-        uint16_t minutes_since_on = 
-            (total_mins - on_total_mins + MINUTES_IN_DAY) % MINUTES_IN_DAY;
-        uint16_t minutes_since_off = 
-            (total_mins - off_total_mins + MINUTES_IN_DAY) % MINUTES_IN_DAY;
-
-        // Determine desired state based on grace periods
-        if (!current_state && (minutes_since_on <= grace_min)) {
-            desired_state = 1; // Should be ON
-
-        } else if (current_state && (minutes_since_off <= grace_min)) {
-            desired_state = 0; // Should be OFF
-        }
 
-    } else {
-        // Boot-up mode - Correct state based on schedule
-        if (on_total_mins < off_total_mins) {
-            // Same-day schedule (e.g., ON 09:00, OFF 18:00)
-            desired_state = ((total_mins >= on_total_mins) &&
-                             (total_mins < off_total_mins));
-
-        } else {
-            // Overnight schedule (e.g., ON 21:00, OFF 06:00)
-            desired_state = ((total_mins >= on_total_mins) ||
-                             (total_mins < off_total_mins));
+    io_reconcile_result_t result = io_schedule_reconcile(
+        schedule, rec, local_epoch, &desired_state,
+        catch_up ? io_log_replayed_edge : NULL, (void *)relay_str
+    );
+
+    if (result == SCHED_RECONCILE_REPLAYED) {
+        // Last replayed edge must agree with the stateless state
+        uint8_t stateless = io_schedule_active(schedule, now->minute_of_day);
+        if (desired_state != stateless) {
+            debug_warnf("[SYNC] Error %s replay ended %s, expected %s\n",
+                        relay_str, desired_state ? "ON" : "OFF",
+                        stateless ? "ON" : "OFF");
+            desired_state = stateless;
         }
     }
 
@@ -113,7 +165,8 @@ void io_pin_trigger(
     if (current_state != desired_state) {
         debug_printf("[SYNC] Triggered auto %s %s%s\n", 
                     relay_str, desired_state ? "ON" : "OFF",
-                    on_boot ? " (boot)" : "");
+                    result == SCHED_RECONCILE_RESYNC ? " (resync)" :
+                    catch_up ? " (catch-up)" : "");
         
         vp_set_value(address, desired_state);
         vp_save_values();
@@ -125,13 +178,12 @@ void io_pin_trigger(
 /**
  * @brief Handles water spray trigger with interval-based control and
  * Only updates if the state needs to change.
+ * @param last_spray Epoch (UTC) of the last spray edge, 0 if none.
  */
 void io_pin_trigger_interval(
     uint8_t enable, uint8_t current_state,
-    uint8_t on_hr, uint8_t on_min,
-    uint8_t off_hr, uint8_t off_min,
-    uint16_t current_hr, uint16_t current_min,
-    uint16_t current_sec, uint16_t interval_hr,
+    const io_schedule_t *schedule,
+    const time_snapshot_t *now, uint16_t interval_hr,
     uint16_t duration_sec, uint16_t address, 
     const char *relay_str, uint32_t *last_spray  // Persistent
 ) {
@@ -139,9 +191,10 @@ void io_pin_trigger_interval(
         return; // Automation is disabled
     }
 
-    if (duration_sec < 1 || duration_sec > 99) {
+    if (duration_sec < 1 || duration_sec > WATER_DURATION_MAX) {
         debug_printf(
-            "[SYNC] Error %s duration must be 1-99 seconds\n", relay_str);
+            "[SYNC] Error %s duration must be 1-%u seconds\n", relay_str,
+            (unsigned)WATER_DURATION_MAX);
         return;
     }
 
@@ -151,26 +204,8 @@ void io_pin_trigger_interval(
         return;
     }
     
-    bool in_schedule = false;
-    const uint16_t MINUTES_IN_DAY = 24 * 60;
-    uint16_t on_total_mins = on_hr * 60 + on_min;
-    uint16_t off_total_mins = off_hr * 60 + off_min;
-    uint16_t total_mins = current_hr * 60 + current_min;
-    
-    if (on_total_mins == off_total_mins) {
-        // ON==OFF -> treat as disabled schedule
-        in_schedule = false;
-
-    } else if (on_total_mins < off_total_mins) {
-        // Same-day schedule
-        in_schedule = ((total_mins >= on_total_mins) &&
-                       (total_mins < off_total_mins));
-
-    } else {
-        // Overnight schedule  
-        in_schedule = ((total_mins >= on_total_mins) ||
-                       (total_mins < off_total_mins));
-    }
+    // ON==OFF compiles to an empty bitmap -> treated as disabled
+    bool in_schedule = io_schedule_active(schedule, now->minute_of_day);
 
     uint8_t desired_state = current_state;
 
@@ -186,40 +221,22 @@ void io_pin_trigger_interval(
 
     } else {
         // Inside schedule - calculate desired state based on timing
-        uint32_t current_time_sec = 
-            (current_hr * 3600) + (current_min * 60) + current_sec;
         uint32_t interval_sec = interval_hr * 3600;
         
-        if (*last_spray == 0) {
-            // First spray - should be ON
+        if (*last_spray == 0 || now->epoch < *last_spray) {
+            // First spray (or clock stepped back) - should be ON
             desired_state = 1;
-            *last_spray = current_time_sec;
+            *last_spray = now->epoch;
 
         } else {
-            // Calculate time since last spray started
-            uint32_t time_since_last_spray;
-            
-            if (current_time_sec >= *last_spray) {
-                time_since_last_spray = current_time_sec - *last_spray;
-
-            } else {
-                // Handle midnight rollover
-                time_since_last_spray = (86400 - *last_spray) + current_time_sec;
-            }
-
-            if (current_state == 1) {
-                // Currently spraying - check if duration is complete
-                if (time_since_last_spray >= duration_sec) {
-                    desired_state = 0; // Should turn OFF
-                    *last_spray = current_time_sec; // Reset for next interval
-                }
-
-            } else {
-                // Not spraying - check if interval has passed
-                if (time_since_last_spray >= interval_sec) {
-                    desired_state = 1; // Should turn ON
-                    *last_spray = current_time_sec; // Reset spray start time
-                }
+            // Absolute deadline of the next edge, no rollover needed
+            uint32_t deadline = *last_spray +
+                (current_state ? duration_sec : interval_sec);
+
+            if (now->epoch >= deadline) {
+                // Spray duration complete, or interval has passed
+                desired_state = !current_state;
+                *last_spray = now->epoch; // Reset for next edge
             }
         }
     }
@@ -235,97 +252,250 @@ void io_pin_trigger_interval(
     }
 }
 
+// === Scheduler automation pass ===
+/**
+ * @brief Runs one automation pass for light, fan, spray and growth day
+ * against a single clock snapshot.
+ * @note Call with xVPMutex held and a valid snapshot. Shared by
+ * TaskSync and the host simulator.
+ */
+void io_automation_run(const time_snapshot_t *now) {
+    static io_reconcile_t light_reconcile = {0};
+    static io_reconcile_t fan_reconcile = {0};
+    static uint32_t last_spray_time = 0; // Epoch of last spray edge
+
+    // Relay automation, replays any edge missed since last run
+    io_pin_reconcile(
+        vp.light_auto, vp.light_state,
+        &light_schedule, now,
+        &light_reconcile, VP_LIGHT_STATE, "Light"
+    );
+
+    io_pin_reconcile(
+        vp.fan_auto, vp.fan_state,
+        &fan_schedule, now,
+        &fan_reconcile, VP_FAN_STATE, "Fan"
+    );
+
+    // Growth day follows the clock, no midnight tick needed
+    growth_update(now);
+
+    // Spray automation runs every cycle
+    if (vp.water_auto) {
+        io_pin_trigger_interval(
+            vp.water_auto, vp.water_state,
+            &water_schedule, now,
+            vp.water_interval_hr, vp.water_duration_sec,
+            VP_WATER_STATE, "Spray",
+            &last_spray_time
+        );
+    }
+}
+
 // === NTP Client Initialization ===
+static const char *const ntp_server_list[] = {
+    NTP_SERVER, NTP_SERVER_2, NTP_SERVER_3
+};
+
+// === NTP round completion ===
+static void ntp_on_sync(const ntp_sync_result_t *result) {
+    static int64_t last_rtc_write_us = 0; // Monotonic, 0 = not written yet
+
+    if (!result->ok) {
+        return;
+    }
+
+    if (result->stepped) {
+        time_snapshot_t now;
+        time_now(&now);
+        debug_printf("[NTP] Time successfully set: %02u:%02u:%02u local\n",
+                    now.hours, now.minutes, now.seconds);
+    }
+
+    // Keep the panel RTC close for the next offline boot. Each write
+    // rounds to a second, so only after a step or once a day.
+    int64_t mono_us = esp_timer_get_time();
+    if (result->stepped || last_rtc_write_us == 0 ||
+        mono_us - last_rtc_write_us >= RTC_WRITEBACK_INTERVAL * 1000000LL
+    ) {
+        last_rtc_write_us = mono_us;
+        hmi_update_rtc();
+    }
+}
+
+/**
+ * @brief Starts the asynchronous SNTP service, the first request goes
+ * out on the next ntp_sync_poll().
+ * @note Replaces the blocking NTPClient forceUpdate/retry loop.
+ */
 void ntp_client_init(void) {
-    timeClient.begin();
-    timeClient.setTimeOffset(NTP_OFFSET);
-    timeClient.setUpdateInterval(NTP_UPDATE_INTERVAL);
+    ntp_sync_begin(
+        ntp_server_list,
+        sizeof(ntp_server_list) / sizeof(ntp_server_list[0]),
+        NTP_UPDATE_INTERVAL, ntp_on_sync
+    );
 }
 
-// === NTP Client Update ===
-void ntp_client_update(bool force) {
-    const uint8_t MAX_RETRIES = 3;
-    const uint32_t RETRY_DELAY_MS = 1000;
-    const uint32_t MAX_RETRY_DELAY_MS = 6000;
-    
-    // If time is already synced and no force update, skip
-    if (timeClient.isTimeSet() && !force) {
-        timeClient.update();
-        // debug_printf("[NTP] Time sync maintained: %s\n", 
-        //             timeClient.getFormattedTime().c_str());
-        return;
+// === WiFi status on the HMI ===
+// Link status is runtime only, kept out of NVS so reconnect loops do
+// not wear the flash. Call with xVPMutex held, returns true if changed.
+static bool wifi_status_set(uint16_t address, const char *text) {
+    const char *cur = vp_get_string(address);
+    if (cur == NULL || strcmp(cur, text) == 0) {
+        return false;
     }
-    
-    debug_println("[NTP] Time not in sync, calling forceUpdate!");
-    
-    
-    // Blocking call, be careful with delays
-    for (uint8_t attempt = 1; attempt <= MAX_RETRIES; attempt++) {
-        // Calculate exponential backoff delay
-        uint32_t retry_delay_ms = RETRY_DELAY_MS * (1 << (attempt - 1));
-        if (retry_delay_ms > MAX_RETRY_DELAY_MS) {
-            retry_delay_ms = MAX_RETRY_DELAY_MS;
+    vp_set_string(address, text);
+    return true;
+}
+
+// === WiFi link state changes ===
+/**
+ * @brief Starts and stops the network services and updates the HMI
+ * status as the STA link comes and goes.
+ * @note Called from TaskWiFi by wifi_link_poll().
+ */
+void wifi_on_link_change(wifi_link_state_t state, wifi_link_state_t prev) {
+    char ip[sizeof(vp.ip_address)] = "0.0.0.0";
+    const char *status = NULL;
+
+    if (state == WIFI_LINK_UP) {
+        snprintf(ip, sizeof(ip), "%s", WiFi.localIP().toString().c_str());
+        status = "Connected";
+    } else if (state == WIFI_LINK_CONNECTING) {
+        status = "Connecting...";
+    } else if (state == WIFI_LINK_BACKOFF || state == WIFI_LINK_OFF) {
+        status = "Disconnected";
+    }
+
+    // Portal owns the status VPs while in HOLD
+    if (status) {
+        bool ip_changed = false;
+        bool status_changed = false;
+        if (vp_lock()) {
+            ip_changed = wifi_status_set(VP_IP_ADDRESS, ip);
+            status_changed = wifi_status_set(VP_PSWD_AND_SIGNAL, status);
+            vp_unlock();
         }
-        
-        debug_printf(
-            "[NTP] Updating time from server failed (attempt %d/%d)\n",
-            attempt,
-            MAX_RETRIES
-        );
-        
-        // Try to update
-        if (timeClient.forceUpdate()) {
-            // Give it time to complete
-            vTaskDelay(pdMS_TO_TICKS(500));
-            
-            if (timeClient.isTimeSet()) {
-                debug_printf("[NTP] Time successfully set: %s\n",
-                            timeClient.getFormattedTime().c_str());
-                return; // Success
-            }
+
+        // Queue outside the mutex, TaskHMI takes it to drain
+        if (ip_changed) {
+            hmi_update_string(VP_IP_ADDRESS);
         }
-        
-        // If this wasn't the last attempt, wait before retrying
-        if (attempt < MAX_RETRIES) {
-            debug_printf("[NTP] Update failed, retrying in %lu ms\n", retry_delay_ms);
-            vTaskDelay(pdMS_TO_TICKS(retry_delay_ms));
+        if (status_changed) {
+            hmi_update_string(VP_PSWD_AND_SIGNAL);
         }
     }
-    
-    // All retries failed
-    debug_println("[NTP] Error: Maximum attempt reached, giving up!!");
-}
 
-// === Time Validation Helper ===
-bool is_valid_time(int hours, int minutes, int seconds) {
-    return (hours >= 0 && hours <= 23 &&
-            minutes >= 0 && minutes <= 59 &&
-            seconds >= 0 && seconds <= 59);
+    // Link gained or lost in the journal, retries are left out
+    if (state == WIFI_LINK_UP || prev == WIFI_LINK_UP) {
+        journal_log(JOURNAL_WIFI, (uint8_t)state, (int32_t)prev, NULL);
+    }
+
+    if (state == WIFI_LINK_UP) {
+        debug_printf("[WiFi] Connected! IP Address: %s\n", ip);
+
+        // Initialize WiFi-dependent services
+        wifi_signal_reset(); // Quality replaces "Connected" on the next sample
+        ota_init();
+        ota_mdns_init();
+        vp_http_begin(); // Listens once, across reconnects
+        vp_ws_begin();
+        ntp_client_init(); // Syncs in the background
+
+    } else if (prev == WIFI_LINK_UP) {
+        ntp_sync_stop();
+    }
 }
 
 // === Growth & Progress Update ===
-void vp_growth_bar_update(void) {
-    uint8_t bar = 1; 
-    if (vp.total_cycle > 0) {
-        // Progress is segmented into 20 parts (1-20)
-        bar = (uint8_t)round((vp.growth_day / (float)vp.total_cycle) * 20.0f);
-        if (bar < 1) bar = 1;
-        if (bar > 20) bar = 20;
-        vp.growth_bar = bar;
-
-        // Cap at 99 days for display
-        if (vp.growth_day > 99) {
-            vp.growth_day = 99;
-        }
-        
-        snprintf(
-            vp.growth_str,
-            sizeof(vp.growth_str),
-            "%d%s",
-            vp.growth_day,
-            ordinal(vp.growth_day)
-        );
-        vp_sync_item(VP_GROWTH_STR, &vp.growth_str);
+/**
+ * @brief Derives the growth bar and label from growth_day and
+ * total_cycle, writing only the VPs that changed.
+ * @return true if the bar or label changed.
+ */
+bool vp_growth_bar_update(void) {
+    if (vp.total_cycle == 0) {
+        return false;
+    }
+
+    // Progress is segmented into 20 parts (1-20)
+    uint8_t bar = (uint8_t)round((vp.growth_day / (float)vp.total_cycle) * 20.0f);
+    if (bar < 1) bar = 1;
+    if (bar > 20) bar = 20;
+
+    // Label fits "99th" and no more
+    uint8_t day = vp.growth_day > GROWTH_MAX_DAY ? GROWTH_MAX_DAY : vp.growth_day;
+    char growth_str[sizeof(vp.growth_str)];
+    snprintf(
+        growth_str,
+        sizeof(growth_str),
+        "%d%s",
+        day,
+        ordinal(day)
+    );
+
+    bool changed = vp_sync_item(VP_GROWTH_BAR, &bar);
+    changed |= vp_sync_item(VP_GROWTH_STR, growth_str);
+    return changed;
+}
+
+// === Growth Cycle Engine ===
+// Cycle is anchored at the UTC epoch of local midnight on day 1, so the
+// growth day follows the clock across reboots, stalls and NTP gaps.
+static uint32_t growth_start_epoch = 0; // 0 = waiting for valid time
+static uint32_t growth_eval_day = 0;
+
+void growth_init(void) {
+    growth_start_epoch = vp_load_u32(GROWTH_START_KEY, 0);
+}
+
+// === Re-anchor so that today is vp.growth_day ===
+void growth_anchor(const time_snapshot_t *now) {
+    uint8_t day = vp.growth_day < 1 ? 1 : vp.growth_day;
+
+    if (now->valid) {
+        uint32_t today = now->local_day * 86400UL - TIME_LOCAL_OFFSET;
+        growth_start_epoch = today - (day - 1) * 86400UL;
+    } else {
+        growth_start_epoch = 0; // Anchor once the clock is valid
+    }
+
+    growth_eval_day = 0;
+    vp_save_u32(GROWTH_START_KEY, growth_start_epoch);
+}
+
+// === Derive growth day from the clock ===
+/**
+ * @brief Recomputes growth day, bar and label from the cycle start and
+ * the clock. Cheap when the local day is unchanged.
+ * @note Call with xVPMutex held.
+ */
+void growth_update(const time_snapshot_t *now) {
+    if (!now->valid || now->local_day == growth_eval_day) {
+        return;
+    }
+
+    if (growth_start_epoch == 0) {
+        growth_anchor(now);
+    }
+    growth_eval_day = now->local_day;
+
+    int32_t start_day = (growth_start_epoch + TIME_LOCAL_OFFSET) / 86400;
+    int32_t day = (int32_t)now->local_day - start_day + 1;
+    if (day < 1) day = 1;
+    if (day > GROWTH_MAX_DAY) day = GROWTH_MAX_DAY;
+
+    uint8_t growth_day = (uint8_t)day;
+    bool day_changed = vp_sync_item(VP_GROWTH_DAY, &growth_day);
+    bool bar_changed = vp_growth_bar_update();
+
+    if (day_changed) {
+        hmi_update_value(VP_GROWTH_DAY);
+        debug_printf("[SYNC] Growth day is now %u\n", vp.growth_day);
+    }
+    if (bar_changed) {
+        hmi_update_value(VP_GROWTH_BAR);
+        hmi_update_string(VP_GROWTH_STR);
     }
 }
 
@@ -335,9 +505,262 @@ void hmi_init(void) {
     hmi_update_all();
 }
 
+// === Send one item to the panel ===
+/**
+ * @brief Writes the current value of vp_items[index] to the panel, and
+ * drives the relay of a switch VP to match.
+ * @note TaskHMI only, one step of HMI_UPDATE_ALL.
+ */
+void hmi_send_item(size_t index) {
+    const vp_item_t& item = vp_items[index];
+
+    if (item.type == VP_UINT8) {
+        uint8_t val = 0;
+        if (vp_lock()) {
+            val = vp_get_value(item.address);
+            vp_unlock();
+        }
+        hmi.setVP(item.address, val);
+        metric_inc(&metric_hmi_frames_tx);
+        
+        // Control relay if pin is assigned
+        uint8_t pin = io_pin_map(item.address);
+        if (pin != 0) {
+            digitalWrite(pin, val);
+            journal_relay(pin, val);
+        }
+
+    } else if (item.type == VP_STRING) {
+        const char* str = "";
+        if (vp_lock()) {
+            str = vp_get_string(item.address);
+            vp_unlock();
+        }
+        hmi.setText(item.address, hmi_pad_string(str, item.storage_size));
+        metric_inc(&metric_hmi_frames_tx);
+    }
+}
+
+// === Panel RTC ===
+// The DWIN panel keeps local time in its own RTC, read once at boot so
+// automations can run before WiFi and NTP are up.
+
+/**
+ * @brief Asks the panel for its RTC, the reply arrives through
+ * hmi.listen() and hmi_on_event().
+ * @note Raw frame, the DWIN library only reads single VPs. Call from
+ * the task that owns the panel UART.
+ */
+void hmi_rtc_request(void) {
+    const uint8_t frame[] = {
+        0x5A, 0xA5, 0x04, 0x83,
+        (uint8_t)(VP_RTC >> 8), (uint8_t)(VP_RTC & 0xFF), VP_RTC_WORDS
+    };
+    DGUS_SERIAL.write(frame, sizeof(frame));
+    metric_inc(&metric_hmi_frames_tx);
+}
+
+/**
+ * @brief Decodes an RTC read reply as printed by the DWIN library
+ * ("5A A5 0C 83 00 10 04 YY MM DD WW HH MM SS 00").
+ * @param epoch UTC seconds on success.
+ * @return false for other frames or an RTC that lost its time.
+ */
+bool hmi_rtc_parse(const char *response, uint32_t *epoch) {
+    uint8_t bytes[16];
+    size_t count = 0;
+    const char *p = response;
+
+    while (p && *p && count < sizeof(bytes)) {
+        char *end;
+        unsigned long byte = strtoul(p, &end, 16);
+        if (end == p) {
+            break;
+        }
+        bytes[count++] = (uint8_t)byte;
+        p = end;
+    }
+
+    // Header, length, read command, address and word count, then data
+    if (count < 7 + VP_RTC_WORDS * 2 - 1 ||
+        bytes[0] != 0x5A || bytes[1] != 0xA5 || bytes[3] != 0x83 ||
+        ((bytes[4] << 8) | bytes[5]) != VP_RTC || bytes[6] != VP_RTC_WORDS
+    ) {
+        return false;
+    }
+
+    const uint8_t *rtc = &bytes[7];
+    *epoch = time_epoch_from_local(
+        2000 + rtc[0], rtc[1], rtc[2], rtc[4], rtc[5], rtc[6]
+    );
+    return *epoch >= TIME_MIN_VALID_EPOCH;
+}
+
+// === RTC read reply ===
+static void hmi_rtc_on_reply(const char *response) {
+    uint32_t epoch;
+    if (!hmi_rtc_parse(response, &epoch)) {
+        debug_println("[HMI] Panel RTC not set, waiting for NTP");
+        return;
+    }
+
+    // Mid-second is the best guess for a whole-second RTC
+    if (time_source_offer(TIME_SOURCE_RTC, (int64_t)epoch * 1000000 + 500000)) {
+        time_snapshot_t now;
+        time_now(&now);
+        debug_printf("[HMI] Time set from panel RTC: %02u:%02u:%02u local\n",
+                    now.hours, now.minutes, now.seconds);
+    }
+}
+
+/**
+ * @brief Writes the current local time to the panel RTC.
+ * @note Called by TaskHMI for HMI_UPDATE_RTC. Rounded to the nearest
+ * second, the RTC has no finer resolution.
+ */
+void hmi_rtc_write(void) {
+    int64_t epoch_us = time_epoch_us();
+    if (epoch_us == 0) {
+        return;
+    }
+
+    time_t local = (time_t)((epoch_us + 500000) / 1000000) + TIME_LOCAL_OFFSET;
+    struct tm tm_local;
+    gmtime_r(&local, &tm_local);
+
+    hmi.setRTC(
+        tm_local.tm_year - 100, tm_local.tm_mon + 1, tm_local.tm_mday,
+        tm_local.tm_hour, tm_local.tm_min, tm_local.tm_sec
+    );
+    metric_inc(&metric_hmi_frames_tx);
+    debug_printf("[HMI] Panel RTC set to %02d:%02d:%02d local\n",
+                tm_local.tm_hour, tm_local.tm_min, tm_local.tm_sec);
+}
+
+// === Side effects of an operator change ===
+/**
+ * @brief Clamps, schedule recompiles and derived VPs after `vp_addr`
+ * changed in RAM, from the panel or the network API.
+ * @return Number of derived VPs written to `derived`, at most
+ * VP_DERIVED_MAX, that the panel must be sent.
+ * @note Call with xVPMutex held. Queues nothing, the caller queues the
+ * item and `derived` once the mutex is released.
+ */
+size_t vp_apply_change(uint16_t vp_addr, uint16_t *derived) {
+    size_t n = 0;
+
+    switch (vp_addr) {
+        case VP_TOTAL_CYCLE:
+        case VP_GROWTH_DAY: {
+            // Prevent division by zero
+            if (vp.total_cycle < 1) {
+                vp.total_cycle = 1;
+                vp_sync_item(VP_TOTAL_CYCLE, &vp.total_cycle);
+            }
+            if (vp.growth_day < 1) {
+                vp.growth_day = 1;
+                vp_sync_item(VP_GROWTH_DAY, &vp.growth_day);
+
+            } else if (vp.growth_day > GROWTH_MAX_DAY) {
+                vp.growth_day = GROWTH_MAX_DAY;
+                vp_sync_item(VP_GROWTH_DAY, &vp.growth_day);
+            }
+
+            // Operator set the day, move the cycle start to match
+            if (vp_addr == VP_GROWTH_DAY) {
+                time_snapshot_t now;
+                time_now(&now);
+                growth_anchor(&now);
+            }
+
+            if (vp_growth_bar_update()) {
+                derived[n++] = VP_GROWTH_BAR;
+                derived[n++] = VP_GROWTH_STR;
+            }
+            break;
+        }
+
+        case VP_LIGHT_ON_HR:
+        case VP_LIGHT_ON_MIN:
+        case VP_LIGHT_OFF_HR:
+        case VP_LIGHT_OFF_MIN:
+        case VP_WATER_ON_HR:
+        case VP_WATER_ON_MIN:
+        case VP_WATER_OFF_HR:
+        case VP_WATER_OFF_MIN:
+        case VP_FAN_ON_HR:
+        case VP_FAN_ON_MIN:
+        case VP_FAN_OFF_HR:
+        case VP_FAN_OFF_MIN:
+            io_schedule_update(vp_addr);
+            break;
+
+        case VP_WIFI_SSID:
+        case VP_WIFI_PSWD:
+            wifi_portal_cred_sync();
+            break;
+
+        case VP_WATER_INTERVAL_HR: {
+            if (vp.water_interval_hr < 1) {
+                vp.water_interval_hr = 1;
+                vp_sync_item(VP_WATER_INTERVAL_HR, &vp.water_interval_hr);
+
+            } else if (vp.water_interval_hr > 12) {
+                vp.water_interval_hr = 12;
+                vp_sync_item(VP_WATER_INTERVAL_HR, &vp.water_interval_hr);
+            }
+            break;
+        }
+
+        case VP_WATER_DURATION_SEC: {
+            if (vp.water_duration_sec < 1) {
+                vp.water_duration_sec = 1;
+                vp_sync_item(VP_WATER_DURATION_SEC, &vp.water_duration_sec);
+
+            } else if (vp.water_duration_sec > WATER_DURATION_MAX) {
+                vp.water_duration_sec = WATER_DURATION_MAX;
+                vp_sync_item(VP_WATER_DURATION_SEC, &vp.water_duration_sec);
+            }
+            break;
+        }
+
+        case VP_LIGHT_AUTO:
+            debug_printf("[HMI] Light auto setting changed to %s\n",
+                         vp.light_auto ? "ENABLED" : "DISABLED");
+            break;
+
+        case VP_WATER_AUTO:
+            debug_printf("[HMI] Spray auto setting changed to %s\n",
+                         vp.water_auto ? "ENABLED" : "DISABLED");
+            break;
+
+        case VP_FAN_AUTO:
+            debug_printf("[HMI] Fan auto setting changed to %s\n",
+                         vp.fan_auto ? "ENABLED" : "DISABLED");
+            break;
+
+        default:
+            break;
+    }
+    return n;
+}
+
 // == Callback function for DWIN events ===
 void hmi_on_event(String address, int data, String message, String response) {
-    if (xSemaphoreTake(xVPMutex, portMAX_DELAY) == pdTRUE) {
+    metric_inc(&metric_hmi_frames_rx);
+
+    // Panel system registers are not VPs, keep them out of the table
+    if (strtol(address.c_str(), NULL, 16) == VP_RTC) {
+        hmi_rtc_on_reply(response.c_str());
+        return;
+    }
+
+    // Touch trace, stamped again along the path to the relay
+    uint16_t trace_id = trace_begin();
+    uint16_t derived[VP_DERIVED_MAX];
+    size_t n_derived = 0;
+
+    if (vp_lock()) {
         uint16_t vp_addr = strtol(address.c_str(), NULL, 16);
         bool updated = false;
         
@@ -355,83 +778,20 @@ void hmi_on_event(String address, int data, String message, String response) {
             }
         }
 
-        // Update HMI display based on the address
         if (updated) {
-            switch (vp_addr) {
-                case VP_TOTAL_CYCLE:
-                case VP_GROWTH_DAY: {
-                    // Prevent division by zero
-                    if (vp.total_cycle < 1) {
-                        vp.total_cycle = 1;
-                        vp_sync_item(VP_TOTAL_CYCLE, &vp.total_cycle);
-                    }
-                    if (vp.growth_day < 1) {
-                        vp.growth_day = 1;
-                        vp_sync_item(VP_GROWTH_DAY, &vp.growth_day);
-
-                    }
-
-                    vp_growth_bar_update();
-                    hmi_update_value(VP_GROWTH_BAR);
-                    hmi_update_string(VP_GROWTH_STR);
-                    break;
-                }
-
-                case VP_WATER_INTERVAL_HR: {
-                    if (vp.water_interval_hr < 1) {
-                        vp.water_interval_hr = 1;
-                        vp_sync_item(VP_WATER_INTERVAL_HR, &vp.water_interval_hr);
-
-                    } else if (vp.water_interval_hr > 12) {
-                        vp.water_interval_hr = 12;
-                        vp_sync_item(VP_WATER_INTERVAL_HR, &vp.water_interval_hr);
-                    }
-                    break;
-                }
+            trace_mark(trace_id, TRACE_SYNCED);
+            n_derived = vp_apply_change(vp_addr, derived);
 
-                case VP_WATER_DURATION_SEC: {
-                    if (vp.water_duration_sec < 1) {
-                        vp.water_duration_sec = 1;
-                        vp_sync_item(VP_WATER_DURATION_SEC, &vp.water_duration_sec);
-
-                    } else if (vp.water_duration_sec > 99) {
-                        vp.water_duration_sec = 99;
-                        vp_sync_item(VP_WATER_DURATION_SEC, &vp.water_duration_sec);
-                    }
-                    break;
-                }
-
-                case VP_LIGHT_AUTO:
-                    debug_print("[HMI] Light auto setting changed to ");
-                    debug_println(vp.light_auto ? "ENABLED" : "DISABLED");
-                    break;
-
-                case VP_WATER_AUTO:
-                    debug_print("[HMI] Spray auto setting changed to ");
-                    debug_println(vp.water_auto ? "ENABLED" : "DISABLED");
-                    break;
-
-                case VP_FAN_AUTO:
-                    debug_print("[HMI] Fan auto setting changed to ");
-                    debug_println(vp.fan_auto ? "ENABLED" : "DISABLED");
-                    break;
-
-                case VP_LIGHT_STATE:
-                    hmi_update_value(VP_LIGHT_STATE);
-                    break;
-
-                case VP_WATER_STATE:
-                    hmi_update_value(VP_WATER_STATE);
-                    break;
-
-                case VP_FAN_STATE:
-                    hmi_update_value(VP_FAN_STATE);
-                    break;
-
-                default:
-                    break;
+            // Relay follows the switch, TaskHMI drives the pin
+            if (io_pin_map(vp_addr) != 0) {
+                hmi_update_traced(vp_addr, trace_id);
+                trace_mark(trace_id, TRACE_QUEUED);
             }
         }
-        xSemaphoreGive(xVPMutex);
+        vp_unlock();
+    }
+
+    for (size_t i = 0; i < n_derived; i++) {
+        hmi_update_item(derived[i]);
     }
 }
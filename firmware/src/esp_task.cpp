@@ -4,6 +4,8 @@
 TaskHandle_t xHMITaskHandle = NULL;
 TaskHandle_t xWiFiTaskHandle = NULL;
 TaskHandle_t xSyncTaskHandle = NULL;
+TaskHandle_t xLogTaskHandle = NULL;
+TaskHandle_t xSupervisorTaskHandle = NULL;
 
 // Mutex for shared resources
 SemaphoreHandle_t xVPMutex = NULL;
@@ -13,7 +15,20 @@ QueueHandle_t xHMIUpdateQueue = NULL;
 
 // Events
 EventGroupHandle_t eventGroup = xEventGroupCreate();
-const EventBits_t WIFI_CONNECTED_BIT = BIT0;
+
+// === Full HMI refresh ===
+// Every VP 30 ms apart, ~1.3 s, beating for each
+static void hmi_send_all(void) {
+    debug_verbosef("[HMI] Processing full update request\n");
+
+    for (size_t i = 0; i < num_vp_items; i++) {
+        supervisor_beat(supervisor_hmi_id);
+        hmi_send_item(i);
+
+        // Short delay between updates
+        vTaskDelay(pdMS_TO_TICKS(30));
+    }
+}
 
 // === HMI Task ===
 void TaskHMI(void *pvParameters) {
@@ -28,7 +43,15 @@ void TaskHMI(void *pvParameters) {
     TickType_t last_listen_time = xTaskGetTickCount();
     const TickType_t listen_interval = pdMS_TO_TICKS(10); // Listen every 10ms
 
+    // Offline-first time, the reply is picked up by the next listen
+    hmi_rtc_request();
+    TickType_t last_rtc_request = last_listen_time;
+    uint8_t rtc_tries = 1;
+
+    supervisor_hmi_id = supervisor_register("hmi", TASK_PERIOD_HMI_MS, TASK_DEADLINE_HMI_MS);
+
     for (;;) {
+        supervisor_beat(supervisor_hmi_id);
         TickType_t current_time = xTaskGetTickCount();
 
         // Process incoming HMI data
@@ -37,22 +60,39 @@ void TaskHMI(void *pvParameters) {
             last_listen_time = current_time;
         }
 
-        // Process queued HMI updates
+        // Panel may still be booting, ask again until a source is set
+        if (rtc_tries < RTC_READ_MAX_TRIES && !time_is_valid() &&
+            (current_time - last_rtc_request) >= pdMS_TO_TICKS(RTC_READ_RETRY_MS)
+        ) {
+            hmi_rtc_request();
+            last_rtc_request = current_time;
+            rtc_tries++;
+        }
+
+        // Process queued HMI updates, each one counts as a loop
         while (xQueueReceive(xHMIUpdateQueue, &msg, 0) == pdTRUE) {
+            supervisor_beat(supervisor_hmi_id);
+            metric_inc(&metric_hmi_updates);
+
             if (msg.type == HMI_UPDATE_VALUE) {
+                trace_mark(msg.trace_id, TRACE_DEQUEUED);
                 uint8_t val = 0;
-                if (xSemaphoreTake(xVPMutex, portMAX_DELAY) == pdTRUE) {
+                if (vp_lock()) {
                     val = vp_get_value(msg.address);
-                    xSemaphoreGive(xVPMutex);
+                    vp_unlock();
                 } 
                 
                 // Update HMI display
                 hmi.setVP(msg.address, val);
+                metric_inc(&metric_hmi_frames_tx);
+                trace_mark(msg.trace_id, TRACE_SENT);
                 
                 // Control relay if pin is assigned
                 uint8_t pin = io_pin_map(msg.address);
                 if (pin != 0) {
                     digitalWrite(pin, val);
+                    trace_mark(msg.trace_id, TRACE_RELAY);
+                    journal_relay(pin, val);
                 }
                 
                 // Short delay to process
@@ -61,7 +101,7 @@ void TaskHMI(void *pvParameters) {
             } else if (msg.type == HMI_UPDATE_STRING) {
                 const char* str = "";
                 size_t maxlen = 0;
-                if (xSemaphoreTake(xVPMutex, portMAX_DELAY) == pdTRUE) {
+                if (vp_lock()) {
                     str = vp_get_string(msg.address);
                     
                     // Find the storage_size for this address
@@ -72,88 +112,35 @@ void TaskHMI(void *pvParameters) {
                             break;
                         }
                     }
-                    xSemaphoreGive(xVPMutex);
+                    vp_unlock();
                 }
-                        
-                // Create padded string
-                String padded_str;
-                if (str && maxlen > 0) {
-                    size_t real_len = strnlen(str, maxlen);
-                    padded_str.reserve(maxlen);
-                    padded_str = String(str).substring(0, real_len);
-                    while (padded_str.length() < maxlen) {
-                        padded_str += ' ';
-                    }
 
-                } else if (maxlen > 0) {
-                    // Send blank string with full padding
-                    padded_str = String(maxlen, ' ');
-                
-                } else {
-                    padded_str = ""; // No padding if maxlen is 0
-                }
-                
                 // Update HMI display
-                hmi.setText(msg.address, padded_str);
+                hmi.setText(msg.address, hmi_pad_string(str, maxlen));
+                metric_inc(&metric_hmi_frames_tx);
                 
                 // Short delay to process
                 vTaskDelay(pdMS_TO_TICKS(30));
 
             } else if (msg.type == HMI_UPDATE_ALL) {
-                debug_println("[HMI] Processing full update request");
-                
-                // Update all VP items
-                for (size_t i = 0; i < num_vp_items; i++) {
-                    if (vp_items[i].type == VP_UINT8) {
-                        uint8_t val = 0;
-                        if (xSemaphoreTake(xVPMutex, portMAX_DELAY) == pdTRUE) {
-                            val = vp_get_value(vp_items[i].address);
-                            xSemaphoreGive(xVPMutex);
-                        }
-                        hmi.setVP(vp_items[i].address, val);
-                        
-                        // Control relay if pin is assigned
-                        uint8_t pin = io_pin_map(vp_items[i].address);
-                        if (pin != 0) {
-                            digitalWrite(pin, val);
-                        }
+                hmi_update_all_taken();
+                hmi_send_all();
 
-                    } else if (vp_items[i].type == VP_STRING) {
-                        const char* str = "";
-                        size_t maxlen = vp_items[i].storage_size;
-                        if (xSemaphoreTake(xVPMutex, portMAX_DELAY) == pdTRUE) {
-                            str = vp_get_string(vp_items[i].address);
-                            xSemaphoreGive(xVPMutex);
-                        }
-                        
-                        // Create padded string
-                        String padded_str;
-                        if (str && maxlen > 0) {
-                            size_t real_len = strnlen(str, maxlen);
-                            padded_str.reserve(maxlen);
-                            padded_str = String(str).substring(0, real_len);
-                            while (padded_str.length() < maxlen) {
-                                padded_str += ' ';
-                            }
-
-                        } else if (maxlen > 0) {
-                            // Send blank string with full padding
-                            padded_str = String(maxlen, ' ');
-                        
-                        } else {
-                            padded_str = ""; // No padding if maxlen is 0
-                        }
-                        
-                        hmi.setText(vp_items[i].address, padded_str);
-                    }
+            } else if (msg.type == HMI_UPDATE_RTC) {
+                hmi_rtc_write();
+
+                // Short delay to process
+                vTaskDelay(pdMS_TO_TICKS(30));
 
-                    // Short delay between updates
-                    vTaskDelay(pdMS_TO_TICKS(30));
-                }
             } else {
-                debug_printf("[HMI] Unknown update type: %d\n", msg.type);
+                debug_warnf("[HMI] Unknown update type: %d\n", msg.type);
             }
         }
+
+        // Refresh asked for while the queue was full
+        if (hmi_update_all_deferred()) {
+            hmi_send_all();
+        }
         
         // Yield to other tasks
         vTaskDelay(pdMS_TO_TICKS(1));
@@ -164,205 +151,58 @@ void TaskHMI(void *pvParameters) {
 void TaskWiFi(void *pvParameters) {
     debug_printf("[WiFi] Task started on core %d\n", xPortGetCoreID());
     
-    WiFiManager wm;
-    int retries = 0;
-    bool ap_mode_active = false;
-    bool wifi_connected = false;
-    static TickType_t last_ntp_sync = 0;
-    static TickType_t last_wifi_check = 0;
-    
-    // Configure WiFiManager
-    wm.setDebugOutput(false);
-    wm.setConfigPortalTimeout(WIFI_AP_TIMEOUT);
-    
-    // Custom menu for WiFiManager
-    std::vector<const char *> menu = {"wifi", "wifinoscan", "exit"};
-    wm.setMenu(menu);
-
-    // Set custom HTML for the configuration portal
-    const char* customHeadElement = R"rawliteral(
-      <style>
-        #hostname, label[for="hostname"], input[name="hostname"] { display: none !important; }
-      </style>
-    )rawliteral";
-    wm.setCustomHeadElement(customHeadElement);
+    // Portal and STA connection are polled from here on
+    wifi_portal_begin();
+    wifi_link_begin(wifi_on_link_change);
+    mqtt_bridge_begin();
 
-    for (;;) {
-        // Check if AP mode should be activated
-        if (vp.wifi_ap_state && !ap_mode_active) {
-            debug_println("[WiFi] Enabling AP mode for configuration");
-            
-            // Enter AP mode
-            WiFi.disconnect(true);
-            WiFi.mode(WIFI_AP);
-            ap_mode_active = true;
-            
-            // Clear WiFi connected event
-            wifi_connected = false;
-            xEventGroupClearBits(eventGroup, WIFI_CONNECTED_BIT);
-
-            // HMI AP mode parameters
-            if (xSemaphoreTake(xVPMutex, portMAX_DELAY) == pdTRUE) {
-                vp_set_string(VP_HOLDER_SIGNAL, "Password"); // For HMI
-                vp_set_string(VP_PSWD_AND_SIGNAL, WIFI_AP_PSWD);
-                vp_set_string(VP_IP_ADDRESS, WiFi.softAPIP().toString().c_str());
-                vp_save_values();
-                xSemaphoreGive(xVPMutex);
-            }
-            
-            // Update HMI
-            // hmi_update_text(VP_WIFI_SSID);
-            // hmi_update_text(VP_IP_ADDRESS);
-            // hmi_update_text(VP_HOLDER_SIGNAL);
-            //hmi_update_text(VP_PSWD_AND_SIGNAL);
-            
-            // Start configuration portal
-            debug_printf("[WiFi AP] SSID: %s\n", vp.hostname);
-            debug_printf("[WiFi AP] Password: %s\n", WIFI_AP_PSWD);
-            debug_printf("[WiFi AP] IP Address: %s\n", vp.ip_address);
-            
-            if (!wm.startConfigPortal(vp.hostname, WIFI_AP_PSWD)) {
-                debug_println("[WiFi AP] Config portal timeout, no WiFi configured");
-                
-                // Reset AP state and return to STA mode
-                if (xSemaphoreTake(xVPMutex, portMAX_DELAY) == pdTRUE) {
-                    vp_set_value(VP_WIFI_STATE, 1);
-                    vp_set_value(VP_WIFI_AP_STATE, 0);
-                    vp_save_values();
-                    xSemaphoreGive(xVPMutex);
-                }
+    supervisor_wifi_id = supervisor_register("wifi", TASK_PERIOD_WIFI_MS, TASK_DEADLINE_WIFI_MS);
 
-            } else {
-                // Configuration successful - save credentials
-                debug_println("[WiFi AP] Saved WiFi credentials");
-                
-                // Save credentials and exit AP mode
-                if (xSemaphoreTake(xVPMutex, portMAX_DELAY) == pdTRUE) {
-                    // Save WiFi credentials
-                    vp_set_string(VP_WIFI_SSID, WiFi.SSID().c_str());
-                    vp_set_string(VP_WIFI_PSWD, WiFi.psk().c_str());
-                    
-                    // Reset AP state
-                    vp_set_value(VP_WIFI_STATE, 1);
-                    vp_set_value(VP_WIFI_AP_STATE, 0);
-                    vp_set_string(VP_HOLDER_SIGNAL, "Signal Strength");
-                    vp_set_string(VP_PSWD_AND_SIGNAL, "Connected");
-                    vp_save_values();
-                    xSemaphoreGive(xVPMutex);
-                }
-            }
+    for (;;) {
+        supervisor_beat(supervisor_wifi_id);
 
-            // Exit AP mode
-            WiFi.disconnect(true);
-            ap_mode_active = false;
-            debug_println("[WiFi] Exiting AP mode!");
-        }
-        
-        // WiFi STA mode - Runs on boot & after AP mode is disabled
-        if (!ap_mode_active &&
-            !wifi_connected &&
-            vp.wifi_state &&
-            strlen(vp.wifi_ssid) > 0 &&
-            last_wifi_check == 0
-        ) {
-            debug_printf("[WiFi] Attempting to connect to: %s\n", vp.wifi_ssid);
-            
-            WiFi.mode(WIFI_STA);
-            WiFi.begin(vp.wifi_ssid, vp.wifi_pswd);
-            
-            // Wait for connection with timeout
-            while (
-                WiFi.status() != WL_CONNECTED &&
-                retries < WIFI_STA_MAX_RETRY
-            ) {
-                // Random delay between 3 and 10 seconds
-                uint32_t delay_ms = 3000 + (esp_random() % 7000);
-                vTaskDelay(pdMS_TO_TICKS(delay_ms));
-                retries++;
-                debug_printf("[WiFi] Retries: %d, delay: %u sec\n", retries, delay_ms / 1000);
-            }
+        // Provisioning portal, opened and closed from the HMI
+        wifi_portal_poll();
 
-            // If max retries reached, enter delay period before next attempt
-            if (retries >= WIFI_STA_MAX_RETRY) {
-                if (last_wifi_check == 0) {
-                    last_wifi_check = xTaskGetTickCount();
-                    debug_println("[WiFi] Max retries reached, Entering retry delay period!");
-                }
-            }
+        // Network services only while the link has an IP
+        bool link_up = xEventGroupGetBits(eventGroup) & WIFI_CONNECTED_BIT;
+        if (link_up) {
+            // Handle OTA updates and other WiFi services
+            ArduinoOTA.handle();
             
-            // Check connection result
-            if (WiFi.status() == WL_CONNECTED) {
-                retries = 0;
-                wifi_connected = true;
-                xEventGroupSetBits(eventGroup, WIFI_CONNECTED_BIT);
-                
-                // Save IP address
-                if (xSemaphoreTake(xVPMutex, portMAX_DELAY) == pdTRUE) {
-                    vp_set_string(VP_IP_ADDRESS, WiFi.localIP().toString().c_str());
-                    // TODO: Update signal strength
-                    vp_save_values();
-                    xSemaphoreGive(xVPMutex);
-                }
-                debug_printf("[WiFi] Connected! IP Address: %s\n", vp.ip_address);
+            // Periodic NTP sync, returns immediately
+            ntp_sync_poll();
 
-                // Initialize WiFi-dependent services
-                ota_init();
-                ota_mdns_init();
-                ntp_client_init();
-                ntp_client_update(true);
+            // Signal quality on the HMI, only when the level changes
+            wifi_signal_poll(millis());
 
-                // TODO: Update HMI
-
-            } else {
-                debug_println("[WiFi] Failed to connect to WiFi!!");
-                WiFi.disconnect(true);
-                wifi_connected = false;
-                xEventGroupClearBits(eventGroup, WIFI_CONNECTED_BIT);
-            }
-        }
-            
-        // Handle WiFi connection maintenance
-        if (wifi_connected) {
-            // Check if WiFi is still connected
-            if (WiFi.status() != WL_CONNECTED) {
-                debug_println("[WiFi] Disconnected from WiFi");
-
-                // Clear WiFi connected event
-                wifi_connected = false;
-                xEventGroupClearBits(eventGroup, WIFI_CONNECTED_BIT);
-                
-                // Save disconnection status
-                if (xSemaphoreTake(xVPMutex, portMAX_DELAY) == pdTRUE) {
-                    vp_set_string(VP_IP_ADDRESS, "0.0.0.0");
-                    vp_set_string(VP_PSWD_AND_SIGNAL, "Disconnected");
-                    vp_save_values();
-                    xSemaphoreGive(xVPMutex);
-                }
+            // VP API, answers queued requests without waiting on clients
+            vp_http_poll();
 
-                // TODO: Update HMI
-            } else {
-                // Handle OTA updates and other WiFi services
-                ArduinoOTA.handle();
-                
-                // Periodic NTP sync
-                if ((xTaskGetTickCount() - last_ntp_sync) > pdMS_TO_TICKS(NTP_UPDATE_INTERVAL)) {
-                    ntp_client_update();
-                    last_ntp_sync = xTaskGetTickCount();
-                }
-            }
+            // Live VP stream, one frame in flight per client
+            vp_ws_poll(millis());
         }
 
-        // Reset retries after delay
-        if (last_wifi_check != 0 &&
-            (xTaskGetTickCount() - last_wifi_check) > pdMS_TO_TICKS(WIFI_STA_RETRY_DELAY)
-        ) {
-            retries = 0;
-            last_wifi_check = 0;
-            debug_println("[WiFi] Retry delay elapsed, Trying to reconnect");
+        // Telemetry batches are queued offline too, sent once connected
+        mqtt_bridge_poll(millis(), link_up);
+
+        // Connection state machine, also the loop delay: wakes on WiFi
+        // events, short while the portal is open, a request is half read,
+        // an MQTT backlog is sent or a connect is in flight, an NTP reply
+        // is due or a stream is open
+        uint32_t wait_ms = WIFI_LOOP_MS;
+        if (wifi_portal_active()) {
+            wait_ms = WIFI_PORTAL_POLL_MS;
+        } else if (vp_http_busy()) {
+            wait_ms = VP_HTTP_POLL_MS;
+        } else if (mqtt_bridge_busy()) {
+            wait_ms = MQTT_POLL_MS;
+        } else if (ntp_sync_busy()) {
+            wait_ms = NTP_POLL_MS;
+        } else if (vp_ws_busy()) {
+            wait_ms = VP_WS_POLL_MS;
         }
-
-        // Yield to other tasks
-        vTaskDelay(pdMS_TO_TICKS(500));
+        wifi_link_poll(wait_ms);
     }
 }
 
@@ -371,113 +211,54 @@ void TaskSync(void *pvParameters) {
     debug_printf("[SYNC] Task started on core %d\n", xPortGetCoreID());
 
     // Constants
-    const uint16_t GRACE_PERIOD_MIN = 1;  // Error grace period in minutes
     const TickType_t AUTOMATION_INTERVAL = pdMS_TO_TICKS(500); // 500 ms
     const TickType_t TIME_UPDATE_INTERVAL = pdMS_TO_TICKS(5000); // 5 secs
+    const TickType_t TRACE_PRINT_INTERVAL = pdMS_TO_TICKS(TRACE_PRINT_MS);
     const TickType_t TASK_YIELD_DELAY = pdMS_TO_TICKS(50); // 50 ms
 
     // State variables
     static bool on_boot = true;
-    static uint32_t last_spray_time = 0;
+    static bool time_wait_logged = false;
 
     // Timer tracking for periodic operations
     static TickType_t current_time;
     static TickType_t last_auto_check = 0;
     static TickType_t last_time_check = 0;
-    static uint16_t last_auto_minute = UINT16_MAX;
+    static TickType_t last_trace_print = 0;
+
+    supervisor_sync_id = supervisor_register("sync", TASK_PERIOD_SYNC_MS, TASK_DEADLINE_SYNC_MS);
 
     for (;;) {
+        supervisor_beat(supervisor_sync_id);
         current_time = xTaskGetTickCount();
 
-        // Automation checks (every interval)
-        if ((current_time - last_auto_check) >= AUTOMATION_INTERVAL) {
-            last_auto_check = current_time;
+        // One consistent clock snapshot per loop
+        time_snapshot_t now;
+        time_now(&now);
 
-            // Get current time
-            int raw_hours = timeClient.getHours();
-            int raw_minutes = timeClient.getMinutes();
-            int raw_seconds = timeClient.getSeconds();
+        // Automation checks (every interval, at once when time turns valid)
+        if ((current_time - last_auto_check) >= AUTOMATION_INTERVAL ||
+            (on_boot && now.valid)
+        ) {
+            last_auto_check = current_time;
 
             // Validate time before proceeding
-            if (is_valid_time(raw_hours, raw_minutes, raw_seconds)) {
-                uint16_t hours = (uint16_t)raw_hours;
-                uint16_t minutes = (uint16_t)raw_minutes;
-                uint16_t seconds = (uint16_t)raw_seconds;
-
+            if (now.valid) {
                 // Take mutex for shared resource access
-                if (xSemaphoreTake(xVPMutex, portMAX_DELAY) != pdTRUE) {
-                    debug_println(
-                        "[SYNC] Failed to acquire mutex, yielding task");
+                if (!vp_lock()) {
+                    debug_warnf("[SYNC] Failed to acquire mutex, yielding task\n");
                     goto yield_task_sync;
                 }
 
-                // Handle per-minute automation
-                if (minutes != last_auto_minute) {
-                    // Light automation
-                    if (vp.light_auto) {
-                        io_pin_trigger(
-                            vp.light_auto, vp.light_state,
-                            vp.light_on_hr, vp.light_on_min,
-                            vp.light_off_hr, vp.light_off_min,
-                            hours, minutes,
-                            GRACE_PERIOD_MIN, on_boot,
-                            VP_LIGHT_STATE, "Light"
-                        );
-                    }
-
-                    // Fan automation
-                    if (vp.fan_auto) {
-                        io_pin_trigger(
-                            vp.fan_auto, vp.fan_state,
-                            vp.fan_on_hr, vp.fan_on_min,
-                            vp.fan_off_hr, vp.fan_off_min,
-                            hours, minutes,
-                            GRACE_PERIOD_MIN, on_boot,
-                            VP_FAN_STATE, "Fan"
-                        );
-                    }
-
-                    // Growth day increment at midnight
-                    if ((!on_boot) &&
-                        hours == 0 &&
-                        minutes == 0 &&
-                        last_auto_minute != 0
-                    ) {
-                        vp.growth_day++;
-
-                        // Update shared variables and HMI
-                        snprintf(
-                            vp.growth_str,
-                            sizeof(vp.growth_str), 
-                            "%u", vp.growth_day
-                        );
-                        vp_sync_item(VP_GROWTH_DAY, &vp.growth_day);
-                        vp_growth_bar_update();
-                        hmi_update_value(VP_GROWTH_BAR);
-                        hmi_update_string(VP_GROWTH_STR);
-                        debug_printf(
-                            "[SYNC] Growth day incremented to %u\n",
-                            vp.growth_day);
-                    }
-                    
-                    last_auto_minute = minutes;
-                }
+                // Relays, spray and growth day for this snapshot
+                int64_t run_start = esp_timer_get_time();
+                io_automation_run(&now);
+                metric_inc(&metric_sched_evals);
+                metric_set(&metric_sched_last_us,
+                           (int32_t)(esp_timer_get_time() - run_start));
 
-                // Spray automation runs every cycle
-                if (vp.water_auto) {
-                    io_pin_trigger_interval(
-                        vp.water_auto, vp.water_state,
-                        vp.water_on_hr, vp.water_on_min,
-                        vp.water_off_hr, vp.water_off_min,
-                        hours, minutes, seconds,
-                        vp.water_interval_hr, vp.water_duration_sec,
-                        VP_WATER_STATE, "Spray",
-                        &last_spray_time
-                    );
-                }
-                
                 // Release mutex after operations
-                xSemaphoreGive(xVPMutex);
+                vp_unlock();
 
                 // Handle boot flag (one-time operation)
                 if (on_boot) {
@@ -485,8 +266,9 @@ void TaskSync(void *pvParameters) {
                     debug_println("[SYNC] Boot automation check completed");
                 }
 
-            } else {
-                debug_printf("[SYNC] Invalid time: %d:%d\n", raw_hours, raw_minutes);
+            } else if (on_boot && !time_wait_logged) {
+                debug_println("[SYNC] Invalid time, waiting for time sync");
+                time_wait_logged = true;
             }
         }
 
@@ -494,20 +276,13 @@ void TaskSync(void *pvParameters) {
         if ((current_time - last_time_check) >= TIME_UPDATE_INTERVAL) {
             last_time_check = current_time;
 
-            // Get current time
-            int raw_hours = timeClient.getHours();
-            int raw_minutes = timeClient.getMinutes();
-
-            if (is_valid_time(raw_hours, raw_minutes, 0)) {
-                uint16_t hours = (uint16_t)raw_hours;
-                uint16_t minutes = (uint16_t)raw_minutes;
-
+            if (now.valid) {
                 // Format time string
                 char time[6] = {0};
-                snprintf(time, sizeof(time), "%02u:%02u", hours, minutes);
+                snprintf(time, sizeof(time), "%02u:%02u", now.hours, now.minutes);
 
                 // Update only if changed to display on HMI
-                if (xSemaphoreTake(xVPMutex, portMAX_DELAY) == pdTRUE) {
+                if (vp_lock()) {
                     const char* cur = vp_get_string(VP_TIME);
                     if ((cur == NULL || strcmp(cur, time) != 0) &&
                         time[0] != '\0') {
@@ -515,12 +290,44 @@ void TaskSync(void *pvParameters) {
                         vp_save_values();
                         hmi_update_string(VP_TIME);
                     }
-                    xSemaphoreGive(xVPMutex);
+                    vp_unlock();
                 }
             }
         }
 
+        // Touch latency summary on serial, after new touches only
+        if ((current_time - last_trace_print) >= TRACE_PRINT_INTERVAL) {
+            last_trace_print = current_time;
+            trace_print();
+        }
+
         yield_task_sync:
         vTaskDelay(pdMS_TO_TICKS(50));
     }
 }
+
+// === Console Task ===
+void TaskLog(void *pvParameters) {
+    // Producers only fill the ring and the journal queue, the UART and
+    // flash waits happen here
+    supervisor_log_id = supervisor_register("log", TASK_PERIOD_LOG_MS, TASK_DEADLINE_LOG_MS);
+
+    for (;;) {
+        supervisor_beat(supervisor_log_id);
+        log_ring_flush();
+        journal_flush();
+        journal_console_poll();
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_MS));
+    }
+}
+
+// === Supervisor Task ===
+void TaskSupervisor(void *pvParameters) {
+    // Highest priority, a task spinning past its deadline cannot keep
+    // the miss from being logged
+    supervisor_begin();
+    for (;;) {
+        supervisor_poll();
+        vTaskDelay(pdMS_TO_TICKS(SUPERVISOR_PERIOD_MS));
+    }
+}
@@ -0,0 +1,346 @@
+#include "global.h"
+#include <esp_timer.h>
+#include <time.h>
+
+// === Clock Anchor ===
+// UTC epoch at a monotonic instant, written by time sources only.
+// Between anchors the clock runs at the monotonic rate corrected by
+// time_freq_ppb, plus any pending slew at TIME_SLEW_PPM.
+static portMUX_TYPE time_mux = portMUX_INITIALIZER_UNLOCKED;
+static bool time_valid = false;
+static int64_t anchor_epoch_us = 0; // UTC microseconds at anchor_us
+static int64_t anchor_us = 0;
+static int64_t slew_us = 0;         // Correction still to apply after anchor_us
+static int32_t time_freq_ppb = 0;   // Oscillator correction, + runs faster
+static uint32_t time_jump_count = 0;
+static time_source_t time_source = TIME_SOURCE_NONE;
+
+// === Drift Estimator ===
+static int64_t drift_sample_us = 0; // Monotonic time of the last sample, 0 = none
+static int64_t drift_offset_us = 0; // Last measured offset
+static uint8_t drift_stable = 0;    // Consecutive samples under the lock limit
+static uint32_t drift_samples = 0;
+
+// === Clock at a monotonic instant ===
+/**
+ * @brief Evaluates the disciplined clock at `mono_us`.
+ * @note Call inside time_mux.
+ */
+static int64_t time_eval_locked(int64_t mono_us, int64_t *slew_left) {
+    int64_t elapsed = mono_us - anchor_us;
+    int64_t epoch_us = anchor_epoch_us + elapsed +
+                       elapsed * time_freq_ppb / 1000000000LL;
+
+    // Slew at a bounded rate so the clock never steps or runs backwards
+    int64_t max_slew = elapsed * TIME_SLEW_PPM / 1000000;
+    int64_t applied = slew_us > max_slew ? max_slew :
+                      slew_us < -max_slew ? -max_slew : slew_us;
+    if (slew_left) {
+        *slew_left = slew_us - applied;
+    }
+    return epoch_us + applied;
+}
+
+// === Fold elapsed time into the anchor ===
+static void time_reanchor_locked(int64_t mono_us) {
+    int64_t slew_left;
+    anchor_epoch_us = time_eval_locked(mono_us, &slew_left);
+    anchor_us = mono_us;
+    slew_us = slew_left;
+}
+
+// === Log steps the scheduler will notice ===
+static void time_note_step(int64_t step_us) {
+    if (step_us >= TIME_JUMP_LOG_SEC * 1000000LL ||
+        step_us <= -TIME_JUMP_LOG_SEC * 1000000LL
+    ) {
+        time_jump_count++;
+        debug_printf("[TIME] Clock jump of %+lld s detected on resync\n",
+                    (long long)(step_us / 1000000));
+    }
+}
+
+// === Set time from a source ===
+/**
+ * @brief Re-anchors the clock to `epoch_us` (UTC microseconds) at the
+ * current monotonic instant.
+ * @note Epochs below TIME_MIN_VALID_EPOCH are rejected so a failed
+ * source can never mark 1970 as valid.
+ * @return false if the epoch was rejected.
+ */
+bool time_set_epoch_us(int64_t epoch_us) {
+    if (epoch_us < (int64_t)TIME_MIN_VALID_EPOCH * 1000000) {
+        debug_warnf("[TIME] Rejected epoch %lld\n",
+                    (long long)(epoch_us / 1000000));
+        return false;
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    bool was_valid;
+    int64_t step_us;
+
+    portENTER_CRITICAL(&time_mux);
+    was_valid = time_valid;
+    step_us = epoch_us - time_eval_locked(now_us, NULL);
+    anchor_epoch_us = epoch_us;
+    anchor_us = now_us;
+    slew_us = 0;
+    time_valid = true;
+    portEXIT_CRITICAL(&time_mux);
+
+    // A step invalidates the drift baseline, not the learned frequency
+    drift_sample_us = 0;
+    drift_stable = 0;
+
+    // Resync moved the clock, the scheduler will replay or resync
+    if (was_valid) {
+        time_note_step(step_us);
+    }
+    return true;
+}
+
+void time_set_epoch(uint32_t epoch) {
+    time_set_epoch_us((int64_t)epoch * 1000000);
+}
+
+// === Time source arbiter ===
+/**
+ * @brief Sets the clock from `source` unless a better source already
+ * did. The panel RTC gives a valid time at boot without WiFi, NTP
+ * takes over once reachable.
+ * @return true if the clock was set.
+ */
+bool time_source_offer(time_source_t source, int64_t epoch_us) {
+    if (source < time_source) {
+        return false;
+    }
+
+    if (!time_set_epoch_us(epoch_us)) {
+        return false;
+    }
+
+    if (source != time_source) {
+        debug_printf("[TIME] Time source is now %s\n", time_source_name(source));
+        time_source = source;
+    }
+    return true;
+}
+
+time_source_t time_source_get(void) {
+    return time_source;
+}
+
+const char *time_source_name(time_source_t source) {
+    switch (source) {
+        case TIME_SOURCE_RTC:
+            return "RTC";
+        case TIME_SOURCE_NTP:
+            return "NTP";
+        default:
+            return "none";
+    }
+}
+
+// === Local calendar fields to UTC epoch ===
+/**
+ * @brief Inverse of the local fields in time_now(), independent of the
+ * C library time zone.
+ * @return UTC seconds, 0 if a field is out of range.
+ */
+uint32_t time_epoch_from_local(
+    uint16_t year, uint8_t month, uint8_t day,
+    uint8_t hours, uint8_t minutes, uint8_t seconds
+) {
+    if (year < 1970 || month < 1 || month > 12 || day < 1 || day > 31 ||
+        hours > 23 || minutes > 59 || seconds > 59
+    ) {
+        return 0;
+    }
+
+    // Days from civil, March based so the leap day ends the year
+    int32_t y = year - (month <= 2);
+    int32_t era = y / 400;
+    uint32_t yoe = (uint32_t)(y - era * 400);
+    uint32_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int64_t days = (int64_t)era * 146097 + doe - 719468;
+
+    int64_t local = days * 86400 + hours * 3600 + minutes * 60 + seconds;
+    return (uint32_t)(local - TIME_LOCAL_OFFSET);
+}
+
+// === Step a valid clock by a measured offset ===
+/**
+ * @brief Moves the clock by `offset_us` at once, as measured by a time
+ * source against time_epoch_us(). Cancels any pending slew.
+ * @return false if the clock is not valid yet.
+ */
+bool time_adjust_us(int64_t offset_us) {
+    int64_t now_us = esp_timer_get_time();
+    bool valid;
+
+    portENTER_CRITICAL(&time_mux);
+    valid = time_valid;
+    if (valid) {
+        time_reanchor_locked(now_us);
+        anchor_epoch_us += offset_us;
+        slew_us = 0;
+    }
+    portEXIT_CRITICAL(&time_mux);
+
+    if (valid) {
+        drift_sample_us = 0;
+        drift_stable = 0;
+        time_note_step(offset_us);
+    }
+    return valid;
+}
+
+// === Apply a measured offset from a time source ===
+/**
+ * @brief Feeds one offset sample (source minus local, microseconds) to
+ * the clock discipline.
+ * @note Offsets of TIME_STEP_US or more are stepped. Smaller ones are
+ * slewed at TIME_SLEW_PPM, and the part not explained by the pending
+ * slew updates the oscillator frequency estimate.
+ * @return true if the clock was stepped.
+ */
+bool time_discipline(int64_t offset_us) {
+    if (!time_is_valid()) {
+        return false;
+    }
+
+    if (offset_us >= TIME_STEP_US || offset_us <= -TIME_STEP_US) {
+        time_adjust_us(offset_us);
+        drift_sample_us = esp_timer_get_time();
+        drift_offset_us = offset_us;
+        return true;
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    int64_t slew_left;
+
+    portENTER_CRITICAL(&time_mux);
+    time_reanchor_locked(now_us);
+    slew_left = slew_us;
+
+    // Offset built up since the last sample, beyond what is still pending.
+    // Samples closer than TIME_DRIFT_MIN_SAMPLE_US are slewed only.
+    int64_t dt = now_us - drift_sample_us;
+    bool estimate = drift_sample_us != 0 && dt >= TIME_DRIFT_MIN_SAMPLE_US;
+    int32_t sample_ppb = 0;
+    if (estimate) {
+        sample_ppb = (int32_t)((offset_us - slew_left) * 1000000000LL / dt);
+        int32_t freq = time_freq_ppb + sample_ppb / 2;
+        if (freq > TIME_FREQ_MAX_PPB) freq = TIME_FREQ_MAX_PPB;
+        if (freq < -TIME_FREQ_MAX_PPB) freq = -TIME_FREQ_MAX_PPB;
+        time_freq_ppb = freq;
+    }
+    slew_us = offset_us;
+    portEXIT_CRITICAL(&time_mux);
+
+    if (estimate) {
+        drift_samples++;
+        bool stable = sample_ppb < TIME_DRIFT_LOCK_PPB &&
+                      sample_ppb > -TIME_DRIFT_LOCK_PPB;
+        drift_stable = stable ? (drift_stable < 255 ? drift_stable + 1 : 255) : 0;
+    }
+    drift_sample_us = now_us;
+    drift_offset_us = offset_us;
+    return false;
+}
+
+// === Current UTC in microseconds ===
+int64_t time_epoch_us(void) {
+    int64_t now_us = esp_timer_get_time();
+    int64_t epoch_us = 0;
+
+    portENTER_CRITICAL(&time_mux);
+    if (time_valid) {
+        epoch_us = time_eval_locked(now_us, NULL);
+    }
+    portEXIT_CRITICAL(&time_mux);
+
+    return epoch_us;
+}
+
+// === Consistent clock snapshot ===
+/**
+ * @brief Fills `snap` from a single monotonic reading.
+ * @return snap->valid, false until a time source has synced.
+ */
+bool time_now(time_snapshot_t *snap) {
+    int64_t epoch_us = 0;
+    bool valid;
+
+    memset(snap, 0, sizeof(*snap));
+    snap->mono_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&time_mux);
+    valid = time_valid;
+    if (valid) {
+        epoch_us = time_eval_locked(snap->mono_us, NULL);
+    }
+    portEXIT_CRITICAL(&time_mux);
+
+    snap->valid = valid;
+    if (!valid) {
+        return false;
+    }
+
+    snap->epoch = (uint32_t)(epoch_us / 1000000);
+
+    // Local calendar fields
+    time_t local = (time_t)snap->epoch + TIME_LOCAL_OFFSET;
+    struct tm tm_local;
+    gmtime_r(&local, &tm_local);
+
+    snap->year = tm_local.tm_year + 1900;
+    snap->month = tm_local.tm_mon + 1;
+    snap->day = tm_local.tm_mday;
+    snap->yday = tm_local.tm_yday;
+    snap->hours = tm_local.tm_hour;
+    snap->minutes = tm_local.tm_min;
+    snap->seconds = tm_local.tm_sec;
+    snap->minute_of_day = snap->hours * 60 + snap->minutes;
+    snap->local_day = (uint32_t)(local / 86400);
+
+    return true;
+}
+
+// === Clock validity ===
+bool time_is_valid(void) {
+    bool valid;
+    portENTER_CRITICAL(&time_mux);
+    valid = time_valid;
+    portEXIT_CRITICAL(&time_mux);
+    return valid;
+}
+
+// === Clock jumps seen on resync ===
+uint32_t time_jump_count_get(void) {
+    return time_jump_count;
+}
+
+// === Discipline metrics ===
+/**
+ * @brief Copies the drift estimator state for diagnostics.
+ * @note freq_ppb is the learned correction, the oscillator error is the
+ * same magnitude with the opposite sign.
+ */
+void time_discipline_stats(time_discipline_stats_t *stats) {
+    int64_t now_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&time_mux);
+    time_eval_locked(now_us, &stats->slew_pending_us);
+    stats->freq_ppb = time_freq_ppb;
+    portEXIT_CRITICAL(&time_mux);
+
+    stats->offset_us = drift_offset_us;
+    stats->samples = drift_samples;
+    stats->locked = drift_stable >= TIME_DRIFT_LOCK_SAMPLES;
+}
+
+bool time_drift_locked(void) {
+    return drift_stable >= TIME_DRIFT_LOCK_SAMPLES;
+}
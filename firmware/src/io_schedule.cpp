@@ -0,0 +1,199 @@
+#include "io_schedule.h"
+#include <string.h>
+
+// === Set bits for minutes [start, end) ===
+static void sched_set_range(io_schedule_t *schedule, uint16_t start, uint16_t end) {
+    while (start < end) {
+        uint16_t word = start / SCHED_WORD_BITS;
+        uint16_t bit = start % SCHED_WORD_BITS;
+        uint16_t span = SCHED_WORD_BITS - bit;
+        if (span > end - start) {
+            span = end - start;
+        }
+
+        // `span` ones, placed MSB first starting at `bit`
+        uint32_t mask = (span == SCHED_WORD_BITS) ?
+            0xFFFFFFFFu : (((1u << span) - 1) << (SCHED_WORD_BITS - bit - span));
+        schedule->bits[word] |= mask;
+        start += span;
+    }
+}
+
+// === Edge mask for one word ===
+/**
+ * @brief Returns the minutes in `word` where the schedule turns ON
+ * (rising) or OFF (falling), compared to the minute just before.
+ * @note The day is treated as circular, so minute 0 compares
+ * against minute 1439.
+ */
+static inline uint32_t sched_edges(
+    const io_schedule_t *schedule, uint16_t word, bool rising
+) {
+    uint32_t cur = schedule->bits[word];
+    uint32_t prev_word = schedule->bits[word ? word - 1 : SCHED_WORDS - 1];
+    uint32_t prev = (cur >> 1) | (prev_word << (SCHED_WORD_BITS - 1));
+    return rising ? (cur & ~prev) : (~cur & prev);
+}
+
+// === Compile ON/OFF window into a day bitmap ===
+/**
+ * @brief Precomputes the minute bitmap for a daily ON/OFF window.
+ * @note ON == OFF compiles to an empty schedule (no edges), matching
+ * the "invalid schedule" handling of the triggers. Times past 23:59
+ * wrap around the day.
+ */
+void io_schedule_compile(
+    io_schedule_t *schedule,
+    uint8_t on_hr, uint8_t on_min,
+    uint8_t off_hr, uint8_t off_min
+) {
+    uint16_t on_total_mins = (on_hr * 60 + on_min) % SCHED_MINUTES_IN_DAY;
+    uint16_t off_total_mins = (off_hr * 60 + off_min) % SCHED_MINUTES_IN_DAY;
+
+    memset(schedule->bits, 0, sizeof(schedule->bits));
+    schedule->empty = (on_total_mins == off_total_mins);
+
+    if (schedule->empty) {
+        return;
+
+    } else if (on_total_mins < off_total_mins) {
+        // Same-day schedule (e.g., ON 09:00, OFF 18:00)
+        sched_set_range(schedule, on_total_mins, off_total_mins);
+
+    } else {
+        // Overnight schedule (e.g., ON 21:00, OFF 06:00)
+        sched_set_range(schedule, on_total_mins, SCHED_MINUTES_IN_DAY);
+        sched_set_range(schedule, 0, off_total_mins);
+    }
+}
+
+// === Desired state lookup ===
+bool io_schedule_active(const io_schedule_t *schedule, uint16_t minute) {
+    minute %= SCHED_MINUTES_IN_DAY;
+    return (schedule->bits[minute / SCHED_WORD_BITS] >>
+            (SCHED_WORD_BITS - 1 - minute % SCHED_WORD_BITS)) & 1u;
+}
+
+bool io_schedule_is_empty(const io_schedule_t *schedule) {
+    return schedule->empty;
+}
+
+// === Minutes until the next edge ===
+/**
+ * @brief Forward word-wise search for the next ON (rising) or OFF
+ * edge, starting at `minute` itself.
+ * @return 0 if the edge is at `minute`, up to 1439, or SCHED_NO_EDGE
+ * for an empty schedule.
+ */
+uint16_t io_schedule_next_edge(
+    const io_schedule_t *schedule, uint16_t minute, bool rising
+) {
+    if (schedule->empty) {
+        return SCHED_NO_EDGE;
+    }
+
+    minute %= SCHED_MINUTES_IN_DAY;
+    uint16_t word = minute / SCHED_WORD_BITS;
+    uint32_t edges = sched_edges(schedule, word, rising) &
+                     (0xFFFFFFFFu >> (minute % SCHED_WORD_BITS));
+
+    // One extra step revisits the start word for edges before `minute`
+    for (uint16_t n = 0; n <= SCHED_WORDS; n++) {
+        if (edges) {
+            uint16_t pos = word * SCHED_WORD_BITS + __builtin_clz(edges);
+            return (pos + SCHED_MINUTES_IN_DAY - minute) % SCHED_MINUTES_IN_DAY;
+        }
+        word = (word + 1 < SCHED_WORDS) ? word + 1 : 0;
+        edges = sched_edges(schedule, word, rising);
+    }
+
+    return SCHED_NO_EDGE;
+}
+
+// === Minutes since the last edge ===
+/**
+ * @brief Backward word-wise search for the most recent ON (rising) or
+ * OFF edge at or before `minute`.
+ * @return 0 if the edge is at `minute`, up to 1439, or SCHED_NO_EDGE
+ * for an empty schedule.
+ */
+uint16_t io_schedule_since_edge(
+    const io_schedule_t *schedule, uint16_t minute, bool rising
+) {
+    if (schedule->empty) {
+        return SCHED_NO_EDGE;
+    }
+
+    minute %= SCHED_MINUTES_IN_DAY;
+    uint16_t word = minute / SCHED_WORD_BITS;
+    uint32_t edges = sched_edges(schedule, word, rising) &
+                     (0xFFFFFFFFu << (SCHED_WORD_BITS - 1 - minute % SCHED_WORD_BITS));
+
+    for (uint16_t n = 0; n <= SCHED_WORDS; n++) {
+        if (edges) {
+            uint16_t pos = word * SCHED_WORD_BITS +
+                           (SCHED_WORD_BITS - 1 - __builtin_ctz(edges));
+            return (minute + SCHED_MINUTES_IN_DAY - pos) % SCHED_MINUTES_IN_DAY;
+        }
+        word = word ? word - 1 : SCHED_WORDS - 1;
+        edges = sched_edges(schedule, word, rising);
+    }
+
+    return SCHED_NO_EDGE;
+}
+
+// === Replay missed edges since the last evaluation ===
+/**
+ * @brief Walks every ON/OFF edge in the local minutes after the last
+ * evaluated epoch up to and including `local_epoch`, in order, and
+ * leaves `state` at the last one.
+ * @note Boot, a clock step backwards or a gap longer than
+ * SCHED_REPLAY_MAX_SEC skip the replay and set the stateless desired
+ * state instead. With no edge crossed `state` is left untouched, so
+ * manual overrides survive until the next edge.
+ */
+io_reconcile_result_t io_schedule_reconcile(
+    const io_schedule_t *schedule, io_reconcile_t *rec,
+    uint32_t local_epoch, uint8_t *state,
+    io_schedule_edge_cb on_edge, void *ctx
+) {
+    uint32_t last_epoch = rec->last_epoch;
+    rec->last_epoch = local_epoch;
+
+    if (schedule->empty) {
+        return SCHED_RECONCILE_NONE;
+    }
+
+    uint32_t now_min = local_epoch / 60;
+    if (last_epoch == 0 ||
+        local_epoch < last_epoch ||
+        local_epoch - last_epoch > SCHED_REPLAY_MAX_SEC
+    ) {
+        *state = io_schedule_active(schedule, now_min % SCHED_MINUTES_IN_DAY);
+        return SCHED_RECONCILE_RESYNC;
+    }
+
+    // At most two edges per day, so this loop is short
+    bool replayed = false;
+    uint32_t minute = last_epoch / 60 + 1;
+    while (minute <= now_min) {
+        uint16_t day_min = minute % SCHED_MINUTES_IN_DAY;
+        uint16_t to_on = io_schedule_next_edge(schedule, day_min, true);
+        uint16_t to_off = io_schedule_next_edge(schedule, day_min, false);
+        bool rising = to_on < to_off;
+        uint32_t edge = minute + (rising ? to_on : to_off);
+
+        if (edge > now_min) {
+            break;
+        }
+
+        if (on_edge) {
+            on_edge(edge, rising, ctx);
+        }
+        *state = rising;
+        replayed = true;
+        minute = edge + 1;
+    }
+
+    return replayed ? SCHED_RECONCILE_REPLAYED : SCHED_RECONCILE_NONE;
+}
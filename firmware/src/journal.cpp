@@ -0,0 +1,442 @@
+#include "global.h"
+#include "journal.h"
+#include <esp_partition.h>
+#include <esp_system.h>
+
+// === Journal State ===
+// Callers stamp a record and queue it, TaskLog assigns the sequence
+// number and writes it, so logging never waits on flash. Slots fill
+// sector by sector; a sector is erased when the writer enters it, which
+// drops the oldest records and leaves the rest readable.
+#define JOURNAL_RECORD_SIZE sizeof(journal_record_t)
+#define JOURNAL_PER_SECTOR (SPI_FLASH_SEC_SIZE / JOURNAL_RECORD_SIZE)
+#define JOURNAL_PINS 40 // GPIO numbers tracked for relay changes
+
+static const esp_partition_t *journal_part = NULL;
+static QueueHandle_t journal_queue = NULL;
+static SemaphoreHandle_t journal_mutex = NULL;  // Writer, TaskLog or an OTA end
+static uint32_t journal_sectors = 0;
+static uint32_t journal_slots = 0;
+static uint32_t journal_next = 0;   // Slot the next record goes to
+static uint32_t journal_seq = 1;    // Sequence of the next record
+static uint16_t journal_boot = 0;
+static uint8_t journal_levels[JOURNAL_PINS]; // Last level logged, 0xFF unknown
+
+// Serial command being typed, and the dump it started
+static char journal_cmd[24];
+static uint8_t journal_cmd_len = 0;
+static bool journal_console_dumping = false;
+static uint32_t journal_console_since = 0;
+
+metric_counter_t metric_journal_records;
+metric_counter_t metric_journal_dropped;
+
+// === Record checks ===
+// CRC-16/CCITT-FALSE over everything before the crc field
+static uint16_t journal_crc(const journal_record_t *rec) {
+    const uint8_t *p = (const uint8_t *)rec;
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < offsetof(journal_record_t, crc); i++) {
+        crc ^= (uint16_t)p[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static bool journal_blank(const journal_record_t *rec) {
+    const uint8_t *p = (const uint8_t *)rec;
+    for (size_t i = 0; i < JOURNAL_RECORD_SIZE; i++) {
+        if (p[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Written completely, a torn or erased slot fails the CRC
+static bool journal_valid(const journal_record_t *rec) {
+    return !journal_blank(rec) && rec->type != 0 && rec->crc == journal_crc(rec);
+}
+
+static bool journal_read(uint32_t slot, journal_record_t *rec) {
+    return esp_partition_read(journal_part, slot * JOURNAL_RECORD_SIZE, rec,
+                              JOURNAL_RECORD_SIZE) == ESP_OK;
+}
+
+// === Find the write position ===
+/**
+ * @brief Picks the sector whose first record has the highest sequence,
+ * then its first blank slot. Torn records are skipped.
+ * @note A full newest sector moves the writer to the next one, which is
+ * erased on the first write.
+ */
+static void journal_scan(void) {
+    journal_record_t rec;
+    uint32_t newest = UINT32_MAX;
+    uint32_t newest_seq = 0;
+
+    for (uint32_t s = 0; s < journal_sectors; s++) {
+        if (journal_read(s * JOURNAL_PER_SECTOR, &rec) && journal_valid(&rec) &&
+            (newest == UINT32_MAX || rec.seq > newest_seq)) {
+            newest = s;
+            newest_seq = rec.seq;
+        }
+    }
+
+    journal_next = 0;
+    journal_seq = 1;
+    journal_boot = 1;
+    if (newest == UINT32_MAX) {
+        return; // Blank or foreign contents, sector 0 is erased first
+    }
+
+    uint32_t base = newest * JOURNAL_PER_SECTOR;
+    journal_next = (base + JOURNAL_PER_SECTOR) % journal_slots;
+    for (uint32_t i = 0; i < JOURNAL_PER_SECTOR; i++) {
+        if (!journal_read(base + i, &rec)) {
+            continue;
+        }
+        if (journal_blank(&rec)) {
+            journal_next = base + i;
+            break;
+        }
+        if (journal_valid(&rec) && rec.seq >= newest_seq) {
+            newest_seq = rec.seq;
+            journal_boot = rec.boot + 1;
+        }
+    }
+    journal_seq = newest_seq + 1;
+}
+
+// === Start the journal ===
+/**
+ * @brief Finds the partition and the write position, then queues the
+ * boot record with the reset reason.
+ * @return false without a usable partition, records are then dropped.
+ * @note Call early in setup(). A panic or watchdog reset shows up as the
+ * reason of the next boot record.
+ */
+bool journal_begin(void) {
+    journal_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                            (esp_partition_subtype_t)JOURNAL_SUBTYPE,
+                                            JOURNAL_LABEL);
+    if (journal_part == NULL || journal_part->size < 2 * SPI_FLASH_SEC_SIZE) {
+        journal_part = NULL;
+        debug_errorf("[JOURNAL] No \"%s\" partition, events are not kept\n", JOURNAL_LABEL);
+        return false;
+    }
+
+    if (journal_queue == NULL) {
+        journal_queue = xQueueCreate(JOURNAL_QUEUE_LEN, sizeof(journal_record_t));
+    }
+    if (journal_mutex == NULL) {
+        journal_mutex = xSemaphoreCreateMutex();
+    }
+    if (journal_queue == NULL || journal_mutex == NULL) {
+        journal_part = NULL;
+        debug_errorf("[JOURNAL] Failed to create queue\n");
+        return false;
+    }
+
+    journal_sectors = journal_part->size / SPI_FLASH_SEC_SIZE;
+    journal_slots = journal_sectors * JOURNAL_PER_SECTOR;
+    memset(journal_levels, 0xFF, sizeof(journal_levels));
+
+    if (xSemaphoreTake(journal_mutex, portMAX_DELAY) == pdTRUE) {
+        journal_scan();
+        xSemaphoreGive(journal_mutex);
+    }
+
+    esp_reset_reason_t reason = esp_reset_reason();
+    journal_log(JOURNAL_BOOT, (uint8_t)reason, 0, FW_VERSION);
+    debug_printf("[JOURNAL] Boot %u, reset reason %d, next record %lu\n",
+                 journal_boot, (int)reason, (unsigned long)journal_seq);
+    return true;
+}
+
+// === Queue a record ===
+/**
+ * @brief Stamps an event and queues it for TaskLog, never waits.
+ * @return false when the queue is full or the journal is not running,
+ * counted in metric_journal_dropped.
+ */
+bool journal_log(journal_type_t type, uint8_t code, int32_t value, const char *detail) {
+    if (journal_queue == NULL || journal_part == NULL) {
+        return false;
+    }
+
+    journal_record_t rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.uptime_ms = millis();
+    rec.epoch = (uint32_t)(time_epoch_us() / 1000000);
+    rec.type = (uint8_t)type;
+    rec.code = code;
+    rec.value = value;
+    if (detail != NULL) {
+        memcpy(rec.detail, detail, strnlen(detail, sizeof(rec.detail)));
+    }
+
+    if (xQueueSend(journal_queue, &rec, 0) != pdTRUE) {
+        metric_inc(&metric_journal_dropped);
+        return false;
+    }
+    return true;
+}
+
+// === Relay transitions ===
+// Called at every digitalWrite() of a relay, logs only level changes
+void journal_relay(uint8_t pin, uint8_t level) {
+    if (pin >= JOURNAL_PINS || journal_levels[pin] == level) {
+        return;
+    }
+    journal_levels[pin] = level;
+
+    const char *name = "relay";
+    if (pin == LIGHT_RELAY) {
+        name = "light";
+    } else if (pin == WATER_RELAY) {
+        name = "water";
+    } else if (pin == FAN_RELAY) {
+        name = "fan";
+    }
+    journal_log(JOURNAL_RELAY, level ? 1 : 0, pin, name);
+}
+
+// === Write queued records ===
+/**
+ * @brief Writes every queued record to flash from the calling task.
+ * @return Records written.
+ * @note TaskLog calls it every LOG_DRAIN_MS. Call it directly before a
+ * restart so the last records are kept.
+ */
+size_t journal_flush(void) {
+    if (journal_part == NULL || xSemaphoreTake(journal_mutex, portMAX_DELAY) != pdTRUE) {
+        return 0;
+    }
+
+    size_t written = 0;
+    journal_record_t rec;
+    while (xQueueReceive(journal_queue, &rec, 0) == pdTRUE) {
+        // Entering a sector, its oldest records make room
+        if (journal_next % JOURNAL_PER_SECTOR == 0 &&
+            esp_partition_erase_range(journal_part, journal_next * JOURNAL_RECORD_SIZE,
+                                      SPI_FLASH_SEC_SIZE) != ESP_OK) {
+            metric_inc(&metric_journal_dropped);
+            continue;
+        }
+
+        rec.seq = journal_seq;
+        rec.boot = journal_boot;
+        rec.crc = journal_crc(&rec);
+        esp_err_t err = esp_partition_write(journal_part, journal_next * JOURNAL_RECORD_SIZE,
+                                            &rec, JOURNAL_RECORD_SIZE);
+        __atomic_store_n(&journal_next, (journal_next + 1) % journal_slots, __ATOMIC_RELEASE);
+        if (err != ESP_OK) {
+            metric_inc(&metric_journal_dropped);
+            continue;
+        }
+        __atomic_store_n(&journal_seq, journal_seq + 1, __ATOMIC_RELEASE);
+        written++;
+        metric_inc(&metric_journal_records);
+    }
+
+    xSemaphoreGive(journal_mutex);
+    return written;
+}
+
+// === Text form ===
+static const char *journal_type_name(uint8_t type) {
+    switch (type) {
+        case JOURNAL_BOOT:
+            return "boot";
+        case JOURNAL_RELAY:
+            return "relay";
+        case JOURNAL_WIFI:
+            return "wifi";
+        case JOURNAL_OTA:
+            return "ota";
+        case JOURNAL_WATCHDOG:
+            return "watchdog";
+        default:
+            return "?";
+    }
+}
+
+static const char *journal_event_name(uint8_t type, uint8_t code) {
+    static const char *const reasons[] = {
+        "UNKNOWN", "POWERON", "EXT", "SW", "PANIC", "INT_WDT",
+        "TASK_WDT", "WDT", "DEEPSLEEP", "BROWNOUT", "SDIO"
+    };
+    static const char *const ota[] = { "START", "DONE", "FAILED" };
+    static const char *const links[] = { // wifi_link_state_t order
+        "OFF", "CONNECTING", "UP", "BACKOFF", "HOLD"
+    };
+
+    switch (type) {
+        case JOURNAL_BOOT:
+            return code < sizeof(reasons) / sizeof(reasons[0]) ? reasons[code] : "?";
+        case JOURNAL_RELAY:
+            return code ? "ON" : "OFF";
+        case JOURNAL_WIFI:
+            return code < sizeof(links) / sizeof(links[0]) ? links[code] : "?";
+        case JOURNAL_OTA:
+            return code < sizeof(ota) / sizeof(ota[0]) ? ota[code] : "?";
+        case JOURNAL_WATCHDOG:
+            return "MISSED";
+        default:
+            return "?";
+    }
+}
+
+// === Dump ===
+/**
+ * @brief Passes up to `max` records newer than `*since` to `sink`,
+ * oldest first, one line each:
+ *
+ *   1042 17 9100 1760780004 relay ON 23 light
+ *
+ * @param since In: last record already seen. Out: last record passed,
+ * the cursor for the next page.
+ * @return Records written.
+ * @note Reads flash without the writer lock. Records written meanwhile
+ * are left for the next page, a sector erased meanwhile is skipped.
+ * Sectors older than `*since` are passed over after one read.
+ */
+uint32_t journal_write_records(journal_sink_t sink, void *ctx, uint32_t *since, uint32_t max) {
+    if (journal_part == NULL) {
+        return 0;
+    }
+
+    // Oldest records start at the next sector boundary
+    uint32_t next = __atomic_load_n(&journal_next, __ATOMIC_ACQUIRE);
+    uint32_t slot = (next + JOURNAL_PER_SECTOR - 1) / JOURNAL_PER_SECTOR % journal_sectors *
+                    JOURNAL_PER_SECTOR;
+    uint32_t count = 0;
+    journal_record_t rec;
+    char line[JOURNAL_LINE_MAX];
+
+    do {
+        bool read = journal_read(slot, &rec);
+
+        // Sectors are judged by their first record, as journal_scan()
+        // does: one without a valid first record is blank or foreign,
+        // one the next sector in range starts at or before `since` is
+        // older. Either is passed over. Sequence numbers grow by at most
+        // one per slot, so the rest start no nearer than `since` allows.
+        if (slot % JOURNAL_PER_SECTOR == 0) {
+            bool writing = next >= slot && next < slot + JOURNAL_PER_SECTOR;
+            uint32_t following = (slot + JOURNAL_PER_SECTOR) % journal_slots;
+            journal_record_t first;
+            uint32_t skip = 0;
+
+            if (!writing && (!read || !journal_valid(&rec) ||
+                             (following != next && journal_read(following, &first) &&
+                              journal_valid(&first) && first.seq <= *since + 1))) {
+                skip = JOURNAL_PER_SECTOR;
+            } else if (read && journal_valid(&rec) && rec.seq <= *since) {
+                skip = *since + 1 - rec.seq;
+                skip = skip < JOURNAL_PER_SECTOR ? skip : JOURNAL_PER_SECTOR;
+            }
+            if (skip > 0) {
+                if (writing && slot + skip >= next) {
+                    break; // Nothing newer written yet
+                }
+                slot = (slot + skip) % journal_slots;
+                continue;
+            }
+        }
+
+        if (read && journal_valid(&rec) && rec.seq > *since) {
+            int len = snprintf(line, sizeof(line), "%lu %u %lu %lu %s %s %ld %.*s\n",
+                               (unsigned long)rec.seq, rec.boot, (unsigned long)rec.uptime_ms,
+                               (unsigned long)rec.epoch, journal_type_name(rec.type),
+                               journal_event_name(rec.type, rec.code), (long)rec.value,
+                               rec.detail[0] ? JOURNAL_DETAIL_MAX : 1,
+                               rec.detail[0] ? rec.detail : "-");
+            if (len > 0) {
+                sink(line, (size_t)len < sizeof(line) ? (size_t)len : sizeof(line) - 1, ctx);
+                *since = rec.seq;
+                if (++count == max) {
+                    break;
+                }
+            }
+        }
+        slot = (slot + 1) % journal_slots;
+    } while (slot != next);
+
+    return count;
+}
+
+/**
+ * @brief Passes every record newer than `since` to `sink` after a header
+ * line:
+ *
+ *   # seq boot uptime_ms epoch type event value detail
+ *   1042 17 9100 1760780004 relay ON 23 light
+ *
+ * @return Records written.
+ */
+uint32_t journal_write(journal_sink_t sink, void *ctx, uint32_t since) {
+    sink(JOURNAL_HEADER, sizeof(JOURNAL_HEADER) - 1, ctx);
+    return journal_write_records(sink, ctx, &since, UINT32_MAX);
+}
+
+// Sequence of the newest record on flash, 0 before the first
+uint32_t journal_last_seq(void) {
+    return __atomic_load_n(&journal_seq, __ATOMIC_ACQUIRE) - 1;
+}
+
+static void journal_serial_sink(const char *text, size_t len, void *ctx) {
+    Serial.write((const uint8_t *)text, len);
+}
+
+// === Dump to Serial ===
+// Plain text, also on a LOG_BINARY console where it passes the decoder
+uint32_t journal_dump(uint32_t since) {
+    return journal_write(journal_serial_sink, NULL, since);
+}
+
+// === Serial command ===
+/**
+ * @brief Reads console input, "journal" or "journal <seq>" dumps the
+ * records after <seq>.
+ * @note Called by TaskLog, the dump waits on the UART there only, and
+ * goes out JOURNAL_CONSOLE_PAGE records per call so the task keeps
+ * beating.
+ */
+void journal_console_poll(void) {
+    while (Serial.available() > 0) {
+        int c = Serial.read();
+        if (c < 0) {
+            break;
+        }
+        if (c != '\r' && c != '\n') {
+            if (journal_cmd_len < sizeof(journal_cmd) - 1) {
+                journal_cmd[journal_cmd_len++] = (char)c;
+            }
+            continue;
+        }
+
+        journal_cmd[journal_cmd_len] = '\0';
+        journal_cmd_len = 0;
+        if (strncmp(journal_cmd, "journal", 7) == 0 &&
+            (journal_cmd[7] == '\0' || journal_cmd[7] == ' ')) {
+            journal_serial_sink(JOURNAL_HEADER, sizeof(JOURNAL_HEADER) - 1, NULL);
+            journal_console_since = (uint32_t)strtoul(journal_cmd + 7, NULL, 10);
+            journal_console_dumping = true;
+        }
+    }
+
+    // Caught up once a page comes back short
+    if (journal_console_dumping &&
+        journal_write_records(journal_serial_sink, NULL, &journal_console_since,
+                              JOURNAL_CONSOLE_PAGE) < JOURNAL_CONSOLE_PAGE) {
+        journal_console_dumping = false;
+    }
+}
+
+uint16_t journal_boot_count(void) {
+    return journal_boot;
+}
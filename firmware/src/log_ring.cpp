@@ -0,0 +1,215 @@
+#include "global.h"
+#include "log_ring.h"
+
+// === Ring State ===
+// Bounded multi-producer ring, one line per slot. A writer claims the
+// head with a CAS, formats into its slot and publishes it through the
+// slot state, so tasks on both cores and the HMI callback log without a
+// lock and without touching the UART. TaskLog is the consumer.
+//
+// Slot state for position `pos` on lap `pos & ~MASK`:
+//   lap      free, may be claimed for `pos`
+//   lap + 1  written, may be drained
+// Draining sets it to the next lap. All zero is the empty ring.
+#define LOG_MASK (LOG_SLOTS - 1)
+
+typedef struct {
+  uint32_t state;
+  uint16_t len;
+  char text[LOG_LINE_MAX];
+} log_slot_t;
+
+static log_slot_t log_slots[LOG_SLOTS];
+static uint32_t log_head = 0;      // Next position to claim
+static uint32_t log_tail = 0;      // Next position to drain
+static uint8_t log_draining = 0;   // Consumer guard, TaskLog or a flush
+static uint32_t log_reported = 0;  // Drops already announced
+
+metric_counter_t metric_log_lines;
+metric_counter_t metric_log_dropped;
+
+static_assert((LOG_SLOTS & LOG_MASK) == 0, "LOG_SLOTS must be a power of two");
+
+// Format offsets of binary records are relative to this string
+const char log_ring_anchor[] = "log_ring";
+
+// === Claim a slot ===
+/**
+ * @brief Reserves the next slot for `rec`, never waits.
+ * @return false when the ring is full, the line is counted as dropped.
+ * @note Pair with log_ring_publish(), the drain stops at this slot until
+ * then.
+ */
+bool log_ring_claim(log_record_t *rec) {
+    uint32_t pos = __atomic_load_n(&log_head, __ATOMIC_RELAXED);
+    for (;;) {
+        log_slot_t *slot = &log_slots[pos & LOG_MASK];
+        uint32_t state = __atomic_load_n(&slot->state, __ATOMIC_ACQUIRE);
+        int32_t diff = (int32_t)(state - (pos & ~LOG_MASK));
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&log_head, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                rec->data = slot->text;
+                rec->len = 0;
+                rec->pos = pos;
+                return true;
+            }
+        } else if (diff < 0) {
+            metric_inc(&metric_log_dropped); // Slot not drained yet
+            return false;
+        } else {
+            pos = __atomic_load_n(&log_head, __ATOMIC_RELAXED); // Lost a race
+        }
+    }
+}
+
+// === Hand a slot to the drain ===
+void log_ring_publish(log_record_t *rec) {
+    log_slot_t *slot = &log_slots[rec->pos & LOG_MASK];
+    slot->len = rec->len;
+    metric_inc(&metric_log_lines);
+    __atomic_store_n(&slot->state, (rec->pos & ~LOG_MASK) + 1, __ATOMIC_RELEASE);
+}
+
+// === Queue a line ===
+/**
+ * @brief Formats a line into the ring, never waits on the UART.
+ * @note A full ring drops the line and counts it in metric_log_dropped.
+ * Levels are filtered before this, by the debug_*() macros.
+ */
+void log_ring_write(const char *fmt, ...) {
+    log_record_t rec;
+    if (!log_ring_claim(&rec)) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(rec.data, LOG_LINE_MAX, fmt, args);
+    va_end(args);
+    if (len < 0) {
+        len = 0;
+    } else if (len >= LOG_LINE_MAX) {
+        len = LOG_LINE_MAX - 1;
+        rec.data[len - 1] = '\n';
+    }
+    rec.len = (uint16_t)len;
+    log_ring_publish(&rec);
+}
+
+// === Binary record fields ===
+// Header first, then arguments while they fit. The length byte counts
+// everything after itself.
+static bool log_record_room(log_record_t *rec, uint16_t bytes) {
+    return rec->len + bytes <= LOG_LINE_MAX;
+}
+
+static void log_record_put(log_record_t *rec, uint64_t value, uint8_t bytes) {
+    for (uint8_t i = 0; i < bytes; i++) {
+        rec->data[rec->len++] = (char)(value >> (8 * i));
+    }
+    rec->data[1] = (char)(rec->len - 2);
+}
+
+void log_record_format(log_record_t *rec, const char *fmt) {
+    rec->data[0] = LOG_BIN_MARK;
+    rec->len = 2;
+    log_record_put(rec, (uint32_t)(int32_t)(fmt - log_ring_anchor), 4);
+}
+
+void log_record_u32(log_record_t *rec, uint32_t value) {
+    if (log_record_room(rec, 5)) {
+        rec->data[rec->len++] = LOG_ARG_U32;
+        log_record_put(rec, value, 4);
+    }
+}
+
+void log_record_u64(log_record_t *rec, uint64_t value) {
+    if (log_record_room(rec, 9)) {
+        rec->data[rec->len++] = LOG_ARG_U64;
+        log_record_put(rec, value, 8);
+    }
+}
+
+void log_record_f64(log_record_t *rec, double value) {
+    if (log_record_room(rec, 9)) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        rec->data[rec->len++] = LOG_ARG_F64;
+        log_record_put(rec, bits, 8);
+    }
+}
+
+void log_record_str(log_record_t *rec, const char *value) {
+    if (!log_record_room(rec, 2)) {
+        return;
+    }
+    if (value == NULL) {
+        value = "(null)";
+    }
+    size_t len = strnlen(value, LOG_LINE_MAX - rec->len - 2);
+    rec->data[rec->len++] = LOG_ARG_STR;
+    rec->data[rec->len++] = (char)len;
+    memcpy(rec->data + rec->len, value, len);
+    rec->len += len;
+    rec->data[1] = (char)(rec->len - 2);
+}
+
+// === Drain to a sink ===
+/**
+ * @brief Passes every published line to `sink` in order, then a note
+ * when lines were dropped since the last drain.
+ * @return Lines drained, 0 when another caller is draining.
+ * @note Stops at a slot still being formatted, the next drain picks it up.
+ */
+size_t log_ring_drain(log_sink_t sink, void *ctx) {
+    if (__atomic_exchange_n(&log_draining, 1, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+
+    size_t lines = 0;
+    for (;;) {
+        log_slot_t *slot = &log_slots[log_tail & LOG_MASK];
+        uint32_t lap = log_tail & ~LOG_MASK;
+        if (__atomic_load_n(&slot->state, __ATOMIC_ACQUIRE) != lap + 1) {
+            break;
+        }
+        sink(slot->text, slot->len, ctx);
+        __atomic_store_n(&slot->state, lap + LOG_SLOTS, __ATOMIC_RELEASE);
+        log_tail++;
+        lines++;
+    }
+
+    uint32_t dropped = __atomic_load_n(&metric_log_dropped.value, __ATOMIC_RELAXED);
+    if (dropped != log_reported) {
+        char note[48];
+#if LOG_BINARY
+        log_record_t rec = { note, 0, 0 };
+        log_record_format(&rec, "[LOG] %lu line(s) dropped\n");
+        log_record_u32(&rec, dropped - log_reported);
+        sink(note, rec.len, ctx);
+#else
+        int len = snprintf(note, sizeof(note), "[LOG] %lu line(s) dropped\n",
+                           (unsigned long)(dropped - log_reported));
+        sink(note, (size_t)len, ctx);
+#endif
+        log_reported = dropped;
+    }
+
+    __atomic_store_n(&log_draining, 0, __ATOMIC_RELEASE);
+    return lines;
+}
+
+static void log_serial_sink(const char *text, size_t len, void *ctx) {
+    Serial.write((const uint8_t *)text, len);
+}
+
+// === Drain to Serial ===
+/**
+ * @brief Writes pending lines to Serial from the calling task.
+ * @note TaskLog calls it every LOG_DRAIN_MS. Call it directly before a
+ * hang or restart so the last lines reach the console.
+ */
+size_t log_ring_flush(void) {
+    return log_ring_drain(log_serial_sink, NULL);
+}
@@ -2,14 +2,31 @@
 
 void setup() {
     hmi.restartHMI();
-    debug_begin(115200);
+    Serial.begin(115200); // Opened without logs too, the journal console and OTA use it
+
+    // Console and journal writer first, so boot lines and the boot
+    // record are written while setup() runs
+    xTaskCreatePinnedToCore(
+        TaskLog,
+        "Log_Task",
+        LOG_TASK_STACK,
+        NULL,
+        TASK_PRIORITY_LOG,
+        &xLogTaskHandle,
+        0               // Core ID (Core 0)
+    );
+
+    // Boot record with the reset reason, watchdog and panic resets included
+    journal_begin();
+
     debug_println("[BOOT] Initializing communication...");
     delay(1000);
 
     // Create mutex for VP access
     xVPMutex = xSemaphoreCreateMutex();
     if (xVPMutex == NULL) {
-        debug_println("[ERROR] Failed to create VP mutex");
+        debug_errorf("[ERROR] Failed to create VP mutex\n");
+        debug_flush();
         while(1); // Hang on error
     }
 
@@ -21,13 +38,15 @@ void setup() {
     // Create queue for HMI updates
     xHMIUpdateQueue = xQueueCreate(15, sizeof(hmi_update_item_t));
     if (xHMIUpdateQueue == NULL) {
-        debug_println("[ERROR] Failed to create HMI update queue");
+        debug_errorf("[ERROR] Failed to create HMI update queue\n");
+        debug_flush();
         while(1); // Hang on error
     }
 
     // Load VP values from NVS and save defaults
-    if (xSemaphoreTake(xVPMutex, portMAX_DELAY) == pdTRUE) {
+    if (vp_lock()) {
         vp_load_values();
+        wifi_portal_recover(); // Finish a credential save cut by power loss
 
         // Set default placeholder texts
         vp_set_string(VP_HOLDER_SSID, "Network (SSID)");
@@ -102,6 +121,9 @@ void setup() {
             vp.fan_off_min = 0;
         }
 
+        // Precompile day bitmaps from the loaded schedules
+        io_schedule_init();
+
         // Default growth cycle
         if ((vp.total_cycle == 0) && (vp.growth_day == 0)) {
             vp.plant_id = 0;
@@ -110,12 +132,15 @@ void setup() {
             vp_growth_bar_update();
         }
 
+        // Cycle start epoch, anchored on first valid time if unset
+        growth_init();
+
         // Test defaults & Simulated values
         // vp.wifi_state = 1;
         // vp.wifi_ap_state = 1;
 
         vp_save_values();
-        xSemaphoreGive(xVPMutex);
+        vp_unlock();
     }
 
     // Print initial values
@@ -142,6 +167,11 @@ void setup() {
 
     // Explicitly set, esp defaults to STA+AP
     WiFi.mode(WIFI_STA);
+
+#if BENCH_ON_BOOT
+    // Hot paths timed while no task competes for the core
+    bench_run(NULL, bench_console_sink, NULL);
+#endif
     
     // Create tasks with core affinity
     xTaskCreatePinnedToCore(
@@ -174,6 +204,24 @@ void setup() {
         1               // Core ID (Core 1)
     );
 
+    // Heartbeats of the tasks above, feeds the task watchdog
+    xTaskCreatePinnedToCore(
+        TaskSupervisor,
+        "Supervisor_Task",
+        SUPERVISOR_TASK_STACK,
+        NULL,
+        TASK_PRIORITY_SUPERVISOR,
+        &xSupervisorTaskHandle,
+        0               // Core ID (Core 0)
+    );
+
+    // Stack high-water marks on /metrics
+    metrics_register_task("hmi", xHMITaskHandle);
+    metrics_register_task("wifi", xWiFiTaskHandle);
+    metrics_register_task("sync", xSyncTaskHandle);
+    metrics_register_task("log", xLogTaskHandle);
+    metrics_register_task("supervisor", xSupervisorTaskHandle);
+
     debug_println("[BOOT] Tasks created. Setup complete!");
 
     // Delete the setup task as it's no longer needed
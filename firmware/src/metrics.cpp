@@ -0,0 +1,376 @@
+#include "global.h"
+#include "metrics.h"
+#include <esp_timer.h>
+
+// === Metric Instances ===
+metric_counter_t metric_hmi_frames_tx;
+metric_counter_t metric_hmi_frames_rx;
+metric_counter_t metric_hmi_updates;
+metric_counter_t metric_nvs_writes;
+metric_counter_t metric_sched_evals;
+metric_gauge_t metric_sched_last_us;
+
+static const uint32_t mutex_wait_bounds[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+metric_histogram_t metric_vp_mutex_wait = METRIC_HISTOGRAM(mutex_wait_bounds);
+
+// === Task stacks ===
+// Handles only exist once setup() created the tasks
+typedef struct {
+  const char *name;
+  TaskHandle_t handle;
+} metrics_task_t;
+
+static metrics_task_t metrics_tasks[METRICS_TASKS_MAX];
+static size_t metrics_num_tasks = 0;
+
+// === Sampled gauges ===
+// Read when /metrics is scraped, nothing to update on a hot path
+static int32_t sample_hmi_queue_depth(void) {
+    return xHMIUpdateQueue ? (int32_t)uxQueueMessagesWaiting(xHMIUpdateQueue) : 0;
+}
+
+static int32_t sample_heap_free(void) {
+    return (int32_t)ESP.getFreeHeap();
+}
+
+static int32_t sample_heap_largest_block(void) {
+    return (int32_t)ESP.getMaxAllocHeap();
+}
+
+static int32_t sample_uptime(void) {
+    return (int32_t)(esp_timer_get_time() / 1000000);
+}
+
+// Clock discipline, see time_discipline_stats()
+static int32_t sample_clamp_us(int64_t us) {
+    return us > INT32_MAX ? INT32_MAX : us < -INT32_MAX ? -INT32_MAX : (int32_t)us;
+}
+
+static int32_t sample_time_freq_ppb(void) {
+    time_discipline_stats_t stats;
+    time_discipline_stats(&stats);
+    return stats.freq_ppb;
+}
+
+static int32_t sample_time_offset_us(void) {
+    time_discipline_stats_t stats;
+    time_discipline_stats(&stats);
+    return sample_clamp_us(stats.offset_us);
+}
+
+static int32_t sample_time_slew_pending_us(void) {
+    time_discipline_stats_t stats;
+    time_discipline_stats(&stats);
+    return sample_clamp_us(stats.slew_pending_us);
+}
+
+static int32_t sample_time_jumps(void) {
+    return (int32_t)time_jump_count_get();
+}
+
+static int32_t sample_ntp_interval(void) {
+    return (int32_t)(ntp_sync_interval_get() / 1000);
+}
+
+// Link quality, see wifi_signal_stats()
+static int32_t sample_wifi_rssi(void) {
+    wifi_signal_stats_t stats;
+    wifi_signal_stats(&stats);
+    return stats.rssi_avg;
+}
+
+static int32_t sample_wifi_level(void) {
+    wifi_signal_stats_t stats;
+    wifi_signal_stats(&stats);
+    return stats.level;
+}
+
+// === Registry ===
+typedef enum {
+  METRIC_COUNTER,
+  METRIC_GAUGE,
+  METRIC_HISTOGRAM,
+  METRIC_SAMPLED,     // Gauge from a function
+  METRIC_SAMPLED_TOTAL, // Counter from a function
+  METRIC_TASK_STACK,  // Gauge per registered task
+  METRIC_LOCK_TOTAL,  // Counter per vp_lock() call site
+  METRIC_LOCK_MAX,    // Gauge per vp_lock() call site
+  METRIC_TASK_JITTER, // Histogram per supervised task
+  METRIC_TASK_LOOP_MAX, // Gauge per supervised task
+  METRIC_TASK_MISSED, // Counter per supervised task
+  METRIC_RSSI_HISTORY // Gauge per minute of wifi_signal_history()
+} metric_kind_t;
+
+typedef struct {
+  const char *name;
+  const char *help;
+  metric_kind_t kind;
+  const void *metric;
+  int32_t (*sample)(void);
+  size_t field;       // vp_lock_site_t member for the lock kinds
+} metric_desc_t;
+
+static const metric_desc_t metrics_table[] = {
+  { "hmi_queue_depth", "Items waiting in xHMIUpdateQueue",
+    METRIC_SAMPLED, NULL, sample_hmi_queue_depth },
+  { "hmi_updates_total", "HMI queue items handled by TaskHMI",
+    METRIC_COUNTER, &metric_hmi_updates, NULL },
+  { "hmi_frames_sent_total", "Frames written to the panel",
+    METRIC_COUNTER, &metric_hmi_frames_tx, NULL },
+  { "hmi_frames_received_total", "Frames received from the panel",
+    METRIC_COUNTER, &metric_hmi_frames_rx, NULL },
+  { "touch_total_us", "Panel touch to relay pin, whole path",
+    METRIC_HISTOGRAM, &trace_stage_us[TRACE_RX], NULL },
+  { "touch_sync_us", "Touch stage: VP synced and saved to NVS",
+    METRIC_HISTOGRAM, &trace_stage_us[TRACE_SYNCED], NULL },
+  { "touch_apply_us", "Touch stage: side effects and HMI queue send",
+    METRIC_HISTOGRAM, &trace_stage_us[TRACE_QUEUED], NULL },
+  { "touch_wait_us", "Touch stage: waiting in xHMIUpdateQueue",
+    METRIC_HISTOGRAM, &trace_stage_us[TRACE_DEQUEUED], NULL },
+  { "touch_send_us", "Touch stage: setVP frame written",
+    METRIC_HISTOGRAM, &trace_stage_us[TRACE_SENT], NULL },
+  { "touch_relay_us", "Touch stage: relay pin written",
+    METRIC_HISTOGRAM, &trace_stage_us[TRACE_RELAY], NULL },
+  { "vp_mutex_wait_us", "Time spent waiting for xVPMutex",
+    METRIC_HISTOGRAM, &metric_vp_mutex_wait, NULL },
+  { "vp_lock_holds_total", "xVPMutex holds per call site",
+    METRIC_LOCK_TOTAL, NULL, NULL, offsetof(vp_lock_site_t, holds) },
+  { "vp_lock_wait_us_total", "Time spent waiting for xVPMutex per call site",
+    METRIC_LOCK_TOTAL, NULL, NULL, offsetof(vp_lock_site_t, wait_us) },
+  { "vp_lock_hold_us_total", "Time xVPMutex was held per call site",
+    METRIC_LOCK_TOTAL, NULL, NULL, offsetof(vp_lock_site_t, hold_us) },
+  { "vp_lock_hold_us_max", "Longest xVPMutex hold per call site",
+    METRIC_LOCK_MAX, NULL, NULL, offsetof(vp_lock_site_t, hold_max_us) },
+  { "vp_lock_over_budget_total", "Holds longer than VP_LOCK_BUDGET_US per call site",
+    METRIC_LOCK_TOTAL, NULL, NULL, offsetof(vp_lock_site_t, over_budget) },
+  { "nvs_writes_total", "Preferences puts",
+    METRIC_COUNTER, &metric_nvs_writes, NULL },
+  { "sched_evaluations_total", "Automation passes run by TaskSync",
+    METRIC_COUNTER, &metric_sched_evals, NULL },
+  { "sched_last_us", "Duration of the last automation pass",
+    METRIC_GAUGE, &metric_sched_last_us, NULL },
+  { "log_lines_total", "Lines queued in the log ring",
+    METRIC_COUNTER, &metric_log_lines, NULL },
+  { "log_dropped_total", "Lines dropped on a full log ring",
+    METRIC_COUNTER, &metric_log_dropped, NULL },
+  { "journal_records_total", "Events written to the flash journal",
+    METRIC_COUNTER, &metric_journal_records, NULL },
+  { "journal_dropped_total", "Events lost to a full queue or a flash error",
+    METRIC_COUNTER, &metric_journal_dropped, NULL },
+  { "heap_free_bytes", "Free heap",
+    METRIC_SAMPLED, NULL, sample_heap_free },
+  { "heap_largest_free_block_bytes", "Largest block malloc can return",
+    METRIC_SAMPLED, NULL, sample_heap_largest_block },
+  { "task_stack_free_min_bytes", "Stack high-water mark, the least free stack seen",
+    METRIC_TASK_STACK, NULL, NULL },
+  { "task_jitter_ms", "Loop time past the declared period, per heartbeat",
+    METRIC_TASK_JITTER, NULL, NULL },
+  { "task_loop_max_ms", "Longest time between two heartbeats",
+    METRIC_TASK_LOOP_MAX, NULL, NULL },
+  { "task_deadline_missed_total", "Heartbeat deadlines missed",
+    METRIC_TASK_MISSED, NULL, NULL },
+  { "time_drift_ppb", "Learned clock frequency correction",
+    METRIC_SAMPLED, NULL, sample_time_freq_ppb },
+  { "time_offset_us", "Residual clock offset at the last NTP sample",
+    METRIC_SAMPLED, NULL, sample_time_offset_us },
+  { "time_slew_pending_us", "Correction still being slewed in",
+    METRIC_SAMPLED, NULL, sample_time_slew_pending_us },
+  { "time_jumps_total", "Wall clock jumps detected on resync",
+    METRIC_SAMPLED_TOTAL, NULL, sample_time_jumps },
+  { "ntp_sync_interval_seconds", "Current SNTP interval, grows once drift is locked",
+    METRIC_SAMPLED, NULL, sample_ntp_interval },
+  { "wifi_rssi_dbm", "Filtered RSSI of the station link",
+    METRIC_SAMPLED, NULL, sample_wifi_rssi },
+  { "wifi_signal_level", "Quality level shown on the panel, 0 Poor to 4 Excellent",
+    METRIC_SAMPLED, NULL, sample_wifi_level },
+  { "wifi_rssi_history_dbm", "Filtered RSSI per minute, minutes_ago 0 the newest",
+    METRIC_RSSI_HISTORY, NULL, NULL },
+  { "uptime_seconds", "Time since boot",
+    METRIC_SAMPLED, NULL, sample_uptime },
+};
+
+static const size_t num_metrics = sizeof(metrics_table) / sizeof(metric_desc_t);
+
+// === Record a histogram sample ===
+void metric_observe(metric_histogram_t *h, uint32_t value) {
+    uint8_t i = 0;
+    while (i < h->num_bounds && value > h->bounds[i]) {
+        i++;
+    }
+    __atomic_fetch_add(&h->buckets[i], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum, value, __ATOMIC_RELAXED);
+}
+
+// === Samples in a histogram ===
+uint32_t metric_count(const metric_histogram_t *h) {
+    uint32_t count = 0;
+    for (uint8_t i = 0; i <= h->num_bounds; i++) {
+        count += __atomic_load_n(&h->buckets[i], __ATOMIC_RELAXED);
+    }
+    return count;
+}
+
+// === Add a task to the stack gauge ===
+/**
+ * @brief Reports the stack high-water mark of `handle` as
+ * task_stack_free_min_bytes{task="name"}.
+ * @note Call from setup() after the task is created.
+ */
+void metrics_register_task(const char *name, TaskHandle_t handle) {
+    if (handle == NULL || metrics_num_tasks >= METRICS_TASKS_MAX) {
+        return;
+    }
+    metrics_tasks[metrics_num_tasks].name = name;
+    metrics_tasks[metrics_num_tasks].handle = handle;
+    metrics_num_tasks++;
+}
+
+// === Exposition ===
+// Lines before `skip` are counted but not formatted, and output stops
+// after `left` lines, so a reply can be written a window at a time
+typedef struct {
+  metrics_sink_t sink;
+  void *ctx;
+  uint32_t line;  // Lines seen so far
+  uint32_t skip;
+  uint32_t left;
+} metrics_out_t;
+
+static void metrics_line(metrics_out_t *out, const char *fmt, ...) {
+    if (out->line++ < out->skip || out->left == 0) {
+        return;
+    }
+    char line[METRICS_LINE_MAX];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (len > 0) {
+        out->sink(line, (size_t)len < sizeof(line) ? (size_t)len : sizeof(line) - 1, out->ctx);
+    }
+    out->left--;
+}
+
+static uint32_t metric_load(const uint32_t *value) {
+    return __atomic_load_n(value, __ATOMIC_RELAXED);
+}
+
+// `task` adds a task label to every series, NULL for none
+static void metrics_histogram(metrics_out_t *out, const char *name,
+                              const metric_histogram_t *h, const char *task) {
+    char label[40] = "";
+    char only[40] = "";
+    if (task != NULL) {
+        snprintf(label, sizeof(label), "task=\"%s\",", task);
+        snprintf(only, sizeof(only), "{task=\"%s\"}", task);
+    }
+
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < h->num_bounds; i++) {
+        total += metric_load(&h->buckets[i]);
+        metrics_line(out, METRICS_PREFIX "%s_bucket{%sle=\"%lu\"} %lu\n", name, label,
+                     (unsigned long)h->bounds[i], (unsigned long)total);
+    }
+    total += metric_load(&h->buckets[h->num_bounds]);
+    metrics_line(out, METRICS_PREFIX "%s_bucket{%sle=\"+Inf\"} %lu\n", name, label,
+                 (unsigned long)total);
+    metrics_line(out, METRICS_PREFIX "%s_sum%s %lu\n", name, only,
+                 (unsigned long)metric_load(&h->sum));
+    metrics_line(out, METRICS_PREFIX "%s_count%s %lu\n", name, only,
+                 (unsigned long)total);
+}
+
+/**
+ * @brief Writes lines `first` to `first + max - 1` of the Prometheus text
+ * format (0.0.4) exposition.
+ * @return Lines written, fewer than `max` at the end.
+ * @note Values are read one by one, not as a snapshot. Buckets racing
+ * with an update may disagree by a sample, a window may miss or repeat
+ * a line of a task, lock site or RSSI minute added meanwhile.
+ */
+uint32_t metrics_write_lines(metrics_sink_t sink, void *ctx, uint32_t first, uint32_t max) {
+    static const char *type_names[] = {
+        "counter", "gauge", "histogram", "gauge", "counter", "gauge", "counter", "gauge",
+        "histogram", "gauge", "counter", "gauge"
+    };
+    size_t num_tasks = 0;
+    const supervisor_task_t *tasks = supervisor_tasks(&num_tasks);
+
+    metrics_out_t out_lines = { sink, ctx, 0, first, max };
+    metrics_out_t *out = &out_lines;
+
+    for (size_t i = 0; i < num_metrics && out->left > 0; i++) {
+        const metric_desc_t *m = &metrics_table[i];
+        metrics_line(out, "# HELP " METRICS_PREFIX "%s %s\n", m->name, m->help);
+        metrics_line(out, "# TYPE " METRICS_PREFIX "%s %s\n", m->name, type_names[m->kind]);
+
+        switch (m->kind) {
+            case METRIC_COUNTER:
+                metrics_line(out, METRICS_PREFIX "%s %lu\n", m->name,
+                             (unsigned long)metric_load(&((const metric_counter_t *)m->metric)->value));
+                break;
+            case METRIC_GAUGE:
+                metrics_line(out, METRICS_PREFIX "%s %ld\n", m->name,
+                             (long)__atomic_load_n(&((const metric_gauge_t *)m->metric)->value,
+                                                   __ATOMIC_RELAXED));
+                break;
+            case METRIC_HISTOGRAM:
+                metrics_histogram(out, m->name, (const metric_histogram_t *)m->metric, NULL);
+                break;
+            case METRIC_SAMPLED:
+            case METRIC_SAMPLED_TOTAL:
+                metrics_line(out, METRICS_PREFIX "%s %ld\n", m->name, (long)m->sample());
+                break;
+            case METRIC_TASK_STACK:
+                for (size_t t = 0; t < metrics_num_tasks; t++) {
+                    metrics_line(out, METRICS_PREFIX "%s{task=\"%s\"} %lu\n", m->name,
+                                 metrics_tasks[t].name,
+                                 (unsigned long)uxTaskGetStackHighWaterMark(metrics_tasks[t].handle));
+                }
+                break;
+            case METRIC_LOCK_TOTAL:
+            case METRIC_LOCK_MAX:
+                for (const vp_lock_site_t *site = vp_lock_sites(); site; site = site->next) {
+                    const char *file = strrchr(site->file, '/');
+                    metrics_line(out, METRICS_PREFIX "%s{site=\"%s:%u\",func=\"%s\"} %lu\n",
+                                 m->name, file ? file + 1 : site->file, site->line, site->func,
+                                 (unsigned long)metric_load(
+                                     (const uint32_t *)((const uint8_t *)site + m->field)));
+                }
+                break;
+            case METRIC_TASK_JITTER:
+            case METRIC_TASK_LOOP_MAX:
+            case METRIC_TASK_MISSED:
+                for (size_t t = 0; t < num_tasks; t++) {
+                    const char *task = __atomic_load_n(&tasks[t].name, __ATOMIC_ACQUIRE);
+                    if (task == NULL) {
+                        continue;
+                    }
+                    if (m->kind == METRIC_TASK_JITTER) {
+                        metrics_histogram(out, m->name, &tasks[t].jitter_ms, task);
+                    } else {
+                        metrics_line(out, METRICS_PREFIX "%s{task=\"%s\"} %lu\n",
+                                     m->name, task, (unsigned long)metric_load(
+                                         m->kind == METRIC_TASK_MISSED ? &tasks[t].missed.value
+                                                                       : &tasks[t].max_ms));
+                    }
+                }
+                break;
+            case METRIC_RSSI_HISTORY: {
+                int8_t history[WIFI_RSSI_HISTORY_LEN];
+                size_t count = wifi_signal_history(history, WIFI_RSSI_HISTORY_LEN);
+                for (size_t h = 0; h < count; h++) {
+                    metrics_line(out, METRICS_PREFIX "%s{minutes_ago=\"%u\"} %d\n", m->name,
+                                 (unsigned)(count - 1 - h), history[h]);
+                }
+                break;
+            }
+        }
+    }
+    return max - out->left;
+}
+
+// === Whole exposition ===
+void metrics_write(metrics_sink_t sink, void *ctx) {
+    metrics_write_lines(sink, ctx, 0, UINT32_MAX);
+}
@@ -0,0 +1,551 @@
+#include "global.h"
+#include "mqtt_bridge.h"
+#include <PubSubClient.h>
+#include <lwip/dns.h>
+#include <lwip/sockets.h>
+
+// === MQTT Bridge State ===
+// Polled from TaskWiFi. Every MQTT_PUBLISH_MS the VPs that changed since
+// the last batch are formatted into delta messages and queued, whether
+// or not the broker is reachable. The queue is a RAM ring of records
+// (2-byte length, payload) that spills its oldest records to fixed size
+// NVS segments when full, so the order is always flash, then RAM.
+// Delivery is at least once: a message leaves the queue only after the
+// broker accepted it, and a segment cut short by a reboot is resent.
+static WiFiClient mqtt_net;
+static PubSubClient mqtt_client(mqtt_net);
+static bool mqtt_started = false;
+static uint32_t mqtt_next_batch_ms = 0;
+static uint32_t mqtt_next_connect_ms = 0;
+static mqtt_stats_t mqtt_stats;
+
+// Connect attempt. The broker name is resolved and the TCP handshake
+// run without waiting, PubSubClient gets the connected socket and only
+// waits for CONNACK, up to MQTT_TIMEOUT_S.
+typedef enum {
+    MQTT_CONN_IDLE,
+    MQTT_CONN_RESOLVE, // Name lookup in flight
+    MQTT_CONN_TCP      // Non-blocking connect() in flight
+} mqtt_conn_state_t;
+
+static mqtt_conn_state_t mqtt_conn = MQTT_CONN_IDLE;
+static uint32_t mqtt_conn_deadline_ms = 0;
+static int mqtt_conn_fd = -1;
+
+// Written by the DNS callback on the tcpip thread, `mqtt_dns_tag` drops
+// answers to an abandoned lookup
+static portMUX_TYPE mqtt_dns_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t mqtt_dns_tag = 0;
+static uint32_t mqtt_dns_addr = 0; // 0 if the lookup failed
+static bool mqtt_dns_done = false;
+
+// Topics, fixed at begin() from the hostname
+static char mqtt_id[16];
+static char mqtt_topic_delta[32];
+static char mqtt_topic_status[32];
+static char mqtt_topic_cmd[32];
+static char mqtt_topic_ack[32];
+
+// Delta cursor, see vp_change_seq(). A full batch follows boot and any
+// lost message, so dashboards can resync from the stream alone.
+static uint32_t mqtt_cursor = 0;
+static bool mqtt_full = true;
+static uint32_t mqtt_seq = 0;
+static vp_values_t mqtt_snap;
+static char mqtt_msg[MQTT_MSG_MAX];
+
+// RAM ring, records in [ring_head, ring_tail), compacted to the front
+// when the tail runs out of room
+static uint8_t mqtt_ring[MQTT_RING_BYTES];
+static size_t ring_head = 0;
+static size_t ring_tail = 0;
+static size_t ring_records = 0;
+
+// Flash segments: 2-byte record count, records, zero padding. Slots are
+// used round robin from seg_first, seg_sent records of the first one
+// are already published (RAM only).
+static uint8_t mqtt_seg[MQTT_SPILL_BYTES];
+static uint8_t seg_first = 0;
+static uint8_t seg_count = 0;
+static int seg_loaded = -1;   // Slot held in mqtt_seg, -1 if none
+static uint16_t seg_sent = 0;
+static size_t seg_off = 0;    // Offset of record seg_sent
+
+static inline uint16_t mqtt_get_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline void mqtt_put_u16(uint8_t *p, uint16_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+static void mqtt_seg_key(uint8_t slot, char *key, size_t len) {
+    snprintf(key, len, MQTT_SPILL_SLOT_KEY, (unsigned)slot);
+}
+
+static void mqtt_seg_save_meta(void) {
+    vp_save_u32(MQTT_SPILL_KEY, ((uint32_t)seg_first << 8) | seg_count);
+    mqtt_stats.spill_count = seg_count;
+}
+
+// Oldest segment is gone, sent or dropped
+static void mqtt_seg_pop(void) {
+    seg_first = (seg_first + 1) % MQTT_SPILL_SEGMENTS;
+    seg_count--;
+    seg_sent = 0;
+    seg_loaded = -1;
+    mqtt_seg_save_meta();
+}
+
+// === Spill the oldest RAM records to a new flash segment ===
+static void mqtt_spill(void) {
+    char key[12];
+
+    // Make room by dropping the oldest segment, its unsent records are lost
+    if (seg_count == MQTT_SPILL_SEGMENTS) {
+        mqtt_seg_key(seg_first, key, sizeof(key));
+        uint16_t records = 0;
+        if (vp_load_blob(key, mqtt_seg, sizeof(mqtt_seg))) {
+            records = mqtt_get_u16(mqtt_seg);
+        }
+        mqtt_stats.dropped += records > seg_sent ? records - seg_sent : 0;
+        mqtt_seg_pop();
+        mqtt_full = true;
+        debug_warnf("[MQTT] Backlog full, dropped %u message(s)\n", (unsigned)records);
+    }
+
+    // Pack whole records, at least one always fits
+    memset(mqtt_seg, 0, sizeof(mqtt_seg));
+    size_t off = 2;
+    uint16_t records = 0;
+    while (ring_records > 0) {
+        size_t rec = 2 + mqtt_get_u16(&mqtt_ring[ring_head]);
+        if (off + rec > sizeof(mqtt_seg)) {
+            break;
+        }
+        memcpy(&mqtt_seg[off], &mqtt_ring[ring_head], rec);
+        off += rec;
+        ring_head += rec;
+        ring_records--;
+        records++;
+    }
+    mqtt_put_u16(mqtt_seg, records);
+
+    // Segment first, then the count that makes it visible
+    uint8_t slot = (seg_first + seg_count) % MQTT_SPILL_SEGMENTS;
+    mqtt_seg_key(slot, key, sizeof(key));
+    vp_save_blob(key, mqtt_seg, sizeof(mqtt_seg));
+    seg_count++;
+    seg_loaded = -1; // mqtt_seg no longer holds the replay segment
+    mqtt_seg_save_meta();
+    mqtt_stats.spilled += records;
+}
+
+// === Queue one message ===
+static void mqtt_enqueue(const char *msg, size_t len) {
+    size_t rec = 2 + len;
+
+    while (MQTT_RING_BYTES - (ring_tail - ring_head) < rec) {
+        mqtt_spill();
+    }
+    if (ring_records == 0) {
+        ring_head = ring_tail = 0;
+    } else if (ring_tail + rec > MQTT_RING_BYTES) {
+        memmove(mqtt_ring, &mqtt_ring[ring_head], ring_tail - ring_head);
+        ring_tail -= ring_head;
+        ring_head = 0;
+    }
+
+    mqtt_put_u16(&mqtt_ring[ring_tail], (uint16_t)len);
+    memcpy(&mqtt_ring[ring_tail + 2], msg, len);
+    ring_tail += rec;
+    ring_records++;
+
+    mqtt_stats.batches++;
+    mqtt_stats.ring_used = ring_tail - ring_head;
+    if (mqtt_stats.ring_used > mqtt_stats.ring_peak) {
+        mqtt_stats.ring_peak = mqtt_stats.ring_used;
+    }
+}
+
+// === Build the delta batch ===
+/**
+ * @brief Queues the VPs changed since the last batch, split over several
+ * messages when they do not fit in MQTT_MSG_MAX.
+ * @note Values come from a snapshot taken with the change sequence under
+ * xVPMutex. A VP changed after it is skipped and goes out with its
+ * latest value in the next batch, so bursts coalesce.
+ */
+static void mqtt_build_batch(void) {
+    uint32_t upto = 0;
+
+    if (vp_lock()) {
+        memcpy(&mqtt_snap, &vp, sizeof(vp));
+        upto = vp_change_seq();
+        vp_unlock();
+    }
+
+    time_snapshot_t now;
+    uint32_t epoch = time_now(&now) ? now.epoch : 0;
+    bool full = mqtt_full;
+    size_t len = 0;
+    mqtt_full = false; // A spill below may set it again
+
+    for (size_t i = 0; i < num_vp_items; i++) {
+        uint32_t seq = vp_item_seq(i);
+        if (vp_items[i].address == VP_WIFI_PSWD ||
+            (!full && (seq <= mqtt_cursor || seq > upto))) {
+            continue;
+        }
+
+        // Close the message when the next member might not fit
+        if (len > 0 && len + VP_JSON_ITEM_MAX + 2 > sizeof(mqtt_msg)) {
+            len += snprintf(&mqtt_msg[len], sizeof(mqtt_msg) - len, "}}");
+            mqtt_enqueue(mqtt_msg, len);
+            len = 0;
+        }
+        if (len == 0) {
+            len = snprintf(mqtt_msg, sizeof(mqtt_msg), "{\"seq\":%lu,\"t\":%lu,%s\"d\":{",
+                           (unsigned long)++mqtt_seq, (unsigned long)epoch,
+                           full ? "\"full\":true," : "");
+        } else {
+            mqtt_msg[len++] = ',';
+        }
+        len += vp_json_item(&vp_items[i], &mqtt_snap, &mqtt_msg[len]);
+    }
+
+    if (len > 0) {
+        len += snprintf(&mqtt_msg[len], sizeof(mqtt_msg) - len, "}}");
+        mqtt_enqueue(mqtt_msg, len);
+    }
+    mqtt_cursor = upto;
+}
+
+// === Commands ===
+static void mqtt_on_message(char *topic, uint8_t *payload, unsigned int len) {
+    if (strcmp(topic, mqtt_topic_cmd) != 0) {
+        return;
+    }
+
+    // Same validation and all-or-nothing apply as PUT /vp
+    size_t changed = 0;
+    int status = vp_http_apply_json((const char *)payload, len, &changed);
+    if (status == 0) {
+        mqtt_stats.commands++;
+        snprintf(mqtt_msg, sizeof(mqtt_msg), "{\"changed\":%u}", (unsigned)changed);
+    } else {
+        mqtt_stats.rejected++;
+        snprintf(mqtt_msg, sizeof(mqtt_msg), "{\"error\":\"%s\"}", vp_http_error());
+        debug_printf("[MQTT] Command rejected: %s\n", vp_http_error());
+    }
+    mqtt_client.publish(mqtt_topic_ack, mqtt_msg);
+}
+
+// === Broker name lookup ===
+static void mqtt_dns_found(const char *name, const ip_addr_t *ipaddr, void *arg) {
+    (void)name;
+    portENTER_CRITICAL(&mqtt_dns_mux);
+    if ((uint8_t)(uintptr_t)arg == mqtt_dns_tag) {
+        mqtt_dns_addr = ipaddr ? ip_addr_get_ip4_u32(ipaddr) : 0;
+        mqtt_dns_done = true;
+    }
+    portEXIT_CRITICAL(&mqtt_dns_mux);
+}
+
+// Starts a new lookup tag, or only orphans the pending one
+static uint8_t mqtt_dns_reset(void) {
+    portENTER_CRITICAL(&mqtt_dns_mux);
+    uint8_t tag = ++mqtt_dns_tag;
+    mqtt_dns_done = false;
+    portEXIT_CRITICAL(&mqtt_dns_mux);
+    return tag;
+}
+
+// Address of the finished lookup, 0 if it failed
+static bool mqtt_dns_result(uint32_t *addr) {
+    portENTER_CRITICAL(&mqtt_dns_mux);
+    bool done = mqtt_dns_done;
+    *addr = mqtt_dns_addr;
+    portEXIT_CRITICAL(&mqtt_dns_mux);
+    return done;
+}
+
+// === Connect attempt ===
+static void mqtt_conn_abort(void) {
+    if (mqtt_conn_fd >= 0) {
+        close(mqtt_conn_fd);
+        mqtt_conn_fd = -1;
+    }
+    if (mqtt_conn == MQTT_CONN_RESOLVE) {
+        mqtt_dns_reset(); // A pending answer is not ours any more
+    }
+    mqtt_conn = MQTT_CONN_IDLE;
+}
+
+// Non-blocking connect() to the resolved broker
+static void mqtt_tcp_start(uint32_t addr) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        debug_printf("[MQTT] No socket for the broker\n");
+        mqtt_conn = MQTT_CONN_IDLE;
+        return;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    struct sockaddr_in broker;
+    memset(&broker, 0, sizeof(broker));
+    broker.sin_family = AF_INET;
+    broker.sin_port = htons(MQTT_BROKER_PORT);
+    broker.sin_addr.s_addr = addr;
+    if (connect(fd, (struct sockaddr *)&broker, sizeof(broker)) < 0 && errno != EINPROGRESS) {
+        debug_printf("[MQTT] Connect to %s failed, errno %d\n", MQTT_BROKER, errno);
+        close(fd);
+        mqtt_conn = MQTT_CONN_IDLE;
+        return;
+    }
+    mqtt_conn_fd = fd;
+    mqtt_conn = MQTT_CONN_TCP;
+}
+
+// Handshake state of the pending socket: 1 done, 0 in flight, -errno failed
+static int mqtt_tcp_check(void) {
+    fd_set writable;
+    FD_ZERO(&writable);
+    FD_SET(mqtt_conn_fd, &writable);
+    struct timeval none = { 0, 0 };
+    int ready = select(mqtt_conn_fd + 1, NULL, &writable, NULL, &none);
+    if (ready == 0) {
+        return 0;
+    }
+
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (ready < 0 || getsockopt(mqtt_conn_fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0) {
+        err = errno;
+    }
+    return err == 0 ? 1 : -err;
+}
+
+static bool mqtt_connect(void) {
+    if (!mqtt_client.connect(mqtt_id, mqtt_topic_status, 1, true, "offline")) {
+        debug_printf("[MQTT] Connect failed, state %d\n", mqtt_client.state());
+        return false;
+    }
+    mqtt_client.publish(mqtt_topic_status, "online", true);
+    mqtt_client.subscribe(mqtt_topic_cmd);
+    debug_printf("[MQTT] Connected, %u segment(s) and %u message(s) queued\n",
+                 (unsigned)seg_count, (unsigned)ring_records);
+    return true;
+}
+
+/**
+ * @brief Advances a connect attempt, starting one every MQTT_RETRY_MS.
+ * @return true once the session is up.
+ * @note Only the CONNACK wait in mqtt_connect() blocks, the lookup and
+ * the handshake are checked once per call.
+ */
+static bool mqtt_connect_poll(uint32_t now_ms) {
+    if (mqtt_conn == MQTT_CONN_IDLE) {
+        if ((int32_t)(now_ms - mqtt_next_connect_ms) < 0) {
+            return false;
+        }
+        mqtt_next_connect_ms = now_ms + MQTT_RETRY_MS;
+        mqtt_conn_deadline_ms = now_ms + MQTT_CONNECT_TIMEOUT_MS;
+
+        // Called directly, as the Arduino core's hostByName() does
+        ip_addr_t addr;
+        uint8_t tag = mqtt_dns_reset();
+        err_t err = dns_gethostbyname(MQTT_BROKER, &addr, mqtt_dns_found,
+                                      (void *)(uintptr_t)tag);
+        if (err == ERR_INPROGRESS) {
+            mqtt_conn = MQTT_CONN_RESOLVE;
+            return false;
+        }
+        if (err != ERR_OK) {
+            debug_printf("[MQTT] Cannot resolve %s\n", MQTT_BROKER);
+            return false;
+        }
+        mqtt_tcp_start(ip_addr_get_ip4_u32(&addr));
+        return false;
+    }
+
+    bool due = (int32_t)(now_ms - mqtt_conn_deadline_ms) >= 0;
+
+    if (mqtt_conn == MQTT_CONN_RESOLVE) {
+        uint32_t addr = 0;
+        if (mqtt_dns_result(&addr)) {
+            mqtt_conn = MQTT_CONN_IDLE;
+            if (addr == 0) {
+                debug_printf("[MQTT] Cannot resolve %s\n", MQTT_BROKER);
+                return false;
+            }
+            mqtt_tcp_start(addr);
+
+        } else if (due) {
+            debug_printf("[MQTT] No DNS answer for %s\n", MQTT_BROKER);
+            mqtt_conn_abort();
+        }
+        return false;
+    }
+
+    int state = mqtt_tcp_check();
+    if (state == 0) {
+        if (due) {
+            debug_printf("[MQTT] No answer from %s\n", MQTT_BROKER);
+            mqtt_conn_abort();
+        }
+        return false;
+    }
+    if (state < 0) {
+        debug_printf("[MQTT] Connect to %s failed, errno %d\n", MQTT_BROKER, -state);
+        mqtt_conn_abort();
+        return false;
+    }
+
+    // Blocking again, as WiFiClient::connect() leaves its sockets
+    int fd = mqtt_conn_fd;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) & ~O_NONBLOCK);
+    mqtt_conn_fd = -1;
+    mqtt_conn = MQTT_CONN_IDLE;
+    mqtt_net = WiFiClient(fd);
+    return mqtt_connect();
+}
+
+// === Publish the backlog, oldest first ===
+/**
+ * @brief Sends up to MQTT_SEND_PER_POLL queued messages, flash segments
+ * before the RAM ring. A message the broker refuses stays queued.
+ */
+static void mqtt_send_backlog(void) {
+    char key[12];
+
+    for (int budget = MQTT_SEND_PER_POLL; budget > 0; budget--) {
+        if (seg_count > 0) {
+            if (seg_loaded != seg_first) {
+                mqtt_seg_key(seg_first, key, sizeof(key));
+                if (!vp_load_blob(key, mqtt_seg, sizeof(mqtt_seg))) {
+                    mqtt_seg_pop(); // Erased or unreadable, skip it
+                    mqtt_full = true;
+                    continue;
+                }
+                seg_loaded = seg_first;
+                seg_off = 2;
+                for (uint16_t i = 0; i < seg_sent; i++) {
+                    seg_off += 2 + mqtt_get_u16(&mqtt_seg[seg_off]);
+                }
+            }
+
+            uint16_t records = mqtt_get_u16(mqtt_seg);
+            if (seg_sent < records) {
+                uint16_t len = mqtt_get_u16(&mqtt_seg[seg_off]);
+                if (!mqtt_client.publish(mqtt_topic_delta, &mqtt_seg[seg_off + 2], len)) {
+                    return;
+                }
+                mqtt_stats.published++;
+                seg_sent++;
+                seg_off += 2 + len;
+            }
+            if (seg_sent >= records) {
+                mqtt_seg_pop();
+            }
+
+        } else if (ring_records > 0) {
+            uint16_t len = mqtt_get_u16(&mqtt_ring[ring_head]);
+            if (!mqtt_client.publish(mqtt_topic_delta, &mqtt_ring[ring_head + 2], len)) {
+                return;
+            }
+            mqtt_stats.published++;
+            ring_head += 2 + len;
+            ring_records--;
+            mqtt_stats.ring_used = ring_tail - ring_head;
+
+        } else {
+            break;
+        }
+    }
+}
+
+// === Start ===
+/**
+ * @brief Sets up topics from the hostname and restores the flash
+ * backlog left by the previous boot.
+ * @note Call from TaskWiFi before the first poll.
+ */
+void mqtt_bridge_begin(void) {
+    const char *host = vp.hostname[0] ? vp.hostname : "node";
+
+    snprintf(mqtt_id, sizeof(mqtt_id), "%s-%s", MQTT_TOPIC_ROOT, host);
+    snprintf(mqtt_topic_delta, sizeof(mqtt_topic_delta), "%s/%s/delta", MQTT_TOPIC_ROOT, host);
+    snprintf(mqtt_topic_status, sizeof(mqtt_topic_status), "%s/%s/status", MQTT_TOPIC_ROOT, host);
+    snprintf(mqtt_topic_cmd, sizeof(mqtt_topic_cmd), "%s/%s/cmd", MQTT_TOPIC_ROOT, host);
+    snprintf(mqtt_topic_ack, sizeof(mqtt_topic_ack), "%s/%s/ack", MQTT_TOPIC_ROOT, host);
+
+    uint32_t meta = vp_load_u32(MQTT_SPILL_KEY, 0);
+    seg_first = (uint8_t)(meta >> 8) % MQTT_SPILL_SEGMENTS;
+    seg_count = (uint8_t)meta;
+    if (seg_count > MQTT_SPILL_SEGMENTS) {
+        seg_count = 0;
+    }
+    seg_sent = 0;
+    seg_loaded = -1;
+    mqtt_stats.spill_count = seg_count;
+
+    // Topic and header on top of the payload
+    mqtt_client.setServer(MQTT_BROKER, MQTT_BROKER_PORT);
+    mqtt_client.setCallback(mqtt_on_message);
+    mqtt_client.setBufferSize(MQTT_MSG_MAX + 64);
+    mqtt_client.setSocketTimeout(MQTT_TIMEOUT_S);
+    mqtt_started = true;
+
+    if (seg_count > 0) {
+        debug_printf("[MQTT] %u backlog segment(s) from flash\n", (unsigned)seg_count);
+    }
+}
+
+// === Poll ===
+/**
+ * @brief Builds a batch when one is due, and while `link_up` keeps the
+ * session open, runs commands and sends the backlog.
+ * @note Call from TaskWiFi on every loop, also while offline.
+ */
+void mqtt_bridge_poll(uint32_t now_ms, bool link_up) {
+    if (!mqtt_started) {
+        return;
+    }
+
+    if ((int32_t)(now_ms - mqtt_next_batch_ms) >= 0) {
+        mqtt_next_batch_ms = now_ms + MQTT_PUBLISH_MS;
+        mqtt_build_batch();
+    }
+
+    if (!link_up) {
+        if (mqtt_client.connected()) {
+            mqtt_client.disconnect();
+        }
+        mqtt_conn_abort();
+        mqtt_stats.connected = false;
+        return;
+    }
+
+    if (!mqtt_client.connected() && !mqtt_connect_poll(now_ms)) {
+        mqtt_stats.connected = false;
+        return;
+    }
+
+    if (mqtt_client.loop()) {
+        mqtt_send_backlog();
+    }
+    mqtt_stats.connected = mqtt_client.connected();
+}
+
+// A backlog is being sent or a connect is in flight, TaskWiFi should
+// come back soon
+bool mqtt_bridge_busy(void) {
+    return mqtt_conn != MQTT_CONN_IDLE ||
+           (mqtt_stats.connected && (seg_count > 0 || ring_records > 0));
+}
+
+void mqtt_bridge_stats(mqtt_stats_t *stats) {
+    *stats = mqtt_stats;
+}
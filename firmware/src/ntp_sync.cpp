@@ -0,0 +1,368 @@
+#include "global.h"
+#include "ntp_sync.h"
+#include <lwip/dns.h>
+
+// === SNTP Client State ===
+// Driven by ntp_sync_poll() from TaskWiFi. Nothing here waits: a request
+// is sent, and later polls pick up the reply or give up on a deadline.
+// Server names go to lwIP's resolver the same way, its cache keeps them
+// for their TTL.
+typedef enum {
+    NTP_STATE_STOPPED,
+    NTP_STATE_IDLE,    // Waiting for the next round
+    NTP_STATE_RESOLVE, // Name lookup in flight
+    NTP_STATE_WAIT     // Request in flight
+} ntp_state_t;
+
+static WiFiUDP ntp_udp;
+static const char *const *ntp_servers = NULL;
+static uint8_t ntp_server_count = 0;
+static uint32_t ntp_interval_ms = 0;   // Base interval
+static uint32_t ntp_interval_cur = 0;  // Current, grows once drift is locked
+static ntp_sync_cb ntp_on_complete = NULL;
+
+static ntp_state_t ntp_state = NTP_STATE_STOPPED;
+static uint32_t ntp_deadline_ms = 0; // Next round, or reply timeout
+static uint32_t ntp_retry_ms = NTP_RETRY_MIN_MS;
+static uint8_t ntp_server_idx = 0;
+static uint8_t ntp_cookie[8]; // Echoed back as the originate timestamp
+static int64_t ntp_t1_us = 0; // Monotonic send time
+
+// Written by the DNS callback on the tcpip thread, `ntp_dns_tag` drops
+// answers to lookups given up on
+static portMUX_TYPE ntp_dns_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t ntp_dns_tag = 0;
+static uint32_t ntp_dns_addr = 0; // 0 if the lookup failed
+static bool ntp_dns_done = false;
+
+// Best reply of the current round (lowest delay)
+static ntp_sync_result_t ntp_round;
+static int64_t ntp_best_server_us = 0; // Server time at ntp_best_t4_us
+static int64_t ntp_best_t4_us = 0;
+static bool ntp_best_local_valid = false;
+
+static int64_t ntp_offset_avg_us = 0;
+static uint32_t ntp_sync_count = 0;
+
+// === Packet helpers ===
+static uint32_t ntp_read_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | p[3];
+}
+
+// NTP 32.32 timestamp to UTC microseconds
+static int64_t ntp_stamp_to_us(const uint8_t *p) {
+    uint64_t sec = ntp_read_be32(p);
+    uint64_t frac = ntp_read_be32(p + 4);
+
+    // Era 1 starts in 2036, seconds wrap around 2^32
+    if (sec < 0x80000000UL) {
+        sec += 0x100000000ULL;
+    }
+    return (int64_t)(sec - NTP_UNIX_OFFSET) * 1000000 +
+           (int64_t)((frac * 1000000) >> 32);
+}
+
+// === Send one request ===
+/**
+ * @brief Sends an SNTP client request to the current server at `addr`.
+ * @return false if the packet could not be sent (no route).
+ */
+static bool ntp_send_request(IPAddress addr) {
+    uint8_t packet[NTP_PACKET_SIZE];
+    memset(packet, 0, sizeof(packet));
+    packet[0] = 0x23; // LI 0, version 4, mode 3 (client)
+
+    // Random transmit stamp, only used to match the reply
+    for (uint8_t i = 0; i < sizeof(ntp_cookie); i += 4) {
+        uint32_t r = esp_random();
+        memcpy(&ntp_cookie[i], &r, 4);
+    }
+    memcpy(&packet[40], ntp_cookie, sizeof(ntp_cookie));
+
+    if (!ntp_udp.beginPacket(addr, NTP_PORT)) {
+        return false;
+    }
+    ntp_udp.write(packet, sizeof(packet));
+    ntp_t1_us = esp_timer_get_time();
+    return ntp_udp.endPacket() != 0;
+}
+
+// === Check for a matching reply ===
+/**
+ * @brief Drains received packets and keeps the reply to our request.
+ * @note Stale replies, Kiss-o'-Death and unsynchronised servers are
+ * dropped without failing the request.
+ * @return true if a valid reply was recorded.
+ */
+static bool ntp_read_reply(void) {
+    uint8_t packet[NTP_PACKET_SIZE];
+
+    while (ntp_udp.parsePacket() > 0) {
+        int len = ntp_udp.read(packet, sizeof(packet));
+        int64_t t4_us = esp_timer_get_time();
+        int64_t local_us = time_epoch_us();
+
+        uint8_t leap = packet[0] >> 6;
+        uint8_t mode = packet[0] & 0x07;
+        uint8_t stratum = packet[1];
+        if (len < NTP_PACKET_SIZE ||
+            mode != 4 || leap == 3 ||
+            stratum == 0 || stratum > 15 ||
+            memcmp(&packet[24], ntp_cookie, sizeof(ntp_cookie)) != 0
+        ) {
+            continue;
+        }
+
+        int64_t t2 = ntp_stamp_to_us(&packet[32]);
+        int64_t t3 = ntp_stamp_to_us(&packet[40]);
+        int64_t delay = (t4_us - ntp_t1_us) - (t3 - t2);
+        if (delay < 0) {
+            delay = 0;
+        }
+
+        // Server clock at the receive instant, half the path assumed
+        int64_t server_us = t3 + delay / 2;
+        ntp_round.replies++;
+
+        if (ntp_round.replies == 1 || (uint32_t)delay < ntp_round.delay_us) {
+            ntp_round.server = ntp_server_idx;
+            ntp_round.delay_us = (uint32_t)delay;
+            ntp_round.offset_us = local_us ? server_us - local_us : 0;
+            ntp_best_local_valid = local_us != 0;
+            ntp_best_server_us = server_us;
+            ntp_best_t4_us = t4_us;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+// === Apply the best reply of the round ===
+static void ntp_finish_round(uint32_t now_ms) {
+    ntp_state = NTP_STATE_IDLE;
+    ntp_round.ok = ntp_round.replies > 0;
+
+    if (!ntp_round.ok) {
+        ntp_deadline_ms = now_ms + ntp_retry_ms;
+        debug_printf("[NTP] No server answered, retrying in %lu ms\n",
+                    (unsigned long)ntp_retry_ms);
+        ntp_retry_ms = ntp_retry_ms * 2 > NTP_RETRY_MAX_MS ?
+            NTP_RETRY_MAX_MS : ntp_retry_ms * 2;
+
+    } else {
+        int64_t offset = ntp_round.offset_us;
+        ntp_retry_ms = NTP_RETRY_MIN_MS;
+        ntp_sync_count++;
+
+        if (!ntp_best_local_valid || time_source_get() != TIME_SOURCE_NTP) {
+            // First sync: take the server time as is, an RTC time is only
+            // good to the second and not worth slewing from
+            time_source_offer(TIME_SOURCE_NTP, ntp_best_server_us +
+                              (esp_timer_get_time() - ntp_best_t4_us));
+            ntp_round.stepped = true;
+        } else {
+            // Clock discipline slews small errors and learns the drift
+            ntp_round.stepped = time_discipline(offset);
+        }
+        ntp_round.applied_us = offset;
+        ntp_offset_avg_us = ntp_round.stepped ? 0 :
+            ntp_offset_avg_us + (offset - ntp_offset_avg_us) / 4;
+
+        // Known drift needs fewer wakeups, anything else starts over
+        if (time_drift_locked()) {
+            if (ntp_interval_cur < (ntp_interval_ms << NTP_INTERVAL_MAX_SHIFT)) {
+                ntp_interval_cur *= 2;
+            }
+        } else {
+            ntp_interval_cur = ntp_interval_ms;
+        }
+        ntp_deadline_ms = now_ms + ntp_interval_cur;
+
+        time_discipline_stats_t stats;
+        time_discipline_stats(&stats);
+        debug_printf("[NTP] Synced from %s, offset %+lld ms, delay %lu ms, "
+                    "drift %+ld ppb, next in %lu s%s\n",
+                    ntp_servers[ntp_round.server],
+                    (long long)(offset / 1000),
+                    (unsigned long)(ntp_round.delay_us / 1000),
+                    (long)stats.freq_ppb,
+                    (unsigned long)(ntp_interval_cur / 1000),
+                    ntp_round.stepped ? " (step)" : "");
+    }
+
+    if (ntp_on_complete) {
+        ntp_on_complete(&ntp_round);
+    }
+}
+
+// === Server name lookup ===
+static void ntp_dns_found(const char *name, const ip_addr_t *ipaddr, void *arg) {
+    (void)name;
+    portENTER_CRITICAL(&ntp_dns_mux);
+    if ((uint8_t)(uintptr_t)arg == ntp_dns_tag) {
+        ntp_dns_addr = ipaddr ? ip_addr_get_ip4_u32(ipaddr) : 0;
+        ntp_dns_done = true;
+    }
+    portEXIT_CRITICAL(&ntp_dns_mux);
+}
+
+// Starts a new lookup tag, or only orphans the pending one
+static uint8_t ntp_dns_reset(void) {
+    portENTER_CRITICAL(&ntp_dns_mux);
+    uint8_t tag = ++ntp_dns_tag;
+    ntp_dns_done = false;
+    portEXIT_CRITICAL(&ntp_dns_mux);
+    return tag;
+}
+
+// Address of the finished lookup, 0 if it failed
+static bool ntp_dns_result(uint32_t *addr) {
+    portENTER_CRITICAL(&ntp_dns_mux);
+    bool done = ntp_dns_done;
+    *addr = ntp_dns_addr;
+    portEXIT_CRITICAL(&ntp_dns_mux);
+    return done;
+}
+
+/**
+ * @brief Sends to the current server, or to the next one that can be
+ * reached, and finishes the round when none is left.
+ * @note A name lwIP has cached is sent to at once, anything else waits
+ * in NTP_STATE_RESOLVE for ntp_dns_found().
+ */
+static void ntp_start_server(uint32_t now_ms) {
+    for (; ntp_server_idx < ntp_server_count; ntp_server_idx++) {
+        ip_addr_t addr;
+        uint8_t tag = ntp_dns_reset();
+
+        // Called directly, as the Arduino core's hostByName() does
+        err_t err = dns_gethostbyname(ntp_servers[ntp_server_idx], &addr, ntp_dns_found,
+                                      (void *)(uintptr_t)tag);
+        if (err == ERR_INPROGRESS) {
+            ntp_state = NTP_STATE_RESOLVE;
+            ntp_deadline_ms = now_ms + NTP_DNS_TIMEOUT_MS;
+            return;
+        }
+        if (err == ERR_OK && ntp_send_request(IPAddress(ip_addr_get_ip4_u32(&addr)))) {
+            ntp_state = NTP_STATE_WAIT;
+            ntp_deadline_ms = now_ms + NTP_REPLY_TIMEOUT_MS;
+            return;
+        }
+        debug_printf("[NTP] Cannot reach %s\n", ntp_servers[ntp_server_idx]);
+    }
+    ntp_finish_round(now_ms);
+}
+
+// === Move on to the next server of the round ===
+static void ntp_next_server(uint32_t now_ms) {
+    ntp_server_idx++;
+    ntp_start_server(now_ms);
+}
+
+// === Start the service ===
+/**
+ * @brief Starts periodic SNTP rounds against `servers`, the first one on
+ * the next poll.
+ * @param servers Array of host names, must stay valid while running.
+ * @param on_complete Optional, called after every round.
+ */
+void ntp_sync_begin(
+    const char *const *servers, uint8_t count,
+    uint32_t interval_ms, ntp_sync_cb on_complete
+) {
+    ntp_sync_stop();
+
+    ntp_servers = servers;
+    ntp_server_count = count > NTP_MAX_SERVERS ? NTP_MAX_SERVERS : count;
+    ntp_interval_ms = interval_ms;
+    ntp_interval_cur = interval_ms;
+    ntp_on_complete = on_complete;
+    ntp_retry_ms = NTP_RETRY_MIN_MS;
+
+    ntp_udp.begin(NTP_LOCAL_PORT);
+    ntp_state = NTP_STATE_IDLE;
+    ntp_deadline_ms = millis();
+}
+
+void ntp_sync_stop(void) {
+    if (ntp_state != NTP_STATE_STOPPED) {
+        ntp_udp.stop();
+        ntp_state = NTP_STATE_STOPPED;
+        ntp_dns_reset(); // A pending answer is not ours any more
+    }
+}
+
+// === Run a round on the next poll ===
+void ntp_sync_request(void) {
+    if (ntp_state == NTP_STATE_IDLE) {
+        ntp_deadline_ms = millis();
+    }
+}
+
+// === Advance the client, never waits ===
+/**
+ * @brief Starts a due round, collects replies and handles timeouts.
+ * @note Call from one task only. While ntp_sync_busy() the caller
+ * should poll every NTP_POLL_MS, so lookups are picked up at once and
+ * the receive time stays accurate.
+ */
+void ntp_sync_poll(void) {
+    if (ntp_state == NTP_STATE_STOPPED || ntp_server_count == 0) {
+        return;
+    }
+
+    uint32_t now_ms = millis();
+    bool due = (int32_t)(now_ms - ntp_deadline_ms) >= 0;
+
+    if (ntp_state == NTP_STATE_RESOLVE) {
+        uint32_t addr = 0;
+        if (ntp_dns_result(&addr)) {
+            if (addr != 0 && ntp_send_request(IPAddress(addr))) {
+                ntp_state = NTP_STATE_WAIT;
+                ntp_deadline_ms = now_ms + NTP_REPLY_TIMEOUT_MS;
+            } else {
+                debug_printf("[NTP] Cannot resolve %s\n", ntp_servers[ntp_server_idx]);
+                ntp_next_server(now_ms);
+            }
+
+        } else if (due) {
+            ntp_dns_reset();
+            debug_printf("[NTP] No DNS answer for %s\n", ntp_servers[ntp_server_idx]);
+            ntp_next_server(now_ms);
+        }
+
+    } else if (ntp_state == NTP_STATE_WAIT) {
+        if (ntp_read_reply()) {
+            ntp_next_server(now_ms);
+
+        } else if (due) {
+            debug_printf("[NTP] No reply from %s\n", ntp_servers[ntp_server_idx]);
+            ntp_next_server(now_ms);
+        }
+
+    } else if (due) {
+        memset(&ntp_round, 0, sizeof(ntp_round));
+        ntp_server_idx = 0;
+        ntp_start_server(now_ms);
+    }
+}
+
+bool ntp_sync_busy(void) {
+    return ntp_state == NTP_STATE_RESOLVE || ntp_state == NTP_STATE_WAIT;
+}
+
+// === Smoothed offset of recent rounds ===
+int64_t ntp_sync_offset_us(void) {
+    return ntp_offset_avg_us;
+}
+
+uint32_t ntp_sync_count_get(void) {
+    return ntp_sync_count;
+}
+
+// === Current sync interval, adapted to the drift estimate ===
+uint32_t ntp_sync_interval_get(void) {
+    return ntp_interval_cur;
+}
@@ -34,14 +34,20 @@ void ota_init() {
                 type = "filesystem";
             
             Serial.println("[OTA] Start updating " + type);
+            journal_log(JOURNAL_OTA, JOURNAL_OTA_START, 0, type.c_str());
         })
 
         .onEnd([]() {
             Serial.println("\n[OTA] Update successful!");
+
+            // ArduinoOTA restarts right after this, write the record now
+            journal_log(JOURNAL_OTA, JOURNAL_OTA_DONE, 0, NULL);
+            journal_flush();
         })
         
         .onProgress([](unsigned int progress, unsigned int total) {
             Serial.printf("[OTA] Progress: %u%%\r", (progress / (total / 100)));
+            supervisor_beat(supervisor_wifi_id); // The upload runs inside ArduinoOTA.handle()
         })
 
         .onError([](ota_error_t error) {
@@ -52,6 +58,7 @@ void ota_init() {
             else if (error == OTA_RECEIVE_ERROR) Serial.println("[OTA] Receive Failed");
             else if (error == OTA_END_ERROR) Serial.println("[OTA] End Failed");
             else Serial.println("[OTA] Unknown Error");
+            journal_log(JOURNAL_OTA, JOURNAL_OTA_FAILED, (int32_t)error, NULL);
         });
     
     ArduinoOTA.begin();
@@ -0,0 +1,145 @@
+#include "global.h"
+#include "supervisor.h"
+#include <esp_task_wdt.h>
+
+// === Supervisor State ===
+// Slots are claimed with an atomic add and published by their name, so
+// tasks on both cores may register at once. Only the owning task beats
+// its slot.
+static const uint32_t jitter_bounds[] = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000 };
+
+static supervisor_task_t supervisor_slots[SUPERVISOR_TASKS_MAX];
+static uint32_t supervisor_claimed = 0;
+static bool supervisor_trip = false; // A deadline was missed, no more feeds
+
+int supervisor_hmi_id = -1;
+int supervisor_wifi_id = -1;
+int supervisor_sync_id = -1;
+int supervisor_log_id = -1;
+
+static_assert(sizeof(jitter_bounds) / sizeof(jitter_bounds[0]) <= METRICS_BUCKETS_MAX,
+              "jitter_bounds exceeds METRICS_BUCKETS_MAX");
+
+// === Register a task ===
+/**
+ * @brief Declares the calling task's loop period and deadline, the
+ * deadline counts from now.
+ * @return Id for supervisor_beat(), -1 when all slots are taken.
+ * @note Call once at the top of the task, before its loop.
+ */
+int supervisor_register(const char *name, uint32_t period_ms, uint32_t deadline_ms) {
+    uint32_t id = __atomic_fetch_add(&supervisor_claimed, 1, __ATOMIC_RELAXED);
+    if (id >= SUPERVISOR_TASKS_MAX) {
+        debug_errorf("[SUPERVISOR] No slot left for %s\n", name);
+        return -1;
+    }
+
+    supervisor_task_t *t = &supervisor_slots[id];
+    t->period_ms = period_ms;
+    t->deadline_ms = deadline_ms;
+    t->last_ms = millis();
+    t->jitter_ms.bounds = jitter_bounds;
+    t->jitter_ms.num_bounds = sizeof(jitter_bounds) / sizeof(jitter_bounds[0]);
+    __atomic_store_n(&t->name, name, __ATOMIC_RELEASE);
+
+    debug_printf("[SUPERVISOR] %s: period %lu ms, deadline %lu ms\n", name,
+                 (unsigned long)period_ms, (unsigned long)deadline_ms);
+    return (int)id;
+}
+
+// === Heartbeat ===
+/**
+ * @brief Marks one loop of the task, records how far the gap since the
+ * last beat ran past its period.
+ * @note Lock-free, call it where the loop starts.
+ */
+void supervisor_beat(int id) {
+    if (id < 0 || id >= SUPERVISOR_TASKS_MAX) {
+        return;
+    }
+    supervisor_task_t *t = &supervisor_slots[id];
+    uint32_t now = millis();
+    uint32_t gap = now - t->last_ms;
+    __atomic_store_n(&t->last_ms, now, __ATOMIC_RELEASE);
+
+    metric_observe(&t->jitter_ms, gap > t->period_ms ? gap - t->period_ms : 0);
+    if (gap > t->max_ms) {
+        __atomic_store_n(&t->max_ms, gap, __ATOMIC_RELAXED);
+    }
+}
+
+// === Deadline check ===
+/**
+ * @brief Checks every registered task against its deadline at `now_ms`.
+ * @return true when all are within it and the watchdog may be fed.
+ * @note The first miss is logged to the console and the journal, both
+ * flushed from here since TaskLog may be the one starved. From then on
+ * it returns false until the watchdog resets the chip.
+ */
+bool supervisor_check(uint32_t now_ms) {
+    if (supervisor_trip) {
+        return false;
+    }
+
+    uint32_t count = __atomic_load_n(&supervisor_claimed, __ATOMIC_RELAXED);
+    if (count > SUPERVISOR_TASKS_MAX) {
+        count = SUPERVISOR_TASKS_MAX;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        supervisor_task_t *t = &supervisor_slots[i];
+        const char *name = __atomic_load_n(&t->name, __ATOMIC_ACQUIRE);
+        if (name == NULL) {
+            continue; // Still registering
+        }
+        int32_t gap = (int32_t)(now_ms - __atomic_load_n(&t->last_ms, __ATOMIC_ACQUIRE));
+        if (gap <= (int32_t)t->deadline_ms) {
+            continue;
+        }
+
+        supervisor_trip = true;
+        metric_inc(&t->missed);
+        debug_errorf("[SUPERVISOR] %s missed its deadline: no beat for %ld ms, deadline %lu ms\n",
+                     name, (long)gap, (unsigned long)t->deadline_ms);
+        journal_log(JOURNAL_WATCHDOG, 0, gap, name);
+    }
+
+    if (supervisor_trip) {
+        debug_errorf("[SUPERVISOR] Watchdog reset in %d s\n", SUPERVISOR_WDT_S);
+        journal_flush();
+        debug_flush();
+        return false;
+    }
+    return true;
+}
+
+bool supervisor_tripped(void) {
+    return supervisor_trip;
+}
+
+// === Registered tasks ===
+// For /metrics, slots still registering have a NULL name
+const supervisor_task_t *supervisor_tasks(size_t *count) {
+    uint32_t claimed = __atomic_load_n(&supervisor_claimed, __ATOMIC_ACQUIRE);
+    *count = claimed < SUPERVISOR_TASKS_MAX ? claimed : SUPERVISOR_TASKS_MAX;
+    return supervisor_slots;
+}
+
+// === Task watchdog ===
+/**
+ * @brief Arms the task watchdog with a reset on timeout and subscribes
+ * the calling task, TaskSupervisor.
+ */
+void supervisor_begin(void) {
+    esp_task_wdt_init(SUPERVISOR_WDT_S, true); // Reconfigures the core's TWDT
+    if (esp_task_wdt_add(NULL) != ESP_OK) {
+        debug_errorf("[SUPERVISOR] Failed to subscribe to the task watchdog\n");
+    }
+}
+
+// Feeds the watchdog while every task is on time
+void supervisor_poll(void) {
+    if (supervisor_check(millis())) {
+        esp_task_wdt_reset();
+    }
+}
@@ -0,0 +1,142 @@
+#include "global.h"
+#include "trace.h"
+
+// === Trace State ===
+// Stamps are CPU cycle counts, a register read. Both ends of the path
+// run in TaskHMI, hmi_on_event() from hmi.listen() and the dequeue, so
+// the slots have a single writer and need no lock. Histograms are read
+// from other tasks with the metrics atomics.
+typedef struct {
+  uint16_t id;
+  uint8_t seen;     // Bit per stage stamped
+  uint32_t cycles[TRACE_NUM_STAGES];
+} trace_slot_t;
+
+static trace_slot_t trace_slots[TRACE_SLOTS];
+static uint16_t trace_last_id = TRACE_NONE;
+static uint32_t trace_max[TRACE_NUM_STAGES];
+static uint32_t trace_printed = 0; // Samples in all stages at the last print
+
+static const uint32_t trace_bounds[] = {
+    100, 500, 1000, 5000, 10000, 20000, 50000, 100000, 200000, 500000
+};
+
+metric_histogram_t trace_stage_us[TRACE_NUM_STAGES] = {
+    METRIC_HISTOGRAM(trace_bounds), METRIC_HISTOGRAM(trace_bounds),
+    METRIC_HISTOGRAM(trace_bounds), METRIC_HISTOGRAM(trace_bounds),
+    METRIC_HISTOGRAM(trace_bounds), METRIC_HISTOGRAM(trace_bounds)
+};
+
+static const char *trace_names[TRACE_NUM_STAGES] = {
+    "total", "sync", "apply", "wait", "send", "relay"
+};
+
+// === Record one stage ===
+static void trace_record(trace_stage_t stage, uint32_t cycles) {
+    uint32_t us = cycles / ESP.getCpuFreqMHz();
+    metric_observe(&trace_stage_us[stage], us);
+    if (us > trace_max[stage]) {
+        trace_max[stage] = us;
+    }
+}
+
+// === Start a touch trace ===
+/**
+ * @brief Stamps TRACE_RX for a new touch.
+ * @return Trace ID to pass along the path, TRACE_NONE when compiled out.
+ */
+uint16_t trace_begin(void) {
+#if TRACE_ENABLED
+    if (++trace_last_id == TRACE_NONE) {
+        trace_last_id++;
+    }
+    trace_slot_t *slot = &trace_slots[trace_last_id % TRACE_SLOTS];
+    slot->id = trace_last_id;
+    slot->seen = 1 << TRACE_RX;
+    slot->cycles[TRACE_RX] = ESP.getCycleCount();
+    return trace_last_id;
+#else
+    return TRACE_NONE;
+#endif
+}
+
+// === Stamp a stage ===
+/**
+ * @brief Records the time since the previous stage of trace `id`, and
+ * the whole path on TRACE_RELAY.
+ * @note No-op for TRACE_NONE, a stage out of order or stamped twice,
+ * or a slot already reused by a newer touch. The cycle counter wraps after ~17 s at 240
+ * MHz, far longer than a touch takes.
+ */
+void trace_mark(uint16_t id, trace_stage_t stage) {
+#if TRACE_ENABLED
+    trace_slot_t *slot = &trace_slots[id % TRACE_SLOTS];
+    if (id == TRACE_NONE || stage == TRACE_RX || slot->id != id ||
+        !(slot->seen & (1 << (stage - 1))) || (slot->seen & (1 << stage))
+    ) {
+        return;
+    }
+    uint32_t now = ESP.getCycleCount();
+    slot->cycles[stage] = now;
+    slot->seen |= 1 << stage;
+    trace_record(stage, now - slot->cycles[stage - 1]);
+
+    if (stage == TRACE_RELAY) {
+        trace_record(TRACE_RX, now - slot->cycles[TRACE_RX]);
+        slot->id = TRACE_NONE;
+    }
+#endif
+}
+
+const char *trace_stage_name(trace_stage_t stage) {
+    return stage < TRACE_NUM_STAGES ? trace_names[stage] : "?";
+}
+
+uint32_t trace_stage_max_us(trace_stage_t stage) {
+    return stage < TRACE_NUM_STAGES ? trace_max[stage] : 0;
+}
+
+// === Upper bound of the bucket holding a quantile ===
+// `above` past the last bound, the stage maximum is the best bound there
+static uint32_t trace_quantile(const metric_histogram_t *h, uint32_t count,
+                               uint8_t percent, uint32_t above) {
+    uint32_t want = (count * percent + 99) / 100;
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < h->num_bounds; i++) {
+        total += __atomic_load_n(&h->buckets[i], __ATOMIC_RELAXED);
+        if (total >= want) {
+            return h->bounds[i];
+        }
+    }
+    return above;
+}
+
+// === Serial summary ===
+/**
+ * @brief Prints count, p50, p90 and max per stage, when touches were
+ * traced since the last call. Percentiles are bucket upper bounds.
+ * @note The same histograms are on GET /metrics as touch_*_us.
+ */
+void trace_print(void) {
+    uint32_t counts[TRACE_NUM_STAGES];
+    uint32_t traced = 0;
+    for (uint8_t s = 0; s < TRACE_NUM_STAGES; s++) {
+        counts[s] = metric_count(&trace_stage_us[s]);
+        traced += counts[s];
+    }
+    if (traced == trace_printed) {
+        return;
+    }
+    trace_printed = traced;
+
+    for (uint8_t s = 0; s < TRACE_NUM_STAGES; s++) {
+        if (counts[s] == 0) {
+            continue;
+        }
+        debug_printf("[TRACE] %-5s n=%lu p50<=%luus p90<=%luus max=%luus\n",
+                     trace_names[s], (unsigned long)counts[s],
+                     (unsigned long)trace_quantile(&trace_stage_us[s], counts[s], 50, trace_max[s]),
+                     (unsigned long)trace_quantile(&trace_stage_us[s], counts[s], 90, trace_max[s]),
+                     (unsigned long)trace_max[s]);
+    }
+}
@@ -1,5 +1,6 @@
 #include "global.h"
 #include "vp_dwin.h"
+#include <esp_timer.h>
 
 // === DWIN HMI Initialization ===
 DWIN hmi(DGUS_SERIAL, 16, 17, DGUS_BAUD); // Serial2 16 as Rx and 17 as Tx
@@ -8,6 +9,123 @@ DWIN hmi(DGUS_SERIAL, 16, 17, DGUS_BAUD); // Serial2 16 as Rx and 17 as Tx
 vp_values_t vp;
 Preferences prefs;
 
+// === Change tracking ===
+// Each write that changes a VP stamps it with a rising sequence number.
+// Network consumers keep the last number they sent as a cursor and read
+// the current value of whatever changed since, so a slow consumer gets
+// the latest value once instead of a backlog.
+static portMUX_TYPE vp_seq_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t vp_seq_last = 0;
+static uint32_t vp_seq[num_vp_items];
+
+static void vp_mark_index(size_t index) {
+    portENTER_CRITICAL(&vp_seq_mux);
+    vp_seq[index] = ++vp_seq_last;
+    portEXIT_CRITICAL(&vp_seq_mux);
+}
+
+void vp_mark_changed(uint16_t address) {
+    for (size_t i = 0; i < num_vp_items; i++) {
+        if (vp_items[i].address == address) {
+            vp_mark_index(i);
+            return;
+        }
+    }
+}
+
+// Latest sequence number handed out
+uint32_t vp_change_seq(void) {
+    portENTER_CRITICAL(&vp_seq_mux);
+    uint32_t seq = vp_seq_last;
+    portEXIT_CRITICAL(&vp_seq_mux);
+    return seq;
+}
+
+// Sequence number of the last change to vp_items[index], 0 if none
+uint32_t vp_item_seq(size_t index) {
+    portENTER_CRITICAL(&vp_seq_mux);
+    uint32_t seq = vp_seq[index];
+    portEXIT_CRITICAL(&vp_seq_mux);
+    return seq;
+}
+
+// === Shared VP access ===
+// The holder's site and take time, only touched with xVPMutex held
+static vp_lock_site_t* vp_lock_owner = NULL;
+static int64_t vp_lock_taken_us = 0;
+static vp_lock_site_t* vp_lock_list = NULL;
+static uint32_t vp_lock_over = 0;
+
+/**
+ * @brief Takes xVPMutex for the vp_lock() call site `site`, recording
+ * the wait there and in metric_vp_mutex_wait.
+ * @return true once held, pair with vp_unlock().
+ */
+bool vp_lock_at(vp_lock_site_t* site) {
+    int64_t start = esp_timer_get_time();
+    if (xSemaphoreTake(xVPMutex, portMAX_DELAY) != pdTRUE) {
+        return false;
+    }
+    int64_t now = esp_timer_get_time();
+    uint32_t waited = (uint32_t)(now - start);
+    metric_observe(&metric_vp_mutex_wait, waited);
+
+    if (!site->linked) {
+        site->linked = true;
+        site->next = vp_lock_list;
+        __atomic_store_n(&vp_lock_list, site, __ATOMIC_RELEASE);
+    }
+    site->holds++;
+    site->wait_us += waited;
+    if (waited > site->wait_max_us) {
+        site->wait_max_us = waited;
+    }
+    vp_lock_owner = site;
+    vp_lock_taken_us = now;
+    return true;
+}
+
+/**
+ * @brief Releases xVPMutex, charging the hold to the site that took it.
+ * @note A hold over VP_LOCK_BUDGET_US is counted at the site and logged
+ * when it is the site's longest yet, after the mutex is given back.
+ */
+void vp_unlock(void) {
+    vp_lock_site_t* site = vp_lock_owner;
+    uint32_t held = (uint32_t)(esp_timer_get_time() - vp_lock_taken_us);
+    bool worst = false;
+
+    if (site != NULL) {
+        site->hold_us += held;
+        if (held > VP_LOCK_BUDGET_US) {
+            site->over_budget++;
+            vp_lock_over++;
+            worst = held > site->hold_max_us;
+        }
+        if (held > site->hold_max_us) {
+            site->hold_max_us = held;
+        }
+    }
+    vp_lock_owner = NULL;
+    xSemaphoreGive(xVPMutex);
+
+    if (worst) {
+        debug_warnf("[LOCK] %s() %s:%u held xVPMutex %lu us, budget %u us\n",
+                    site->func, site->file, site->line,
+                    (unsigned long)held, VP_LOCK_BUDGET_US);
+    }
+}
+
+// Call sites that took the mutex at least once, newest first
+vp_lock_site_t* vp_lock_sites(void) {
+    return __atomic_load_n(&vp_lock_list, __ATOMIC_ACQUIRE);
+}
+
+// Holds over VP_LOCK_BUDGET_US at any site
+uint32_t vp_lock_overruns(void) {
+    return __atomic_load_n(&vp_lock_over, __ATOMIC_RELAXED);
+}
+
 // === Load from NVS ===
 void vp_load_values() {
     prefs.begin(NVS_NAMESPACE, true);  // Read-only
@@ -44,15 +162,61 @@ void vp_save_values() {
 
     if (item.type == VP_UINT8) {
       prefs.putUChar(key, *((uint8_t*)item.storage_ptr));
+      metric_inc(&metric_nvs_writes);
       
     } else if (item.type == VP_STRING) {
       prefs.putString(key, (const char*)item.storage_ptr);
+      metric_inc(&metric_nvs_writes);
     }
   }
 
   prefs.end();
 }
 
+// === Load a value kept outside the VP table ===
+uint32_t vp_load_u32(const char* key, uint32_t fallback) {
+    prefs.begin(NVS_NAMESPACE, true);
+    uint32_t val = prefs.getULong(key, fallback);
+    prefs.end();
+    return val;
+}
+
+// === Save a value kept outside the VP table ===
+void vp_save_u32(const char* key, uint32_t value) {
+    prefs.begin(NVS_NAMESPACE, false);
+    if (prefs.getULong(key, ~value) != value) {
+        prefs.putULong(key, value);
+        metric_inc(&metric_nvs_writes);
+    }
+    prefs.end();
+}
+
+// === Load a record kept outside the VP table ===
+// False unless exactly `len` bytes are stored, e.g. after a layout change
+bool vp_load_blob(const char* key, void* buf, size_t len) {
+    prefs.begin(NVS_NAMESPACE, true);
+    bool ok = prefs.getBytesLength(key) == len &&
+              prefs.getBytes(key, buf, len) == len;
+    prefs.end();
+    return ok;
+}
+
+// === Save a record kept outside the VP table ===
+void vp_save_blob(const char* key, const void* buf, size_t len) {
+    uint8_t stored[64];
+
+    prefs.begin(NVS_NAMESPACE, false);
+    bool same = len <= sizeof(stored) &&
+                prefs.getBytesLength(key) == len &&
+                prefs.getBytes(key, stored, len) == len &&
+                memcmp(stored, buf, len) == 0;
+    if (!same) {
+        prefs.putBytes(key, buf, len);
+        metric_inc(&metric_nvs_writes);
+    }
+    prefs.end();
+}
+
 // === Get uint8_t value by address ===
 uint8_t vp_get_value(uint16_t address) {
     for (size_t i = 0; i < num_vp_items; i++) {
@@ -68,7 +232,10 @@ uint8_t vp_get_value(uint16_t address) {
 bool vp_set_value(uint16_t address, uint8_t value) {
     for (size_t i = 0; i < num_vp_items; i++) {
         if (vp_items[i].address == address && vp_items[i].type == VP_UINT8) {
-            *((uint8_t*)vp_items[i].storage_ptr) = value;
+            if (*((uint8_t*)vp_items[i].storage_ptr) != value) {
+                *((uint8_t*)vp_items[i].storage_ptr) = value;
+                vp_mark_index(i);
+            }
             return true;
         }
     }
@@ -91,8 +258,14 @@ const char* vp_get_string(uint16_t address) {
 bool vp_set_string(uint16_t address, const char* value) {
     for (size_t i = 0; i < num_vp_items; i++) {
         if (vp_items[i].address == address && vp_items[i].type == VP_STRING) {
-            strncpy((char*)vp_items[i].storage_ptr, value, vp_items[i].storage_size);
-            ((char*)vp_items[i].storage_ptr)[vp_items[i].storage_size - 1] = '\0';  // Ensure null-termination
+            char* stored = (char*)vp_items[i].storage_ptr;
+            size_t size = vp_items[i].storage_size;
+            bool same = strncmp(stored, value, size - 1) == 0;
+            strncpy(stored, value, size);
+            stored[size - 1] = '\0';  // Ensure null-termination
+            if (!same) {
+                vp_mark_index(i);
+            }
             return true;
         }
     }
@@ -108,9 +281,40 @@ void vp_save_item(const vp_item_t& item) {
 
     if (item.type == VP_UINT8) {
         prefs.putUChar(key, *((uint8_t*)item.storage_ptr));
+        metric_inc(&metric_nvs_writes);
     
     } else if (item.type == VP_STRING) {
         prefs.putString(key, (const char*)item.storage_ptr);
+        metric_inc(&metric_nvs_writes);
+    }
+
+    prefs.end();
+}
+
+// === Save several items in one NVS session ===
+// For batched edits, the items are already set in RAM
+void vp_save_items(const uint16_t* addresses, size_t count) {
+    prefs.begin(NVS_NAMESPACE, false);
+
+    for (size_t n = 0; n < count; n++) {
+        for (size_t i = 0; i < num_vp_items; i++) {
+            const vp_item_t& item = vp_items[i];
+            if (item.address != addresses[n]) {
+                continue;
+            }
+            char key[8];
+            snprintf(key, sizeof(key), "%04X", item.address);
+
+            if (item.type == VP_UINT8) {
+                prefs.putUChar(key, *((uint8_t*)item.storage_ptr));
+                metric_inc(&metric_nvs_writes);
+
+            } else if (item.type == VP_STRING) {
+                prefs.putString(key, (const char*)item.storage_ptr);
+                metric_inc(&metric_nvs_writes);
+            }
+            break;
+        }
     }
 
     prefs.end();
@@ -168,23 +372,105 @@ bool vp_sync_item(uint16_t address, const void* new_value) {
 
     if (changed) {
         vp_save_item(*item);
+        vp_mark_index(item - vp_items);
     }
 
     return changed;
 }
 
+// === JSON member for one VP ===
+/**
+ * @brief Writes `"XXXX":value` for `item`, read from `values` at the
+ * item's offset in `vp`, so a snapshot copy can be formatted.
+ * @param out At least VP_JSON_ITEM_MAX bytes, not terminated.
+ * @return Bytes written.
+ */
+size_t vp_json_item(const vp_item_t* item, const vp_values_t* values, char* out) {
+    static const char hex[] = "0123456789ABCDEF";
+    const uint8_t* ptr = (const uint8_t*)values +
+        ((const uint8_t*)item->storage_ptr - (const uint8_t*)&vp);
+    size_t n = 0;
+
+    out[n++] = '"';
+    for (int shift = 12; shift >= 0; shift -= 4) {
+        out[n++] = hex[(item->address >> shift) & 0x0F];
+    }
+    out[n++] = '"';
+    out[n++] = ':';
+
+    if (item->type == VP_UINT8) {
+        uint8_t value = *ptr;
+        if (value >= 100) out[n++] = '0' + value / 100;
+        if (value >= 10) out[n++] = '0' + value / 10 % 10;
+        out[n++] = '0' + value % 10;
+        return n;
+    }
+
+    // Quoted, escaped, at most storage_size - 1 characters
+    const char* str = (const char*)ptr;
+    out[n++] = '"';
+    for (size_t i = 0; i + 1 < item->storage_size && str[i]; i++) {
+        char c = str[i];
+        if (c == '"' || c == '\\') {
+            out[n++] = '\\';
+            out[n++] = c;
+        } else if ((uint8_t)c < 0x20) {
+            memcpy(&out[n], "\\u00", 4);
+            n += 4;
+            out[n++] = hex[(uint8_t)c >> 4];
+            out[n++] = hex[c & 0x0F];
+        } else {
+            out[n++] = c;
+        }
+    }
+    out[n++] = '"';
+    return n;
+}
+
+// === Padded panel text ===
+/**
+ * @brief Pads `str` with spaces to `maxlen`, so a shorter value
+ * overwrites all of the previous one on the panel.
+ * @note A NULL `str` sends `maxlen` spaces.
+ */
+String hmi_pad_string(const char* str, size_t maxlen) {
+    String padded_str;
+    if (str && maxlen > 0) {
+        size_t real_len = strnlen(str, maxlen);
+        padded_str.reserve(maxlen);
+        padded_str = String(str).substring(0, real_len);
+        while (padded_str.length() < maxlen) {
+            padded_str += ' ';
+        }
+
+    } else if (maxlen > 0) {
+        // Send blank string with full padding
+        padded_str = String(maxlen, ' ');
+    
+    } else {
+        padded_str = ""; // No padding if maxlen is 0
+    }
+    return padded_str;
+}
+
 // === Queue HMI update for a value ===
 void hmi_update_value(uint16_t address) {
+    hmi_update_traced(address, TRACE_NONE);
+}
+
+// === Queue HMI update for a value, carrying a touch trace ===
+void hmi_update_traced(uint16_t address, uint16_t trace_id) {
     hmi_update_item_t msg = {
         .type = HMI_UPDATE_VALUE,
-        .address = address
+        .address = address,
+        .trace_id = trace_id
     };
 
     // Queue the update
     BaseType_t xStatus = xQueueSend(xHMIUpdateQueue, &msg, portMAX_DELAY);
 
     if (xStatus != pdPASS) {
-        debug_printf(
+        debug_errorf(
             "[ERROR] Failed to queue HMI value update for address 0x%04X\n",
             address
         );
@@ -202,24 +488,80 @@ void hmi_update_string(uint16_t address) {
     BaseType_t xStatus = xQueueSend(xHMIUpdateQueue, &msg, portMAX_DELAY);
 
     if (xStatus != pdPASS) {
-        debug_printf(
+        debug_errorf(
             "[ERROR] Failed to queue HMI string update for address 0x%04X\n",
             address
         );
     }
 }
 
+// === Queue HMI update for any VP, by its type ===
+void hmi_update_item(uint16_t address) {
+    for (size_t i = 0; i < num_vp_items; i++) {
+        if (vp_items[i].address == address) {
+            if (vp_items[i].type == VP_STRING) {
+                hmi_update_string(address);
+            } else {
+                hmi_update_value(address); // Also drives relay pins
+            }
+            return;
+        }
+    }
+}
+
 // === Queue full HMI refresh ===
+// At most one waits. It reads every VP when sent, so it covers any
+// refresh asked for before TaskHMI takes it. With the queue full it is
+// left to TaskHMI's next loop instead of blocking the caller.
+#define HMI_ALL_NONE 0
+#define HMI_ALL_QUEUED 1
+#define HMI_ALL_DEFERRED 2
+static uint8_t hmi_all_pending = HMI_ALL_NONE;
+
 void hmi_update_all() {
+    uint8_t none = HMI_ALL_NONE;
+    if (!__atomic_compare_exchange_n(&hmi_all_pending, &none, HMI_ALL_QUEUED, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
     hmi_update_item_t msg = {
         .type = HMI_UPDATE_ALL,
         .address = 0
     };
 
     // Queue the update
+    BaseType_t xStatus = xQueueSend(xHMIUpdateQueue, &msg, 0);
+
+    if (xStatus != pdPASS) {
+        __atomic_store_n(&hmi_all_pending, HMI_ALL_DEFERRED, __ATOMIC_RELEASE);
+        debug_verbosef("[HMI] Queue full, full refresh deferred\n");
+    }
+}
+
+// TaskHMI took the refresh off the queue, later changes need another
+void hmi_update_all_taken() {
+    __atomic_store_n(&hmi_all_pending, HMI_ALL_NONE, __ATOMIC_RELEASE);
+}
+
+// True once per refresh that found the queue full, TaskHMI sends it
+bool hmi_update_all_deferred() {
+    uint8_t deferred = HMI_ALL_DEFERRED;
+    return __atomic_compare_exchange_n(&hmi_all_pending, &deferred, HMI_ALL_NONE, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+// === Queue panel RTC write-back ===
+void hmi_update_rtc() {
+    hmi_update_item_t msg = {
+        .type = HMI_UPDATE_RTC,
+        .address = VP_RTC_SET
+    };
+
+    // Time is read when TaskHMI sends, not when queued
     BaseType_t xStatus = xQueueSend(xHMIUpdateQueue, &msg, portMAX_DELAY);
 
     if (xStatus != pdPASS) {
-        debug_println("[ERROR] Failed to queue full HMI refresh");
+        debug_errorf("[ERROR] Failed to queue panel RTC update\n");
     }
 }
@@ -0,0 +1,829 @@
+#include "global.h"
+#include "vp_http.h"
+#include <lwip/sockets.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// === HTTP API State ===
+// One client at a time, polled from TaskWiFi. The request is read into a
+// static buffer and the reply is streamed through a small chunk buffer
+// straight from the vp_items[] descriptors, no String is built.
+static WiFiServer http_server(VP_HTTP_PORT);
+static WiFiClient http_client;
+static bool http_started = false;
+static bool http_open = false;        // Client accepted, not closed yet
+static bool http_replying = false;    // Request answered, reply being sent
+static char http_req[VP_HTTP_REQ_MAX + 1];
+static size_t http_req_len = 0;
+static uint32_t http_start_ms = 0;    // Accept time, then last bytes sent
+static const char *http_why = "";     // Error text for the reply
+static vp_http_stats_t http_stats;
+
+// Copy of the VPs for GET, so the mutex is not held while sending
+static vp_values_t http_snap;
+
+// Reply buffer, sent like a WebSocket frame in vp_ws.cpp: what the
+// socket takes now, the rest on later polls. A long body is produced by
+// `http_fill` from a cursor, a piece at a time once the last has left.
+typedef bool (*http_fill_t)(void); // False once the body is complete
+
+static char http_tx[VP_HTTP_TX_CHUNK];
+static size_t http_tx_len = 0;
+static size_t http_tx_off = 0;        // Bytes of http_tx already sent
+static http_fill_t http_fill = NULL;
+static uint32_t http_cursor = 0;      // VP index, metrics line or journal seq
+static uint32_t http_left = 0;        // Journal records left in the page
+static bool http_first = true;        // No VP written yet, no comma
+
+// PUT values, applied only once the whole body is valid
+typedef struct {
+  const vp_item_t *item;
+  uint8_t value;
+  char text[sizeof(vp.wifi_ssid)]; // Longest VP string
+} vp_http_change_t;
+static vp_http_change_t http_changes[num_vp_items];
+
+// === Streamed output ===
+static size_t http_room(void) {
+    return sizeof(http_tx) - http_tx_len;
+}
+
+// Fill functions check http_room() first, a full buffer only truncates
+static inline void http_putc(char c) {
+    if (http_tx_len < sizeof(http_tx)) {
+        http_tx[http_tx_len++] = c;
+    }
+}
+
+static void http_puts(const char *s) {
+    while (*s) {
+        http_putc(*s++);
+    }
+}
+
+static void http_put_u8(uint8_t value) {
+    if (value >= 100) http_putc('0' + value / 100);
+    if (value >= 10) http_putc('0' + value / 10 % 10);
+    http_putc('0' + value % 10);
+}
+
+static void http_head(int status, const char *reason, const char *type) {
+    http_puts("HTTP/1.1 ");
+    http_put_u8((uint8_t)(status / 100));
+    http_put_u8((uint8_t)(status / 10 % 10));
+    http_put_u8((uint8_t)(status % 10));
+    http_putc(' ');
+    http_puts(reason);
+    http_puts("\r\nContent-Type: ");
+    http_puts(type);
+    http_puts("\r\nConnection: close\r\n\r\n");
+}
+
+static int http_error(int status) {
+    const char *reason = status == 404 ? "Not Found" :
+                         status == 403 ? "Forbidden" :
+                         status == 405 ? "Method Not Allowed" :
+                         status == 413 ? "Payload Too Large" : "Bad Request";
+    http_head(status, reason, "application/json");
+    http_puts("{\"error\":\"");
+    http_puts(http_why); // Fixed texts, nothing to escape
+    http_puts("\"}\n");
+    http_stats.errors++;
+    return status;
+}
+
+// "XXXX":value, formatted in place, needs VP_JSON_ITEM_MAX of room
+static void http_put_item(const vp_item_t *item, const vp_values_t *values) {
+    http_tx_len += vp_json_item(item, values, &http_tx[http_tx_len]);
+}
+
+/**
+ * @brief Sends what the socket takes without waiting, refilling the
+ * buffer from `http_fill` while it is drained.
+ * @return True once the reply is out or the peer is gone, false to
+ * resume on the next poll.
+ */
+static bool http_send(void) {
+    for (;;) {
+        // Pieces go in while nothing of the buffer has left yet
+        if (http_fill != NULL && http_tx_off == 0 && !http_fill()) {
+            http_fill = NULL;
+        }
+        while (http_tx_off < http_tx_len) {
+            ssize_t n = send(http_client.fd(), http_tx + http_tx_off, http_tx_len - http_tx_off,
+                             MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (n > 0) {
+                http_tx_off += n;
+                http_stats.bytes_out += n;
+                http_start_ms = millis();
+            } else {
+                return !(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+            }
+        }
+        http_tx_len = 0;
+        http_tx_off = 0;
+        if (http_fill == NULL) {
+            return true;
+        }
+    }
+}
+
+// === VP access rules ===
+static const vp_item_t *vp_http_find(uint16_t address) {
+    for (size_t i = 0; i < num_vp_items; i++) {
+        if (vp_items[i].address == address) {
+            return &vp_items[i];
+        }
+    }
+    return NULL;
+}
+
+// The WiFi password can be set but is never sent back
+static bool vp_http_readable(uint16_t address) {
+    return address != VP_WIFI_PSWD;
+}
+
+/**
+ * @brief Checks a write against the operator settings the panel edits,
+ * the rest is derived or shown by the firmware.
+ * @param text New value of a string VP, NULL for the others.
+ * @return 0 when allowed, else the HTTP status with http_why set.
+ * @note Limits match the clamps in vp_apply_change(), credentials the
+ * provisioning portal's rules.
+ */
+static int vp_http_check(uint16_t address, uint8_t value, const char *text) {
+    uint8_t max;
+
+    switch (address) {
+        case VP_PLANT_ID:
+            return 0;
+
+        case VP_WIFI_SSID:
+            if (!wifi_portal_ssid_valid(text)) {
+                http_why = "SSID needs 1 to 31 characters";
+                return 400;
+            }
+            return 0;
+
+        case VP_WIFI_PSWD:
+            if (!wifi_portal_pswd_valid(text)) {
+                http_why = "password needs 8 to 31 characters, or none";
+                return 400;
+            }
+            return 0;
+
+        case VP_TOTAL_CYCLE:
+        case VP_GROWTH_DAY:
+            max = GROWTH_MAX_DAY;
+            if (value < 1) {
+                http_why = "out of range";
+                return 400;
+            }
+            break;
+
+        case VP_WATER_DURATION_SEC:
+            max = WATER_DURATION_MAX;
+            if (value < 1) {
+                http_why = "out of range";
+                return 400;
+            }
+            break;
+
+        case VP_WATER_INTERVAL_HR:
+            max = 12;
+            if (value < 1) {
+                http_why = "out of range";
+                return 400;
+            }
+            break;
+
+        case VP_LIGHT_STATE:
+        case VP_LIGHT_AUTO:
+        case VP_WATER_STATE:
+        case VP_WATER_AUTO:
+        case VP_FAN_STATE:
+        case VP_FAN_AUTO:
+        case VP_WIFI_STATE:
+        case VP_WIFI_AP_STATE:
+            max = 1;
+            break;
+
+        case VP_LIGHT_ON_HR:
+        case VP_LIGHT_OFF_HR:
+        case VP_WATER_ON_HR:
+        case VP_WATER_OFF_HR:
+        case VP_FAN_ON_HR:
+        case VP_FAN_OFF_HR:
+            max = 23;
+            break;
+
+        case VP_LIGHT_ON_MIN:
+        case VP_LIGHT_OFF_MIN:
+        case VP_WATER_ON_MIN:
+        case VP_WATER_OFF_MIN:
+        case VP_FAN_ON_MIN:
+        case VP_FAN_OFF_MIN:
+            max = 59;
+            break;
+
+        default:
+            http_why = "read-only VP";
+            return 403;
+    }
+
+    if (value > max) {
+        http_why = "out of range";
+        return 400;
+    }
+    return 0;
+}
+
+// === JSON input ===
+// Just the subset the PUT bodies use: one value, or a flat object of
+// hex address keys. Each helper returns the position after what it
+// read, or NULL with http_why set.
+static const char *json_skip(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) {
+        p++;
+    }
+    return p;
+}
+
+// Into `out`, NULL when it does not fit in `cap` with the terminator
+static const char *json_string(const char *p, const char *end, char *out, size_t cap) {
+    size_t n = 0;
+
+    if (p >= end || *p != '"') {
+        http_why = "expected a string";
+        return NULL;
+    }
+    for (p++; p < end && *p != '"'; p++) {
+        char c = *p;
+        if (c == '\\') {
+            if (++p >= end) {
+                break;
+            }
+            c = *p;
+            if (c == 'u' && end - p > 4) {
+                char hex[5] = { p[1], p[2], p[3], p[4], '\0' };
+                char *tail;
+                unsigned long code = strtoul(hex, &tail, 16);
+                if (*tail || code >= 0x80) {
+                    http_why = "only ASCII escapes";
+                    return NULL;
+                }
+                c = (char)code;
+                p += 4;
+            } else if (c != '"' && c != '\\' && c != '/') {
+                http_why = "bad escape";
+                return NULL;
+            }
+        }
+        if ((uint8_t)c < 0x20) {
+            http_why = "control character";
+            return NULL;
+        }
+        if (n + 1 >= cap) {
+            http_why = "string too long";
+            return NULL;
+        }
+        out[n++] = c;
+    }
+
+    if (p >= end) {
+        http_why = "unterminated string";
+        return NULL;
+    }
+    out[n] = '\0';
+    return p + 1;
+}
+
+static const char *json_u8(const char *p, const char *end, uint8_t *value) {
+    uint16_t v = 0;
+    const char *start = p;
+
+    while (p < end && *p >= '0' && *p <= '9' && p - start < 4) {
+        v = v * 10 + (*p++ - '0');
+    }
+    if (p == start || v > 255 || (p < end && *p >= '0' && *p <= '9')) {
+        http_why = "expected 0 to 255";
+        return NULL;
+    }
+    *value = (uint8_t)v;
+    return p;
+}
+
+static const char *json_key(const char *p, const char *end, uint16_t *address) {
+    char key[8];
+    char *tail;
+
+    p = json_string(p, end, key, sizeof(key));
+    if (p == NULL) {
+        return NULL;
+    }
+    unsigned long addr = strtoul(key, &tail, 16);
+    if (key[0] == '\0' || *tail || addr > 0xFFFF) {
+        http_why = "bad VP address";
+        return NULL;
+    }
+    *address = (uint16_t)addr;
+    return p;
+}
+
+// === Stage one write ===
+// A repeated address replaces its earlier value in the batch
+static int vp_http_stage(uint16_t address, const char **p, const char *end, size_t *count) {
+    const vp_item_t *item = vp_http_find(address);
+    if (item == NULL) {
+        http_why = "unknown VP";
+        return 404;
+    }
+
+    vp_http_change_t *change = NULL;
+    for (size_t i = 0; i < *count; i++) {
+        if (http_changes[i].item == item) {
+            change = &http_changes[i];
+            break;
+        }
+    }
+    if (change == NULL) {
+        change = &http_changes[(*count)++];
+    }
+    change->item = item;
+    change->value = 0;
+
+    if (item->type == VP_UINT8) {
+        *p = json_u8(*p, end, &change->value);
+    } else {
+        *p = json_string(*p, end, change->text, item->storage_size);
+    }
+    if (*p == NULL) {
+        return 400;
+    }
+    return vp_http_check(address, change->value,
+                         item->type == VP_UINT8 ? NULL : change->text);
+}
+
+// === Apply a staged batch ===
+/**
+ * @brief Sets every staged VP under one mutex hold, so readers see all
+ * or none of them, saves them in one NVS session and runs the same side
+ * effects as a panel edit.
+ * @return Number of VPs that changed.
+ * @note The HMI batch, derived VPs included, is queued after the mutex
+ * is released, TaskHMI takes it to drain the queue.
+ */
+static size_t vp_http_apply(size_t count) {
+    uint16_t changed[num_vp_items + VP_DERIVED_MAX];
+    size_t n = 0;
+    size_t queued = 0; // Changed ones, then the VPs derived from them
+
+    if (vp_lock()) {
+        for (size_t i = 0; i < count; i++) {
+            const vp_item_t *item = http_changes[i].item;
+
+            if (item->type == VP_UINT8) {
+                uint8_t *stored = (uint8_t *)item->storage_ptr;
+                if (*stored != http_changes[i].value) {
+                    *stored = http_changes[i].value;
+                    vp_mark_changed(item->address);
+                    changed[n++] = item->address;
+                }
+            } else {
+                char *stored = (char *)item->storage_ptr;
+                if (strcmp(stored, http_changes[i].text) != 0) {
+                    strcpy(stored, http_changes[i].text);
+                    vp_mark_changed(item->address);
+                    changed[n++] = item->address;
+                }
+            }
+        }
+
+        queued = n;
+        if (n > 0) {
+            vp_save_items(changed, n);
+            for (size_t i = 0; i < n; i++) {
+                uint16_t derived[VP_DERIVED_MAX];
+                size_t extra = vp_apply_change(changed[i], derived);
+                for (size_t d = 0; d < extra && queued < num_vp_items + VP_DERIVED_MAX; d++) {
+                    changed[queued++] = derived[d];
+                }
+            }
+        }
+        vp_unlock();
+    }
+
+    // Large batches as one full refresh, the queue holds 15
+    if (n >= VP_HTTP_HMI_ALL_MIN) {
+        hmi_update_all();
+    } else {
+        for (size_t i = 0; i < queued; i++) {
+            hmi_update_item(changed[i]);
+        }
+    }
+    return n;
+}
+
+// === Handlers ===
+// Rest of GET /vp from the snapshot, as many VPs as fit
+static bool http_fill_vps(void) {
+    for (; http_cursor < num_vp_items; http_cursor++) {
+        const vp_item_t *item = &vp_items[http_cursor];
+        if (!vp_http_readable(item->address)) {
+            continue;
+        }
+        if (http_room() < VP_JSON_ITEM_MAX + 1) {
+            return true;
+        }
+        if (!http_first) {
+            http_putc(',');
+        }
+        http_put_item(item, &http_snap);
+        http_first = false;
+    }
+    if (http_room() < 2) {
+        return true;
+    }
+    http_puts("}\n");
+    return false;
+}
+
+static int vp_http_get(const vp_item_t *one) {
+    if (vp_lock()) {
+        memcpy(&http_snap, &vp, sizeof(vp));
+        vp_unlock();
+    }
+
+    http_head(200, "OK", "application/json");
+    http_putc('{');
+    if (one != NULL) {
+        http_put_item(one, &http_snap);
+        http_puts("}\n");
+    } else {
+        http_cursor = 0;
+        http_first = true;
+        http_fill = http_fill_vps;
+    }
+    return 200;
+}
+
+// === Parse and apply a write ===
+// Single value for `one`, else an object of address keys. Returns 0
+// with `changed` set, or the HTTP status with http_why set.
+static int vp_http_write(const vp_item_t *one, const char *body, const char *end,
+                         size_t *changed) {
+    const char *p = json_skip(body, end);
+    size_t count = 0;
+    int status = 0;
+
+    if (one != NULL) {
+        status = vp_http_stage(one->address, &p, end, &count);
+
+    } else if (p >= end || *p != '{') {
+        http_why = "expected an object";
+        status = 400;
+
+    } else {
+        p = json_skip(p + 1, end);
+        bool more = true;
+        if (p < end && *p == '}') {
+            p++;
+            more = false;
+        }
+        while (more) {
+            uint16_t address;
+            p = json_key(p, end, &address);
+            if (p == NULL) {
+                status = 400;
+                break;
+            }
+            p = json_skip(p, end);
+            if (p >= end || *p != ':') {
+                http_why = "expected ':'";
+                status = 400;
+                break;
+            }
+            p = json_skip(p + 1, end);
+            status = vp_http_stage(address, &p, end, &count);
+            if (status != 0) {
+                break;
+            }
+            p = json_skip(p, end);
+            if (p < end && *p == ',') {
+                p = json_skip(p + 1, end);
+            } else if (p < end && *p == '}') {
+                p++;
+                more = false;
+            } else {
+                http_why = "expected ',' or '}'";
+                status = 400;
+            }
+            more = more && status == 0;
+        }
+    }
+
+    if (status == 0 && json_skip(p, end) != end) {
+        http_why = "trailing data";
+        status = 400;
+    }
+    if (status != 0) {
+        return status;
+    }
+
+    *changed = vp_http_apply(count);
+    if (*changed > 0) {
+        http_stats.commits++;
+        debug_printf("[HTTP] %u VP(s) changed\n", (unsigned)*changed);
+    }
+    return 0;
+}
+
+static int vp_http_put(const vp_item_t *one, const char *body, const char *end) {
+    size_t changed = 0;
+    int status = vp_http_write(one, body, end, &changed);
+    if (status != 0) {
+        return http_error(status);
+    }
+
+    http_head(200, "OK", "application/json");
+    http_puts("{\"changed\":");
+    http_put_u8((uint8_t)changed);
+    http_puts("}\n");
+    return 200;
+}
+
+// === GET /metrics ===
+static void vp_http_text_sink(const char *text, size_t len, void *ctx) {
+    while (len--) {
+        http_putc(*text++);
+    }
+}
+
+// Prometheus text exposition, the lines that fit in the chunk buffer
+static bool http_fill_metrics(void) {
+    uint32_t max = http_room() / METRICS_LINE_MAX;
+    if (max == 0) {
+        return true;
+    }
+    uint32_t n = metrics_write_lines(vp_http_text_sink, NULL, http_cursor, max);
+    http_cursor += n;
+    return n == max;
+}
+
+static int vp_http_metrics(void) {
+    http_head(200, "OK", "text/plain; version=0.0.4");
+    http_cursor = 0;
+    http_fill = http_fill_metrics;
+    return 200;
+}
+
+// === GET /journal ===
+// Event journal as text, VP_HTTP_JOURNAL_PAGE records after `?since=<seq>`.
+// A page that stops short of the newest record ends with the next URL.
+static bool http_fill_journal(void) {
+    uint32_t max = http_room() / JOURNAL_LINE_MAX;
+    if (max > http_left) {
+        max = http_left;
+    }
+    if (max > 0) {
+        uint32_t n = journal_write_records(vp_http_text_sink, NULL, &http_cursor, max);
+        http_left = n < max ? 0 : http_left - n;
+    }
+    if (http_left > 0 || http_room() < 40) {
+        return true;
+    }
+    if (http_cursor < journal_last_seq()) {
+        char more[40];
+        snprintf(more, sizeof(more), "# more /journal?since=%lu\n",
+                 (unsigned long)http_cursor);
+        http_puts(more);
+    }
+    return false;
+}
+
+static int vp_http_journal(const char *query) {
+    uint32_t since = 0;
+    if (*query == '?' && strncmp(query + 1, "since=", 6) == 0) {
+        since = (uint32_t)strtoul(query + 7, NULL, 10);
+    }
+    http_head(200, "OK", "text/plain");
+    http_puts(JOURNAL_HEADER);
+    http_cursor = since;
+    http_left = VP_HTTP_JOURNAL_PAGE;
+    http_fill = http_fill_journal;
+    return 200;
+}
+
+// Value of a header, NULL when absent
+static const char *vp_http_header(const char *name, const char *head_end) {
+    size_t len = strlen(name);
+    const char *line = strstr(http_req, "\r\n");
+
+    while (line != NULL && line < head_end) {
+        line += 2;
+        if (strncasecmp(line, name, len) == 0 && line[len] == ':') {
+            return json_skip(line + len + 1, head_end);
+        }
+        line = strstr(line, "\r\n");
+    }
+    return NULL;
+}
+
+/**
+ * @brief Routes a complete request in http_req and streams the reply.
+ * @return HTTP status, 0 while the request is still arriving.
+ */
+static int vp_http_request(void) {
+    const char *head_end = strstr(http_req, "\r\n\r\n");
+    if (head_end == NULL) {
+        return 0;
+    }
+
+    // Body must be in the buffer too
+    const char *body = head_end + 4;
+    const char *length = vp_http_header("Content-Length", head_end);
+    size_t body_len = length ? strtoul(length, NULL, 10) : 0;
+    if (body_len > VP_HTTP_REQ_MAX - (size_t)(body - http_req)) {
+        http_why = "request too large";
+        return http_error(413);
+    }
+    if ((size_t)(http_req + http_req_len - body) < body_len) {
+        return 0;
+    }
+
+    // Request line: METHOD /vp[/addr][?query] HTTP/1.x
+    bool get = strncmp(http_req, "GET ", 4) == 0;
+    bool put = strncmp(http_req, "PUT ", 4) == 0;
+    const char *path = strchr(http_req, ' ');
+    if (path == NULL || (!get && !put)) {
+        http_why = "GET or PUT only";
+        return http_error(405);
+    }
+    path++;
+    size_t path_len = strcspn(path, " ?\r");
+
+    if (path_len == 8 && strncmp(path, "/metrics", 8) == 0) {
+        if (!get) {
+            http_why = "GET only";
+            return http_error(405);
+        }
+        return vp_http_metrics();
+    }
+
+    if (path_len == 8 && strncmp(path, "/journal", 8) == 0) {
+        if (!get) {
+            http_why = "GET only";
+            return http_error(405);
+        }
+        return vp_http_journal(path + path_len);
+    }
+
+    const vp_item_t *one = NULL;
+    if (path_len == 3 && strncmp(path, "/vp", 3) == 0) {
+        // Whole table
+
+    } else if (path_len > 4 && path_len <= 8 && strncmp(path, "/vp/", 4) == 0) {
+        char addr[5] = { 0 };
+        char *tail;
+        memcpy(addr, path + 4, path_len - 4);
+        one = vp_http_find((uint16_t)strtoul(addr, &tail, 16));
+        if (one == NULL || *tail) {
+            http_why = "unknown VP";
+            return http_error(404);
+        }
+        if (get && !vp_http_readable(one->address)) {
+            http_why = "write-only VP";
+            return http_error(403);
+        }
+
+    } else {
+        http_why = "no such path";
+        return http_error(404);
+    }
+
+    return get ? vp_http_get(one) : vp_http_put(one, body, body + body_len);
+}
+
+// === Serve one connection step ===
+static void vp_http_close(void) {
+    http_client.stop();
+    http_open = false;
+    http_replying = false;
+    http_fill = NULL;
+    http_tx_len = 0;
+    http_tx_off = 0;
+}
+
+// True when a request was answered and another may be queued
+static bool vp_http_step(void) {
+    if (http_replying) {
+        // A reader that stalls for VP_HTTP_TIMEOUT_MS is dropped
+        if (!http_send() && millis() - http_start_ms <= VP_HTTP_TIMEOUT_MS) {
+            return false;
+        }
+        vp_http_close();
+        return true;
+    }
+
+    if (!http_open) {
+        http_client = http_server.available();
+        if (!http_client) {
+            return false;
+        }
+        http_open = true;
+        http_req_len = 0;
+        http_start_ms = millis();
+    }
+
+    int avail = http_client.available();
+    if (avail > 0 && http_req_len < VP_HTTP_REQ_MAX) {
+        int n = http_client.read((uint8_t *)http_req + http_req_len,
+                                 VP_HTTP_REQ_MAX - http_req_len);
+        if (n > 0) {
+            http_req_len += n;
+        }
+    }
+    http_req[http_req_len] = '\0';
+
+    int status = vp_http_request();
+    if (status == 0) {
+        if (http_req_len >= VP_HTTP_REQ_MAX) {
+            http_why = "request too large";
+            status = http_error(413);
+        } else if (millis() - http_start_ms > VP_HTTP_TIMEOUT_MS ||
+                   !http_client.connected()) {
+            status = -1; // Dropped, nothing to answer
+        } else {
+            return false;
+        }
+    }
+
+    if (status > 0) {
+        http_stats.requests++;
+        http_replying = true;
+        http_start_ms = millis();
+        if (!http_send()) {
+            return false; // Rest of the reply on the next polls
+        }
+    }
+    vp_http_close();
+    return true;
+}
+
+// === Public API ===
+/**
+ * @brief Starts listening on VP_HTTP_PORT.
+ * @note Called from wifi_on_link_change() on every link up, only the
+ * first call opens the socket.
+ */
+void vp_http_begin(void) {
+    if (http_started) {
+        return;
+    }
+    http_server.begin();
+    http_started = true;
+    debug_printf("[HTTP] VP API on port %u\n", VP_HTTP_PORT);
+}
+
+/**
+ * @brief Accepts and answers queued requests, never waits for a slow
+ * client.
+ * @note Call from TaskWiFi while WIFI_CONNECTED_BIT is set.
+ */
+void vp_http_poll(void) {
+    if (!http_started) {
+        return;
+    }
+    for (int i = 0; i < VP_HTTP_PER_POLL && vp_http_step(); i++) {
+    }
+}
+
+/**
+ * @brief Applies a JSON object of VP writes with the API's rules: the
+ * whole object is checked, then saved and sent to the HMI as one batch.
+ * @return 0 on success, else the status PUT /vp would reply, see
+ * vp_http_error().
+ * @note For other transports, e.g. the MQTT command topic. Call from
+ * TaskWiFi, it shares the staging buffer with the server.
+ */
+int vp_http_apply_json(const char *json, size_t len, size_t *changed) {
+    *changed = 0;
+    return vp_http_write(NULL, json, json + len, changed);
+}
+
+// Reason for the last rejected write
+const char *vp_http_error(void) {
+    return http_why;
+}
+
+// A request is partly read or its reply partly sent, TaskWiFi should
+// come back soon
+bool vp_http_busy(void) {
+    return http_open;
+}
+
+void vp_http_stats(vp_http_stats_t *stats) {
+    *stats = http_stats;
+}
@@ -0,0 +1,530 @@
+#include "global.h"
+#include "vp_ws.h"
+#include <lwip/sockets.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// === WebSocket Stream State ===
+// Polled from TaskWiFi. Each client holds a cursor into the VP change
+// sequence (see vp_change_seq()) and one outgoing frame. A frame is only
+// built once the previous one has left, from the values current at that
+// moment, so a slow reader costs the same fixed buffer as a fast one and
+// sees intermediate values collapse into the latest.
+typedef enum {
+  WS_FREE,
+  WS_HANDSHAKE,
+  WS_OPEN
+} vp_ws_state_t;
+
+typedef struct {
+  WiFiClient sock;
+  uint8_t state;
+  uint32_t since_ms;           // Accept time, for the handshake timeout
+  bool upgrade;                // Upgrade: websocket seen
+  bool path_ok;
+  char key[32];                // Sec-WebSocket-Key
+  char line[VP_WS_LINE_MAX];
+  size_t line_len;
+  uint8_t rx[VP_WS_RX_MAX];
+  size_t rx_len;
+  uint8_t tx[VP_WS_TX_MAX];
+  size_t tx_len;
+  size_t tx_off;               // Bytes of tx already sent
+  uint32_t cursor;             // Changes up to here are sent
+  uint32_t pass_upto;          // Changes the current pass covers
+  size_t pass_index;           // Next vp_items[] entry of the pass
+  uint32_t pass_items;
+  bool pass_active;
+  bool full;                   // Next pass sends every VP
+} vp_ws_client_t;
+
+static WiFiServer ws_server(VP_WS_PORT);
+static bool ws_started = false;
+static vp_ws_client_t ws_clients[VP_WS_MAX_CLIENTS];
+static vp_ws_stats_t ws_stats;
+
+// Values frames are built from, shared by all clients of one poll
+static vp_values_t ws_snap;
+static uint32_t ws_snap_seq = 0;
+static bool ws_snap_valid = false;
+
+#define WS_OP_TEXT  0x1
+#define WS_OP_CLOSE 0x8
+#define WS_OP_PING  0x9
+#define WS_OP_PONG  0xA
+
+// === SHA-1, for the handshake only ===
+static inline uint32_t ws_rol(uint32_t value, int bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+static void ws_sha1_block(uint32_t h[5], const uint8_t *p) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 |
+               (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+    }
+    for (int i = 16; i < 80; i++) {
+        w[i] = ws_rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+        uint32_t f, k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+        uint32_t t = ws_rol(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = ws_rol(b, 30);
+        b = a;
+        a = t;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+}
+
+static void ws_sha1(const uint8_t *data, size_t len, uint8_t out[20]) {
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    uint8_t block[64];
+    size_t done = 0;
+
+    for (; len - done >= 64; done += 64) {
+        ws_sha1_block(h, data + done);
+    }
+
+    // Padding, then the length in bits, one or two blocks
+    size_t rest = len - done;
+    memset(block, 0, sizeof(block));
+    memcpy(block, data + done, rest);
+    block[rest] = 0x80;
+    if (rest >= 56) {
+        ws_sha1_block(h, block);
+        memset(block, 0, sizeof(block));
+    }
+    uint64_t bits = (uint64_t)len * 8;
+    for (int i = 0; i < 8; i++) {
+        block[63 - i] = (uint8_t)(bits >> (8 * i));
+    }
+    ws_sha1_block(h, block);
+
+    for (int i = 0; i < 20; i++) {
+        out[i] = (uint8_t)(h[i / 4] >> (24 - 8 * (i % 4)));
+    }
+}
+
+// Sec-WebSocket-Accept for `key`, 28 characters
+static void ws_accept_key(const char *key, char out[29]) {
+    static const char guid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    static const char b64[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    uint8_t text[sizeof(((vp_ws_client_t *)0)->key) + sizeof(guid)];
+    uint8_t digest[21];
+    size_t key_len = strlen(key);
+
+    memcpy(text, key, key_len);
+    memcpy(text + key_len, guid, sizeof(guid) - 1);
+    ws_sha1(text, key_len + sizeof(guid) - 1, digest);
+    digest[20] = 0;
+
+    size_t n = 0;
+    for (int i = 0; i < 21; i += 3) {
+        uint32_t v = (uint32_t)digest[i] << 16 | (uint32_t)digest[i + 1] << 8 |
+                     (i + 2 < 21 ? digest[i + 2] : 0);
+        out[n++] = b64[(v >> 18) & 0x3F];
+        out[n++] = b64[(v >> 12) & 0x3F];
+        out[n++] = b64[(v >> 6) & 0x3F];
+        out[n++] = b64[v & 0x3F];
+    }
+    out[27] = '='; // 20 bytes leave one byte of padding
+    out[28] = '\0';
+}
+
+// === Client slots ===
+static void ws_drop(vp_ws_client_t *c, bool error) {
+    c->sock.stop();
+    if (c->state == WS_OPEN) {
+        ws_stats.open--;
+    }
+    c->state = WS_FREE;
+    if (error) {
+        ws_stats.dropped++;
+    }
+}
+
+// Queues raw bytes, only when nothing else is in flight
+static void ws_queue(vp_ws_client_t *c, const void *data, size_t len) {
+    memcpy(c->tx, data, len);
+    c->tx_len = len;
+    c->tx_off = 0;
+}
+
+static void ws_queue_str(vp_ws_client_t *c, const char *text) {
+    ws_queue(c, text, strlen(text));
+}
+
+// Queues a frame around the payload at tx + 4
+static void ws_queue_frame(vp_ws_client_t *c, uint8_t opcode, size_t len) {
+    if (len < 126) {
+        c->tx[2] = 0x80 | opcode; // FIN
+        c->tx[3] = (uint8_t)len;
+        c->tx_off = 2;
+    } else {
+        c->tx[0] = 0x80 | opcode;
+        c->tx[1] = 126;
+        c->tx[2] = (uint8_t)(len >> 8);
+        c->tx[3] = (uint8_t)len;
+        c->tx_off = 0;
+    }
+    c->tx_len = 4 + len;
+}
+
+static bool ws_tx_idle(const vp_ws_client_t *c) {
+    return c->tx_off == c->tx_len;
+}
+
+/**
+ * @brief Sends what the socket takes without waiting.
+ * @return False when the peer is gone.
+ */
+static bool ws_flush(vp_ws_client_t *c) {
+    while (!ws_tx_idle(c)) {
+        ssize_t n = send(c->sock.fd(), c->tx + c->tx_off, c->tx_len - c->tx_off,
+                         MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n > 0) {
+            c->tx_off += n;
+            ws_stats.bytes_out += n;
+        } else {
+            return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+    }
+    return true;
+}
+
+// === Handshake ===
+static bool ws_has_word(const char *text, const char *word) {
+    size_t len = strlen(word);
+    for (; *text; text++) {
+        if (strncasecmp(text, word, len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void ws_header_line(vp_ws_client_t *c) {
+    const char *line = c->line;
+
+    if (strncmp(line, "GET ", 4) == 0) {
+        size_t len = strlen(VP_WS_PATH);
+        c->path_ok = strncmp(line + 4, VP_WS_PATH, len) == 0 &&
+                     (line[4 + len] == ' ' || line[4 + len] == '?');
+    } else if (strncasecmp(line, "Upgrade:", 8) == 0) {
+        c->upgrade = ws_has_word(line + 8, "websocket");
+    } else if (strncasecmp(line, "Sec-WebSocket-Key:", 18) == 0) {
+        const char *value = line + 18;
+        while (*value == ' ') {
+            value++;
+        }
+        strncpy(c->key, value, sizeof(c->key) - 1);
+        c->key[sizeof(c->key) - 1] = '\0';
+        c->key[strcspn(c->key, " ")] = '\0';
+    }
+}
+
+static void ws_handshake_done(vp_ws_client_t *c) {
+    if (!c->path_ok || !c->upgrade || strlen(c->key) != 24) {
+        ws_queue_str(c, "HTTP/1.1 400 Bad Request\r\nConnection: close\r\n\r\n");
+        ws_flush(c);
+        ws_drop(c, false);
+        ws_stats.rejected++;
+        return;
+    }
+
+    char accept[29];
+    ws_accept_key(c->key, accept);
+    int len = snprintf((char *)c->tx, sizeof(c->tx),
+                       "HTTP/1.1 101 Switching Protocols\r\n"
+                       "Upgrade: websocket\r\nConnection: Upgrade\r\n"
+                       "Sec-WebSocket-Accept: %s\r\n\r\n", accept);
+    c->tx_len = len;
+    c->tx_off = 0;
+    c->state = WS_OPEN;
+    c->rx_len = 0;
+    c->full = true;
+    c->pass_active = false;
+    ws_stats.open++;
+    ws_stats.accepted++;
+    debug_verbosef("[WS] Client %u open\n", (unsigned)(c - ws_clients));
+}
+
+// Reads header lines, keeps the three that matter
+static void ws_read_handshake(vp_ws_client_t *c, uint32_t now_ms) {
+    uint8_t buf[64];
+    int n;
+
+    while (c->state == WS_HANDSHAKE && (n = c->sock.read(buf, sizeof(buf))) > 0) {
+        for (int i = 0; i < n && c->state == WS_HANDSHAKE; i++) {
+            char ch = (char)buf[i];
+            if (ch == '\r') {
+                continue;
+            }
+            if (ch != '\n') {
+                if (c->line_len < sizeof(c->line) - 1) {
+                    c->line[c->line_len++] = ch;
+                }
+                continue;
+            }
+            c->line[c->line_len] = '\0';
+            if (c->line_len == 0) {
+                ws_handshake_done(c); // Blank line ends the request
+            } else {
+                ws_header_line(c);
+            }
+            c->line_len = 0;
+        }
+        // Bytes after the request belong to frames, clients wait for 101
+    }
+
+    if (c->state == WS_HANDSHAKE && now_ms - c->since_ms > VP_WS_TIMEOUT_MS) {
+        ws_drop(c, true);
+    }
+}
+
+// === Client frames ===
+/**
+ * @brief Answers pings and closes, skips data frames.
+ * @note A ping waits while a frame is in flight, control frames can not
+ * go inside one.
+ */
+static void ws_read_frames(vp_ws_client_t *c) {
+    int n = c->sock.read(c->rx + c->rx_len, sizeof(c->rx) - c->rx_len);
+    if (n > 0) {
+        c->rx_len += n;
+    }
+
+    while (c->rx_len >= 2) {
+        uint8_t opcode = c->rx[0] & 0x0F;
+        size_t len = c->rx[1] & 0x7F;
+
+        // Clients must mask, we never need more than a control frame
+        if (!(c->rx[1] & 0x80) || len > 125) {
+            ws_drop(c, true);
+            return;
+        }
+        if (c->rx_len < 6 + len) {
+            return;
+        }
+        if ((opcode == WS_OP_PING || opcode == WS_OP_CLOSE) && !ws_tx_idle(c)) {
+            return;
+        }
+
+        uint8_t *payload = c->rx + 6;
+        for (size_t i = 0; i < len; i++) {
+            payload[i] ^= c->rx[2 + i % 4];
+        }
+
+        if (opcode == WS_OP_PING) {
+            memmove(c->tx + 4, payload, len);
+            ws_queue_frame(c, WS_OP_PONG, len);
+        } else if (opcode == WS_OP_CLOSE) {
+            memmove(c->tx + 4, payload, len < 2 ? len : 2); // Echo the code
+            ws_queue_frame(c, WS_OP_CLOSE, len < 2 ? len : 2);
+            ws_flush(c);
+            ws_drop(c, false);
+            return;
+        }
+
+        c->rx_len -= 6 + len;
+        memmove(c->rx, c->rx + 6 + len, c->rx_len);
+    }
+}
+
+// === Delta frames ===
+static void ws_take_snapshot(void) {
+    if (vp_lock()) {
+        memcpy(&ws_snap, &vp, sizeof(vp));
+        ws_snap_seq = vp_change_seq();
+        vp_unlock();
+    }
+    ws_snap_valid = true;
+}
+
+/**
+ * @brief Builds the client's next frame once the last one has left.
+ * @note A pass covers the changes up to the snapshot it started with and
+ * may span several frames. A VP changed again meanwhile is left for the
+ * next pass, which sends its latest value.
+ */
+static void ws_build_frame(vp_ws_client_t *c) {
+    if (!c->pass_active) {
+        if (!c->full && vp_change_seq() == c->cursor) {
+            return; // Nothing new
+        }
+        if (!ws_snap_valid) {
+            ws_take_snapshot();
+        }
+        c->pass_upto = ws_snap_seq;
+        c->pass_index = 0;
+        c->pass_items = 0;
+        c->pass_active = true;
+    } else if (!ws_snap_valid) {
+        ws_take_snapshot();
+    }
+
+    char *out = (char *)c->tx + 4;
+    size_t cap = sizeof(c->tx) - 4;
+    size_t len = 0;
+
+    for (; c->pass_index < num_vp_items; c->pass_index++) {
+        const vp_item_t *item = &vp_items[c->pass_index];
+        uint32_t seq = vp_item_seq(c->pass_index);
+        if (item->address == VP_WIFI_PSWD ||
+            (!c->full && (seq <= c->cursor || seq > c->pass_upto))) {
+            continue;
+        }
+        if (len + VP_JSON_ITEM_MAX + 2 > cap) {
+            break; // Next frame
+        }
+        out[len] = len == 0 ? '{' : ',';
+        len++;
+        len += vp_json_item(item, &ws_snap, &out[len]);
+        c->pass_items++;
+    }
+
+    if (c->pass_index == num_vp_items) {
+        if (!c->full && c->pass_upto - c->cursor > c->pass_items) {
+            ws_stats.coalesced += c->pass_upto - c->cursor - c->pass_items;
+        }
+        c->cursor = c->pass_upto;
+        c->pass_active = false;
+        c->full = false;
+    }
+    if (len > 0) {
+        out[len++] = '}';
+        ws_queue_frame(c, WS_OP_TEXT, len);
+        ws_stats.frames++;
+    }
+}
+
+// === Accept ===
+static void ws_accept(uint32_t now_ms) {
+    while (ws_server.hasClient()) {
+        WiFiClient sock = ws_server.available();
+        if (!sock) {
+            return;
+        }
+
+        vp_ws_client_t *c = NULL;
+        for (size_t i = 0; i < VP_WS_MAX_CLIENTS && c == NULL; i++) {
+            if (ws_clients[i].state == WS_FREE) {
+                c = &ws_clients[i];
+            }
+        }
+        if (c == NULL) {
+            static const char busy[] = "HTTP/1.1 503 Service Unavailable\r\nConnection: close\r\n\r\n";
+            sock.write((const uint8_t *)busy, sizeof(busy) - 1);
+            sock.stop();
+            ws_stats.rejected++;
+            continue;
+        }
+
+        c->sock = sock;
+        c->state = WS_HANDSHAKE;
+        c->since_ms = now_ms;
+        c->upgrade = false;
+        c->path_ok = false;
+        c->key[0] = '\0';
+        c->line_len = 0;
+        c->tx_len = c->tx_off = 0;
+    }
+}
+
+// === Start ===
+/**
+ * @brief Opens the stream socket.
+ * @note Called from wifi_on_link_change() on every link up, only the
+ * first call opens it.
+ */
+void vp_ws_begin(void) {
+    if (ws_started) {
+        return;
+    }
+    ws_server.begin();
+    ws_started = true;
+    debug_printf("[WS] VP stream on port %u\n", VP_WS_PORT);
+}
+
+// === Poll ===
+/**
+ * @brief Accepts clients, answers their control frames and sends each
+ * open client its next frame, never waits on a socket.
+ * @note Call from TaskWiFi while WIFI_CONNECTED_BIT is set.
+ */
+void vp_ws_poll(uint32_t now_ms) {
+    if (!ws_started) {
+        return;
+    }
+    ws_accept(now_ms);
+    ws_snap_valid = false;
+
+    for (size_t i = 0; i < VP_WS_MAX_CLIENTS; i++) {
+        vp_ws_client_t *c = &ws_clients[i];
+        if (c->state == WS_FREE) {
+            continue;
+        }
+        if (!c->sock.connected()) {
+            ws_drop(c, false);
+            continue;
+        }
+        if (c->state == WS_HANDSHAKE) {
+            ws_read_handshake(c, now_ms);
+            if (c->state != WS_OPEN) {
+                continue;
+            }
+        } else {
+            ws_read_frames(c);
+            if (c->state != WS_OPEN) {
+                continue;
+            }
+        }
+
+        // Previous frame first, new ones only while the socket takes them
+        bool ok = ws_flush(c);
+        while (ok && ws_tx_idle(c)) {
+            ws_build_frame(c);
+            ok = ws_flush(c);
+            if (!c->pass_active) {
+                break;
+            }
+        }
+        if (!ok) {
+            ws_drop(c, true);
+        }
+    }
+}
+
+// A client is streaming, TaskWiFi should poll often enough to push
+bool vp_ws_busy(void) {
+    return ws_stats.open > 0;
+}
+
+void vp_ws_stats(vp_ws_stats_t *stats) {
+    *stats = ws_stats;
+}
@@ -0,0 +1,470 @@
+#include "global.h"
+#include "wifi_link.h"
+#include <esp_netif.h>
+#include <lwip/dhcp.h>
+
+// === WiFi Link State ===
+// Connection state machine run by TaskWiFi. The WiFi event handler only
+// flips WIFI_CONNECTED_BIT and queues the event, every decision and
+// timer lives in wifi_link_poll(), which never waits longer than asked.
+typedef enum {
+    WIFI_EVT_GOT_IP,
+    WIFI_EVT_DOWN
+} wifi_link_evt_type_t;
+
+typedef struct {
+    uint8_t type;
+    uint8_t reason; // Disconnect reason, 0 for other events
+} wifi_link_evt_t;
+
+static QueueHandle_t wifi_event_queue = NULL;
+static wifi_link_cb wifi_on_change = NULL;
+static wifi_link_state_t link_state = WIFI_LINK_OFF;
+static bool link_hold = false;
+static uint32_t link_deadline_ms = 0; // Attempt timeout or end of backoff
+static uint8_t link_failures = 0;     // Consecutive failed attempts
+static uint32_t link_attempts = 0;    // Since boot
+
+// === Fast reconnect cache ===
+// Last good AP and IP configuration, see wifi_link_cache_t.
+// A reconnect first associates straight to the cached BSSID on its
+// channel, reusing the lease while it is fresh, and falls back to a
+// full scan plus DHCP once per outage if that fails.
+static wifi_link_cache_t link_cache;
+static bool link_cache_loaded = false;
+static bool link_fast = false;        // Current attempt uses the cache
+static bool link_fast_missed = false; // Fast path failed this outage
+static bool link_static = false;      // IP reused, no DHCP ran
+static uint32_t link_outage_ms = 0;   // Start of the current outage
+static uint32_t link_fast_misses = 0;
+static uint32_t link_dhcp_skipped = 0;
+
+// Reconnect times, ring buffers per path
+static uint32_t timing_fast[WIFI_TIMING_SAMPLES];
+static uint32_t timing_scan[WIFI_TIMING_SAMPLES];
+static uint16_t timing_fast_count = 0;
+static uint16_t timing_scan_count = 0;
+
+// === WiFi event handler ===
+// Runs in the WiFi event task: no blocking and no VP access
+static void wifi_link_on_event(WiFiEvent_t event, WiFiEventInfo_t info) {
+    wifi_link_evt_t evt = { 0, 0 };
+
+    switch (event) {
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+            evt.type = WIFI_EVT_GOT_IP;
+            xEventGroupSetBits(eventGroup, WIFI_CONNECTED_BIT);
+            break;
+
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+            evt.reason = info.wifi_sta_disconnected.reason;
+            evt.type = WIFI_EVT_DOWN;
+            xEventGroupClearBits(eventGroup, WIFI_CONNECTED_BIT);
+            break;
+
+        case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+            evt.type = WIFI_EVT_DOWN;
+            xEventGroupClearBits(eventGroup, WIFI_CONNECTED_BIT);
+            break;
+
+        default:
+            return;
+    }
+
+    // Dropped if full, the attempt timeout still recovers
+    xQueueSend(wifi_event_queue, &evt, 0);
+}
+
+// === State change ===
+static void wifi_link_set(wifi_link_state_t state) {
+    if (state == link_state) {
+        return;
+    }
+
+    wifi_link_state_t prev = link_state;
+    link_state = state;
+    debug_printf("[WiFi] Link %s -> %s\n",
+                wifi_link_state_name(prev), wifi_link_state_name(state));
+
+    if (wifi_on_change) {
+        wifi_on_change(state, prev);
+    }
+}
+
+static bool wifi_link_enabled(void) {
+    return !link_hold && vp.wifi_state && vp.wifi_ssid[0] != '\0';
+}
+
+// === Cache helpers ===
+// FNV-1a, never 0 so an empty record cannot match
+static uint32_t wifi_link_ssid_hash(const char *ssid) {
+    uint32_t hash = 2166136261u;
+    while (*ssid) {
+        hash = (hash ^ (uint8_t)*ssid++) * 16777619u;
+    }
+    return hash ? hash : 1;
+}
+
+static uint32_t wifi_link_epoch(void) {
+    return time_is_valid() ? (uint32_t)(time_epoch_us() / 1000000) : 0;
+}
+
+// Lease time in the server's ACK (option 51), 0 unless the client is bound.
+// Two words lwIP's tcpip thread only writes while it handles that ACK.
+static uint32_t wifi_link_granted_lease_s(void) {
+    esp_netif_t *sta = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    struct netif *netif = sta ? (struct netif *)esp_netif_get_netif_impl(sta) : NULL;
+    struct dhcp *dhcp = netif ? netif_dhcp_data(netif) : NULL;
+    return dhcp && dhcp->state == DHCP_STATE_BOUND ? dhcp->offered_t0_lease : 0;
+}
+
+// Reused only through the first half of the lease, when a DHCP client
+// would start renewing (T1), so the server never hands the address on
+static bool wifi_link_lease_fresh(void) {
+    uint32_t now = wifi_link_epoch();
+    return link_cache.lease_epoch != 0 && now != 0 &&
+           now >= link_cache.lease_epoch &&
+           now - link_cache.lease_epoch < link_cache.lease_s / 2;
+}
+
+// Saves the AP and IP the link is up on, lease time only after DHCP
+static void wifi_link_cache_store(const char *ssid) {
+    wifi_link_cache_t cache;
+    memset(&cache, 0, sizeof(cache));
+
+    const uint8_t *bssid = WiFi.BSSID();
+    if (bssid == NULL) {
+        return;
+    }
+    cache.ssid_hash = wifi_link_ssid_hash(ssid);
+    memcpy(cache.bssid, bssid, sizeof(cache.bssid));
+    cache.channel = (uint8_t)WiFi.channel();
+    cache.ip = (uint32_t)WiFi.localIP();
+    cache.gateway = (uint32_t)WiFi.gatewayIP();
+    cache.subnet = (uint32_t)WiFi.subnetMask();
+    cache.dns = (uint32_t)WiFi.dnsIP();
+    cache.lease_epoch = link_static ? link_cache.lease_epoch : wifi_link_epoch();
+    cache.lease_s = link_static ? link_cache.lease_s : wifi_link_granted_lease_s();
+
+    // Writes only when something changed
+    link_cache = cache;
+    vp_save_blob(WIFI_CACHE_KEY, &link_cache, sizeof(link_cache));
+}
+
+// === Reconnect timing ===
+static void wifi_link_timing_add(uint32_t *ring, uint16_t *count, uint32_t ms) {
+    ring[*count % WIFI_TIMING_SAMPLES] = ms;
+    (*count)++;
+}
+
+static void wifi_link_timing_get(const uint32_t *ring, uint16_t count,
+                                 wifi_link_timing_t *out) {
+    uint32_t sorted[WIFI_TIMING_SAMPLES];
+    uint16_t n = count < WIFI_TIMING_SAMPLES ? count : WIFI_TIMING_SAMPLES;
+
+    memset(out, 0, sizeof(*out));
+    if (n == 0) {
+        return;
+    }
+
+    // Insertion sort, at most WIFI_TIMING_SAMPLES entries
+    for (uint16_t i = 0; i < n; i++) {
+        uint32_t v = ring[i];
+        uint16_t j = i;
+        while (j > 0 && sorted[j - 1] > v) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = v;
+    }
+
+    out->samples = n;
+    out->p50_ms = sorted[(n - 1) * 50 / 100];
+    out->p90_ms = sorted[(n - 1) * 90 / 100];
+    out->max_ms = sorted[n - 1];
+}
+
+static void wifi_link_timing_log(uint32_t ms) {
+    wifi_link_stats_t stats;
+    wifi_link_stats(&stats);
+
+    debug_printf("[WiFi] Up in %lu ms (%s%s)\n", (unsigned long)ms,
+                link_fast ? "cached AP" : "scan", link_static ? ", lease reused" : "");
+    debug_printf("[WiFi] Reconnect p50/p90/max ms: cached %lu/%lu/%lu (%u), "
+                "scan %lu/%lu/%lu (%u), fallbacks %lu\n",
+                (unsigned long)stats.fast.p50_ms, (unsigned long)stats.fast.p90_ms,
+                (unsigned long)stats.fast.max_ms, stats.fast.samples,
+                (unsigned long)stats.scan.p50_ms, (unsigned long)stats.scan.p90_ms,
+                (unsigned long)stats.scan.max_ms, stats.scan.samples,
+                (unsigned long)stats.fast_misses);
+}
+
+// === Start one attempt, returns at once ===
+static void wifi_link_connect(uint32_t now_ms) {
+    char ssid[sizeof(vp.wifi_ssid)];
+    char pswd[sizeof(vp.wifi_pswd)];
+
+    if (vp_lock()) {
+        memcpy(ssid, vp.wifi_ssid, sizeof(ssid));
+        memcpy(pswd, vp.wifi_pswd, sizeof(pswd));
+        vp_unlock();
+    }
+    ssid[sizeof(ssid) - 1] = '\0';
+    pswd[sizeof(pswd) - 1] = '\0';
+
+    // New outage, the cached AP gets one try
+    if (link_state != WIFI_LINK_CONNECTING && link_state != WIFI_LINK_BACKOFF) {
+        link_outage_ms = now_ms;
+        link_fast_missed = false;
+    }
+
+    if (!link_cache_loaded) {
+        if (!vp_load_blob(WIFI_CACHE_KEY, &link_cache, sizeof(link_cache))) {
+            memset(&link_cache, 0, sizeof(link_cache));
+        }
+        link_cache_loaded = true;
+    }
+
+    link_attempts++;
+    link_fast = !link_fast_missed && link_cache.channel != 0 &&
+                link_cache.ssid_hash == wifi_link_ssid_hash(ssid);
+    link_static = link_fast && wifi_link_lease_fresh();
+
+    WiFi.mode(WIFI_STA);
+    if (link_static) {
+        WiFi.config(IPAddress(link_cache.ip), IPAddress(link_cache.gateway),
+                    IPAddress(link_cache.subnet), IPAddress(link_cache.dns));
+    } else {
+        WiFi.config(IPAddress(), IPAddress(), IPAddress()); // DHCP
+    }
+
+    if (link_fast) {
+        debug_printf("[WiFi] Attempting to connect to: %s (cached AP, channel %u%s)\n",
+                    ssid, link_cache.channel, link_static ? ", lease reused" : "");
+        WiFi.begin(ssid, pswd, link_cache.channel, link_cache.bssid);
+        link_deadline_ms = now_ms + WIFI_FAST_TIMEOUT_MS;
+    } else {
+        debug_printf("[WiFi] Attempting to connect to: %s (try %u)\n",
+                    ssid, link_failures + 1);
+        WiFi.begin(ssid, pswd);
+        link_deadline_ms = now_ms + WIFI_CONNECT_TIMEOUT_MS;
+    }
+    wifi_link_set(WIFI_LINK_CONNECTING);
+}
+
+// === Link is up, record how it got there ===
+static void wifi_link_up(uint32_t now_ms) {
+    uint32_t ms = now_ms - link_outage_ms;
+
+    if (link_fast) {
+        wifi_link_timing_add(timing_fast, &timing_fast_count, ms);
+    } else {
+        wifi_link_timing_add(timing_scan, &timing_scan_count, ms);
+    }
+    if (link_static) {
+        link_dhcp_skipped++;
+    }
+
+    wifi_link_cache_store(vp.wifi_ssid);
+    link_failures = 0;
+    wifi_link_set(WIFI_LINK_UP);
+    wifi_link_timing_log(ms);
+}
+
+// === Failed attempt, schedule the next one ===
+static void wifi_link_fail(uint32_t now_ms, uint8_t reason) {
+    uint32_t delay_ms;
+
+    // AP moved or replaced, scan right away instead of backing off
+    if (link_fast) {
+        debug_printf("[WiFi] Cached AP not reachable (reason %u), scanning\n", reason);
+        link_fast_missed = true;
+        link_fast_misses++;
+        WiFi.disconnect();
+        wifi_link_connect(now_ms);
+        return;
+    }
+
+    link_failures++;
+    if (link_failures >= WIFI_STA_MAX_RETRY) {
+        link_failures = 0;
+        delay_ms = WIFI_STA_RETRY_DELAY;
+        debug_println("[WiFi] Max retries reached, Entering retry delay period!");
+    } else {
+        // Random delay between 3 and 10 seconds
+        delay_ms = WIFI_BACKOFF_MIN_MS +
+                   esp_random() % (WIFI_BACKOFF_MAX_MS - WIFI_BACKOFF_MIN_MS);
+    }
+
+    if (reason) {
+        debug_printf("[WiFi] Failed to connect (reason %u), retry in %lu sec\n",
+                    reason, (unsigned long)(delay_ms / 1000));
+    } else {
+        debug_printf("[WiFi] Failed to connect (timeout), retry in %lu sec\n",
+                    (unsigned long)(delay_ms / 1000));
+    }
+
+    // Stop the driver's own attempt, its disconnect event is ignored
+    WiFi.disconnect();
+    link_deadline_ms = now_ms + delay_ms;
+    wifi_link_set(WIFI_LINK_BACKOFF);
+}
+
+// === Apply one queued WiFi event ===
+static void wifi_link_handle(const wifi_link_evt_t *evt, uint32_t now_ms) {
+    if (evt->type == WIFI_EVT_GOT_IP) {
+        // A late IP after a timeout is still a working link
+        if (link_state == WIFI_LINK_CONNECTING || link_state == WIFI_LINK_BACKOFF) {
+            wifi_link_up(now_ms);
+
+        } else if (link_state == WIFI_LINK_UP) {
+            // Lease renewed by DHCP, see wifi_link_poll()
+            wifi_link_cache_store(vp.wifi_ssid);
+        }
+        return;
+    }
+
+    // Our own disconnect ending a previous attempt, not this one
+    if (link_state == WIFI_LINK_CONNECTING && evt->reason == WIFI_REASON_ASSOC_LEAVE) {
+        return;
+    }
+
+    if (link_state == WIFI_LINK_UP) {
+        debug_printf("[WiFi] Disconnected from WiFi (reason %u)\n", evt->reason);
+        if (wifi_link_enabled()) {
+            wifi_link_connect(now_ms); // First retry right away
+        }
+
+    } else if (link_state == WIFI_LINK_CONNECTING) {
+        wifi_link_fail(now_ms, evt->reason);
+    }
+}
+
+// === Start the state machine ===
+/**
+ * @brief Registers the WiFi event handler and takes over reconnects from
+ * the driver. The first attempt starts on the next wifi_link_poll().
+ * @param on_change Optional, called from TaskWiFi on state changes.
+ */
+void wifi_link_begin(wifi_link_cb on_change) {
+    if (wifi_event_queue == NULL) {
+        wifi_event_queue = xQueueCreate(WIFI_EVENT_QUEUE_LEN, sizeof(wifi_link_evt_t));
+        WiFi.onEvent(wifi_link_on_event);
+    }
+
+    wifi_on_change = on_change;
+    link_state = WIFI_LINK_OFF;
+    link_failures = 0;
+    WiFi.setAutoReconnect(false);
+    xEventGroupClearBits(eventGroup, WIFI_CONNECTED_BIT);
+}
+
+// === Advance the state machine ===
+/**
+ * @brief Waits up to `wait_ms` for a WiFi event, then applies all queued
+ * events and due timers.
+ * @note Call from TaskWiFi only. Doubles as the task's loop delay, so an
+ * event is handled as soon as it arrives.
+ */
+void wifi_link_poll(uint32_t wait_ms) {
+    wifi_link_evt_t evt;
+    TickType_t wait = pdMS_TO_TICKS(wait_ms);
+
+    while (xQueueReceive(wifi_event_queue, &evt, wait) == pdTRUE) {
+        wifi_link_handle(&evt, millis());
+        wait = 0;
+    }
+
+    uint32_t now_ms = millis();
+    bool due = (int32_t)(now_ms - link_deadline_ms) >= 0;
+
+    // Disabled from the HMI, credentials cleared or portal running
+    if (!wifi_link_enabled()) {
+        if (link_state != WIFI_LINK_OFF && link_state != WIFI_LINK_HOLD) {
+            WiFi.disconnect();
+        }
+        wifi_link_set(link_hold ? WIFI_LINK_HOLD : WIFI_LINK_OFF);
+        return;
+    }
+
+    switch (link_state) {
+        case WIFI_LINK_OFF:
+        case WIFI_LINK_HOLD:
+            link_failures = 0;
+            wifi_link_connect(now_ms);
+            break;
+
+        case WIFI_LINK_BACKOFF:
+            if (due) {
+                wifi_link_connect(now_ms);
+            }
+            break;
+
+        case WIFI_LINK_CONNECTING:
+            if (due) {
+                wifi_link_fail(now_ms, 0);
+            }
+            break;
+
+        case WIFI_LINK_UP:
+            // Reused lease getting old, let DHCP confirm it in place
+            if (link_static && !wifi_link_lease_fresh() && wifi_link_epoch() != 0) {
+                debug_println("[WiFi] Reused lease expiring, renewing with DHCP");
+                link_static = false;
+                WiFi.config(IPAddress(), IPAddress(), IPAddress());
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+// === Lend the radio to the provisioning portal ===
+void wifi_link_hold(bool hold) {
+    link_hold = hold;
+    if (hold) {
+        xEventGroupClearBits(eventGroup, WIFI_CONNECTED_BIT);
+        wifi_link_set(WIFI_LINK_HOLD);
+    }
+}
+
+wifi_link_state_t wifi_link_state(void) {
+    return link_state;
+}
+
+const char *wifi_link_state_name(wifi_link_state_t state) {
+    switch (state) {
+        case WIFI_LINK_OFF:
+            return "OFF";
+        case WIFI_LINK_CONNECTING:
+            return "CONNECTING";
+        case WIFI_LINK_UP:
+            return "UP";
+        case WIFI_LINK_BACKOFF:
+            return "BACKOFF";
+        case WIFI_LINK_HOLD:
+            return "HOLD";
+        default:
+            return "?";
+    }
+}
+
+uint32_t wifi_link_attempts(void) {
+    return link_attempts;
+}
+
+// === Reconnect time percentiles ===
+void wifi_link_stats(wifi_link_stats_t *stats) {
+    wifi_link_timing_get(timing_fast, timing_fast_count, &stats->fast);
+    wifi_link_timing_get(timing_scan, timing_scan_count, &stats->scan);
+    stats->fast_misses = link_fast_misses;
+    stats->dhcp_skipped = link_dhcp_skipped;
+}
+
+// === Drop the cached AP, next connect scans ===
+void wifi_link_forget(void) {
+    memset(&link_cache, 0, sizeof(link_cache));
+    link_cache_loaded = true;
+    vp_save_blob(WIFI_CACHE_KEY, &link_cache, sizeof(link_cache));
+}
@@ -0,0 +1,291 @@
+#include "global.h"
+#include "wifi_portal.h"
+
+// === Provisioning Portal State ===
+// WiFiManager in non-blocking mode, driven by wifi_portal_poll() from the
+// TaskWiFi loop. While the portal is open the STA link is held, and the
+// HMI, scheduler and relays keep running on their own tasks.
+static WiFiManager *wm = NULL;
+static bool portal_open = false;
+static uint32_t portal_start_ms = 0;  // Restarts while a phone is joined
+static uint32_t portal_notice_ms = 0; // Hold a notice on the HMI until then
+static bool cred_pending = false;     // Form posted, not committed yet
+static char cred_ssid[64];            // Room to detect over-long input
+static char cred_pswd[72];
+
+// === HMI text, RAM only ===
+static void wifi_portal_show(uint16_t address, const char *text) {
+    bool changed = false;
+
+    if (vp_lock()) {
+        const char *cur = vp_get_string(address);
+        if (cur != NULL && strcmp(cur, text) != 0) {
+            vp_set_string(address, text);
+            changed = true;
+        }
+        vp_unlock();
+    }
+
+    if (changed) {
+        hmi_update_string(address);
+    }
+}
+
+// === Form posted, runs inside wm->process() ===
+static void wifi_portal_on_save(void) {
+    String ssid = wm->server->arg("s");
+    String pswd = wm->server->arg("p");
+
+    // WiFiManager posts an empty SSID for a password-only change
+    if (ssid.length() == 0) {
+        ssid = vp.wifi_ssid;
+    }
+
+    snprintf(cred_ssid, sizeof(cred_ssid), "%s", ssid.c_str());
+    snprintf(cred_pswd, sizeof(cred_pswd), "%s", pswd.c_str());
+    cred_pending = true;
+}
+
+// === Open and close ===
+static void wifi_portal_open(void) {
+    debug_println("[WiFi] Enabling AP mode for configuration");
+
+    // Take the radio from the STA state machine
+    wifi_link_hold(true);
+    WiFi.disconnect(true);
+    wm->startConfigPortal(vp.hostname, WIFI_AP_PSWD); // Returns at once
+
+    portal_open = true;
+    portal_start_ms = millis();
+    portal_notice_ms = portal_start_ms;
+    cred_pending = false;
+
+    // HMI AP mode parameters
+    wifi_portal_show(VP_HOLDER_SIGNAL, "Password");
+    wifi_portal_show(VP_PSWD_AND_SIGNAL, WIFI_AP_PSWD);
+    wifi_portal_show(VP_IP_ADDRESS, WiFi.softAPIP().toString().c_str());
+
+    debug_printf("[WiFi AP] SSID: %s\n", vp.hostname);
+    debug_printf("[WiFi AP] Password: %s\n", WIFI_AP_PSWD);
+    debug_printf("[WiFi AP] IP Address: %s\n", vp.ip_address);
+}
+
+static void wifi_portal_close(void) {
+    if (wm->getConfigPortalActive()) {
+        wm->stopConfigPortal();
+    }
+    WiFi.mode(WIFI_STA);
+    portal_open = false;
+
+    // Labels back, the link callback sets the status VPs
+    wifi_portal_show(VP_HOLDER_IP, "IP Address");
+    wifi_portal_show(VP_HOLDER_SIGNAL, "Signal Strength");
+    wifi_link_hold(false); // STA reconnects on the next poll
+    debug_println("[WiFi] Exiting AP mode!");
+}
+
+// Back to STA, as after a save, without touching the credentials
+static void wifi_portal_reset_state(void) {
+    uint8_t on = 1;
+    uint8_t off = 0;
+
+    if (vp_lock()) {
+        vp_sync_item(VP_WIFI_STATE, &on);
+        vp_sync_item(VP_WIFI_AP_STATE, &off);
+        vp_unlock();
+    }
+    hmi_update_value(VP_WIFI_STATE);
+    hmi_update_value(VP_WIFI_AP_STATE);
+}
+
+// === Progress on the HMI ===
+// Time left in the IP label, or that a phone is on the portal
+static void wifi_portal_progress(uint32_t now_ms) {
+    char text[sizeof(vp.holder_ip)];
+
+    if ((int32_t)(now_ms - portal_notice_ms) < 0) {
+        return;
+    }
+
+    if (WiFi.softAPgetStationNum() > 0) {
+        portal_start_ms = now_ms; // WiFiManager restarts its timeout too
+        snprintf(text, sizeof(text), "Phone joined");
+    } else {
+        uint32_t elapsed = (now_ms - portal_start_ms) / 1000;
+        uint32_t left = elapsed < WIFI_AP_TIMEOUT ? WIFI_AP_TIMEOUT - elapsed : 0;
+        snprintf(text, sizeof(text), "Setup %lu:%02lu",
+                 (unsigned long)(left / 60), (unsigned long)(left % 60));
+    }
+    wifi_portal_show(VP_HOLDER_IP, text);
+}
+
+// === Setup ===
+/**
+ * @brief Configures WiFiManager for the non-blocking portal. Call once
+ * from TaskWiFi before the loop.
+ */
+void wifi_portal_begin(void) {
+    if (wm != NULL) {
+        return;
+    }
+    wm = new WiFiManager();
+
+    wm->setDebugOutput(false);
+    wm->setConfigPortalTimeout(WIFI_AP_TIMEOUT);
+    wm->setConfigPortalBlocking(false);
+
+    // No blocking test connect on save, wifi_link connects
+    wm->setSaveConnect(false);
+    wm->setPreSaveConfigCallback(wifi_portal_on_save);
+
+    // Custom menu for WiFiManager
+    std::vector<const char *> menu = {"wifi", "wifinoscan", "exit"};
+    wm->setMenu(menu);
+
+    // Set custom HTML for the configuration portal
+    const char* customHeadElement = R"rawliteral(
+      <style>
+        #hostname, label[for="hostname"], input[name="hostname"] { display: none !important; }
+      </style>
+    )rawliteral";
+    wm->setCustomHeadElement(customHeadElement);
+}
+
+// === Drive the portal ===
+/**
+ * @brief Opens the portal when AP mode is enabled on the HMI, serves it,
+ * and closes it on save, timeout or when AP mode is turned off.
+ * @note Call from TaskWiFi only, every WIFI_PORTAL_POLL_MS while open.
+ * Never blocks.
+ */
+void wifi_portal_poll(void) {
+    uint32_t now_ms = millis();
+
+    if (!portal_open) {
+        if (vp.wifi_ap_state) {
+            wifi_portal_open();
+        }
+        return;
+    }
+
+    // Turned off from the HMI
+    if (!vp.wifi_ap_state) {
+        debug_println("[WiFi AP] Closed from the HMI");
+        wifi_portal_close();
+        return;
+    }
+
+    wm->process();
+
+    if (cred_pending) {
+        cred_pending = false;
+        if (wifi_portal_commit(cred_ssid, cred_pswd)) {
+            debug_println("[WiFi AP] Saved WiFi credentials");
+            wifi_portal_close();
+            return;
+        }
+
+        // Portal stays open for another try
+        wifi_portal_show(VP_HOLDER_IP, "Check password");
+        portal_notice_ms = now_ms + 5000;
+    }
+
+    if (!wm->getConfigPortalActive()) {
+        debug_println("[WiFi AP] Config portal timeout, no WiFi configured");
+        wifi_portal_reset_state();
+        wifi_portal_close();
+        return;
+    }
+
+    wifi_portal_progress(now_ms);
+}
+
+bool wifi_portal_active(void) {
+    return portal_open;
+}
+
+// === Credential rules ===
+// Also applied to VP writes over the network, see vp_http_check()
+bool wifi_portal_ssid_valid(const char *ssid) {
+    size_t len = strlen(ssid);
+    return len > 0 && len < sizeof(((wifi_cred_t *)0)->ssid);
+}
+
+// WPA needs 8 or more, open networks none
+bool wifi_portal_pswd_valid(const char *pswd) {
+    size_t len = strlen(pswd);
+    return len < sizeof(((wifi_cred_t *)0)->pswd) && (len == 0 || len >= 8);
+}
+
+// === Save credentials ===
+/**
+ * @brief Validates and saves new credentials, then switches to STA.
+ * The wifi_cred_t record is the commit point, the VP keys follow and are
+ * repaired from it by wifi_portal_recover() after a power cut.
+ * @return false if rejected, nothing is written then.
+ */
+bool wifi_portal_commit(const char *ssid, const char *pswd) {
+    wifi_cred_t cred;
+    size_t ssid_len = strlen(ssid);
+    size_t pswd_len = strlen(pswd);
+
+    if (!wifi_portal_ssid_valid(ssid) || !wifi_portal_pswd_valid(pswd)) {
+        debug_printf("[WiFi AP] Rejected credentials (SSID %u, password %u chars)\n",
+                    (unsigned)ssid_len, (unsigned)pswd_len);
+        return false;
+    }
+
+    memset(&cred, 0, sizeof(cred));
+    memcpy(cred.ssid, ssid, ssid_len);
+    memcpy(cred.pswd, pswd, pswd_len);
+
+    if (vp_lock()) {
+        vp_save_blob(WIFI_CRED_KEY, &cred, sizeof(cred)); // Commit point
+        vp_sync_item(VP_WIFI_SSID, cred.ssid);
+        vp_sync_item(VP_WIFI_PSWD, cred.pswd);
+        vp_unlock();
+    }
+
+    wifi_link_forget(); // New network, scan for it
+    wifi_portal_reset_state();
+    hmi_update_string(VP_WIFI_SSID);
+    hmi_update_string(VP_WIFI_PSWD);
+    return true;
+}
+
+// === Repair an interrupted save ===
+/**
+ * @brief Brings the VP credential keys in line with the committed record.
+ * @note Call once at boot with xVPMutex held, after vp_load_values().
+ */
+void wifi_portal_recover(void) {
+    wifi_cred_t cred;
+
+    // Saved by older firmware, the VP keys are all there is
+    if (!vp_load_blob(WIFI_CRED_KEY, &cred, sizeof(cred))) {
+        return;
+    }
+    cred.ssid[sizeof(cred.ssid) - 1] = '\0';
+    cred.pswd[sizeof(cred.pswd) - 1] = '\0';
+
+    bool fixed = vp_sync_item(VP_WIFI_SSID, cred.ssid);
+    fixed |= vp_sync_item(VP_WIFI_PSWD, cred.pswd);
+    if (fixed) {
+        debug_println("[WiFi] Restored credentials from an interrupted save");
+    }
+}
+
+// === Credentials edited on the HMI ===
+/**
+ * @brief Makes the record follow SSID or password edits on the panel, so
+ * wifi_portal_recover() does not undo them at the next boot.
+ * @note Call with xVPMutex held.
+ */
+void wifi_portal_cred_sync(void) {
+    wifi_cred_t cred;
+
+    memset(&cred, 0, sizeof(cred));
+    snprintf(cred.ssid, sizeof(cred.ssid), "%s", vp.wifi_ssid);
+    snprintf(cred.pswd, sizeof(cred.pswd), "%s", vp.wifi_pswd);
+    vp_save_blob(WIFI_CRED_KEY, &cred, sizeof(cred));
+}
@@ -0,0 +1,153 @@
+#include "global.h"
+#include "wifi_signal.h"
+
+// === Signal Sampler State ===
+// Polled by TaskWiFi while the link is up. The filtered RSSI is kept in
+// 1/16 dBm so a small EWMA weight does not stall on integer rounding.
+static const int8_t level_floor_dbm[] = { -128, -85, -75, -67, -55 };
+
+static bool sig_seeded = false;
+static int16_t sig_avg_q4 = 0;        // dBm * 16
+static uint8_t sig_level = WIFI_SIGNAL_POOR;
+static uint32_t sig_next_ms = 0;
+static uint32_t sig_history_ms = 0;   // Next history entry due
+static int8_t sig_history[WIFI_RSSI_HISTORY_LEN];
+static size_t sig_history_count = 0;
+static wifi_signal_stats_t sig_stats;
+
+// === Level with hysteresis ===
+// Leaves the current band only once the average is WIFI_RSSI_HYST_DB past
+// its edge, so noise around an edge does not toggle the HMI
+static uint8_t wifi_signal_classify(int16_t avg_q4, uint8_t level) {
+    while (level < WIFI_SIGNAL_EXCELLENT &&
+           avg_q4 >= (level_floor_dbm[level + 1] + WIFI_RSSI_HYST_DB) * 16) {
+        level++;
+    }
+    while (level > WIFI_SIGNAL_POOR &&
+           avg_q4 < (level_floor_dbm[level] - WIFI_RSSI_HYST_DB) * 16) {
+        level--;
+    }
+    return level;
+}
+
+static int8_t wifi_signal_dbm(int16_t q4) {
+    return (int8_t)((q4 + (q4 < 0 ? -8 : 8)) / 16);
+}
+
+// === Push the level to the HMI ===
+static void wifi_signal_show(uint8_t level) {
+    const char *text = wifi_signal_level_name((wifi_signal_level_t)level);
+    bool changed = false;
+
+    if (vp_lock()) {
+        if (strcmp(vp.pswd_and_signal, text) != 0) {
+            vp_set_string(VP_PSWD_AND_SIGNAL, text); // RAM only
+            changed = true;
+        }
+        vp_unlock();
+    }
+
+    if (changed) {
+        sig_stats.level_changes++;
+        hmi_update_string(VP_PSWD_AND_SIGNAL);
+    }
+}
+
+// === New link ===
+/**
+ * @brief Restarts the filter, the next poll samples at once and shows
+ * the level without hysteresis.
+ * @note Called from wifi_on_link_change() when the link comes up.
+ */
+void wifi_signal_reset(void) {
+    sig_seeded = false;
+    sig_next_ms = millis();
+}
+
+// === Sample ===
+/**
+ * @brief Reads the RSSI every WIFI_RSSI_SAMPLE_MS, filters it and
+ * updates VP_PSWD_AND_SIGNAL only when the quality level changes.
+ * @note Call from TaskWiFi while WIFI_CONNECTED_BIT is set.
+ */
+void wifi_signal_poll(uint32_t now_ms) {
+    if ((int32_t)(now_ms - sig_next_ms) < 0) {
+        return;
+    }
+    sig_next_ms = now_ms + WIFI_RSSI_SAMPLE_MS;
+
+    int8_t rssi = WiFi.RSSI();
+    if (rssi >= 0) {
+        return; // 0 when not associated
+    }
+
+    int16_t sample_q4 = (int16_t)rssi * 16;
+    bool first = !sig_seeded;
+    if (first) {
+        sig_avg_q4 = sample_q4;
+        sig_level = wifi_signal_classify(sample_q4, WIFI_SIGNAL_POOR);
+        sig_seeded = true;
+    } else {
+        sig_avg_q4 += (sample_q4 - sig_avg_q4) / (1 << WIFI_RSSI_EWMA_SHIFT);
+    }
+
+    uint8_t level = wifi_signal_classify(sig_avg_q4, sig_level);
+    sig_stats.samples++;
+    sig_stats.rssi_last = rssi;
+    sig_stats.rssi_avg = wifi_signal_dbm(sig_avg_q4);
+
+    if (first || level != sig_level) {
+        debug_printf("[WiFi] Signal %s (%d dBm)\n",
+                    wifi_signal_level_name((wifi_signal_level_t)level),
+                    sig_stats.rssi_avg);
+        sig_level = level;
+        wifi_signal_show(level);
+    }
+    sig_stats.level = sig_level;
+
+    // Filtered value once a minute, for metrics
+    if ((int32_t)(now_ms - sig_history_ms) >= 0) {
+        sig_history_ms = now_ms + WIFI_RSSI_HISTORY_MS;
+        sig_history[sig_history_count % WIFI_RSSI_HISTORY_LEN] = sig_stats.rssi_avg;
+        sig_history_count++;
+    }
+}
+
+const char *wifi_signal_level_name(wifi_signal_level_t level) {
+    switch (level) {
+        case WIFI_SIGNAL_EXCELLENT:
+            return "Excellent";
+        case WIFI_SIGNAL_GOOD:
+            return "Good";
+        case WIFI_SIGNAL_FAIR:
+            return "Fair";
+        case WIFI_SIGNAL_WEAK:
+            return "Weak";
+        default:
+            return "Poor";
+    }
+}
+
+void wifi_signal_stats(wifi_signal_stats_t *stats) {
+    *stats = sig_stats;
+}
+
+// === RSSI history ===
+/**
+ * @brief Copies up to `max` per-minute filtered RSSI values, oldest
+ * first, and returns how many were copied.
+ */
+size_t wifi_signal_history(int8_t *out, size_t max) {
+    size_t count = sig_history_count < WIFI_RSSI_HISTORY_LEN ?
+                   sig_history_count : WIFI_RSSI_HISTORY_LEN;
+    if (count > max) {
+        count = max;
+    }
+
+    // Newest `count` entries, oldest of them first
+    size_t start = sig_history_count - count;
+    for (size_t i = 0; i < count; i++) {
+        out[i] = sig_history[(start + i) % WIFI_RSSI_HISTORY_LEN];
+    }
+    return count;
+}
@@ -0,0 +1,255 @@
+"""
+Binary console log decoder
+
+About:
+- Firmware built with `-DLOG_BINARY=1` sends log records instead of text:
+    0x1E, length, int32 format offset, tagged arguments. The offset is
+    relative to the `log_ring_anchor` symbol, the format strings are read
+    from the ELF the firmware was built from.
+- Bytes outside records (ROM boot messages, panics) are passed through.
+
+Usage:
+- Live: `python scripts/log_decode.py firmware.elf --port COM7 --baud 115200`
+- Capture: `python scripts/log_decode.py firmware.elf capture.bin`
+- Without a file or port the capture is read from stdin.
+
+Notes:
+- Use the ELF of the exact build on the unit, PlatformIO keeps it as
+    `firmware/.pio/build/esp32dev-release/firmware.elf`. With another build the offsets
+    point at the wrong strings, records that do not decode are shown as
+    raw bytes.
+"""
+
+__author__ = "Bhanu Teja J"
+__version__ = "0.0.1"
+__created__ = "2026-10-18"
+__updated__ = "2026-10-18"
+
+import re
+import sys
+import struct
+import argparse
+
+LOG_BIN_MARK = 0x1E
+SHT_NOBITS = 8
+SHF_ALLOC = 0x2
+ANCHOR = "log_ring_anchor"
+
+# printf conversion, length modifiers are dropped for Python
+SPEC = re.compile(
+    r"%(?P<flags>[-+ #0]*)(?P<width>\*|\d+)?(?:\.(?P<prec>\*|\d+))?"
+    r"(?P<length>hh|h|ll|l|j|z|t|L)?(?P<conv>[diouxXeEfFgGcsp%])"
+)
+
+# ==================================================
+# ELF String Table
+# ==================================================
+class Elf:
+    """Allocated sections and symbols of a 32 or 64-bit ELF"""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF":
+            raise ValueError(f"{path} is not an ELF file")
+        is64 = self.data[4] == 2
+        self.end = "<" if self.data[5] == 1 else ">"
+
+        if is64:
+            shoff, = struct.unpack_from(self.end + "Q", self.data, 0x28)
+            shentsize, shnum = struct.unpack_from(self.end + "HH", self.data, 0x3A)
+            shdr = self.end + "IIQQQQIIQQ"
+        else:
+            shoff, = struct.unpack_from(self.end + "I", self.data, 0x20)
+            shentsize, shnum = struct.unpack_from(self.end + "HH", self.data, 0x2E)
+            shdr = self.end + "IIIIIIIIII"
+
+        self.sections = []
+        for i in range(shnum):
+            name, stype, flags, addr, offset, size, link, _, _, entsize = struct.unpack_from(
+                shdr, self.data, shoff + i * shentsize)
+            self.sections.append({
+                "type": stype, "flags": flags, "addr": addr, "offset": offset,
+                "size": size, "link": link, "entsize": entsize,
+            })
+
+        self.anchor = None
+        for sec in self.sections:
+            if sec["type"] == 2:  # SHT_SYMTAB
+                self.anchor = self._find_symbol(sec, ANCHOR, is64)
+        if self.anchor is None:
+            raise ValueError(f"{ANCHOR} not found, is {path} stripped or not a LOG_BINARY build?")
+
+    def _find_symbol(self, symtab, wanted, is64):
+        strtab = self.sections[symtab["link"]]
+        wanted = wanted.encode()
+        for off in range(symtab["offset"], symtab["offset"] + symtab["size"], symtab["entsize"]):
+            if is64:
+                name, _, _, _, value, _ = struct.unpack_from(self.end + "IBBHQQ", self.data, off)
+            else:
+                name, value, _, _, _, _ = struct.unpack_from(self.end + "IIIBBH", self.data, off)
+            start = strtab["offset"] + name
+            if self.data[start:start + len(wanted) + 1] == wanted + b"\0":
+                return value
+        return None
+
+    def string(self, offset):
+        """NUL-terminated string at `offset` from the anchor, None if unmapped"""
+        addr = self.anchor + offset
+        for sec in self.sections:
+            if (sec["flags"] & SHF_ALLOC and sec["type"] != SHT_NOBITS and
+                    sec["addr"] <= addr < sec["addr"] + sec["size"]):
+                start = sec["offset"] + addr - sec["addr"]
+                stop = self.data.find(b"\0", start, sec["offset"] + sec["size"])
+                return self.data[start:stop] if stop >= 0 else None
+        return None
+
+# ==================================================
+# Records
+# ==================================================
+def parse_args(payload):
+    """Tagged arguments of a record, None when the payload is malformed"""
+    args = []
+    i = 0
+    while i < len(payload):
+        tag = payload[i:i + 1]
+        i += 1
+        if tag == b"I" and i + 4 <= len(payload):
+            args.append((tag, struct.unpack_from("<I", payload, i)[0]))
+            i += 4
+        elif tag in (b"Q", b"D") and i + 8 <= len(payload):
+            fmt = "<Q" if tag == b"Q" else "<d"
+            args.append((tag, struct.unpack_from(fmt, payload, i)[0]))
+            i += 8
+        elif tag == b"S" and i < len(payload) and i + 1 + payload[i] <= len(payload):
+            args.append((tag, payload[i + 1:i + 1 + payload[i]]))
+            i += 1 + payload[i]
+        else:
+            return None
+    return args
+
+def as_int(arg, signed, length):
+    tag, value = arg
+    if tag not in (b"I", b"Q"):
+        return 0
+    bits = {"hh": 8, "h": 16}.get(length, 32 if tag == b"I" else 64)
+    value &= (1 << bits) - 1
+    if signed and value >> (bits - 1):
+        value -= 1 << bits
+    return value
+
+def render(fmt, args):
+    """printf `fmt` with recorded arguments, missing ones shown as ?"""
+    fmt = fmt.decode("latin-1")
+    out = []
+    pos = 0
+    args = list(args)
+
+    def take():
+        return args.pop(0) if args else None
+
+    for m in SPEC.finditer(fmt):
+        out.append(fmt[pos:m.start()])
+        pos = m.end()
+        conv = m.group("conv")
+        if conv == "%":
+            out.append("%")
+            continue
+
+        width, prec = m.group("width") or "", m.group("prec")
+        if width == "*":
+            arg = take()
+            width = str(as_int(arg, True, None)) if arg else ""
+        if prec == "*":
+            arg = take()
+            prec = str(as_int(arg, True, None)) if arg else ""
+        spec = "%" + m.group("flags") + width + ("." + prec if prec is not None else "")
+
+        arg = take()
+        if arg is None:
+            out.append("?")
+        elif conv == "s":
+            out.append((spec + "s") % (arg[1].decode("latin-1") if arg[0] == b"S" else "?"))
+        elif conv == "c":
+            out.append((spec + "c") % chr(as_int(arg, False, None) & 0xFF))
+        elif conv == "p":
+            out.append("0x%x" % as_int(arg, False, None))
+        elif conv in "eEfFgG":
+            value = arg[1] if arg[0] == b"D" else float(as_int(arg, True, None))
+            out.append((spec + conv) % value)
+        else:
+            py = "d" if conv in "diu" else conv
+            out.append((spec + py) % as_int(arg, conv in "di", m.group("length")))
+    out.append(fmt[pos:])
+    return "".join(out).encode("latin-1")
+
+def decode(elf, buf, final=False):
+    """Decoded bytes of `buf` and the tail kept for the next chunk"""
+    out = bytearray()
+    i = 0
+    while i < len(buf):
+        if buf[i] != LOG_BIN_MARK:
+            stop = buf.find(bytes([LOG_BIN_MARK]), i)
+            stop = len(buf) if stop < 0 else stop
+            out += buf[i:stop]
+            i = stop
+            continue
+        if i + 2 > len(buf) or i + 2 + buf[i + 1] > len(buf):
+            if final:
+                out += buf[i:]
+                i = len(buf)
+            break  # Record continues in the next chunk
+
+        payload = buf[i + 2:i + 2 + buf[i + 1]]
+        fmt = None
+        if len(payload) >= 4:
+            offset, = struct.unpack_from("<i", payload, 0)
+            fmt = elf.string(offset)
+        args = parse_args(payload[4:]) if fmt is not None else None
+        if args is None:
+            out.append(buf[i])  # Not a record, resync on the next byte
+            i += 1
+            continue
+        out += render(fmt, args)
+        i += 2 + buf[i + 1]
+    return bytes(out), buf[i:]
+
+# ==================================================
+# Main
+# ==================================================
+def main():
+    parser = argparse.ArgumentParser(description="Decode a LOG_BINARY console")
+    parser.add_argument("elf", help="firmware ELF of the running build")
+    parser.add_argument("capture", nargs="?", help="raw console capture, stdin if omitted")
+    parser.add_argument("--port", help="read live from a serial port")
+    parser.add_argument("--baud", type=int, default=115200)
+    args = parser.parse_args()
+
+    elf = Elf(args.elf)
+    out = sys.stdout.buffer
+
+    if args.port:
+        import serial
+        ser = serial.Serial(args.port, args.baud, timeout=0.1)
+        tail = b""
+        try:
+            while True:
+                text, tail = decode(elf, tail + ser.read(256))
+                out.write(text)
+                out.flush()
+        except KeyboardInterrupt:
+            pass
+        finally:
+            ser.close()
+        return
+
+    if args.capture:
+        with open(args.capture, "rb") as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+    text, _ = decode(elf, data, final=True)
+    out.write(text)
+
+if __name__ == "__main__":
+    main()
@@ -8,6 +8,12 @@ About:
 
 Usage:
 - Run the monitor: `python scripts/serial_emulator.py --port COM7 --baud 115200`
+- Panel RTC: `--rtc now` (default), `--rtc none` for a panel that lost
+    its backup power, or `--rtc "2025-03-10 17:30:00"` to start elsewhere.
+- Panel for the native firmware: `--port /tmp/grow-panel --panel`, where
+    the native build was started with `--pty /tmp/grow-panel`. The firmware
+    drives the display, so the check and initial writes are skipped.
+    `--touch LIGHT_STATE=1` taps a VP once connected (repeatable).
 - Use `--help` to see command line options.
 
 Notes:
@@ -16,16 +22,16 @@ Notes:
 """
 
 __author__ = "Bhanu Teja J"
-__version__ = "0.0.3"
+__version__ = "0.0.5"
 __created__ = "2025-07-11"
-__updated__ = "2025-12-12"
+__updated__ = "2026-10-18"
 
 import sys
 import time
 import serial
 import binascii
 import argparse
-from datetime import datetime
+from datetime import datetime, timedelta
 from collections import OrderedDict
 
 # ==================================================
@@ -39,8 +45,9 @@ VP_CONFIG = OrderedDict({
     0x1040: {'name': 'GROWTH_DAY', 'type': 'uint8', 'length': 1, 'default': 6},
     0x1050: {'name': 'GROWTH_BAR', 'type': 'uint8', 'length': 1, 'default': 10},
     0x1060: {'name': 'GROWTH_STR', 'type': 'str', 'length': 6, 'default': "12/15"},
-    0x1070: {'name': 'FW_VERSION', 'type': 'str', 'length': 6, 'default': "v1.0.0"},
-    0x1080: {'name': 'HW_VERSION', 'type': 'str', 'length': 6, 'default': "v1.0.0"},
+    0x1070: {'name': 'UI_VERSION', 'type': 'str', 'length': 6, 'default': "v1.0.0"},
+    0x1080: {'name': 'FW_VERSION', 'type': 'str', 'length': 6, 'default': "v1.0.0"},
+    0x1090: {'name': 'HW_VERSION', 'type': 'str', 'length': 6, 'default': "v1.0.0"},
 
     0x1100: {'name': 'LIGHT_STATE', 'type': 'uint8', 'length': 1, 'default': 1},
     0x1110: {'name': 'LIGHT_AUTO', 'type': 'uint8', 'length': 1, 'default': 1},
@@ -65,12 +72,12 @@ VP_CONFIG = OrderedDict({
     0x1340: {'name': 'FAN_OFF_HR', 'type': 'uint8', 'length': 1, 'default': 18},
     0x1350: {'name': 'FAN_OFF_MIN', 'type': 'uint8', 'length': 1, 'default': 0},
     
-    0x1400: {'name': 'WIFI_STATE', 'type': 'str', 'length': 16, 'default': "Connected"},
-    0x1410: {'name': 'WIFI_SSID', 'type': 'str', 'length': 32, 'default': "NGS"},
-    0x1420: {'name': 'WIFI_PASSWORD', 'type': 'str', 'length': 32, 'default': ""},
-    0x1430: {'name': 'IP_ADDRESS', 'type': 'str', 'length': 16, 'default': "- - - -"},
-    0x1440: {'name': 'SIGNAL_STRENGTH', 'type': 'str', 'length': 16, 'default': "Strong"},
-    0x1450: {'name': 'CONFIG_NETWORK', 'type': 'uint8', 'length': 1, 'default': 0},
+    0x1400: {'name': 'WIFI_STATE', 'type': 'uint8', 'length': 1, 'default': 0},
+    0x1410: {'name': 'WIFI_AP_STATE', 'type': 'uint8', 'length': 1, 'default': 0},
+    0x1420: {'name': 'WIFI_SSID', 'type': 'str', 'length': 32, 'default': "NGS"},
+    0x1430: {'name': 'WIFI_PASSWORD', 'type': 'str', 'length': 32, 'default': ""},
+    0x1440: {'name': 'IP_ADDRESS', 'type': 'str', 'length': 16, 'default': "- - - -"},
+    0x1450: {'name': 'SIGNAL_STRENGTH', 'type': 'str', 'length': 16, 'default': "Strong"},
 })
 
 # ==================================================
@@ -150,13 +157,55 @@ HEADER = b'\x5A\xA5'
 CMD_WRITE = 0x82 # Writes data to DWIN
 CMD_READ = 0x83 # Reads data from DWIN
 
+# Panel system registers
+RTC_ADDR = 0x0010 # Read: YY MM DD WW HH MM SS 00 (4 words)
+RTC_SET_ADDR = 0x009C # Write: 5A A5 YY MM DD HH MM SS
+
+# ==================================================
+# Panel RTC Class
+# ==================================================
+class PanelRTC:
+    """Emulates the panel RTC, local time kept as an offset to the host clock"""
+    RESET_TIME = datetime(2000, 1, 1) # What a panel without backup power reads
+
+    def __init__(self, start=None):
+        self.offset = timedelta(0)
+        self.set_time(start if start is not None else self.RESET_TIME)
+
+    def set_time(self, when):
+        self.offset = when - datetime.now()
+
+    def now(self):
+        return datetime.now() + self.offset
+
+    def read_bytes(self):
+        """Register contents at 0x0010, binary not BCD"""
+        t = self.now()
+        return bytes([
+            t.year % 100, t.month, t.day, t.isoweekday() % 7,
+            t.hour, t.minute, t.second, 0x00
+        ])
+
+    def write_bytes(self, data):
+        """Apply a 0x009C write, returns the new time or None"""
+        if len(data) < 8 or data[0:2] != HEADER:
+            return None
+        year, month, day, hour, minute, second = data[2:8]
+        try:
+            when = datetime(2000 + year, month, day, hour, minute, second)
+        except ValueError:
+            return None
+        self.set_time(when)
+        return when
+
 # ==================================================
 # DWIN Handler Class
 # ==================================================
 class DWINHandler:
     """Handler for DWIN serial communication"""
-    def __init__(self, serial_port):
+    def __init__(self, serial_port, rtc=None):
         self.ser = serial_port
+        self.rtc = rtc if rtc is not None else PanelRTC(datetime.now())
         self.callbacks = {}
         self.last_frame = None
         
@@ -180,6 +229,19 @@ class DWINHandler:
         address = (frame[4] << 8) | frame[5]
         data_bytes = bytes(frame[6:])  # Exclude checksum
         
+        # Panel RTC registers live outside the VP table
+        if address == RTC_ADDR and command == CMD_READ and len(data_bytes) == 1:
+            self.send_rtc_reply(data_bytes[0])
+            return (command, address, data_bytes, None)
+        if address == RTC_SET_ADDR and command == CMD_WRITE:
+            when = self.rtc.write_bytes(data_bytes)
+            if when:
+                print(f"🕒 [RTC SET] {when:%Y-%m-%d %H:%M:%S}")
+            else:
+                print("⚠️ [RTC SET ERROR] Invalid RTC write")
+            self.ser.write(HEADER + bytes([0x03, CMD_WRITE, 0x4F, 0x4B]))
+            return (command, address, data_bytes, when)
+
         # Get VP info
         vp_name = VP.get_name_by_address(address)
         vp_type = VP.get_type_by_address(address) if address in VP_CONFIG else None
@@ -246,6 +308,41 @@ class DWINHandler:
         print(f"📤 [SENT] {vp_name} = {value}")
         print(f"    Hex: {binascii.hexlify(frame).decode('ascii')}")
 
+    def send_touch(self, vp_name, value):
+        """Send a VP the way the panel uploads a touch or text entry"""
+        address = VP.get_address(vp_name)
+        if address is None:
+            print(f"⚠️ [TOUCH ERROR] Unknown VP: {vp_name}")
+            return
+
+        # 0x83 upload: word count, then the data words
+        if VP.get_type_by_address(address) == 'str':
+            data = value.encode('ascii') + b'\xFF\xFF'
+            if len(data) % 2:
+                data += b'\xFF'
+        else:
+            data = int(value).to_bytes(2, 'big')
+        payload = bytes([
+            CMD_READ, (address >> 8) & 0xFF, address & 0xFF, len(data) // 2
+        ]) + data
+        frame = HEADER + bytes([len(payload)]) + payload
+
+        self.ser.write(frame)
+        print(f"👆 [TOUCH] {vp_name} = {value}")
+        print(f"    Hex: {binascii.hexlify(frame).decode('ascii')}")
+
+    def send_rtc_reply(self, word_count=4):
+        """Answer a read of the RTC registers at 0x0010"""
+        data = self.rtc.read_bytes()[:word_count * 2]
+        payload = bytes([
+            CMD_READ, (RTC_ADDR >> 8) & 0xFF, RTC_ADDR & 0xFF, word_count
+        ]) + data
+        frame = HEADER + bytes([len(payload)]) + payload
+
+        self.ser.write(frame)
+        print(f"📤 [RTC READ] {self.rtc.now():%Y-%m-%d %H:%M:%S}")
+        print(f"    Hex: {binascii.hexlify(frame).decode('ascii')}")
+
     def send_read_command(self, vp_name=None, address=None, word_count=1):
         """
         Send a read command to the display
@@ -433,7 +530,7 @@ class FrameDetector:
             return buffer_copy
         return None
 
-def process_serial_stream(port_name, baud_rate):
+def process_serial_stream(port_name, baud_rate, rtc_start=None, panel=False, touches=()):
     """
     Monitors and processes DWIN display communication over serial.
     
@@ -441,6 +538,9 @@ def process_serial_stream(port_name, baud_rate):
     1. Checks communication with the display
     2. Initializes display values
     3. Enters the main monitoring loop
+
+    As the panel (`panel`), steps 1 and 2 and the clock writes are left
+    to the firmware and `touches` are sent once instead.
     """
     try:
         # Create serial connection
@@ -448,16 +548,17 @@ def process_serial_stream(port_name, baud_rate):
         print(f"Connected to {port_name} at {baud_rate} baud...")
         
         # Create handler instance
-        handler = DWINHandler(ser)
+        handler = DWINHandler(ser, PanelRTC(rtc_start))
+        print(f"Panel RTC: {handler.rtc.now():%Y-%m-%d %H:%M:%S}")
         
         # ==================================================
         # 1. Communication Check
         # ==================================================
         print("Checking display communication...")
-        communication_ok = False
+        communication_ok = panel
         detector = FrameDetector()
         
-        for attempt in range(3):
+        for attempt in range(0 if panel else 3):
             print(f"Attempt {attempt+1}: Sending read request for TIME (0x1000)")
             handler.send_read_command('TIME')
             
@@ -506,8 +607,8 @@ def process_serial_stream(port_name, baud_rate):
             'GROWTH_BAR', 'FW_VERSION', 'HW_VERSION'
         ]
         
-        # Send initial values
-        for vp_name in init_vps:
+        # Send initial values, the firmware does that for a panel
+        for vp_name in ([] if panel else init_vps):
             try:
                 value = getattr(VP, vp_name)
                 handler.send_write_command(vp_name, value)
@@ -517,9 +618,13 @@ def process_serial_stream(port_name, baud_rate):
                 print(f"⚠️ Failed to initialize {vp_name}: {e}")
         
         # Send initial time
-        current_time_str = datetime.now().strftime("%H:%M")
-        handler.send_write_command('TIME', current_time_str)
-        print(f"  - TIME: {current_time_str}")
+        if not panel:
+            current_time_str = datetime.now().strftime("%H:%M")
+            handler.send_write_command('TIME', current_time_str)
+            print(f"  - TIME: {current_time_str}")
+        for vp_name, value in touches:
+            handler.send_touch(vp_name, value)
+            time.sleep(0.1)
         print("Initialization complete\n")
         
         # ==================================================
@@ -535,7 +640,7 @@ def process_serial_stream(port_name, baud_rate):
             current_time = time.time()
 
             # Update time on display periodically
-            if current_time - last_time_update >= update_interval:
+            if not panel and current_time - last_time_update >= update_interval:
                 current_time_str = datetime.now().strftime("%H:%M")
                 handler.send_write_command('TIME', current_time_str)
                 last_time_update = current_time
@@ -588,6 +693,18 @@ def main():
     parser.add_argument(
         "--baud", "-b", type=int, default=115200, help="Baud rate (default: 115200)"
     )
+    parser.add_argument(
+        "--rtc", default="now",
+        help="Panel RTC start: now, none (lost power) or 'YYYY-MM-DD HH:MM:SS'"
+    )
+    parser.add_argument(
+        "--panel", action="store_true",
+        help="Act as the panel of a running firmware, e.g. the native build's pty"
+    )
+    parser.add_argument(
+        "--touch", action="append", default=[], metavar="NAME=VALUE",
+        help="Touch upload sent once connected, e.g. LIGHT_STATE=1 (repeatable)"
+    )
 
     # Show help if no args were passed
     if len(sys.argv) == 1:
@@ -596,8 +713,32 @@ def main():
 
     args = parser.parse_args()
 
+    # Panel RTC start time
+    if args.rtc == "now":
+        rtc_start = datetime.now()
+    elif args.rtc == "none":
+        rtc_start = None
+    else:
+        try:
+            rtc_start = datetime.strptime(args.rtc, "%Y-%m-%d %H:%M:%S")
+        except ValueError:
+            parser.error("--rtc must be now, none or 'YYYY-MM-DD HH:MM:SS'")
+
+    # Touches as (VP name, value), numbers for numeric VPs
+    touches = []
+    for touch in args.touch:
+        name, sep, value = touch.partition('=')
+        if not sep or VP.get_address(name) is None:
+            parser.error(f"--touch {touch}: expected NAME=VALUE with a known VP name")
+        if VP.get_type_by_address(VP.get_address(name)) != 'str':
+            try:
+                value = int(value, 0)
+            except ValueError:
+                parser.error(f"--touch {touch}: value must be a number")
+        touches.append((name, value))
+
     # Start monitoring
-    process_serial_stream(args.port, args.baud)
+    process_serial_stream(args.port, args.baud, rtc_start, args.panel, touches)
 
 if __name__ == "__main__":
     main()
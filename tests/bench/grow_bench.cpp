@@ -0,0 +1,185 @@
+#include "global.h"
+#include "host_shims.h"
+#include <vector>
+
+// ============ HOST BENCHMARKS ============
+// Runs the firmware's own suite (firmware/src/bench.cpp) against the
+// host shims, NVS in memory and panel frames encoded but not sent. The
+// clock follows the wall clock so esp_timer times real work. Results go
+// to a JSON lines file that the next run, or a board, is compared with.
+
+SemaphoreHandle_t xVPMutex = NULL;
+QueueHandle_t xHMIUpdateQueue = NULL;
+EventGroupHandle_t eventGroup = NULL;
+
+typedef struct {
+    char name[32];
+    char target[8];
+    double ns;
+} BenchRow;
+
+typedef struct {
+    FILE *out;
+    std::vector<BenchRow> rows;
+} BenchRun;
+
+static void on_result(const bench_result_t *result, void *ctx) {
+    BenchRun *run = (BenchRun *)ctx;
+    char line[BENCH_LINE_MAX];
+    size_t len = bench_format(result, "host", line, sizeof(line));
+    fwrite(line, 1, len, run->out);
+
+    BenchRow row = {};
+    snprintf(row.name, sizeof(row.name), "%s", result->name);
+    snprintf(row.target, sizeof(row.target), "host");
+    row.ns = result->ns_per_op;
+    run->rows.push_back(row);
+
+    printf("  %-22s %10.1f ns %10.1f cycles %9lu ops\n", result->name,
+           result->ns_per_op, result->cycles_per_op, (unsigned long)result->ops);
+}
+
+// ============ BASELINE ============
+// Any line holding a result object, so a board's console log works too
+static std::vector<BenchRow> load_baseline(const char *path) {
+    std::vector<BenchRow> rows;
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        printf("  Cannot open %s\n", path);
+        return rows;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        const char *obj = strstr(line, "{\"bench\":\"");
+        const char *ns = strstr(line, "\"ns\":");
+        const char *target = strstr(line, "\"target\":\"");
+        BenchRow row = {};
+        if (!obj || !ns ||
+            sscanf(obj, "{\"bench\":\"%31[^\"]\"", row.name) != 1 ||
+            sscanf(ns, "\"ns\":%lf", &row.ns) != 1) {
+            continue;
+        }
+        if (!target || sscanf(target, "\"target\":\"%7[^\"]\"", row.target) != 1) {
+            snprintf(row.target, sizeof(row.target), "?");
+        }
+        rows.push_back(row);
+    }
+    fclose(f);
+    return rows;
+}
+
+// Prints the change per case, counts those slower by more than `max_pct`
+static int compare_baseline(const std::vector<BenchRow> &now,
+                            const std::vector<BenchRow> &base, double max_pct) {
+    int regressions = 0;
+    printf("\n  %-22s %12s %12s %9s\n", "Case", "Baseline ns", "Now ns", "Change");
+    for (const BenchRow &row : now) {
+        const BenchRow *old = NULL;
+        for (const BenchRow &b : base) {
+            if (strcmp(b.name, row.name) == 0) {
+                old = &b;
+            }
+        }
+        if (!old || old->ns <= 0) {
+            printf("  %-22s %12s %12.1f %9s\n", row.name, "-", row.ns, "new");
+            continue;
+        }
+
+        double pct = (row.ns - old->ns) * 100.0 / old->ns;
+        bool regressed = max_pct > 0 && pct > max_pct;
+        regressions += regressed;
+        printf("  %-22s %9.1f %-2s %12.1f %+8.1f%%%s\n", row.name, old->ns,
+               strcmp(old->target, "host") == 0 ? "" : old->target, row.ns, pct,
+               regressed ? "  REGRESSED" : "");
+    }
+    return regressions;
+}
+
+// ============ MAIN ============
+static void usage(const char *prog) {
+    printf("Usage: %s [--filter TEXT] [--out FILE]\n"
+           "          [--baseline FILE [--max-regress PCT]]\n", prog);
+}
+
+int main(int argc, char **argv) {
+    const char *filter = NULL;
+    const char *out_path = "grow_bench.jsonl";
+    const char *baseline = NULL;
+    double max_pct = 0; // Report only
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--filter") && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (!strcmp(argv[i], "--out") && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (!strcmp(argv[i], "--baseline") && i + 1 < argc) {
+            baseline = argv[++i];
+        } else if (!strcmp(argv[i], "--max-regress") && i + 1 < argc) {
+            max_pct = strtod(argv[++i], NULL);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    // Read first, the baseline may be the file about to be written
+    std::vector<BenchRow> base;
+    if (baseline) {
+        base = load_baseline(baseline);
+    }
+
+    BenchRun run;
+    run.out = fopen(out_path, "w");
+    if (!run.out) {
+        perror("out");
+        return 2;
+    }
+
+    host_serial_quiet(true);
+    xVPMutex = xSemaphoreCreateMutex();
+    xHMIUpdateQueue = xQueueCreate(64, sizeof(hmi_update_item_t));
+    eventGroup = xEventGroupCreate();
+
+    // Defaults of a first boot, as setup() leaves them
+    memset(&vp, 0, sizeof(vp));
+    strcpy(vp.hostname, "E-1A2B");
+    strcpy(vp.wifi_ssid, "GrowRoom");
+    vp.light_auto = 1;
+    vp.light_on_hr = 9;
+    vp.light_off_hr = 21;
+    vp.water_auto = 1;
+    vp.water_on_hr = 9;
+    vp.water_off_hr = 18;
+    vp.water_interval_hr = 1;
+    vp.water_duration_sec = 30;
+    vp.fan_auto = 1;
+    vp.fan_on_hr = 12;
+    vp.fan_off_hr = 21;
+    vp.growth_day = 1;
+    vp.total_cycle = 15;
+    vp_save_values();
+    io_schedule_init();
+    time_set_epoch(1741608000);
+    host_clock_set_realtime(true);
+
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║ FIRMWARE HOT PATHS: host, %3d ms batches%*s║\n", BENCH_MIN_US / 1000, 17, "");
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+
+    uint32_t cases = bench_run(filter, on_result, &run);
+    fclose(run.out);
+    printf("  Cases         : %lu -> %s\n", (unsigned long)cases, out_path);
+
+    int result = cases > 0 ? 0 : 1;
+    if (baseline) {
+        int regressions = compare_baseline(run.rows, base, max_pct);
+        if (max_pct > 0) {
+            printf("  Regressions   : %d over %.0f%%\n", regressions, max_pct);
+        }
+        result |= regressions > 0;
+    }
+
+    printf("  Result:   %s\n", result == 0 ? "PASS" : "FAIL");
+    return result == 0 ? 0 : 1;
+}
@@ -0,0 +1,232 @@
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "host_shims.h"
+
+// === Host FreeRTOS shim ===
+// Blocking waits use wall time, delays move the virtual clock. A wait
+// that can never be satisfied (no other task exists) aborts instead of
+// hanging the test.
+
+struct host_task {
+    std::string name;
+    std::thread thread;
+};
+
+struct host_queue {
+    std::mutex lock;
+    std::condition_variable changed;
+    std::deque<std::vector<uint8_t>> items;
+    size_t length;
+    size_t item_size;
+    bool is_mutex;
+};
+
+struct host_event_group {
+    std::mutex lock;
+    std::condition_variable changed;
+    EventBits_t bits;
+};
+
+static int task_count = 0;
+
+// === Wait helper ===
+template <typename Pred>
+static bool host_wait(std::unique_lock<std::mutex> &lock,
+                      std::condition_variable &cv, TickType_t wait, Pred ready) {
+    if (ready()) {
+        return true;
+    }
+    if (wait == 0) {
+        return false;
+    }
+    if (task_count == 0 && wait == portMAX_DELAY) {
+        fprintf(stderr, "[HOST] Blocking forever with no other task\n");
+        abort();
+    }
+    if (wait == portMAX_DELAY) {
+        cv.wait(lock, ready);
+        return true;
+    }
+    return cv.wait_for(lock, std::chrono::milliseconds(wait), ready);
+}
+
+// === Critical sections ===
+static std::recursive_mutex critical_lock;
+
+void host_critical_enter(portMUX_TYPE *mux) {
+    critical_lock.lock();
+    mux->locked++;
+}
+
+void host_critical_exit(portMUX_TYPE *mux) {
+    mux->locked--;
+    critical_lock.unlock();
+}
+
+// === Tasks ===
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t)(host_local_us() / 1000);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    host_clock_advance_us((int64_t)ticks * 1000);
+    std::this_thread::yield();
+}
+
+void vTaskDelayUntil(TickType_t *prev_wake, TickType_t increment) {
+    TickType_t wake = *prev_wake + increment;
+    TickType_t now = xTaskGetTickCount();
+    if ((int32_t)(wake - now) > 0) {
+        vTaskDelay(wake - now);
+    }
+    *prev_wake = wake;
+}
+
+BaseType_t xPortGetCoreID(void) {
+    return 1; // Arduino loop core
+}
+
+BaseType_t xTaskCreatePinnedToCore(
+    TaskFunction_t fn, const char *name, uint32_t stack, void *param,
+    UBaseType_t priority, TaskHandle_t *handle, BaseType_t core
+) {
+    (void)stack;
+    (void)priority;
+    (void)core;
+    host_task *task = new host_task;
+    task->name = name ? name : "";
+    task_count++;
+    task->thread = std::thread(fn, param);
+    task->thread.detach();
+    if (handle) {
+        *handle = task;
+    }
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    (void)task; // Threads end when their function returns
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return nullptr;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    (void)task;
+    return 4096;
+}
+
+const char *pcTaskGetName(TaskHandle_t task) {
+    return task ? task->name.c_str() : "main";
+}
+
+// === Queues ===
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    host_queue *queue = new host_queue;
+    queue->length = length;
+    queue->item_size = item_size;
+    queue->is_mutex = false;
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t wait) {
+    std::unique_lock<std::mutex> lock(queue->lock);
+    if (!host_wait(lock, queue->changed, wait,
+                   [&] { return queue->items.size() < queue->length; })) {
+        return errQUEUE_FULL;
+    }
+    const uint8_t *bytes = (const uint8_t *)item;
+    queue->items.emplace_back(bytes, bytes + queue->item_size);
+    queue->changed.notify_all();
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t wait) {
+    std::unique_lock<std::mutex> lock(queue->lock);
+    if (!host_wait(lock, queue->changed, wait,
+                   [&] { return !queue->items.empty(); })) {
+        return pdFALSE;
+    }
+    if (item && queue->item_size) {
+        memcpy(item, queue->items.front().data(), queue->item_size);
+    }
+    queue->items.pop_front();
+    queue->changed.notify_all();
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> guard(queue->lock);
+    return (UBaseType_t)queue->items.size();
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> guard(queue->lock);
+    return (UBaseType_t)(queue->length - queue->items.size());
+}
+
+// === Mutexes ===
+// A FreeRTOS mutex is a one-item queue that starts full
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    host_queue *sem = xQueueCreate(1, 0);
+    sem->is_mutex = true;
+    sem->items.emplace_back();
+    return sem;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait) {
+    return xQueueReceive(sem, nullptr, wait);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    return xQueueSend(sem, nullptr, 0);
+}
+
+// === Event groups ===
+EventGroupHandle_t xEventGroupCreate(void) {
+    host_event_group *group = new host_event_group;
+    group->bits = 0;
+    return group;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> guard(group->lock);
+    group->bits |= bits;
+    group->changed.notify_all();
+    return group->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> guard(group->lock);
+    EventBits_t before = group->bits;
+    group->bits &= ~bits;
+    return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+    std::lock_guard<std::mutex> guard(group->lock);
+    return group->bits;
+}
+
+EventBits_t xEventGroupWaitBits(
+    EventGroupHandle_t group, EventBits_t bits, BaseType_t clear,
+    BaseType_t all, TickType_t wait
+) {
+    std::unique_lock<std::mutex> lock(group->lock);
+    auto ready = [&] {
+        return all ? (group->bits & bits) == bits : (group->bits & bits) != 0;
+    };
+    host_wait(lock, group->changed, wait, ready);
+    EventBits_t result = group->bits;
+    if (clear && ready()) {
+        group->bits &= ~bits;
+    }
+    return result;
+}
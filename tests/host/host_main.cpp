@@ -0,0 +1,270 @@
+#include "global.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "host_shims.h"
+
+// === Native firmware entry ===
+// Runs the unmodified setup() and loop() of main.cpp like the Arduino
+// core does, with every task on its own thread and the clock on wall
+// time. `--seconds N` stops after N seconds, for CI.
+//
+// The panel is the built-in stand-in, or whatever attaches to the pty
+// from `--pty`. `--script` plays touches and clock steps at set times,
+// `--state` rewrites a file every second with the clock, relay pins,
+// panel traffic and /metrics, and `--nvs` keeps NVS in a file.
+
+void setup(void);
+void loop(void);
+
+static const char *state_path = NULL;
+static const char *nvs_path = NULL;
+static FILE *script = NULL;
+static int64_t start_us = 0;
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [--seconds N] [--pty LINK] [--script FILE]\n"
+            "          [--state FILE] [--nvs FILE] [--rtc now|none|'YYYY-MM-DD HH:MM:SS']\n",
+            argv0);
+}
+
+// === Scripted panel traffic ===
+// One event per line, at seconds since boot, in order:
+//   2     touch 1100 1      0x83 upload of a switch or number VP
+//   5     text 1420 Grow    0x83 upload of text entry
+//   8     burst 1100 50     50 toggles at once, for queue depth
+//   60    warp 3600         Wall clock steps forward, as NTP would
+static double script_at = -1; // Seconds of the event read, -1 none
+static char script_cmd[16];
+static char script_args[128];
+
+static bool script_next(void) {
+    char line[160];
+    while (script && fgets(line, sizeof(line), script)) {
+        char *comment = strchr(line, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+        script_args[0] = '\0';
+        if (sscanf(line, "%lf %15s %127[^\n]", &script_at, script_cmd, script_args) >= 2) {
+            size_t len = strlen(script_args);
+            while (len > 0 && isspace((unsigned char)script_args[len - 1])) {
+                script_args[--len] = '\0';
+            }
+            return true;
+        }
+    }
+    script_at = -1;
+    return false;
+}
+
+static void panel_touch(uint16_t address, uint8_t value) {
+    const uint8_t frame[] = {
+        0x5A, 0xA5, 0x06, 0x83, (uint8_t)(address >> 8), (uint8_t)address, 0x01, 0x00, value
+    };
+    host_panel_input(frame, sizeof(frame));
+}
+
+// Text entry ends with FF FF, the length byte counts words
+static void panel_text(uint16_t address, const char *text) {
+    uint8_t frame[3 + 255];
+    size_t len = strlen(text); // At most 127, from script_args
+    size_t words = (len + 2 + 1) / 2;
+    frame[0] = 0x5A;
+    frame[1] = 0xA5;
+    frame[2] = (uint8_t)(4 + words * 2);
+    frame[3] = 0x83;
+    frame[4] = (uint8_t)(address >> 8);
+    frame[5] = (uint8_t)address;
+    frame[6] = (uint8_t)words;
+    memset(&frame[7], 0xFF, words * 2);
+    memcpy(&frame[7], text, len);
+    host_panel_input(frame, 7 + words * 2);
+}
+
+static void script_run(void) {
+    unsigned address = 0;
+    long value = 0;
+    char text[128] = "";
+
+    if (strcmp(script_cmd, "touch") == 0 &&
+        sscanf(script_args, "%x %ld", &address, &value) == 2) {
+        panel_touch(address, (uint8_t)value);
+
+    } else if (strcmp(script_cmd, "text") == 0 &&
+               sscanf(script_args, "%x %127[^\n]", &address, text) >= 1) {
+        panel_text(address, text);
+
+    } else if (strcmp(script_cmd, "burst") == 0 &&
+               sscanf(script_args, "%x %ld", &address, &value) == 2) {
+        uint8_t level = 0;
+        if (vp_lock()) {
+            level = vp_get_value(address);
+            vp_unlock();
+        }
+        for (long i = 0; i < value; i++) {
+            level ^= 1;
+            panel_touch(address, level);
+        }
+
+    } else if (strcmp(script_cmd, "warp") == 0 &&
+               sscanf(script_args, "%ld", &value) == 1) {
+        time_snapshot_t now;
+        if (time_now(&now)) {
+            time_set_epoch_us(((int64_t)now.epoch + value) * 1000000);
+        } else {
+            fprintf(stderr, "[HOST] warp %ld ignored, clock not set\n", value);
+        }
+
+    } else {
+        fprintf(stderr, "[HOST] Bad script line: %.1f %s %s\n", script_at, script_cmd,
+                script_args);
+    }
+}
+
+// === State file ===
+static void file_sink(const char *text, size_t len, void *ctx) {
+    fwrite(text, 1, len, (FILE *)ctx);
+}
+
+// Written aside and renamed, a reader never sees half a file
+static void state_write(void) {
+    char tmp[256];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", state_path);
+    FILE *f = fopen(tmp, "w");
+    if (!f) {
+        return;
+    }
+
+    time_snapshot_t now = {};
+    bool valid = time_now(&now);
+    host_panel_stats_t panel;
+    host_panel_stats(&panel);
+    const uint8_t pins[] = { LIGHT_RELAY, WATER_RELAY, FAN_RELAY, RELAY_PIN_4 };
+
+    fprintf(f, "# uptime_s %.3f\n", (host_clock_us() - start_us) / 1e6);
+    fprintf(f, "# epoch %lu %s, local %04u-%02u-%02u %02u:%02u:%02u\n",
+            valid ? (unsigned long)now.epoch : 0UL, valid ? "valid" : "invalid",
+            now.year, now.month, now.day, now.hours, now.minutes, now.seconds);
+    for (size_t i = 0; i < sizeof(pins); i++) {
+        fprintf(f, "# gpio %u %u\n", pins[i], host_gpio_level(pins[i]));
+    }
+    fprintf(f, "# panel tx %lu frames %lu bytes %lu dropped, rx %lu frames %lu bytes\n",
+            panel.tx_frames, panel.tx_bytes, panel.tx_dropped, panel.rx_frames,
+            panel.rx_bytes);
+    fprintf(f, "# hmi_queue %u\n", (unsigned)uxQueueMessagesWaiting(xHMIUpdateQueue));
+    metrics_write(file_sink, f);
+    fclose(f);
+    rename(tmp, state_path);
+
+    if (nvs_path) {
+        host_nvs_save(nvs_path);
+    }
+}
+
+// === Entry ===
+int main(int argc, char **argv) {
+    long seconds = 0; // Run until killed
+    const char *pty_link = NULL;
+    const char *rtc = "now";
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--pty") == 0 && i + 1 < argc) {
+            pty_link = argv[++i];
+        } else if (strcmp(argv[i], "--script") == 0 && i + 1 < argc) {
+            script = fopen(argv[++i], "r");
+            if (!script) {
+                perror(argv[i]);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--state") == 0 && i + 1 < argc) {
+            state_path = argv[++i];
+        } else if (strcmp(argv[i], "--nvs") == 0 && i + 1 < argc) {
+            nvs_path = argv[++i];
+        } else if (strcmp(argv[i], "--rtc") == 0 && i + 1 < argc) {
+            rtc = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (pty_link) {
+        const char *path = host_panel_open_pty(pty_link);
+        if (!path) {
+            perror("pty");
+            return 2;
+        }
+        printf("[HOST] Panel UART on %s (%s)\n", path, pty_link);
+    }
+
+    // Built-in panel RTC, local time like the real one
+    struct tm tm_rtc = {};
+    if (strcmp(rtc, "now") == 0) {
+        host_hmi_rtc_set((int64_t)time(NULL) + TIME_LOCAL_OFFSET);
+    } else if (strptime(rtc, "%Y-%m-%d %H:%M:%S", &tm_rtc)) {
+        host_hmi_rtc_set((int64_t)timegm(&tm_rtc));
+    } else if (strcmp(rtc, "none") != 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    // Broker stand-in where the firmware looks for it
+    if (!host_mqtt_listen(MQTT_BROKER, MQTT_BROKER_PORT)) {
+        fprintf(stderr, "[HOST] MQTT broker cannot listen on %s:%u\n", MQTT_BROKER,
+                MQTT_BROKER_PORT);
+    }
+
+    if (nvs_path && host_nvs_load(nvs_path)) {
+        printf("[HOST] NVS loaded from %s\n", nvs_path);
+    }
+
+    host_clock_set_realtime(true);
+    start_us = host_clock_us();
+    script_next();
+    setup();
+
+    int64_t end_us = start_us + (int64_t)seconds * 1000000;
+    int64_t next_state_us = start_us;
+    while (seconds == 0 || host_clock_us() < end_us) {
+        loop();
+
+        int64_t now_us = host_clock_us();
+        while (script_at >= 0 && now_us - start_us >= (int64_t)(script_at * 1e6)) {
+            script_run();
+            script_next();
+        }
+        if (state_path && now_us >= next_state_us) {
+            state_write();
+            next_state_us += 1000000;
+        }
+        delay(1); // The core's loopTask yields between calls
+    }
+
+    if (state_path) {
+        state_write();
+    } else if (nvs_path) {
+        host_nvs_save(nvs_path);
+    }
+
+    // Touch latency and panel traffic of the run
+    trace_print();
+    debug_flush();
+    host_panel_stats_t panel;
+    host_panel_stats(&panel);
+    printf("[HOST] Panel tx %lu frames (%.1f/s) %lu dropped, rx %lu frames\n",
+           panel.tx_frames, seconds > 0 ? (double)panel.tx_frames / seconds : 0.0,
+           panel.tx_dropped, panel.rx_frames);
+
+    // The watchdog would have reset the board, fail the run
+    bool expired = host_wdt_expired();
+    printf("[HOST] Stopped after %ld s, task watchdog %s\n", seconds,
+           expired ? "expired" : "fed");
+    fflush(stdout);
+    _exit(expired ? 1 : 0); // Task threads never return
+}
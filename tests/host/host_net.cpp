@@ -0,0 +1,586 @@
+#include <PubSubClient.h>
+#include <WiFiUdp.h>
+#include <arpa/inet.h>
+#include <chrono>
+#include <deque>
+#include <errno.h>
+#include <fcntl.h>
+#include <map>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <lwip/dns.h>
+#include "host_shims.h"
+
+// === Host name table ===
+static std::mutex net_lock;
+static std::map<std::string, uint16_t> net_hosts; // name -> loopback port
+static std::map<std::string, uint32_t> net_addrs; // name -> 127.0.1.x, kept
+static std::map<uint16_t, uint16_t> net_tcp_ports; // WiFiServer port -> bound
+
+void host_udp_map(const char *host, uint16_t port) {
+    std::lock_guard<std::mutex> guard(net_lock);
+    if (port) {
+        net_hosts[host] = port;
+        if (!net_addrs.count(host)) {
+            net_addrs[host] = (uint32_t)IPAddress(127, 0, 1, (uint8_t)(net_addrs.size() + 1));
+        }
+    } else {
+        net_hosts.erase(host);
+    }
+}
+
+// Loopback port of the mapped name holding `addr`, 0 if none
+static uint16_t net_port_of(uint32_t addr) {
+    for (const auto &entry : net_addrs) {
+        auto host = net_hosts.find(entry.first);
+        if (entry.second == addr && host != net_hosts.end()) {
+            return host->second;
+        }
+    }
+    return 0;
+}
+
+// === DNS ===
+typedef struct {
+    int64_t due_us;
+    std::string name;
+    dns_found_callback found;
+    void *arg;
+} DnsLookup;
+
+static std::deque<DnsLookup> dns_pending;
+static uint32_t dns_delay_ms = 0;
+static bool dns_thread_started = false;
+
+void host_dns_set_delay_ms(uint32_t ms) {
+    std::lock_guard<std::mutex> guard(net_lock);
+    dns_delay_ms = ms;
+}
+
+// Answers due lookups off the caller's thread, like lwIP's tcpip thread
+static void dns_thread(void) {
+    for (;;) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        std::unique_lock<std::mutex> guard(net_lock);
+        while (!dns_pending.empty() && host_clock_us() >= dns_pending.front().due_us) {
+            DnsLookup lookup = dns_pending.front();
+            dns_pending.pop_front();
+            ip_addr_t addr = {};
+            bool found = net_hosts.count(lookup.name) > 0;
+            if (found) {
+                addr.u_addr.ip4.addr = net_addrs[lookup.name];
+            }
+            guard.unlock();
+            lookup.found(lookup.name.c_str(), found ? &addr : NULL, lookup.arg);
+            guard.lock();
+        }
+    }
+}
+
+err_t dns_gethostbyname(const char *hostname, ip_addr_t *addr,
+                        dns_found_callback found, void *callback_arg) {
+    if (!hostname || !addr) {
+        return ERR_ARG;
+    }
+    std::lock_guard<std::mutex> guard(net_lock);
+
+    // No delay: answered from the cache, or failed outright
+    if (dns_delay_ms == 0) {
+        if (!net_hosts.count(hostname)) {
+            return ERR_VAL;
+        }
+        *addr = {};
+        addr->u_addr.ip4.addr = net_addrs[hostname];
+        return ERR_OK;
+    }
+
+    dns_pending.push_back({ host_clock_us() + (int64_t)dns_delay_ms * 1000, hostname,
+                            found, callback_arg });
+    if (!dns_thread_started) {
+        dns_thread_started = true;
+        std::thread(dns_thread).detach();
+    }
+    return ERR_INPROGRESS;
+}
+
+// === WiFiUDP ===
+uint8_t WiFiUDP::begin(uint16_t port) {
+    stop();
+    fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd_ < 0) {
+        return 0;
+    }
+    fcntl(fd_, F_SETFL, O_NONBLOCK);
+
+    // Fixed ports may collide between test runs, fall back to any port
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (bind(fd_, (sockaddr *)&addr, sizeof(addr)) < 0) {
+        addr.sin_port = 0;
+        bind(fd_, (sockaddr *)&addr, sizeof(addr));
+    }
+    return 1;
+}
+
+void WiFiUDP::stop() {
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+    rx_.clear();
+    rx_pos_ = 0;
+}
+
+int WiFiUDP::beginPacket(const char *host, uint16_t port) {
+    (void)port; // Every mapped host is a loopback port
+    std::lock_guard<std::mutex> guard(net_lock);
+    auto it = net_hosts.find(host);
+    if (it == net_hosts.end()) {
+        return 0;
+    }
+    dest_ip_ = htonl(INADDR_LOOPBACK);
+    dest_port_ = it->second;
+    tx_.clear();
+    return 1;
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port) {
+    std::lock_guard<std::mutex> guard(net_lock);
+    uint16_t mapped = net_port_of((uint32_t)ip);
+    dest_ip_ = mapped ? htonl(INADDR_LOOPBACK) : (uint32_t)ip;
+    dest_port_ = mapped ? mapped : port;
+    tx_.clear();
+    return 1;
+}
+
+size_t WiFiUDP::write(const uint8_t *buf, size_t len) {
+    tx_.append((const char *)buf, len);
+    return len;
+}
+
+int WiFiUDP::endPacket() {
+    if (fd_ < 0 || dest_port_ == 0) {
+        return 0;
+    }
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = dest_ip_;
+    addr.sin_port = htons(dest_port_);
+    ssize_t sent = sendto(fd_, tx_.data(), tx_.size(), 0, (sockaddr *)&addr, sizeof(addr));
+    tx_.clear();
+    return sent >= 0 ? 1 : 0;
+}
+
+int WiFiUDP::parsePacket() {
+    if (fd_ < 0) {
+        return 0;
+    }
+    char buf[1500];
+    sockaddr_in from = {};
+    socklen_t from_len = sizeof(from);
+    ssize_t len = recvfrom(fd_, buf, sizeof(buf), 0, (sockaddr *)&from, &from_len);
+    if (len <= 0) {
+        return 0;
+    }
+    rx_.assign(buf, len);
+    rx_pos_ = 0;
+    remote_ip_ = IPAddress((uint32_t)from.sin_addr.s_addr);
+    remote_port_ = ntohs(from.sin_port);
+    return (int)len;
+}
+
+int WiFiUDP::read(uint8_t *buf, size_t len) {
+    size_t n = rx_.size() - rx_pos_;
+    if (n > len) {
+        n = len;
+    }
+    memcpy(buf, rx_.data() + rx_pos_, n);
+    rx_pos_ += n;
+    return (int)n;
+}
+
+// === WiFiClient ===
+struct HostSocket {
+    int fd;
+    explicit HostSocket(int f) : fd(f) {}
+    ~HostSocket() { close(fd); }
+};
+
+WiFiClient::WiFiClient(int fd) : sock_(std::make_shared<HostSocket>(fd)) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    // Send buffer of lwIP's default TCP_SND_BUF (4 MSS), Linux doubles it
+    int sndbuf = 5744 / 2;
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+}
+
+uint8_t WiFiClient::connected() {
+    if (!sock_) {
+        return 0;
+    }
+    // Data still unread counts as connected, like the ESP32 class
+    char c;
+    ssize_t n = recv(sock_->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    return (n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))) ? 1 : 0;
+}
+
+int WiFiClient::available() {
+    int n = 0;
+    if (!sock_ || ioctl(sock_->fd, FIONREAD, &n) < 0) {
+        return 0;
+    }
+    return n;
+}
+
+int WiFiClient::read(uint8_t *buf, size_t size) {
+    if (!sock_) {
+        return -1;
+    }
+    ssize_t n = recv(sock_->fd, buf, size, MSG_DONTWAIT);
+    return n > 0 ? (int)n : -1;
+}
+
+size_t WiFiClient::write(const uint8_t *buf, size_t size) {
+    size_t sent = 0;
+    while (sock_ && sent < size) {
+        ssize_t n = send(sock_->fd, buf + sent, size - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            break; // Peer gone
+        }
+        sent += n;
+    }
+    return sent;
+}
+
+void WiFiClient::stop() {
+    sock_.reset();
+}
+
+int WiFiClient::fd() const {
+    return sock_ ? sock_->fd : -1;
+}
+
+// === WiFiServer ===
+uint16_t host_tcp_port(uint16_t port) {
+    std::lock_guard<std::mutex> guard(net_lock);
+    auto it = net_tcp_ports.find(port);
+    return it == net_tcp_ports.end() ? 0 : it->second;
+}
+
+void WiFiServer::begin(uint16_t port) {
+    if (port) {
+        port_ = port;
+    }
+    stop();
+    fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd_ < 0) {
+        return;
+    }
+    int one = 1;
+    setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port_);
+    if (bind(fd_, (sockaddr *)&addr, sizeof(addr)) < 0) {
+        addr.sin_port = 0;
+        bind(fd_, (sockaddr *)&addr, sizeof(addr));
+    }
+    listen(fd_, 16);
+    fcntl(fd_, F_SETFL, O_NONBLOCK);
+
+    socklen_t len = sizeof(addr);
+    getsockname(fd_, (sockaddr *)&addr, &len);
+    std::lock_guard<std::mutex> guard(net_lock);
+    net_tcp_ports[port_] = ntohs(addr.sin_port);
+}
+
+WiFiClient WiFiServer::available() {
+    if (fd_ < 0) {
+        return WiFiClient();
+    }
+    int fd = accept(fd_, NULL, NULL);
+    return fd < 0 ? WiFiClient() : WiFiClient(fd);
+}
+
+bool WiFiServer::hasClient() {
+    pollfd p = { fd_, POLLIN, 0 };
+    return fd_ >= 0 && poll(&p, 1, 0) > 0;
+}
+
+void WiFiServer::stop() {
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+// === MQTT broker ===
+struct MqttSession {
+    std::string will_topic;
+    std::string will_msg;
+    bool will_retain;
+};
+
+static bool mqtt_up = true;
+static unsigned long mqtt_next_session = 1;
+static std::map<unsigned long, MqttSession> mqtt_sessions;
+static std::deque<std::pair<std::string, std::string>> mqtt_inbox;
+static host_mqtt_hook_t mqtt_hook = NULL;
+static void *mqtt_hook_ctx = NULL;
+static host_mqtt_stats_t mqtt_stats = {};
+
+// TCP listener the firmware connects to, open while the broker is up.
+// Sessions still run in process, the sockets only carry the handshake
+// and the loss of the connection.
+static sockaddr_in mqtt_listen_addr = {}; // sin_port 0 until host_mqtt_listen()
+static int mqtt_listen_fd = -1;
+static std::vector<int> mqtt_peers;       // Broker ends of accepted connections
+
+static void mqtt_listen_open(void) {
+    if (mqtt_listen_fd >= 0 || mqtt_listen_addr.sin_port == 0) {
+        return;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, (sockaddr *)&mqtt_listen_addr, sizeof(mqtt_listen_addr)) < 0 ||
+        listen(fd, 4) < 0) {
+        close(fd);
+        return;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    mqtt_listen_fd = fd;
+}
+
+// Refuses new connections and resets the open ones
+static void mqtt_listen_close(void) {
+    if (mqtt_listen_fd >= 0) {
+        close(mqtt_listen_fd);
+        mqtt_listen_fd = -1;
+    }
+    for (int fd : mqtt_peers) {
+        close(fd);
+    }
+    mqtt_peers.clear();
+}
+
+static void mqtt_accept(void) {
+    int fd;
+    while (mqtt_listen_fd >= 0 && (fd = accept(mqtt_listen_fd, NULL, NULL)) >= 0) {
+        mqtt_peers.push_back(fd);
+    }
+}
+
+bool host_mqtt_listen(const char *host, uint16_t port) {
+    host_udp_map(host, port); // Gives the name an address of its own
+    mqtt_listen_close();
+    {
+        std::lock_guard<std::mutex> guard(net_lock);
+        mqtt_listen_addr.sin_family = AF_INET;
+        mqtt_listen_addr.sin_port = htons(port);
+        mqtt_listen_addr.sin_addr.s_addr = net_addrs[host];
+    }
+    if (mqtt_up) {
+        mqtt_listen_open();
+    }
+    return !mqtt_up || mqtt_listen_fd >= 0;
+}
+
+static void mqtt_emit(const std::string &topic, const uint8_t *payload, size_t len, bool retained) {
+    if (mqtt_hook) {
+        mqtt_hook(topic.c_str(), payload, len, retained, mqtt_hook_ctx);
+    }
+}
+
+void host_mqtt_set_hook(host_mqtt_hook_t hook, void *ctx) {
+    mqtt_hook = hook;
+    mqtt_hook_ctx = ctx;
+}
+
+void host_mqtt_set_broker(bool up) {
+    mqtt_up = up;
+    if (up) {
+        mqtt_listen_open();
+        return;
+    }
+    mqtt_listen_close();
+    // Dropped sessions publish their will, as on a keepalive timeout
+    std::map<unsigned long, MqttSession> dropped;
+    dropped.swap(mqtt_sessions);
+    for (const auto &entry : dropped) {
+        const MqttSession &session = entry.second;
+        if (!session.will_topic.empty()) {
+            mqtt_emit(session.will_topic, (const uint8_t *)session.will_msg.data(),
+                      session.will_msg.size(), session.will_retain);
+        }
+    }
+}
+
+void host_mqtt_inject(const char *topic, const char *payload) {
+    mqtt_inbox.emplace_back(topic, payload);
+}
+
+void host_mqtt_stats(host_mqtt_stats_t *stats) {
+    *stats = mqtt_stats;
+}
+
+void host_mqtt_reset(void) {
+    mqtt_up = true;
+    mqtt_listen_open();
+    mqtt_sessions.clear();
+    mqtt_inbox.clear();
+    mqtt_stats = {};
+}
+
+// Topic filter match with the + and # wildcards
+static bool mqtt_match(const std::string &filter, const std::string &topic) {
+    size_t f = 0, t = 0;
+    while (f < filter.size()) {
+        if (filter[f] == '#') {
+            return true;
+        }
+        if (filter[f] == '+') {
+            while (t < topic.size() && topic[t] != '/') {
+                t++;
+            }
+            f++;
+            continue;
+        }
+        if (t >= topic.size() || filter[f] != topic[t]) {
+            return false;
+        }
+        f++;
+        t++;
+    }
+    return t == topic.size();
+}
+
+// === PubSubClient ===
+PubSubClient &PubSubClient::setServer(const char *domain, uint16_t port) {
+    (void)domain;
+    (void)port;
+    return *this;
+}
+
+bool PubSubClient::connect(const char *id) {
+    return connect(id, NULL, 0, false, NULL);
+}
+
+bool PubSubClient::connect(const char *id, const char *willTopic, uint8_t willQos,
+                           bool willRetain, const char *willMessage) {
+    (void)id;
+    (void)willQos;
+    if (session_) {
+        mqtt_sessions.erase(session_);
+        session_ = 0;
+    }
+    // The library would connect a closed client itself, blocking
+    mqtt_accept();
+    if (!client_ || !client_->connected()) {
+        state_ = MQTT_CONNECT_FAILED;
+        return false;
+    }
+    if (!mqtt_up) {
+        client_->stop();
+        state_ = MQTT_CONNECTION_TIMEOUT;
+        return false;
+    }
+    session_ = mqtt_next_session++;
+    MqttSession &session = mqtt_sessions[session_];
+    session.will_topic = willTopic ? willTopic : "";
+    session.will_msg = willMessage ? willMessage : "";
+    session.will_retain = willRetain;
+    subs_.clear();
+    state_ = MQTT_CONNECTED;
+    mqtt_stats.connects++;
+    return true;
+}
+
+void PubSubClient::disconnect() {
+    // A clean DISCONNECT discards the will
+    if (session_) {
+        mqtt_sessions.erase(session_);
+        session_ = 0;
+    }
+    if (client_) {
+        client_->stop();
+    }
+    state_ = MQTT_DISCONNECTED;
+}
+
+bool PubSubClient::connected() {
+    if (session_ && (!mqtt_sessions.count(session_) || !client_->connected())) {
+        mqtt_sessions.erase(session_);
+        session_ = 0;
+        client_->stop();
+        state_ = MQTT_CONNECTION_LOST;
+    }
+    return session_ != 0;
+}
+
+bool PubSubClient::publish(const char *topic, const char *payload, bool retained) {
+    return publish(topic, (const uint8_t *)payload, strlen(payload), retained);
+}
+
+bool PubSubClient::publish(const char *topic, const uint8_t *payload, unsigned int length,
+                           bool retained) {
+    // The library builds the whole packet in its buffer
+    size_t packet = MQTT_MAX_HEADER_SIZE + 2 + strlen(topic) + length;
+    if (!connected() || packet > buffer_size_) {
+        return false;
+    }
+    mqtt_stats.publishes++;
+    mqtt_stats.bytes += length;
+    mqtt_emit(topic, payload, length, retained);
+    return true;
+}
+
+bool PubSubClient::subscribe(const char *topic, uint8_t qos) {
+    (void)qos;
+    if (!connected()) {
+        return false;
+    }
+    subs_.insert(topic);
+    return true;
+}
+
+bool PubSubClient::loop() {
+    if (!connected()) {
+        return false;
+    }
+    for (auto it = mqtt_inbox.begin(); it != mqtt_inbox.end();) {
+        bool wanted = false;
+        for (const std::string &filter : subs_) {
+            wanted = wanted || mqtt_match(filter, it->first);
+        }
+        if (!wanted) {
+            ++it;
+            continue;
+        }
+        std::string topic = it->first;
+        std::string payload = it->second;
+        it = mqtt_inbox.erase(it);
+        mqtt_stats.delivered++;
+        if (callback_) {
+            callback_(&topic[0], (uint8_t *)&payload[0], payload.size());
+        }
+        // The callback may have disconnected
+        if (!connected()) {
+            return false;
+        }
+        it = mqtt_inbox.begin();
+    }
+    return true;
+}
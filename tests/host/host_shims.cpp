@@ -0,0 +1,1200 @@
+#include <Arduino.h>
+#include <DWIN.h>
+#include <Preferences.h>
+#include <esp_netif.h>
+#include <esp_partition.h>
+#include <esp_system.h>
+#include <esp_task_wdt.h>
+#include <WiFi.h>
+#include <WiFiManager.h>
+#include <ESPmDNS.h>
+#include <ArduinoOTA.h>
+#include <lwip/dhcp.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <time.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include "host_shims.h"
+
+// === Virtual clock ===
+// clock_us is true time. The board's own timers (esp_timer, millis,
+// ticks) follow local_us, which runs `drift_ppm` fast or slow. In real
+// time both also run on the wall clock since `realtime_start`, and an
+// advance sleeps instead.
+static std::mutex clock_lock;
+static int64_t clock_us = 0;
+static double local_us = 0;
+static double drift_ppm = 0;
+static bool realtime = false;
+static std::chrono::steady_clock::time_point realtime_start;
+
+// Wall time since the last rebase, 0 on the virtual clock
+static int64_t realtime_elapsed_us(void) {
+    if (!realtime) {
+        return 0;
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - realtime_start).count();
+}
+
+// Folds the elapsed wall time into the clock, call with clock_lock held
+static void realtime_rebase(void) {
+    int64_t elapsed = realtime_elapsed_us();
+    clock_us += elapsed;
+    local_us += elapsed * (1.0 + drift_ppm * 1e-6);
+    realtime_start = std::chrono::steady_clock::now();
+}
+
+void host_clock_set_us(int64_t us) {
+    std::lock_guard<std::mutex> guard(clock_lock);
+    clock_us = us;
+    local_us = (double)us;
+    realtime_start = std::chrono::steady_clock::now();
+}
+
+void host_clock_advance_us(int64_t us) {
+    {
+        std::lock_guard<std::mutex> guard(clock_lock);
+        if (!realtime) {
+            clock_us += us;
+            local_us += us * (1.0 + drift_ppm * 1e-6);
+            return;
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void host_clock_set_drift_ppm(double ppm) {
+    std::lock_guard<std::mutex> guard(clock_lock);
+    realtime_rebase();
+    drift_ppm = ppm;
+}
+
+void host_clock_set_realtime(bool on) {
+    std::lock_guard<std::mutex> guard(clock_lock);
+    realtime_rebase();
+    realtime = on;
+}
+
+int64_t host_clock_us(void) {
+    std::lock_guard<std::mutex> guard(clock_lock);
+    return clock_us + realtime_elapsed_us();
+}
+
+int64_t host_local_us(void) {
+    std::lock_guard<std::mutex> guard(clock_lock);
+    return (int64_t)(local_us + realtime_elapsed_us() * (1.0 + drift_ppm * 1e-6));
+}
+
+int64_t esp_timer_get_time(void) {
+    return host_local_us();
+}
+
+unsigned long millis(void) {
+    return (unsigned long)(host_local_us() / 1000);
+}
+
+unsigned long micros(void) {
+    return (unsigned long)host_local_us();
+}
+
+void delay(uint32_t ms) {
+    host_clock_advance_us((int64_t)ms * 1000);
+}
+
+void yield(void) {}
+
+uint32_t esp_random(void) {
+    return (uint32_t)rand() ^ ((uint32_t)rand() << 16);
+}
+
+// === GPIO ===
+static uint8_t gpio_levels[40];
+static host_gpio_hook_t gpio_hook = nullptr;
+static void *gpio_hook_ctx = nullptr;
+
+void host_gpio_set_hook(host_gpio_hook_t hook, void *ctx) {
+    gpio_hook = hook;
+    gpio_hook_ctx = ctx;
+}
+
+uint8_t host_gpio_level(uint8_t pin) {
+    return pin < sizeof(gpio_levels) ? gpio_levels[pin] : 0;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    (void)pin;
+    (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    if (pin >= sizeof(gpio_levels)) {
+        return;
+    }
+    gpio_levels[pin] = val ? HIGH : LOW;
+    if (gpio_hook) {
+        gpio_hook(pin, gpio_levels[pin], gpio_hook_ctx);
+    }
+}
+
+int digitalRead(uint8_t pin) {
+    return host_gpio_level(pin);
+}
+
+// === Serial ports ===
+static bool serial_quiet = false;
+
+HardwareSerial Serial(0);
+HardwareSerial Serial2(2);
+
+static std::mutex serial_lock;
+static std::string serial_input;
+static host_serial_hook_t serial_hook = NULL;
+static void *serial_hook_ctx = NULL;
+
+void host_serial_quiet(bool quiet) {
+    serial_quiet = quiet;
+}
+
+void host_serial_input(const char *text) {
+    std::lock_guard<std::mutex> guard(serial_lock);
+    serial_input += text;
+}
+
+void host_serial_set_hook(host_serial_hook_t hook, void *ctx) {
+    serial_hook = hook;
+    serial_hook_ctx = ctx;
+}
+
+static void host_panel_tx(const uint8_t *buf, size_t len);
+
+size_t HardwareSerial::write(const uint8_t *buf, size_t len) {
+    if (num_ == 0 && serial_hook) {
+        serial_hook((const char *)buf, len, serial_hook_ctx);
+    }
+    if (num_ == 0 && !serial_quiet) {
+        fwrite(buf, 1, len, stdout);
+    } else if (num_ == 2) {
+        host_panel_tx(buf, len); // Raw frames to the panel
+    }
+    return len;
+}
+
+size_t HardwareSerial::printf(const char *fmt, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    if (len < 0) {
+        return 0;
+    }
+    if ((size_t)len >= sizeof(buf)) {
+        len = sizeof(buf) - 1;
+    }
+    return write((const uint8_t *)buf, len);
+}
+
+int HardwareSerial::available() {
+    std::lock_guard<std::mutex> guard(serial_lock);
+    return num_ == 0 ? (int)serial_input.size() : 0;
+}
+
+int HardwareSerial::read() {
+    std::lock_guard<std::mutex> guard(serial_lock);
+    if (num_ != 0 || serial_input.empty()) {
+        return -1;
+    }
+    int c = (uint8_t)serial_input[0];
+    serial_input.erase(0, 1);
+    return c;
+}
+
+int HardwareSerial::peek() {
+    std::lock_guard<std::mutex> guard(serial_lock);
+    return num_ == 0 && !serial_input.empty() ? (uint8_t)serial_input[0] : -1;
+}
+
+// === ESP chip helpers ===
+EspClass ESP;
+
+uint32_t EspClass::getCycleCount() {
+    return (uint32_t)(host_local_us() * 240); // 240 MHz core
+}
+
+void EspClass::restart() {
+    fprintf(stderr, "[HOST] ESP.restart() called\n");
+    exit(3);
+}
+
+// === Radio and OTA singletons ===
+WiFiClass WiFi;
+
+// === Emulated access point ===
+// One AP with a fixed BSSID and channel. A connect costs scan + assoc +
+// DHCP time, a begin() aimed at a BSSID skips the scan and a static
+// config skips DHCP.
+#define HOST_WIFI_MAX_HANDLERS 4
+#define HOST_WIFI_LEASE_IP IPAddress(192, 168, 1, 50)
+#define HOST_WIFI_GATEWAY IPAddress(192, 168, 1, 1)
+#define HOST_WIFI_SUBNET IPAddress(255, 255, 255, 0)
+
+static std::recursive_mutex wifi_lock;
+static WiFiEventFuncCb wifi_handlers[HOST_WIFI_MAX_HANDLERS];
+static bool wifi_ap_up = false;
+static uint8_t wifi_ap_bssid[6] = { 0x24, 0x0A, 0xC4, 0x12, 0x34, 0x56 };
+static uint8_t wifi_ap_channel = 6;
+static uint32_t wifi_scan_ms = 0;
+static uint32_t wifi_assoc_ms = 0;
+static uint32_t wifi_dhcp_ms = 0;
+static IPAddress wifi_static_ip;    // 0 = DHCP
+static IPAddress wifi_static_gw;
+static IPAddress wifi_static_mask;
+static IPAddress wifi_static_dns;
+static int8_t wifi_rssi = -60;
+static uint32_t wifi_lease_s = HOST_WIFI_LEASE_S; // Next lease granted
+static uint32_t wifi_bound_lease_s = 0; // Lease of the current address
+static bool wifi_connected = false;
+static bool wifi_pending = false;   // Outcome of begin() not delivered yet
+static bool wifi_pending_direct = false; // begin() named a BSSID
+static uint8_t wifi_pending_bssid[6];
+static uint8_t wifi_pending_channel = 0;
+static int64_t wifi_pending_us = 0; // Local time it becomes due
+static bool wifi_renew = false;     // DHCP started on a connected link
+static int64_t wifi_renew_us = 0;
+static std::vector<std::pair<WiFiEvent_t, uint8_t>> wifi_events;
+static host_wifi_stats_t wifi_stats;
+
+static void host_wifi_post(WiFiEvent_t event, uint8_t reason) {
+    wifi_events.emplace_back(event, reason);
+}
+
+static void host_wifi_drop(uint8_t reason) {
+    if (wifi_connected) {
+        wifi_connected = false;
+        wifi_renew = false;
+        host_wifi_post(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, reason);
+    }
+}
+
+void host_wifi_set_ap(bool up, uint32_t connect_ms) {
+    std::lock_guard<std::recursive_mutex> guard(wifi_lock);
+    wifi_ap_up = up;
+    wifi_scan_ms = 0;
+    wifi_assoc_ms = connect_ms;
+    wifi_dhcp_ms = 0;
+    if (!up) {
+        host_wifi_drop(WIFI_REASON_BEACON_TIMEOUT);
+    }
+}
+
+void host_wifi_set_timing(uint32_t scan_ms, uint32_t assoc_ms, uint32_t dhcp_ms) {
+    std::lock_guard<std::recursive_mutex> guard(wifi_lock);
+    wifi_scan_ms = scan_ms;
+    wifi_assoc_ms = assoc_ms;
+    wifi_dhcp_ms = dhcp_ms;
+}
+
+void host_wifi_set_bssid(const uint8_t bssid[6], uint8_t channel) {
+    std::lock_guard<std::recursive_mutex> guard(wifi_lock);
+    memcpy(wifi_ap_bssid, bssid, sizeof(wifi_ap_bssid));
+    wifi_ap_channel = channel;
+    host_wifi_drop(WIFI_REASON_BEACON_TIMEOUT);
+}
+
+void host_wifi_set_rssi(int8_t dbm) {
+    std::lock_guard<std::recursive_mutex> guard(wifi_lock);
+    wifi_rssi = dbm;
+}
+
+void host_wifi_set_lease(uint32_t lease_s) {
+    std::lock_guard<std::recursive_mutex> guard(wifi_lock);
+    wifi_lease_s = lease_s;
+}
+
+void host_wifi_stats(host_wifi_stats_t *stats) {
+    std::lock_guard<std::recursive_mutex> guard(wifi_lock);
+    *stats = wifi_stats;
+}
+
+void host_wifi_service(void) {
+    std::vector<std::pair<WiFiEvent_t, uint8_t>> due;
+    WiFiEventFuncCb handlers[HOST_WIFI_MAX_HANDLERS];
+    {
+        std::lock_guard<std::recursive_mutex> guard(wifi_lock);
+        if (wifi_pending && host_local_us() >= wifi_pending_us) {
+            wifi_pending = false;
+            bool found = wifi_ap_up &&
+                (!wifi_pending_direct ||
+                 (memcmp(wifi_pending_bssid, wifi_ap_bssid, 6) == 0 &&
+                  wifi_pending_channel == wifi_ap_channel));
+            if (found) {
+                wifi_connected = true;
+                wifi_bound_lease_s = (uint32_t)wifi_static_ip == 0 ? wifi_lease_s : 0;
+                host_wifi_post(ARDUINO_EVENT_WIFI_STA_CONNECTED, 0);
+                host_wifi_post(ARDUINO_EVENT_WIFI_STA_GOT_IP, 0);
+            } else {
+                host_wifi_post(ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+                               WIFI_REASON_NO_AP_FOUND);
+            }
+        }
+        if (wifi_renew && host_local_us() >= wifi_renew_us) {
+            wifi_renew = false;
+            wifi_bound_lease_s = wifi_lease_s;
+            host_wifi_post(ARDUINO_EVENT_WIFI_STA_GOT_IP, 0);
+        }
+        due.swap(wifi_events);
+        memcpy(handlers, wifi_handlers, sizeof(handlers));
+    }
+
+    // Outside the lock, handlers may call back into WiFi
+    for (const auto &evt : due) {
+        WiFiEventInfo_t info;
+        memset(&info, 0, sizeof(info));
+        info.wifi_sta_disconnected.reason = evt.second;
+        for (WiFiEventFuncCb cb : handlers) {
+            if (cb) {
+                cb(evt.first, info);
+            }
+        }
+    }
+}
+
+// === DHCP client of the station ===
+struct esp_netif_obj {
+    int unused;
+};
+
+static esp_netif_t wifi_sta_netif;
+static struct dhcp wifi_dhcp;
+
+esp_netif_t *esp_netif_get_handle_from_ifkey(const char *if_key) {
+    return strcmp(if_key, "WIFI_STA_DEF") == 0 ? &wifi_sta_netif : nullptr;
+}
+
+void *esp_netif_get_netif_impl(esp_netif_t *esp_netif) {
+    return esp_netif;
+}
+
+// Bound on a leased address, not on a static one or while renewing
+struct dhcp *netif_dhcp_data(struct netif *netif) {
+    std::lock_guard<std::recursive_mutex> guard(wifi_lock);
+    bool bound = wifi_connected && (uint32_t)wifi_static_ip == 0 && !wifi_renew;
+    wifi_dhcp.state = bound ? DHCP_STATE_BOUND : DHCP_STATE_OFF;
+    wifi_dhcp.offered_t0_lease = bound ? wifi_bound_lease_s : 0;
+    return &wifi_dhcp;
+}
+
+wl_status_t WiFiClass::begin(const char *ssid, const char *pass,
+                             int32_t channel, const uint8_t *bssid, bool connect) {
+    (void)ssid;
+    (void)pass;
+    if (!connect) {
+        return WL_DISCONNECTED;
+    }
+
+    std::lock_guard<std::recursive_mutex> guard(wifi_lock);
+    bool direct = bssid != nullptr && channel > 0;
+    bool dhcp = (uint32_t)wifi_static_ip == 0;
+    uint32_t ms = wifi_assoc_ms;
+
+    wifi_stats.begins++;
+    if (!direct) {
+        wifi_stats.scans++;
+        ms += wifi_scan_ms;
+    }
+    if (dhcp) {
+        wifi_stats.dhcp_requests++;
+        ms += wifi_dhcp_ms;
+    }
+
+    wifi_connected = false;
+    wifi_renew = false;
+    wifi_pending = true;
+    wifi_pending_direct = direct;
+    if (direct) {
+        memcpy(wifi_pending_bssid, bssid, sizeof(wifi_pending_bssid));
+        wifi_pending_channel = (uint8_t)channel;
+    }
+    wifi_pending_us = host_local_us() + (int64_t)ms * 1000;
+    return WL_DISCONNECTED;
+}
+
+bool WiFiClass::config(IPAddress local_ip, IPAddress gateway, IPAddress subnet,
+                       IPAddress dns1) {
+    std::lock_guard<std::recursive_mutex> guard(wifi_lock);
+    bool was_static = (uint32_t)wifi_static_ip != 0;
+    wifi_static_ip = local_ip;
+    wifi_static_gw = gateway;
+    wifi_static_mask = subnet;
+    wifi_static_dns = dns1;
+
+    // Back to DHCP on a connected link, the client starts right away
+    if (was_static && (uint32_t)local_ip == 0 && wifi_connected) {
+        wifi_stats.dhcp_requests++;
+        wifi_renew = true;
+        wifi_renew_us = host_local_us() + (int64_t)wifi_dhcp_ms * 1000;
+    }
+    return true;
+}
+
+bool WiFiClass::disconnect(bool wifioff) {
+    (void)wifioff;
+    std::lock_guard<std::recursive_mutex> guard(wifi_lock);
+    if (wifi_connected || wifi_pending) {
+        host_wifi_post(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_ASSOC_LEAVE);
+    }
+    wifi_connected = false;
+    wifi_pending = false;
+    wifi_renew = false;
+    return true;
+}
+
+wl_status_t WiFiClass::status() {
+    std::lock_guard<std::recursive_mutex> guard(wifi_lock);
+    return wifi_connected ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+IPAddress WiFiClass::localIP() {
+    std::lock_guard<std::recursive_mutex> guard(wifi_lock);
+    if (!wifi_connected) {
+        return IPAddress();
+    }
+    return (uint32_t)wifi_static_ip ? wifi_static_ip : HOST_WIFI_LEASE_IP;
+}
+
+IPAddress WiFiClass::gatewayIP() {
+    std::lock_guard<std::recursive_mutex> guard(wifi_lock);
+    if (!wifi_connected) {
+        return IPAddress();
+    }
+    return (uint32_t)wifi_static_ip ? wifi_static_gw : HOST_WIFI_GATEWAY;
+}
+
+IPAddress WiFiClass::subnetMask() {
+    std::lock_guard<std::recursive_mutex> guard(wifi_lock);
+    if (!wifi_connected) {
+        return IPAddress();
+    }
+    return (uint32_t)wifi_static_ip ? wifi_static_mask : HOST_WIFI_SUBNET;
+}
+
+IPAddress WiFiClass::dnsIP(uint8_t dns_no) {
+    (void)dns_no;
+    std::lock_guard<std::recursive_mutex> guard(wifi_lock);
+    if (!wifi_connected) {
+        return IPAddress();
+    }
+    return (uint32_t)wifi_static_ip ? wifi_static_dns : HOST_WIFI_GATEWAY;
+}
+
+uint8_t *WiFiClass::BSSID() {
+    std::lock_guard<std::recursive_mutex> guard(wifi_lock);
+    if (!wifi_connected) {
+        return nullptr;
+    }
+    memcpy(bssid_, wifi_ap_bssid, sizeof(bssid_));
+    return bssid_;
+}
+
+int8_t WiFiClass::RSSI() {
+    std::lock_guard<std::recursive_mutex> guard(wifi_lock);
+    return wifi_connected ? wifi_rssi : 0;
+}
+
+int32_t WiFiClass::channel() {
+    std::lock_guard<std::recursive_mutex> guard(wifi_lock);
+    return wifi_connected ? wifi_ap_channel : 0;
+}
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventFuncCb cb) {
+    std::lock_guard<std::recursive_mutex> guard(wifi_lock);
+    for (int i = 0; i < HOST_WIFI_MAX_HANDLERS; i++) {
+        if (!wifi_handlers[i]) {
+            wifi_handlers[i] = cb;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+// === Provisioning portal ===
+static std::mutex portal_lock;
+static uint8_t portal_stations = 0;
+static bool portal_posted = false;
+static std::string portal_ssid;
+static std::string portal_pswd;
+static host_portal_stats_t portal_stats;
+
+void host_portal_join(uint8_t stations) {
+    std::lock_guard<std::mutex> guard(portal_lock);
+    portal_stations = stations;
+}
+
+void host_portal_submit(const char *ssid, const char *pswd) {
+    std::lock_guard<std::mutex> guard(portal_lock);
+    portal_ssid = ssid;
+    portal_pswd = pswd;
+    portal_posted = true;
+}
+
+void host_portal_stats(host_portal_stats_t *stats) {
+    std::lock_guard<std::mutex> guard(portal_lock);
+    *stats = portal_stats;
+}
+
+uint8_t WiFiClass::softAPgetStationNum() {
+    std::lock_guard<std::mutex> guard(portal_lock);
+    return portal_stations;
+}
+
+String HostPortalServer::arg(const char *name) {
+    std::lock_guard<std::mutex> guard(portal_lock);
+    if (strcmp(name, "s") == 0) {
+        return String(portal_ssid.c_str());
+    }
+    if (strcmp(name, "p") == 0) {
+        return String(portal_pswd.c_str());
+    }
+    return String();
+}
+
+bool WiFiManager::startConfigPortal(const char *ssid, const char *pass) {
+    (void)ssid;
+    (void)pass;
+    WiFi.mode(WIFI_AP_STA);
+    active_ = true;
+    start_ms_ = millis();
+    std::lock_guard<std::mutex> guard(portal_lock);
+    portal_posted = false;
+    portal_stats.active = true;
+    portal_stats.opens++;
+    return false; // Non-blocking: not configured yet
+}
+
+bool WiFiManager::process() {
+    bool posted;
+    {
+        std::lock_guard<std::mutex> guard(portal_lock);
+        portal_stats.processed++;
+        posted = portal_posted;
+        portal_posted = false;
+
+        // Like the library, a joined phone restarts the timeout
+        if (portal_stations > 0) {
+            start_ms_ = millis();
+        }
+    }
+    if (!active_) {
+        return false;
+    }
+
+    if (posted && presave_) {
+        presave_(); // Reads server->arg(), lock released
+    }
+
+    if (timeout_s_ && millis() - start_ms_ >= timeout_s_ * 1000) {
+        stopConfigPortal();
+    }
+    return false;
+}
+
+bool WiFiManager::stopConfigPortal() {
+    active_ = false;
+    std::lock_guard<std::mutex> guard(portal_lock);
+    portal_stats.active = false;
+    return true;
+}
+
+MDNSResponder MDNS;
+ArduinoOTAClass ArduinoOTA;
+
+// === HMI panel ===
+static host_hmi_hook_t hmi_hook = nullptr;
+static void *hmi_hook_ctx = nullptr;
+
+void host_hmi_set_hook(host_hmi_hook_t hook, void *ctx) {
+    hmi_hook = hook;
+    hmi_hook_ctx = ctx;
+}
+
+// === Panel RTC ===
+// Local time, runs on the true clock like the panel's own crystal
+#define HOST_RTC_RESET_EPOCH 946684800LL // 2000-01-01, RTC lost power
+
+static std::mutex rtc_lock;
+static int64_t rtc_local = 0;    // Local seconds at rtc_set_us, 0 = reset
+static int64_t rtc_set_us = 0;
+static unsigned long rtc_writes = 0;
+static std::atomic<bool> rtc_read_pending(false);
+
+void host_hmi_rtc_set(int64_t local_epoch) {
+    std::lock_guard<std::mutex> guard(rtc_lock);
+    rtc_local = local_epoch;
+    rtc_set_us = host_clock_us();
+}
+
+int64_t host_hmi_rtc_get(void) {
+    std::lock_guard<std::mutex> guard(rtc_lock);
+    int64_t base = rtc_local ? rtc_local : HOST_RTC_RESET_EPOCH;
+    return base + (host_clock_us() - rtc_set_us) / 1000000;
+}
+
+unsigned long host_hmi_rtc_writes(void) {
+    std::lock_guard<std::mutex> guard(rtc_lock);
+    return rtc_writes;
+}
+
+// === Panel UART ===
+// Bytes the panel sends wait in panel_in until DWIN::listen() parses
+// them. Bridged, Serial2 is a pty and the program on the other end is
+// the panel, RTC included. Otherwise the built-in RTC answers reads.
+#define HOST_PANEL_FRAME_MAX (3 + 255)
+
+static std::mutex panel_lock;
+static std::string panel_in;
+static int panel_fd = -1; // pty master, -1 when not bridged
+static char panel_path[64];
+static host_panel_stats_t panel_stats;
+
+const char *host_panel_open_pty(const char *link) {
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return NULL;
+    }
+    snprintf(panel_path, sizeof(panel_path), "%s", ptsname(fd));
+
+    // Raw bytes both ways. The slave stays open so the pair survives
+    // the emulator closing and reopening it.
+    int slave = open(panel_path, O_RDWR | O_NOCTTY);
+    if (slave >= 0) {
+        struct termios tio;
+        tcgetattr(slave, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(slave, TCSANOW, &tio);
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    if (link) {
+        unlink(link);
+        if (symlink(panel_path, link) != 0) {
+            fprintf(stderr, "[HOST] Cannot link %s to %s\n", link, panel_path);
+        }
+    }
+    std::lock_guard<std::mutex> guard(panel_lock);
+    panel_fd = fd;
+    return panel_path;
+}
+
+void host_panel_input(const uint8_t *buf, size_t len) {
+    std::lock_guard<std::mutex> guard(panel_lock);
+    panel_in.append((const char *)buf, len);
+}
+
+void host_panel_stats(host_panel_stats_t *stats) {
+    std::lock_guard<std::mutex> guard(panel_lock);
+    *stats = panel_stats;
+}
+
+static void host_panel_tx(const uint8_t *buf, size_t len) {
+    std::lock_guard<std::mutex> guard(panel_lock);
+    panel_stats.tx_frames++;
+    panel_stats.tx_bytes += len;
+    if (panel_fd >= 0) {
+        // Nobody reading and the pty buffer full, the frame is lost
+        if (write(panel_fd, buf, len) != (ssize_t)len) {
+            panel_stats.tx_dropped++;
+        }
+        return;
+    }
+
+    // RTC read request: 5A A5 04 83 00 10 04
+    if (len >= 7 && buf[0] == 0x5A && buf[1] == 0xA5 && buf[3] == 0x83 &&
+        buf[4] == 0x00 && buf[5] == 0x10
+    ) {
+        rtc_read_pending = true;
+    }
+}
+
+// Next whole frame from panel_in, bytes before a header are skipped
+static size_t host_panel_next_frame(uint8_t *frame) {
+    std::lock_guard<std::mutex> guard(panel_lock);
+    if (panel_fd >= 0) {
+        uint8_t buf[256];
+        ssize_t n;
+        while ((n = read(panel_fd, buf, sizeof(buf))) > 0) {
+            panel_in.append((const char *)buf, n);
+        }
+    }
+
+    for (;;) {
+        size_t start = panel_in.find("\x5A\xA5");
+        if (start == std::string::npos) {
+            panel_in.erase(0, panel_in.empty() ? 0 : panel_in.size() - 1);
+            return 0;
+        }
+        panel_in.erase(0, start);
+        if (panel_in.size() < 3 || panel_in.size() < 3u + (uint8_t)panel_in[2]) {
+            return 0; // Rest of the frame still on the wire
+        }
+
+        size_t len = 3 + (uint8_t)panel_in[2];
+        memcpy(frame, panel_in.data(), len);
+        panel_in.erase(0, len);
+        panel_stats.rx_frames++;
+        panel_stats.rx_bytes += len;
+        if (len >= 6) {
+            return len;
+        }
+    }
+}
+
+void DWIN::setRTC(byte year, byte month, byte day, byte hour, byte minute, byte second) {
+    struct tm tm_local = {};
+    tm_local.tm_year = year + 100;
+    tm_local.tm_mon = month - 1;
+    tm_local.tm_mday = day;
+    tm_local.tm_hour = hour;
+    tm_local.tm_min = minute;
+    tm_local.tm_sec = second;
+    host_hmi_rtc_set((int64_t)timegm(&tm_local));
+
+    {
+        std::lock_guard<std::mutex> guard(rtc_lock);
+        rtc_writes++;
+    }
+
+    const uint8_t frame[] = {
+        0x5A, 0xA5, 0x0A, 0x82, 0x00, 0x9C, 0x5A, 0xA5,
+        year, month, day, hour, minute, second
+    };
+    port_.write(frame, sizeof(frame));
+}
+
+// Built-in panel RTC, the reply to a pending read
+static void host_rtc_reply(void) {
+    time_t local = (time_t)host_hmi_rtc_get();
+    struct tm tm_local;
+    gmtime_r(&local, &tm_local);
+
+    const uint8_t frame[] = {
+        0x5A, 0xA5, 0x0C, 0x83, 0x00, 0x10, 0x04,
+        (uint8_t)(tm_local.tm_year % 100), (uint8_t)(tm_local.tm_mon + 1),
+        (uint8_t)tm_local.tm_mday, (uint8_t)tm_local.tm_wday,
+        (uint8_t)tm_local.tm_hour, (uint8_t)tm_local.tm_min,
+        (uint8_t)tm_local.tm_sec, 0x00
+    };
+    host_panel_input(frame, sizeof(frame));
+}
+
+// One frame per call, reported the way the library does: address as
+// four hex digits, the last byte, the text after the length byte up to
+// 0x00 or 0xFF, and a hex dump of the whole frame. Later frames wait
+// for the next call like bytes in the UART buffer.
+void DWIN::listen() {
+    if (rtc_read_pending.exchange(false)) {
+        host_rtc_reply();
+    }
+
+    uint8_t frame[HOST_PANEL_FRAME_MAX];
+    size_t len = host_panel_next_frame(frame);
+    if (len > 0 && listener_) {
+        char address[5];
+        snprintf(address, sizeof(address), "%02X%02X", frame[4], frame[5]);
+        String message;
+        for (size_t i = 7; i < len && frame[i] != 0x00 && frame[i] != 0xFF; i++) {
+            message += (char)frame[i];
+        }
+        char response[3 * HOST_PANEL_FRAME_MAX + 1];
+        for (size_t i = 0; i < len; i++) {
+            snprintf(&response[3 * i], 4, "%02X ", frame[i]);
+        }
+        listener_(String(address), frame[len - 1], message, String(response));
+    }
+}
+
+// Writes go out as the library frames them, 0x82 write to a VP
+void DWIN::setVP(long address, byte data) {
+    const uint8_t frame[] = {
+        0x5A, 0xA5, 0x05, 0x82, (uint8_t)(address >> 8), (uint8_t)address, 0x00, data
+    };
+    port_.write(frame, sizeof(frame));
+    if (hmi_hook) {
+        hmi_hook((uint16_t)address, nullptr, data, hmi_hook_ctx);
+    }
+}
+
+void DWIN::setText(long address, String text) {
+    uint8_t frame[6 + 252];
+    size_t len = text.length() < 252 ? text.length() : 252;
+    const uint8_t head[] = {
+        0x5A, 0xA5, (uint8_t)(len + 3), 0x82, (uint8_t)(address >> 8), (uint8_t)address
+    };
+    memcpy(frame, head, sizeof(head));
+    memcpy(frame + sizeof(head), text.c_str(), len);
+    port_.write(frame, sizeof(head) + len);
+    if (hmi_hook) {
+        hmi_hook((uint16_t)address, text.c_str(), 0, hmi_hook_ctx);
+    }
+}
+
+void DWIN::inject(uint16_t address, int data, const char *message) {
+    if (listener_) {
+        char addr[8];
+        snprintf(addr, sizeof(addr), "%X", address);
+        listener_(String(addr), data, String(message ? message : ""), String());
+    }
+}
+
+// === NVS ===
+static std::mutex nvs_lock;
+static std::map<std::string, std::string> nvs_store; // "ns/key" -> bytes
+static host_nvs_stats_t nvs_stats;
+static uint32_t nvs_write_us = 0;
+static uint32_t nvs_commit_us = 0;
+
+void host_nvs_stats(host_nvs_stats_t *stats) {
+    std::lock_guard<std::mutex> guard(nvs_lock);
+    *stats = nvs_stats;
+}
+
+void host_nvs_set_latency(uint32_t write_us, uint32_t commit_us) {
+    nvs_write_us = write_us;
+    nvs_commit_us = commit_us;
+}
+
+void host_nvs_reset(void) {
+    std::lock_guard<std::mutex> guard(nvs_lock);
+    nvs_store.clear();
+    nvs_stats = host_nvs_stats_t();
+}
+
+// One "namespace/key hex" line per entry, sorted like the map
+bool host_nvs_load(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(nvs_lock);
+    char key[64];
+    char hex[2 * 512 + 1];
+    while (fscanf(f, "%63s %1024s", key, hex) == 2) {
+        std::string value;
+        for (size_t i = 0; hex[i] && hex[i + 1]; i += 2) {
+            char byte[3] = { hex[i], hex[i + 1], 0 };
+            value += (char)strtoul(byte, NULL, 16);
+        }
+        nvs_store[key] = value;
+    }
+    fclose(f);
+    return true;
+}
+
+bool host_nvs_save(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(nvs_lock);
+    for (const auto &entry : nvs_store) {
+        fprintf(f, "%s ", entry.first.c_str());
+        for (char c : entry.second) {
+            fprintf(f, "%02X", (uint8_t)c);
+        }
+        fprintf(f, "%s\n", entry.second.empty() ? "-" : "");
+    }
+    fclose(f);
+    return true;
+}
+
+bool Preferences::begin(const char *name, bool readOnly) {
+    ns_ = name;
+    read_only_ = readOnly;
+    open_ = true;
+    return true;
+}
+
+void Preferences::end() {
+    if (dirty_) {
+        {
+            std::lock_guard<std::mutex> guard(nvs_lock);
+            nvs_stats.commits++;
+        }
+        host_clock_advance_us(nvs_commit_us);
+    }
+    open_ = false;
+    dirty_ = false;
+}
+
+size_t Preferences::put(const char *key, const void *data, size_t len) {
+    if (!open_ || read_only_) {
+        return 0;
+    }
+    std::string value((const char *)data, len);
+    bool changed = false;
+    {
+        std::lock_guard<std::mutex> guard(nvs_lock);
+        std::string &slot = nvs_store[ns_ + "/" + key];
+        nvs_stats.puts++;
+        if (slot != value) {
+            nvs_stats.writes++;
+            slot = value;
+            dirty_ = true;
+            changed = true;
+        }
+    }
+    if (changed) {
+        host_clock_advance_us(nvs_write_us);
+    }
+    return len;
+}
+
+bool Preferences::get(const char *key, std::string *out) {
+    if (!open_) {
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(nvs_lock);
+    auto it = nvs_store.find(ns_ + "/" + key);
+    if (it == nvs_store.end()) {
+        return false;
+    }
+    *out = it->second;
+    return true;
+}
+
+bool Preferences::clear() {
+    if (!open_ || read_only_) {
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(nvs_lock);
+    std::string prefix = ns_ + "/";
+    for (auto it = nvs_store.begin(); it != nvs_store.end();) {
+        it = it->first.compare(0, prefix.size(), prefix) == 0 ?
+            nvs_store.erase(it) : std::next(it);
+    }
+    return true;
+}
+
+bool Preferences::remove(const char *key) {
+    if (!open_ || read_only_) {
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(nvs_lock);
+    return nvs_store.erase(ns_ + "/" + key) > 0;
+}
+
+bool Preferences::isKey(const char *key) {
+    std::string value;
+    return get(key, &value);
+}
+
+size_t Preferences::putUChar(const char *key, uint8_t value) {
+    return put(key, &value, sizeof(value));
+}
+
+size_t Preferences::putULong(const char *key, uint32_t value) {
+    return put(key, &value, sizeof(value));
+}
+
+size_t Preferences::putString(const char *key, const char *value) {
+    return put(key, value, strlen(value));
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len) {
+    return put(key, value, len);
+}
+
+uint8_t Preferences::getUChar(const char *key, uint8_t defaultValue) {
+    std::string value;
+    return (get(key, &value) && value.size() == 1) ? (uint8_t)value[0] : defaultValue;
+}
+
+uint32_t Preferences::getULong(const char *key, uint32_t defaultValue) {
+    std::string value;
+    uint32_t out = defaultValue;
+    if (get(key, &value) && value.size() == sizeof(out)) {
+        memcpy(&out, value.data(), sizeof(out));
+    }
+    return out;
+}
+
+size_t Preferences::getString(const char *key, char *value, size_t maxLen) {
+    std::string stored;
+    if (!get(key, &stored) || stored.size() + 1 > maxLen) {
+        return 0; // Same as NVS: buffer too small reads nothing
+    }
+    memcpy(value, stored.c_str(), stored.size() + 1);
+    return stored.size() + 1;
+}
+
+String Preferences::getString(const char *key, String defaultValue) {
+    std::string stored;
+    return get(key, &stored) ? String(stored) : defaultValue;
+}
+
+size_t Preferences::getBytesLength(const char *key) {
+    std::string stored;
+    return get(key, &stored) ? stored.size() : 0;
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen) {
+    std::string stored;
+    if (!get(key, &stored) || stored.size() > maxLen) {
+        return 0;
+    }
+    memcpy(buf, stored.data(), stored.size());
+    return stored.size();
+}
+
+// === Flash partition ===
+static std::mutex flash_lock;
+static uint8_t flash_data[HOST_FLASH_SIZE];
+static bool flash_ready = false;
+static host_flash_stats_t flash_stats;
+static uint32_t flash_write_us = 0;
+static uint32_t flash_erase_us = 0;
+static size_t flash_tear = SIZE_MAX;
+
+static const esp_partition_t flash_journal = {
+    ESP_PARTITION_TYPE_DATA, 0x40, 0x3E0000, HOST_FLASH_SIZE, "journal"
+};
+
+void host_flash_fill(uint8_t byte) {
+    std::lock_guard<std::mutex> guard(flash_lock);
+    memset(flash_data, byte, sizeof(flash_data));
+    flash_ready = true;
+    flash_stats = host_flash_stats_t();
+}
+
+void host_flash_set_latency(uint32_t write_us, uint32_t erase_us) {
+    flash_write_us = write_us;
+    flash_erase_us = erase_us;
+}
+
+void host_flash_tear_next_write(size_t bytes) {
+    flash_tear = bytes;
+}
+
+void host_flash_stats(host_flash_stats_t *stats) {
+    std::lock_guard<std::mutex> guard(flash_lock);
+    *stats = flash_stats;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t subtype,
+                                                const char *label) {
+    if (type != flash_journal.type || subtype != flash_journal.subtype ||
+        (label && strcmp(label, flash_journal.label) != 0)) {
+        return NULL;
+    }
+    std::lock_guard<std::mutex> guard(flash_lock);
+    if (!flash_ready) {
+        memset(flash_data, 0xFF, sizeof(flash_data)); // Erased at the factory
+        flash_ready = true;
+    }
+    return &flash_journal;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t offset, void *dst, size_t size) {
+    if (part != &flash_journal || offset + size > HOST_FLASH_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    std::lock_guard<std::mutex> guard(flash_lock);
+    memcpy(dst, flash_data + offset, size);
+    flash_stats.reads++;
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *part, size_t offset, const void *src,
+                              size_t size) {
+    if (part != &flash_journal || offset + size > HOST_FLASH_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    {
+        std::lock_guard<std::mutex> guard(flash_lock);
+        size_t stored = size < flash_tear ? size : flash_tear;
+        flash_tear = SIZE_MAX;
+        for (size_t i = 0; i < stored; i++) {
+            flash_data[offset + i] &= ((const uint8_t *)src)[i]; // Bits only clear
+        }
+        flash_stats.writes++;
+    }
+    host_clock_advance_us(flash_write_us);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *part, size_t offset, size_t size) {
+    if (part != &flash_journal || offset % SPI_FLASH_SEC_SIZE || size % SPI_FLASH_SEC_SIZE ||
+        offset + size > HOST_FLASH_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    {
+        std::lock_guard<std::mutex> guard(flash_lock);
+        memset(flash_data + offset, 0xFF, size);
+        for (size_t s = offset / SPI_FLASH_SEC_SIZE; s < (offset + size) / SPI_FLASH_SEC_SIZE; s++) {
+            flash_stats.sector_erases[s]++;
+            flash_stats.erases++;
+        }
+    }
+    host_clock_advance_us(flash_erase_us * (size / SPI_FLASH_SEC_SIZE));
+    return ESP_OK;
+}
+
+// === Reset reason ===
+static int reset_reason = ESP_RST_POWERON;
+
+void host_reset_reason_set(int reason) {
+    reset_reason = reason;
+}
+
+esp_reset_reason_t esp_reset_reason(void) {
+    return (esp_reset_reason_t)reset_reason;
+}
+
+// === Task watchdog ===
+static host_wdt_stats_t wdt_stats;
+static int64_t wdt_fed_us = 0;
+
+void host_wdt_stats(host_wdt_stats_t *stats) {
+    *stats = wdt_stats;
+}
+
+bool host_wdt_expired(void) {
+    return wdt_stats.subscribed > 0 && wdt_stats.timeout_s > 0 &&
+           host_local_us() - wdt_fed_us > (int64_t)wdt_stats.timeout_s * 1000000;
+}
+
+esp_err_t esp_task_wdt_init(uint32_t timeout_s, bool panic) {
+    wdt_stats.timeout_s = timeout_s;
+    wdt_stats.panic = panic;
+    wdt_fed_us = host_local_us();
+    return ESP_OK;
+}
+
+esp_err_t esp_task_wdt_add(TaskHandle_t task) {
+    wdt_stats.subscribed++;
+    wdt_fed_us = host_local_us();
+    return ESP_OK;
+}
+
+esp_err_t esp_task_wdt_delete(TaskHandle_t task) {
+    if (wdt_stats.subscribed == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    wdt_stats.subscribed--;
+    return ESP_OK;
+}
+
+esp_err_t esp_task_wdt_reset(void) {
+    wdt_stats.feeds++;
+    wdt_fed_us = host_local_us();
+    return ESP_OK;
+}
@@ -0,0 +1,180 @@
+#ifndef HOST_SHIMS_H
+#define HOST_SHIMS_H
+
+// === Host test controls for the Arduino/FreeRTOS shims ===
+// The clock is virtual: it only moves when a test advances it or when
+// firmware code blocks in delay()/vTaskDelay().
+
+#include <stdint.h>
+#include <stddef.h>
+
+// === Virtual clock ===
+// host_clock_us() is true time, host_local_us() is the board oscillator
+// that esp_timer, millis() and ticks run on. In real time the clock
+// follows the wall clock and delays sleep, for the native firmware.
+void host_clock_set_us(int64_t us);
+void host_clock_advance_us(int64_t us);
+void host_clock_set_drift_ppm(double ppm);
+void host_clock_set_realtime(bool on);
+int64_t host_clock_us(void);
+int64_t host_local_us(void);
+
+// === GPIO ===
+typedef void (*host_gpio_hook_t)(uint8_t pin, uint8_t level, void *ctx);
+void host_gpio_set_hook(host_gpio_hook_t hook, void *ctx);
+uint8_t host_gpio_level(uint8_t pin);
+
+// === HMI panel ===
+typedef void (*host_hmi_hook_t)(uint16_t address, const char *text, uint8_t value, void *ctx);
+void host_hmi_set_hook(host_hmi_hook_t hook, void *ctx);
+
+// === Panel RTC ===
+// Local epoch seconds, running on true time. 0 = RTC lost power and
+// reads 2000-01-01. Read requests sent on Serial2 are answered on the
+// next DWIN::listen().
+void host_hmi_rtc_set(int64_t local_epoch);
+int64_t host_hmi_rtc_get(void);
+unsigned long host_hmi_rtc_writes(void);
+
+// === Panel UART ===
+// Serial2 frames from the firmware, and bytes the panel sends back that
+// DWIN::listen() parses into listener calls like the library. Bridged
+// to a pty, the program on the other end (scripts/serial_emulator.py)
+// is the panel and answers RTC reads; `link` is an optional symlink to
+// the pty. Returns the pty path, NULL on failure.
+const char *host_panel_open_pty(const char *link);
+// Bytes as if the panel sent them, a touch or a reply
+void host_panel_input(const uint8_t *buf, size_t len);
+typedef struct {
+    unsigned long tx_frames;  // Serial2 writes, one frame each
+    unsigned long tx_bytes;
+    unsigned long tx_dropped; // Frames the pty had no room for
+    unsigned long rx_frames;  // Frames parsed by DWIN::listen()
+    unsigned long rx_bytes;
+} host_panel_stats_t;
+void host_panel_stats(host_panel_stats_t *stats);
+
+// === NVS ===
+typedef struct {
+    unsigned long puts;    // put*() calls
+    unsigned long writes;  // puts that changed the stored value
+    unsigned long commits; // begin()/end() sessions with a write
+} host_nvs_stats_t;
+void host_nvs_stats(host_nvs_stats_t *stats);
+void host_nvs_reset(void);
+// Virtual time a changed put and a commit take, 0 (instant) by default
+void host_nvs_set_latency(uint32_t write_us, uint32_t commit_us);
+// Text file with one "namespace/key hex" line per entry, for a store
+// that outlives the process. Load adds to what is in memory.
+bool host_nvs_load(const char *path);
+bool host_nvs_save(const char *path);
+
+// === Flash partition ===
+// The "journal" data partition behind esp_partition_*(), NOR semantics.
+// A torn write stores only the first `bytes` of the next write, as a
+// power cut would. Latencies advance the virtual clock.
+#define HOST_FLASH_SIZE 0x10000
+void host_flash_fill(uint8_t byte);  // Old contents, not a valid erase
+void host_flash_set_latency(uint32_t write_us, uint32_t erase_us);
+void host_flash_tear_next_write(size_t bytes);
+typedef struct {
+    unsigned long reads;
+    unsigned long writes;
+    unsigned long erases;
+    unsigned long sector_erases[HOST_FLASH_SIZE / 4096];
+} host_flash_stats_t;
+void host_flash_stats(host_flash_stats_t *stats);
+
+// === Reset reason ===
+// What esp_reset_reason() returns, ESP_RST_POWERON by default
+void host_reset_reason_set(int reason);
+
+// === Task watchdog ===
+// esp_task_wdt_*() never reset the host. Expired once the virtual clock
+// is past the timeout since the last feed, with a task subscribed.
+typedef struct {
+    unsigned long feeds;
+    uint32_t timeout_s;
+    bool panic;
+    int subscribed;
+} host_wdt_stats_t;
+void host_wdt_stats(host_wdt_stats_t *stats);
+bool host_wdt_expired(void);
+
+// === WiFi ===
+// Emulated access point. WiFi.begin() gets an IP `connect_ms` later
+// while the AP is up, otherwise a disconnect event after the same time.
+// Taking the AP down drops a connected link. Due events are delivered
+// by host_wifi_service(), as the WiFi event task would.
+void host_wifi_set_ap(bool up, uint32_t connect_ms);
+// Splits the connect time: a begin() aimed at a BSSID skips the scan,
+// a static IP config skips DHCP
+void host_wifi_set_timing(uint32_t scan_ms, uint32_t assoc_ms, uint32_t dhcp_ms);
+// AP replaced or moved, drops a connected link
+void host_wifi_set_bssid(const uint8_t bssid[6], uint8_t channel);
+// Signal level WiFi.RSSI() reports while connected
+void host_wifi_set_rssi(int8_t dbm);
+// Lease time the AP's DHCP server grants from the next exchange on
+#define HOST_WIFI_LEASE_S (24 * 60 * 60) // Default
+void host_wifi_set_lease(uint32_t lease_s);
+void host_wifi_service(void);
+
+typedef struct {
+    unsigned long begins;        // WiFi.begin() calls
+    unsigned long scans;         // begin() without a BSSID
+    unsigned long dhcp_requests; // Leases requested from the AP
+} host_wifi_stats_t;
+void host_wifi_stats(host_wifi_stats_t *stats);
+
+// === Provisioning portal ===
+// Phones on the soft AP, and a form post handled on the next
+// WiFiManager::process(). Portal counters for checks.
+void host_portal_join(uint8_t stations);
+void host_portal_submit(const char *ssid, const char *pswd);
+typedef struct {
+    bool active;
+    unsigned long opens;
+    unsigned long processed; // process() calls
+} host_portal_stats_t;
+void host_portal_stats(host_portal_stats_t *stats);
+
+// === Network ===
+// Routes WiFiUDP packets for `host` to 127.0.0.1:port, 0 removes it
+void host_udp_map(const char *host, uint16_t port);
+// dns_gethostbyname() answers `ms` of clock later from another thread,
+// 0 answers at once
+void host_dns_set_delay_ms(uint32_t ms);
+// Loopback port a WiFiServer for `port` listens on, may differ when
+// `port` is taken on the host
+uint16_t host_tcp_port(uint16_t port);
+
+// === MQTT broker ===
+// In-process stand-in for the broker PubSubClient talks to. Publishes
+// go to the hook, injected messages reach subscribed clients on their
+// next loop(). Taking the broker down drops every session and
+// publishes their will.
+typedef void (*host_mqtt_hook_t)(const char *topic, const uint8_t *payload,
+                                 size_t len, bool retained, void *ctx);
+void host_mqtt_set_hook(host_mqtt_hook_t hook, void *ctx);
+void host_mqtt_set_broker(bool up);
+// Broker's TCP listener at `host`:`port`, the name resolves through
+// dns_gethostbyname(). False if the address cannot be bound.
+bool host_mqtt_listen(const char *host, uint16_t port);
+void host_mqtt_inject(const char *topic, const char *payload);
+typedef struct {
+    unsigned long connects;  // Accepted CONNECTs
+    unsigned long publishes; // Messages accepted from clients
+    unsigned long bytes;     // Payload bytes in those
+    unsigned long delivered; // Injected messages handed to a callback
+} host_mqtt_stats_t;
+void host_mqtt_stats(host_mqtt_stats_t *stats);
+void host_mqtt_reset(void);
+
+// === Debug serial ===
+void host_serial_quiet(bool quiet);
+// Typed console input for Serial.read(), and a hook seeing every write
+void host_serial_input(const char *text);
+typedef void (*host_serial_hook_t)(const char *text, size_t len, void *ctx);
+void host_serial_set_hook(host_serial_hook_t hook, void *ctx);
+
+#endif // HOST_SHIMS_H
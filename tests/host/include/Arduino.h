@@ -0,0 +1,145 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// === Host shim for the Arduino core (ESP32 flavour) ===
+// Just enough of the API for the firmware sources to build on Linux.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <string>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+
+typedef uint8_t byte;
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define OUTPUT 0x03
+
+#ifndef BIT0
+#define BIT0 0x00000001
+#endif
+
+// === String ===
+class String {
+public:
+    String() {}
+    String(const char *s) : s_(s ? s : "") {}
+    String(const std::string &s) : s_(s) {}
+    String(char c) : s_(1, c) {}
+    String(int value, unsigned char base = 10) { from_number(value, base); }
+    String(unsigned int value, unsigned char base = 10) { from_number(value, base); }
+    String(long value, unsigned char base = 10) { from_number(value, base); }
+    String(unsigned long value, unsigned char base = 10) { from_number(value, base); }
+
+    const char *c_str() const { return s_.c_str(); }
+    unsigned int length() const { return (unsigned int)s_.size(); }
+    bool reserve(unsigned int size) { s_.reserve(size); return true; }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > s_.size()) return String();
+        if (to > s_.size()) to = (unsigned int)s_.size();
+        return String(s_.substr(from, to > from ? to - from : 0));
+    }
+    String substring(unsigned int from) const { return substring(from, length()); }
+    int toInt() const { return atoi(s_.c_str()); }
+    char operator[](unsigned int i) const { return i < s_.size() ? s_[i] : 0; }
+
+    String &operator+=(const String &o) { s_ += o.s_; return *this; }
+    String &operator+=(const char *o) { s_ += (o ? o : ""); return *this; }
+    String &operator+=(char c) { s_ += c; return *this; }
+    friend String operator+(const String &a, const String &b) { return String(a.s_ + b.s_); }
+    friend String operator+(const String &a, const char *b) { return String(a.s_ + (b ? b : "")); }
+    friend String operator+(const char *a, const String &b) { return String(std::string(a ? a : "") + b.s_); }
+    bool operator==(const String &o) const { return s_ == o.s_; }
+    bool operator==(const char *o) const { return s_ == (o ? o : ""); }
+    bool operator!=(const String &o) const { return s_ != o.s_; }
+
+private:
+    template <typename T> void from_number(T value, unsigned char base) {
+        char buf[72];
+        if (base == 10) {
+            snprintf(buf, sizeof(buf), (T)-1 < 0 ? "%ld" : "%lu", (long)value);
+        } else {
+            // Same digit rules as the Arduino core, any base 2..36
+            unsigned long v = (unsigned long)value;
+            char *p = buf + sizeof(buf) - 1;
+            *p = '\0';
+            if (base < 2) base = 10;
+            do {
+                unsigned d = v % base;
+                *--p = (char)(d < 10 ? '0' + d : 'a' + d - 10);
+                v /= base;
+            } while (v);
+            s_ = p;
+            return;
+        }
+        s_ = buf;
+    }
+    std::string s_;
+};
+
+// === Serial ports ===
+class HardwareSerial {
+public:
+    explicit HardwareSerial(int num) : num_(num) {}
+    void begin(unsigned long baud, uint32_t config = 0, int8_t rx = -1, int8_t tx = -1) {
+        (void)baud; (void)config; (void)rx; (void)tx;
+    }
+    void end() {}
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t write(const uint8_t *buf, size_t len);
+    size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    size_t print(const String &s) { return print(s.c_str()); }
+    size_t print(int v) { return printf("%d", v); }
+    size_t print(unsigned int v) { return printf("%u", v); }
+    size_t print(long v) { return printf("%ld", v); }
+    size_t print(unsigned long v) { return printf("%lu", v); }
+    size_t println() { return print("\n"); }
+    template <typename T> size_t println(T v) { size_t n = print(v); return n + println(); }
+    size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+    int available();
+    int read();
+    int peek();
+    void flush() {}
+    operator bool() const { return true; }
+    int port() const { return num_; }
+
+private:
+    int num_;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial2;
+
+// === ESP chip helpers ===
+class EspClass {
+public:
+    uint64_t getEfuseMac() { return 0x0000A1B2C3D4E5F6ULL; }
+    uint32_t getCycleCount();
+    uint32_t getCpuFreqMHz() { return 240; }
+    uint32_t getFreeHeap() { return 200 * 1024; }
+    uint32_t getMaxAllocHeap() { return 110 * 1024; }
+    uint32_t getHeapSize() { return 320 * 1024; }
+    void restart();
+};
+extern EspClass ESP;
+
+// === Core functions ===
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(uint32_t ms);
+void yield(void);
+uint32_t esp_random(void);
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,45 @@
+#ifndef HOST_ARDUINOOTA_H
+#define HOST_ARDUINOOTA_H
+
+// === Host shim for ArduinoOTA, OTA never starts on the host ===
+
+#include <Arduino.h>
+#include <functional>
+
+#define U_FLASH 0
+#define U_SPIFFS 100
+
+typedef enum {
+    OTA_AUTH_ERROR,
+    OTA_BEGIN_ERROR,
+    OTA_CONNECT_ERROR,
+    OTA_RECEIVE_ERROR,
+    OTA_END_ERROR
+} ota_error_t;
+
+class ArduinoOTAClass {
+public:
+    typedef std::function<void(void)> THandlerFunction;
+    typedef std::function<void(ota_error_t)> THandlerFunction_Error;
+    typedef std::function<void(unsigned int, unsigned int)> THandlerFunction_Progress;
+
+    ArduinoOTAClass &setPort(uint16_t port) { (void)port; return *this; }
+    ArduinoOTAClass &setHostname(const char *name) { hostname_ = name; return *this; }
+    String getHostname() { return hostname_; }
+    ArduinoOTAClass &setPassword(const char *pass) { (void)pass; return *this; }
+    ArduinoOTAClass &setPasswordHash(const char *hash) { (void)hash; return *this; }
+    ArduinoOTAClass &onStart(THandlerFunction fn) { (void)fn; return *this; }
+    ArduinoOTAClass &onEnd(THandlerFunction fn) { (void)fn; return *this; }
+    ArduinoOTAClass &onError(THandlerFunction_Error fn) { (void)fn; return *this; }
+    ArduinoOTAClass &onProgress(THandlerFunction_Progress fn) { (void)fn; return *this; }
+    int getCommand() { return U_FLASH; }
+    void begin() {}
+    void handle() {}
+
+private:
+    String hostname_;
+};
+
+extern ArduinoOTAClass ArduinoOTA;
+
+#endif // HOST_ARDUINOOTA_H
@@ -0,0 +1,33 @@
+#ifndef HOST_DWIN_H
+#define HOST_DWIN_H
+
+// === Host shim for the DWIN_DGUS_HMI library ===
+// Writes are forwarded to host_shims so tests can observe the panel.
+
+#include <Arduino.h>
+
+typedef void (*hmiListener)(String address, int lastBytes, String message, String response);
+
+class DWIN {
+public:
+    DWIN(HardwareSerial &port, uint8_t rx, uint8_t tx, long baud = 115200)
+        : port_(port) { (void)rx; (void)tx; (void)baud; }
+
+    void restartHMI() {}
+    void echoEnabled(bool enabled) { (void)enabled; }
+    void hmiCallBack(hmiListener callback) { listener_ = callback; }
+    void listen();
+    void setVP(long address, byte data);
+    void setText(long address, String text);
+    void setPage(byte page) { (void)page; }
+    void setRTC(byte year, byte month, byte day, byte hour, byte minute, byte second);
+
+    // Host only: deliver a panel event as if it came over the wire
+    void inject(uint16_t address, int data, const char *message);
+
+private:
+    HardwareSerial &port_;
+    hmiListener listener_ = nullptr;
+};
+
+#endif // HOST_DWIN_H
@@ -0,0 +1,19 @@
+#ifndef HOST_ESPMDNS_H
+#define HOST_ESPMDNS_H
+
+// === Host shim for the ESP32 mDNS responder ===
+
+#include <Arduino.h>
+
+class MDNSResponder {
+public:
+    bool begin(const char *hostname) { (void)hostname; return true; }
+    void end() {}
+    void addService(const char *service, const char *proto, uint16_t port) {
+        (void)service; (void)proto; (void)port;
+    }
+};
+
+extern MDNSResponder MDNS;
+
+#endif // HOST_ESPMDNS_H
@@ -0,0 +1,40 @@
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+// === Host shim for the ESP32 Preferences (NVS) library ===
+// Values live in a process-wide map, writes are counted for wear checks.
+
+#include <Arduino.h>
+
+class Preferences {
+public:
+    bool begin(const char *name, bool readOnly = false);
+    void end();
+    bool clear();
+    bool remove(const char *key);
+    bool isKey(const char *key);
+
+    size_t putUChar(const char *key, uint8_t value);
+    size_t putULong(const char *key, uint32_t value);
+    size_t putString(const char *key, const char *value);
+    size_t putString(const char *key, String value) { return putString(key, value.c_str()); }
+    size_t putBytes(const char *key, const void *value, size_t len);
+
+    uint8_t getUChar(const char *key, uint8_t defaultValue = 0);
+    uint32_t getULong(const char *key, uint32_t defaultValue = 0);
+    size_t getString(const char *key, char *value, size_t maxLen);
+    String getString(const char *key, String defaultValue = String());
+    size_t getBytesLength(const char *key);
+    size_t getBytes(const char *key, void *buf, size_t maxLen);
+
+private:
+    size_t put(const char *key, const void *data, size_t len);
+    bool get(const char *key, std::string *out);
+
+    std::string ns_;
+    bool open_ = false;
+    bool read_only_ = true;
+    bool dirty_ = false; // Written since begin()
+};
+
+#endif // HOST_PREFERENCES_H
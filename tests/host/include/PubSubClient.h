@@ -0,0 +1,59 @@
+#ifndef HOST_PUBSUBCLIENT_H
+#define HOST_PUBSUBCLIENT_H
+
+// === Host shim for knolleary/PubSubClient ===
+// Talks to an in-process broker stand-in, see host_mqtt_* in
+// host_shims.h. The client must already be connected to the broker's
+// TCP listener, connect() only runs the CONNECT exchange the library
+// does on a connected client. Publishes go to the test hook, messages a
+// test injects are delivered by loop() to matching subscriptions.
+// Packet size limits follow the library.
+
+#include <WiFi.h>
+#include <functional>
+#include <set>
+
+#define MQTT_MAX_HEADER_SIZE 5
+
+#define MQTT_CONNECTION_TIMEOUT -4
+#define MQTT_CONNECTION_LOST -3
+#define MQTT_CONNECT_FAILED -2
+#define MQTT_DISCONNECTED -1
+#define MQTT_CONNECTED 0
+
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char *, uint8_t *, unsigned int)> callback
+
+class PubSubClient {
+public:
+    PubSubClient() {}
+    explicit PubSubClient(WiFiClient &client) : client_(&client) {}
+    PubSubClient &setServer(const char *domain, uint16_t port);
+    PubSubClient &setCallback(MQTT_CALLBACK_SIGNATURE) { callback_ = callback; return *this; }
+    PubSubClient &setKeepAlive(uint16_t seconds) { (void)seconds; return *this; }
+    PubSubClient &setSocketTimeout(uint16_t seconds) { (void)seconds; return *this; }
+    bool setBufferSize(uint16_t size) { buffer_size_ = size; return true; }
+    uint16_t getBufferSize() { return buffer_size_; }
+
+    bool connect(const char *id);
+    bool connect(const char *id, const char *willTopic, uint8_t willQos,
+                 bool willRetain, const char *willMessage);
+    void disconnect();
+    bool connected();
+    int state() { return connected() ? MQTT_CONNECTED : state_; }
+
+    bool publish(const char *topic, const char *payload, bool retained = false);
+    bool publish(const char *topic, const uint8_t *payload, unsigned int length,
+                 bool retained = false);
+    bool subscribe(const char *topic, uint8_t qos = 0);
+    bool loop();
+
+private:
+    WiFiClient *client_ = nullptr;
+    std::function<void(char *, uint8_t *, unsigned int)> callback_;
+    std::set<std::string> subs_;
+    uint16_t buffer_size_ = 256; // Library default
+    unsigned long session_ = 0;  // Broker session this client holds
+    int state_ = MQTT_DISCONNECTED;
+};
+
+#endif // HOST_PUBSUBCLIENT_H
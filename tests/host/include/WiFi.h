@@ -0,0 +1,117 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+// === Host shim for the ESP32 WiFi library ===
+// An emulated access point on the virtual clock, see host_wifi_* in
+// host_shims.h. Without it the radio never finds an AP.
+
+#include <Arduino.h>
+
+typedef enum {
+    WIFI_OFF = 0,
+    WIFI_STA = 1,
+    WIFI_AP = 2,
+    WIFI_AP_STA = 3
+} wifi_mode_t;
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+class IPAddress {
+public:
+    IPAddress() : addr_(0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+        : addr_((uint32_t)a | (uint32_t)b << 8 | (uint32_t)c << 16 | (uint32_t)d << 24) {}
+    explicit IPAddress(uint32_t addr) : addr_(addr) {}
+    operator uint32_t() const { return addr_; }
+    uint8_t operator[](int i) const { return (uint8_t)(addr_ >> (8 * i)); }
+    String toString() const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u",
+                 (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+        return String(buf);
+    }
+
+private:
+    uint32_t addr_;
+};
+
+// === WiFi events (Arduino-ESP32 2.x names) ===
+typedef enum {
+    ARDUINO_EVENT_WIFI_STA_START = 2,
+    ARDUINO_EVENT_WIFI_STA_CONNECTED = 4,
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED = 5,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP = 7,
+    ARDUINO_EVENT_WIFI_STA_LOST_IP = 8
+} arduino_event_id_t;
+
+// Disconnect reasons (wifi_err_reason_t subset)
+typedef enum {
+    WIFI_REASON_ASSOC_LEAVE = 8,
+    WIFI_REASON_BEACON_TIMEOUT = 200,
+    WIFI_REASON_NO_AP_FOUND = 201
+} wifi_err_reason_t;
+
+typedef union {
+    struct {
+        uint8_t bssid[6];
+        uint8_t channel;
+    } wifi_sta_connected;
+    struct {
+        uint8_t ssid[33];
+        uint8_t ssid_len;
+        uint8_t bssid[6];
+        uint8_t reason;
+    } wifi_sta_disconnected;
+} arduino_event_info_t;
+
+typedef arduino_event_id_t WiFiEvent_t;
+typedef arduino_event_info_t WiFiEventInfo_t;
+typedef void (*WiFiEventFuncCb)(WiFiEvent_t event, WiFiEventInfo_t info);
+typedef int wifi_event_id_t;
+
+class WiFiClass {
+public:
+    bool mode(wifi_mode_t m) { mode_ = m; return true; }
+    wifi_mode_t getMode() { return mode_; }
+    wl_status_t begin(const char *ssid, const char *pass = nullptr,
+                      int32_t channel = 0, const uint8_t *bssid = nullptr,
+                      bool connect = true);
+    bool config(IPAddress local_ip, IPAddress gateway, IPAddress subnet,
+                IPAddress dns1 = IPAddress());
+    bool disconnect(bool wifioff = false);
+    bool reconnect() { return false; }
+    wl_status_t status();
+    bool isConnected() { return status() == WL_CONNECTED; }
+    String SSID() { return String(); }
+    String psk() { return String(); }
+    int8_t RSSI();
+    IPAddress localIP();
+    IPAddress gatewayIP();
+    IPAddress subnetMask();
+    IPAddress dnsIP(uint8_t dns_no = 0);
+    uint8_t *BSSID();
+    int32_t channel();
+    IPAddress softAPIP() { return IPAddress(192, 168, 4, 1); }
+    uint8_t softAPgetStationNum();
+    bool setHostname(const char *name) { (void)name; return true; }
+    void setAutoReconnect(bool on) { (void)on; }
+    wifi_event_id_t onEvent(WiFiEventFuncCb cb);
+
+private:
+    wifi_mode_t mode_ = WIFI_OFF;
+    uint8_t bssid_[6] = { 0 };
+};
+
+extern WiFiClass WiFi;
+
+#include "WiFiClient.h"
+#include "WiFiServer.h"
+
+#endif // HOST_WIFI_H
@@ -0,0 +1,32 @@
+#ifndef HOST_WIFICLIENT_H
+#define HOST_WIFICLIENT_H
+
+// === Host shim for WiFiClient over loopback TCP ===
+// Copies share the socket like the ESP32 class, it closes with the
+// last copy or on stop(). Reads never block, write() sends it all,
+// fd() is the socket for non-blocking send() as on lwIP.
+
+#include <memory>
+
+struct HostSocket;
+
+class WiFiClient {
+public:
+    WiFiClient() {}
+    explicit WiFiClient(int fd);
+    uint8_t connected();
+    int available();
+    int read(uint8_t *buf, size_t size);
+    int read() { uint8_t c; return read(&c, 1) == 1 ? c : -1; }
+    size_t write(const uint8_t *buf, size_t size);
+    size_t write(uint8_t c) { return write(&c, 1); }
+    void flush() {}
+    void stop();
+    int fd() const; // -1 when closed
+    operator bool() { return connected(); }
+
+private:
+    std::shared_ptr<HostSocket> sock_;
+};
+
+#endif // HOST_WIFICLIENT_H
@@ -0,0 +1,44 @@
+#ifndef HOST_WIFIMANAGER_H
+#define HOST_WIFIMANAGER_H
+
+// === Host shim for tzapu/WiFiManager ===
+// Non-blocking portal only: a test posts the form with
+// host_portal_submit() and the next process() runs the pre-save
+// callback. The portal times out on the board clock like the library.
+
+#include <WiFi.h>
+#include <functional>
+#include <memory>
+
+class HostPortalServer {
+public:
+    String arg(const char *name);
+};
+
+class WiFiManager {
+public:
+    WiFiManager() : server(new HostPortalServer()) {}
+    void setDebugOutput(bool on) { (void)on; }
+    void setConfigPortalTimeout(unsigned long sec) { timeout_s_ = sec; }
+    void setConfigPortalBlocking(bool on) { (void)on; }
+    void setSaveConnect(bool on) { (void)on; }
+    void setPreSaveConfigCallback(std::function<void()> cb) { presave_ = cb; }
+    void setMenu(const char *menu[], uint8_t size) { (void)menu; (void)size; }
+    void setMenu(std::vector<const char *> &menu) { (void)menu; }
+    void setCustomHeadElement(const char *html) { (void)html; }
+    bool startConfigPortal(const char *ssid, const char *pass = nullptr);
+    bool process();
+    bool getConfigPortalActive() { return active_; }
+    bool stopConfigPortal();
+    void resetSettings() {}
+
+    std::unique_ptr<HostPortalServer> server;
+
+private:
+    std::function<void()> presave_;
+    unsigned long timeout_s_ = 0;
+    unsigned long start_ms_ = 0;
+    bool active_ = false;
+};
+
+#endif // HOST_WIFIMANAGER_H
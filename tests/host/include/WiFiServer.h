@@ -0,0 +1,24 @@
+#ifndef HOST_WIFISERVER_H
+#define HOST_WIFISERVER_H
+
+// === Host shim for WiFiServer on 127.0.0.1 ===
+// Listens on the requested port, or any free one when it is taken,
+// see host_tcp_port().
+
+#include "WiFiClient.h"
+
+class WiFiServer {
+public:
+    explicit WiFiServer(uint16_t port = 80) : port_(port) {}
+    ~WiFiServer() { stop(); }
+    void begin(uint16_t port = 0);
+    WiFiClient available(); // Accepted client, or an empty one
+    bool hasClient();
+    void stop();
+
+private:
+    int fd_ = -1;
+    uint16_t port_;
+};
+
+#endif // HOST_WIFISERVER_H
@@ -0,0 +1,39 @@
+#ifndef HOST_WIFIUDP_H
+#define HOST_WIFIUDP_H
+
+// === Host shim for WiFiUDP over loopback sockets ===
+// Host names are resolved through host_udp_map(), unmapped names fail
+// like a DNS miss.
+
+#include <WiFi.h>
+
+class WiFiUDP {
+public:
+    ~WiFiUDP() { stop(); }
+    uint8_t begin(uint16_t port);
+    void stop();
+    int beginPacket(const char *host, uint16_t port);
+    int beginPacket(IPAddress ip, uint16_t port);
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t write(const uint8_t *buf, size_t len);
+    int endPacket();
+    int parsePacket();
+    int read(uint8_t *buf, size_t len);
+    int read() { uint8_t c; return read(&c, 1) == 1 ? c : -1; }
+    int available() { return (int)(rx_.size() - rx_pos_); }
+    IPAddress remoteIP() { return remote_ip_; }
+    uint16_t remotePort() { return remote_port_; }
+    void flush() {}
+
+private:
+    int fd_ = -1;
+    uint32_t dest_ip_ = 0;     // Network order
+    uint16_t dest_port_ = 0;
+    std::string tx_;
+    std::string rx_;
+    size_t rx_pos_ = 0;
+    IPAddress remote_ip_;
+    uint16_t remote_port_ = 0;
+};
+
+#endif // HOST_WIFIUDP_H
@@ -0,0 +1,14 @@
+#ifndef HOST_ESP_NETIF_H
+#define HOST_ESP_NETIF_H
+
+// === Host shim for esp_netif ===
+// Only the station interface, whose lwIP netif leads to the emulated
+// AP's DHCP client, see lwip/dhcp.h.
+
+typedef struct esp_netif_obj esp_netif_t;
+
+// "WIFI_STA_DEF" is the station, any other key NULL
+esp_netif_t *esp_netif_get_handle_from_ifkey(const char *if_key);
+void *esp_netif_get_netif_impl(esp_netif_t *esp_netif);
+
+#endif // HOST_ESP_NETIF_H
@@ -0,0 +1,18 @@
+#ifndef HOST_ESP_TASK_WDT_H
+#define HOST_ESP_TASK_WDT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+// === Host shim for the task watchdog (ESP-IDF 4.4 API) ===
+// Nothing resets, see host_wdt_*() in host_shims.h for what a test
+// can check.
+
+esp_err_t esp_task_wdt_init(uint32_t timeout_s, bool panic);
+esp_err_t esp_task_wdt_add(TaskHandle_t task);
+esp_err_t esp_task_wdt_delete(TaskHandle_t task);
+esp_err_t esp_task_wdt_reset(void);
+
+#endif // HOST_ESP_TASK_WDT_H
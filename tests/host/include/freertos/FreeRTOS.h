@@ -0,0 +1,80 @@
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+// === Host shim for the FreeRTOS API used by the firmware ===
+// Ticks are 1 ms and come from the host virtual clock. Mutexes and
+// queues are backed by host threading primitives.
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t EventBits_t;
+typedef void (*TaskFunction_t)(void *);
+
+typedef struct host_task *TaskHandle_t;
+typedef struct host_queue *QueueHandle_t;
+typedef struct host_queue *SemaphoreHandle_t;
+typedef struct host_event_group *EventGroupHandle_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define errQUEUE_FULL pdFAIL
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFFUL)
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+// === Critical sections (spinlocks on the ESP32) ===
+typedef struct {
+  volatile int locked;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+void host_critical_enter(portMUX_TYPE *mux);
+void host_critical_exit(portMUX_TYPE *mux);
+#define portENTER_CRITICAL(mux) host_critical_enter(mux)
+#define portEXIT_CRITICAL(mux) host_critical_exit(mux)
+#define portENTER_CRITICAL_ISR(mux) host_critical_enter(mux)
+#define portEXIT_CRITICAL_ISR(mux) host_critical_exit(mux)
+
+// === Tasks ===
+TickType_t xTaskGetTickCount(void);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t *prev_wake, TickType_t increment);
+BaseType_t xPortGetCoreID(void);
+BaseType_t xTaskCreatePinnedToCore(
+    TaskFunction_t fn, const char *name, uint32_t stack, void *param,
+    UBaseType_t priority, TaskHandle_t *handle, BaseType_t core);
+void vTaskDelete(TaskHandle_t task);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+const char *pcTaskGetName(TaskHandle_t task);
+
+// === Queues ===
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t wait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t wait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue);
+#define xQueueSendToBack xQueueSend
+
+// === Mutexes ===
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+
+// === Event groups ===
+EventGroupHandle_t xEventGroupCreate(void);
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group);
+EventBits_t xEventGroupWaitBits(
+    EventGroupHandle_t group, EventBits_t bits, BaseType_t clear,
+    BaseType_t all, TickType_t wait);
+
+#endif // HOST_FREERTOS_H
@@ -0,0 +1,6 @@
+#ifndef HOST_FREERTOS_EVENT_GROUPS_H
+#define HOST_FREERTOS_EVENT_GROUPS_H
+
+#include "FreeRTOS.h"
+
+#endif // HOST_FREERTOS_EVENT_GROUPS_H
@@ -0,0 +1,22 @@
+#ifndef HOST_LWIP_DHCP_H
+#define HOST_LWIP_DHCP_H
+
+// === Host shim for lwIP's DHCP client ===
+// Bound while the emulated AP's link is up on an address it leased,
+// offering the lease set by host_wifi_set_lease().
+
+#include <stdint.h>
+
+#define DHCP_STATE_OFF 0
+#define DHCP_STATE_BOUND 10
+
+struct netif;
+
+struct dhcp {
+  uint8_t state;
+  uint32_t offered_t0_lease; // Seconds, option 51 of the ACK
+};
+
+struct dhcp *netif_dhcp_data(struct netif *netif);
+
+#endif // HOST_LWIP_DHCP_H
@@ -0,0 +1,36 @@
+#ifndef HOST_LWIP_DNS_H
+#define HOST_LWIP_DNS_H
+
+// === Host shim for lwIP's DNS client ===
+// Names come from host_udp_map(). Each gets an address of its own that
+// WiFiUDP routes to its loopback port. host_dns_set_delay_ms() makes
+// lookups finish later on the shim's own thread, as lwIP's tcpip thread
+// does.
+
+#include <stdint.h>
+
+typedef int8_t err_t;
+#define ERR_OK 0
+#define ERR_INPROGRESS -5
+#define ERR_VAL -6
+#define ERR_ARG -16
+
+#define IPADDR_TYPE_V4 0
+
+typedef struct {
+  union {
+    struct { uint32_t addr; } ip4;
+  } u_addr;
+  uint8_t type;
+} ip_addr_t;
+
+#define ip_addr_get_ip4_u32(ipaddr) \
+  (((ipaddr) && (ipaddr)->type == IPADDR_TYPE_V4) ? (ipaddr)->u_addr.ip4.addr : 0)
+
+typedef void (*dns_found_callback)(const char *name, const ip_addr_t *ipaddr,
+                                   void *callback_arg);
+
+err_t dns_gethostbyname(const char *hostname, ip_addr_t *addr,
+                        dns_found_callback found, void *callback_arg);
+
+#endif // HOST_LWIP_DNS_H
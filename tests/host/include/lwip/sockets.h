@@ -0,0 +1,16 @@
+#ifndef HOST_LWIP_SOCKETS_H
+#define HOST_LWIP_SOCKETS_H
+
+// === Host shim for lwIP's BSD socket API ===
+// The host's own sockets, WiFiClient::fd() is a real descriptor.
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#endif // HOST_LWIP_SOCKETS_H
@@ -1,8 +1,16 @@
-#include <stdio.h>
-#include <stdint.h>
-#include <string.h>
-#include <assert.h>
-#include <stdbool.h>
+#include "global.h"
+#include "host_shims.h"
+
+// ============ HOST SETUP ============
+// Drives the real io_pin_trigger_interval() from esp_node.cpp through
+// the host shims. Times are local, last_spray is seconds into that day
+// and turned into the firmware's UTC epoch.
+
+SemaphoreHandle_t xVPMutex = NULL;
+QueueHandle_t xHMIUpdateQueue = NULL;
+EventGroupHandle_t eventGroup = NULL;
+
+#define DAY_START 1735689600UL // 2025-01-01 00:00 local
 
 // ============ TEST LOGIC FUNCTION ============
 bool compute_trigger_interval_result(
@@ -22,150 +30,44 @@ bool compute_trigger_interval_result(
            interval_hr, duration_sec);
     printf("│  Enable: %s, Last spray: %s\n",
            enable ? "yes" : "no", last_spray == 0 ? "never" : "set");
-    
-    if (!enable) {
-        printf("│  Result: DISABLED (no action)\n");
-        printf("└────────────────────────────────────────\n");
-        *would_trigger = false;
-        *new_state = current_state;
-        *next_last_spray = last_spray;  // No change
-        return true;
-    }
 
-    if (duration_sec < 1 || duration_sec > 99) {
-        printf("│  ERROR: Duration must be 1-99 seconds\n");
-        printf("└────────────────────────────────────────\n");
-        *would_trigger = false;
-        *new_state = current_state;
-        *next_last_spray = last_spray;
-        return false;  // Return false to indicate error
-    }
+    uint32_t now_sec = current_hr * 3600 + current_min * 60 + current_sec;
+    uint32_t day = DAY_START - TIME_LOCAL_OFFSET; // UTC of local midnight
+    time_snapshot_t now;
+    time_set_epoch(day + now_sec);
+    time_now(&now);
 
-    if (interval_hr < 1 || interval_hr > 12) {
-        printf("│  ERROR: Interval must be 1-12 hours\n");
-        printf("└────────────────────────────────────────\n");
-        *would_trigger = false;
-        *new_state = current_state;
-        *next_last_spray = last_spray;
-        return false;
+    // A spray after the current time of day was yesterday's
+    uint32_t last_epoch = 0;
+    if (last_spray != 0) {
+        last_epoch = day + last_spray - (last_spray > now_sec ? 86400 : 0);
     }
 
-    bool in_schedule = false;
-    const uint16_t MINUTES_IN_DAY = 24 * 60;
-    uint16_t on_total_mins = on_hr * 60 + on_min;
-    uint16_t off_total_mins = off_hr * 60 + off_min;
-    uint16_t total_mins = current_hr * 60 + current_min;
-
-    if (on_total_mins == off_total_mins) {
-        printf("│  Schedule: ON==OFF -> disabled schedule\n");
-        in_schedule = false;
-
-    } else if (on_total_mins < off_total_mins) {
-        // Same-day schedule
-        in_schedule = ((total_mins >= on_total_mins) && 
-                       (total_mins < off_total_mins));
-        printf("│  Schedule: %s (same-day window)\n",
-               in_schedule ? "INSIDE" : "OUTSIDE");
-
-    } else {
-        // Overnight schedule  
-        in_schedule = ((total_mins >= on_total_mins) || 
-                       (total_mins < off_total_mins));
-        printf("│  Schedule: %s (overnight window)\n",
-               in_schedule ? "INSIDE" : "OUTSIDE");
-    }
-
-    uint8_t desired_state = current_state;
-    uint32_t updated_last_spray = last_spray;
-    bool schedule_triggered = false;
-
-    if (!in_schedule) {
-        // Outside spray schedule - should be OFF
-        desired_state = 0;
-        
-        if (last_spray != 0) {
-            printf("│  Logic: Outside schedule, resetting timer\n");
-            updated_last_spray = 0;
-
-        } else {
-            printf("│  Logic: Outside schedule, timer already reset\n");
-        }
-        
-    } else {
-        // Inside schedule - interval logic applies
-        uint32_t current_time_sec =
-            (current_hr * 3600) + (current_min * 60) + current_sec;
-        uint32_t interval_sec = interval_hr * 3600;
-        
-        if (last_spray == 0) {
-            // First spray - should be ON
-            printf("│  Logic: First spray in schedule\n");
-            desired_state = 1;
-            updated_last_spray = current_time_sec;
-            schedule_triggered = true;
-            
-        } else {
-            // Calculate time since last spray started
-            uint32_t time_since_last_spray;
-            
-            if (current_time_sec >= last_spray) {
-                time_since_last_spray = current_time_sec - last_spray;
-
-            } else {
-                // Handle midnight rollover
-                time_since_last_spray = (86400 - last_spray) + current_time_sec;
-            }
-            
-            printf("│  Time since last spray: %d sec\n", time_since_last_spray);
-
-            if (current_state == 1) {
-                // Currently spraying
-                if (time_since_last_spray >= duration_sec) {
-                    // Duration complete, should turn OFF
-                    printf("│  Logic: Duration complete (%d >= %d sec)\n",
-                           time_since_last_spray, duration_sec);
-                    desired_state = 0;
-                    updated_last_spray = current_time_sec;  // Reset for next interval
-                    schedule_triggered = true;
-
-                } else {
-                    printf("│  Logic: Still spraying (%d < %d sec)\n",
-                           time_since_last_spray, duration_sec);
-                }
-                
-            } else {
-                // Not currently spraying
-                if (time_since_last_spray >= interval_sec) {
-                    // Interval elapsed, should turn ON
-                    printf("│  Logic: Interval elapsed (%d >= %d sec)\n",
-                           time_since_last_spray, interval_sec);
-                    desired_state = 1;
-                    updated_last_spray = current_time_sec;  // Reset spray start time
-                    schedule_triggered = true;
-
-                } else {
-                    printf("│  Logic: Waiting for interval (%d < %d sec)\n",
-                           time_since_last_spray, interval_sec);
-                }
-            }
-        }
+    io_schedule_t schedule;
+    io_schedule_compile(&schedule, on_hr, on_min, off_hr, off_min);
+    vp.water_state = current_state;
+    io_pin_trigger_interval(
+        enable, current_state, &schedule, &now,
+        interval_hr, duration_sec, VP_WATER_STATE, "Spray", &last_epoch
+    );
+    hmi_update_item_t item;
+    while (xQueueReceive(xHMIUpdateQueue, &item, 0) == pdPASS) {
+        // Stands in for TaskHMI
     }
 
-    // Determine if state change is needed
-    bool trigger = (current_state != desired_state);
-    *would_trigger = trigger;
-    *new_state = desired_state;
-    *next_last_spray = updated_last_spray;
+    *would_trigger = vp.water_state != current_state;
+    *new_state = vp.water_state;
+    *next_last_spray = last_epoch == 0 ? 0 : (last_epoch - day) % 86400;
     
-    if (trigger) {
-        printf("│  Result: TRIGGER %s -> %s",
-               current_state ? "ON" : "OFF", desired_state ? "ON" : "OFF");
-        printf(schedule_triggered ? " (interval logic)\n" : "\n");
+    if (*would_trigger) {
+        printf("│  Result: TRIGGER %s -> %s\n",
+               current_state ? "ON" : "OFF", *new_state ? "ON" : "OFF");
 
     } else {
         printf("│  Result: NO CHANGE (already %s)\n", 
                current_state ? "ON" : "OFF");
     }
+    printf("│  Next last spray: %s\n", *next_last_spray == 0 ? "reset" : "set");
     printf("└────────────────────────────────────────\n");
     
     return true;
@@ -225,6 +127,12 @@ bool run_test_case(TestCase* tc, int test_num) {
 
 // ============ MAIN TEST SUITE ============
 int main() {
+    host_serial_quiet(true);
+    xVPMutex = xSemaphoreCreateMutex();
+    xHMIUpdateQueue = xQueueCreate(64, sizeof(hmi_update_item_t));
+    eventGroup = xEventGroupCreate();
+    memset(&vp, 0, sizeof(vp));
+
     TestCase test_suite[] = {
         // === BASIC FUNCTIONALITY ===
         {
@@ -0,0 +1,293 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "../firmware/include/io_schedule.h"
+
+// ============ VIRTUAL CLOCK ============
+#define DAY_START 1735689600UL // 2025-01-01 00:00 local
+#define HM(h, m) ((uint32_t)(h) * 3600 + (uint32_t)(m) * 60)
+
+typedef struct {
+    uint32_t minutes[64];
+    bool rising[64];
+    int count;
+} EdgeLog;
+
+static void log_edge(uint32_t minute, bool rising, void *ctx) {
+    EdgeLog *log = (EdgeLog *)ctx;
+    if (log->count < 64) {
+        log->minutes[log->count] = minute;
+        log->rising[log->count] = rising;
+    }
+    log->count++;
+}
+
+// Brute-force edges in local minutes (from, to], one minute at a time
+static int brute_edges(
+    const io_schedule_t *s, uint32_t from_min, uint32_t to_min, EdgeLog *out
+) {
+    out->count = 0;
+    for (uint32_t m = from_min + 1; m <= to_min; m++) {
+        bool cur = io_schedule_active(s, m % SCHED_MINUTES_IN_DAY);
+        bool prev = io_schedule_active(s, (m - 1) % SCHED_MINUTES_IN_DAY);
+        if (cur != prev) {
+            log_edge(m, cur, out);
+        }
+    }
+    return out->count;
+}
+
+// Old grace-period trigger, evaluated once at the tick after a stall
+static uint8_t grace_trigger(
+    const io_schedule_t *s, uint8_t state, uint32_t epoch, uint16_t grace_min
+) {
+    uint16_t m = (epoch / 60) % SCHED_MINUTES_IN_DAY;
+    if (!state && io_schedule_since_edge(s, m, true) <= grace_min) return 1;
+    if (state && io_schedule_since_edge(s, m, false) <= grace_min) return 0;
+    return state;
+}
+
+// ============ TEST HELPERS ============
+typedef struct {
+    const char* name;
+    uint8_t on_hr, on_min;
+    uint8_t off_hr, off_min;
+    uint32_t last;          // Last evaluated local epoch (0 = boot)
+    uint32_t now;           // Local epoch after the warp
+    uint8_t state;          // Relay state before the warp
+    io_reconcile_result_t expected_result;
+    int expected_edges;
+    uint8_t expected_state;
+} WarpCase;
+
+static bool run_warp_case(const WarpCase *tc, int test_num) {
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║ TEST #%02d: %-46s ║\n", test_num, tc->name);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+
+    io_schedule_t s;
+    io_schedule_compile(&s, tc->on_hr, tc->on_min, tc->off_hr, tc->off_min);
+    io_reconcile_t rec = { tc->last };
+    uint8_t state = tc->state;
+    EdgeLog log = { {0}, {0}, 0 };
+
+    io_reconcile_result_t result =
+        io_schedule_reconcile(&s, &rec, tc->now, &state, log_edge, &log);
+
+    for (int i = 0; i < log.count && i < 64; i++) {
+        printf("│  Replayed %s at day+%lu %02lu:%02lu\n",
+               log.rising[i] ? "ON " : "OFF",
+               (unsigned long)(log.minutes[i] * 60 - DAY_START) / 86400,
+               (unsigned long)(log.minutes[i] / 60 % 24),
+               (unsigned long)(log.minutes[i] % 60));
+    }
+
+    // Replays must match the brute-force edge list exactly
+    bool edges_ok = true;
+    if (result == SCHED_RECONCILE_REPLAYED || result == SCHED_RECONCILE_NONE) {
+        EdgeLog expect;
+        brute_edges(&s, tc->last / 60, tc->now / 60, &expect);
+        edges_ok = (expect.count == log.count) &&
+            memcmp(expect.minutes, log.minutes, sizeof(uint32_t) * log.count) == 0;
+    }
+
+    bool passed = edges_ok &&
+        result == tc->expected_result &&
+        log.count == tc->expected_edges &&
+        state == tc->expected_state &&
+        rec.last_epoch == tc->now;
+
+    printf("  Expected: result=%d edges=%d state=%s\n",
+           tc->expected_result, tc->expected_edges,
+           tc->expected_state ? "ON" : "OFF");
+    printf("  Got:      result=%d edges=%d state=%s\n",
+           result, log.count, state ? "ON" : "OFF");
+    printf("  Result:   %s\n", passed ? "PASS" : "FAIL");
+    return passed;
+}
+
+// Randomised ticks with stalls and NTP steps over many simulated days
+static bool run_random_warp(int test_num) {
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║ TEST #%02d: %-46s ║\n", test_num, "Random stalls and jumps, 120 days");
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+
+    srand(42);
+    unsigned long ticks = 0, replays = 0, resyncs = 0, edges = 0, missed_by_grace = 0;
+    bool passed = true;
+
+    for (int round = 0; round < 20 && passed; round++) {
+        uint16_t on = rand() % SCHED_MINUTES_IN_DAY;
+        uint16_t off = rand() % SCHED_MINUTES_IN_DAY;
+        io_schedule_t s;
+        io_schedule_compile(&s, on / 60, on % 60, off / 60, off % 60);
+
+        io_reconcile_t rec = { 0 };
+        uint8_t state = 0;
+        uint32_t now = DAY_START + rand() % 86400;
+
+        while (now < DAY_START + 120UL * 86400 && passed) {
+            uint32_t last = rec.last_epoch;
+            uint8_t before = state;
+            EdgeLog log = { {0}, {0}, 0 };
+
+            io_reconcile_result_t result =
+                io_schedule_reconcile(&s, &rec, now, &state, log_edge, &log);
+            ticks++;
+
+            if (result == SCHED_RECONCILE_RESYNC) {
+                resyncs++;
+                passed = (on == off) ||
+                    state == io_schedule_active(&s, (now / 60) % SCHED_MINUTES_IN_DAY);
+
+            } else {
+                EdgeLog expect;
+                brute_edges(&s, last / 60, now / 60, &expect);
+                passed = expect.count == log.count &&
+                    memcmp(expect.minutes, log.minutes,
+                           sizeof(uint32_t) * (log.count < 64 ? log.count : 64)) == 0;
+
+                if (result == SCHED_RECONCILE_REPLAYED) {
+                    replays++;
+                    edges += log.count;
+                    passed = passed && state ==
+                        io_schedule_active(&s, (now / 60) % SCHED_MINUTES_IN_DAY);
+
+                    // Would the old 1-minute grace check have caught it?
+                    if (grace_trigger(&s, before, now, 1) != state) {
+                        missed_by_grace++;
+                    }
+                }
+            }
+
+            if (!passed) {
+                printf("  MISMATCH round=%d on=%u off=%u last=%lu now=%lu\n",
+                       round, on, off, (unsigned long)last, (unsigned long)now);
+            }
+
+            // Mostly 0.5-60 s ticks, with stalls, NTP steps and outages
+            int dice = rand() % 1000;
+            if (dice < 5) {
+                now -= 1 + rand() % 3600;              // Step back
+            } else if (dice < 25) {
+                now += 600 + rand() % (20 * 3600);     // Stall / outage
+            } else if (dice < 27) {
+                now += 2 * 86400 + rand() % 86400;     // Gap > 1 day
+            } else {
+                now += 1 + rand() % 60;                // Normal tick
+            }
+        }
+    }
+
+    printf("  Ticks: %lu, replays: %lu, edges: %lu, resyncs: %lu\n",
+           ticks, replays, edges, resyncs);
+    printf("  Transitions the 1-minute grace check would miss: %lu\n",
+           missed_by_grace);
+    printf("  Result:   %s\n", passed ? "PASS" : "FAIL");
+    return passed;
+}
+
+// ============ MAIN TEST SUITE ============
+int main() {
+    const uint32_t D = DAY_START;
+    WarpCase test_suite[] = {
+        // === NORMAL TICKS ===
+        {
+            "Tick without edge keeps state",
+            9, 0, 21, 0,
+            D + HM(10, 0), D + HM(10, 1), 1,
+            SCHED_RECONCILE_NONE, 0, 1
+        },
+        {
+            "Manual override survives without edge",
+            9, 0, 21, 0,
+            D + HM(10, 0), D + HM(10, 1), 0,  // OFF by hand inside window
+            SCHED_RECONCILE_NONE, 0, 0
+        },
+        {
+            "Tick onto ON edge",
+            9, 0, 21, 0,
+            D + HM(8, 59) + 59, D + HM(9, 0), 0,
+            SCHED_RECONCILE_REPLAYED, 1, 1
+        },
+
+        // === STALLS ===
+        {
+            "5h stall across ON edge",
+            9, 0, 21, 0,
+            D + HM(8, 0), D + HM(13, 0), 0,
+            SCHED_RECONCILE_REPLAYED, 1, 1
+        },
+        {
+            "14h stall across ON and OFF",
+            9, 0, 21, 0,
+            D + HM(8, 0), D + HM(22, 0), 0,
+            SCHED_RECONCILE_REPLAYED, 2, 0
+        },
+        {
+            "Overnight stall across midnight",
+            21, 0, 6, 0,
+            D + HM(20, 30), D + 86400 + HM(7, 0), 0,
+            SCHED_RECONCILE_REPLAYED, 2, 0
+        },
+        {
+            "Stall ends exactly on OFF edge",
+            9, 0, 21, 0,
+            D + HM(12, 0), D + HM(21, 0), 1,
+            SCHED_RECONCILE_REPLAYED, 1, 0
+        },
+
+        // === CLOCK JUMPS ===
+        {
+            "NTP step back 1h resyncs",
+            9, 0, 21, 0,
+            D + HM(9, 30), D + HM(8, 30), 1,
+            SCHED_RECONCILE_RESYNC, 0, 0
+        },
+        {
+            "Outage over one day resyncs",
+            9, 0, 21, 0,
+            D + HM(22, 0), D + 3 * 86400 + HM(10, 0), 0,
+            SCHED_RECONCILE_RESYNC, 0, 1
+        },
+        {
+            "Boot resyncs to stateless state",
+            22, 0, 6, 0,
+            0, D + HM(2, 0), 0,
+            SCHED_RECONCILE_RESYNC, 0, 1
+        },
+
+        // === DISABLED SCHEDULE ===
+        {
+            "ON==OFF never replays",
+            9, 0, 9, 0,
+            D + HM(8, 0), D + HM(13, 0), 1,
+            SCHED_RECONCILE_NONE, 0, 1
+        }
+    };
+
+    int total_tests = sizeof(test_suite) / sizeof(test_suite[0]);
+    int passed_tests = 0;
+
+    for (int i = 0; i < total_tests; i++) {
+        if (run_warp_case(&test_suite[i], i + 1)) passed_tests++;
+    }
+
+    total_tests++;
+    if (run_random_warp(total_tests)) passed_tests++;
+
+    // ============ SUMMARY ============
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║%*sTEST SUMMARY%*s║\n", 46/2, "", (46+1)/ 2, "");
+    printf("║══════════════════════════════════════════════════════════║\n");
+    printf("║  Total tests   : %-39d ║\n", total_tests);
+    printf("║  Passed        : %-39d ║\n", passed_tests);
+    printf("║  Failed        : %-39d ║\n", total_tests - passed_tests);
+    printf("║  Success rate  : %-39.f ║\n",
+        (float)passed_tests / total_tests * 100);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+
+    return (passed_tests == total_tests) ? 0 : 1; // Indicate failure
+}
@@ -0,0 +1,304 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "../firmware/include/io_schedule.h"
+
+// ============ REFERENCE LOGIC (from esp_node.cpp) ============
+// io_pin_trigger() desired state before the day bitmap
+static uint8_t ref_trigger_state(
+    uint8_t current_state,
+    uint16_t on_total_mins, uint16_t off_total_mins,
+    uint16_t total_mins, uint16_t grace_min, bool on_boot
+) {
+    const uint16_t MINUTES_IN_DAY = 24 * 60;
+    uint8_t desired_state = current_state;
+
+    if (on_total_mins == off_total_mins) {
+        return current_state;
+
+    } else if (!on_boot) {
+        uint16_t minutes_since_on =
+            (total_mins - on_total_mins + MINUTES_IN_DAY) % MINUTES_IN_DAY;
+        uint16_t minutes_since_off =
+            (total_mins - off_total_mins + MINUTES_IN_DAY) % MINUTES_IN_DAY;
+
+        if (!current_state && (minutes_since_on <= grace_min)) {
+            desired_state = 1;
+
+        } else if (current_state && (minutes_since_off <= grace_min)) {
+            desired_state = 0;
+        }
+
+    } else {
+        if (on_total_mins < off_total_mins) {
+            desired_state = ((total_mins >= on_total_mins) &&
+                             (total_mins < off_total_mins));
+
+        } else {
+            desired_state = ((total_mins >= on_total_mins) ||
+                             (total_mins < off_total_mins));
+        }
+    }
+
+    return desired_state;
+}
+
+// io_pin_trigger_interval() in_schedule before the day bitmap
+static bool ref_in_schedule(
+    uint16_t on_total_mins, uint16_t off_total_mins, uint16_t total_mins
+) {
+    if (on_total_mins == off_total_mins) {
+        return false;
+
+    } else if (on_total_mins < off_total_mins) {
+        return ((total_mins >= on_total_mins) &&
+                (total_mins < off_total_mins));
+
+    } else {
+        return ((total_mins >= on_total_mins) ||
+                (total_mins < off_total_mins));
+    }
+}
+
+// ============ BITMAP LOGIC (as used in esp_node.cpp) ============
+static uint8_t bitmap_trigger_state(
+    const io_schedule_t *schedule, uint8_t current_state,
+    uint16_t total_mins, uint16_t grace_min, bool on_boot
+) {
+    if (io_schedule_is_empty(schedule)) {
+        return current_state;
+
+    } else if (!on_boot) {
+        if (!current_state &&
+            io_schedule_since_edge(schedule, total_mins, true) <= grace_min) {
+            return 1;
+
+        } else if (current_state &&
+            io_schedule_since_edge(schedule, total_mins, false) <= grace_min) {
+            return 0;
+        }
+        return current_state;
+    }
+
+    return io_schedule_active(schedule, total_mins);
+}
+
+// ============ BRUTE FORCE EDGE SEARCH ============
+static bool raw_bit(const io_schedule_t *s, int minute) {
+    minute = (minute + SCHED_MINUTES_IN_DAY) % SCHED_MINUTES_IN_DAY;
+    return (s->bits[minute / 32] >> (31 - minute % 32)) & 1u;
+}
+
+static bool raw_edge(const io_schedule_t *s, int minute, bool rising) {
+    bool cur = raw_bit(s, minute);
+    bool prev = raw_bit(s, minute - 1);
+    return rising ? (cur && !prev) : (!cur && prev);
+}
+
+static uint16_t brute_next_edge(const io_schedule_t *s, int minute, bool rising) {
+    for (int d = 0; d < SCHED_MINUTES_IN_DAY; d++) {
+        if (raw_edge(s, minute + d, rising)) return d;
+    }
+    return SCHED_NO_EDGE;
+}
+
+static uint16_t brute_since_edge(const io_schedule_t *s, int minute, bool rising) {
+    for (int d = 0; d < SCHED_MINUTES_IN_DAY; d++) {
+        if (raw_edge(s, minute - d, rising)) return d;
+    }
+    return SCHED_NO_EDGE;
+}
+
+// ============ TEST CASES ============
+static int report(const char *name, unsigned long checked, unsigned long failed) {
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║ %-56s ║\n", name);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+    printf("  Checked:  %lu\n", checked);
+    printf("  Mismatch: %lu\n", failed);
+    printf("  Result:   %s\n", failed == 0 ? "PASS" : "FAIL");
+    return failed == 0;
+}
+
+// Every ON/OFF pair, every minute: bitmap vs in_schedule & boot state
+static int test_state_exhaustive(void) {
+    unsigned long checked = 0, failed = 0;
+    io_schedule_t s;
+
+    for (uint16_t on = 0; on < SCHED_MINUTES_IN_DAY; on++) {
+        for (uint16_t off = 0; off < SCHED_MINUTES_IN_DAY; off++) {
+            io_schedule_compile(&s, on / 60, on % 60, off / 60, off % 60);
+
+            // Rebuild each word from the reference logic, minute by minute
+            for (uint16_t w = 0; w < SCHED_WORDS; w++) {
+                uint32_t in_schedule = 0, boot = 0;
+                for (uint16_t b = 0; b < SCHED_WORD_BITS; b++) {
+                    uint16_t m = w * SCHED_WORD_BITS + b;
+                    in_schedule = (in_schedule << 1) | ref_in_schedule(on, off, m);
+                    boot = (boot << 1) | ref_trigger_state(0, on, off, m, 0, true);
+                }
+
+                checked += SCHED_WORD_BITS;
+                if (s.bits[w] != in_schedule || s.bits[w] != boot) {
+                    if (failed++ < 5) {
+                        printf("  MISMATCH on=%u off=%u word=%u\n", on, off, w);
+                    }
+                }
+            }
+        }
+    }
+
+    return report("State: all schedules x all minutes", checked, failed);
+}
+
+// Single-edge distances and grace triggers for one schedule/minute
+static bool check_edges(
+    const io_schedule_t *s, uint16_t on, uint16_t off, uint16_t m
+) {
+    const uint16_t graces[] = {0, 1, 5};
+    uint16_t since_on = io_schedule_since_edge(s, m, true);
+    uint16_t since_off = io_schedule_since_edge(s, m, false);
+    uint16_t next_on = io_schedule_next_edge(s, m, true);
+    uint16_t next_off = io_schedule_next_edge(s, m, false);
+    bool ok;
+
+    if (on == off) {
+        ok = since_on == SCHED_NO_EDGE && since_off == SCHED_NO_EDGE &&
+             next_on == SCHED_NO_EDGE && next_off == SCHED_NO_EDGE;
+    } else {
+        ok = since_on == (m - on + 1440) % 1440 &&
+             since_off == (m - off + 1440) % 1440 &&
+             next_on == (on - m + 1440) % 1440 &&
+             next_off == (off - m + 1440) % 1440;
+    }
+
+    // Bit test lookup agrees with the boot-mode correction
+    ok = ok && io_schedule_active(s, m) ==
+         (bool)ref_trigger_state(0, on, off, m, 0, true);
+
+    for (size_t g = 0; ok && g < sizeof(graces) / sizeof(graces[0]); g++) {
+        for (uint8_t state = 0; state <= 1; state++) {
+            uint8_t expect = ref_trigger_state(
+                state, on, off, m, graces[g], false);
+            uint8_t got = bitmap_trigger_state(
+                s, state, m, graces[g], false);
+            ok = ok && (expect == got);
+        }
+    }
+
+    return ok;
+}
+
+// Every ON/OFF pair: edge minutes, their neighbours and a day stride
+static int test_grace_all_schedules(void) {
+    unsigned long checked = 0, failed = 0;
+    io_schedule_t s;
+
+    for (uint16_t on = 0; on < SCHED_MINUTES_IN_DAY; on++) {
+        for (uint16_t off = 0; off < SCHED_MINUTES_IN_DAY; off++) {
+            io_schedule_compile(&s, on / 60, on % 60, off / 60, off % 60);
+
+            const int offsets[] = {-1, 0, 1, 5, 6};
+            uint16_t minutes[32];
+            size_t n = 0;
+            for (size_t k = 0; k < sizeof(offsets) / sizeof(offsets[0]); k++) {
+                minutes[n++] = (on + offsets[k] + 1440) % 1440;
+                minutes[n++] = (off + offsets[k] + 1440) % 1440;
+            }
+            for (uint16_t m = (on + off) % 241; m < 1440; m += 241) {
+                minutes[n++] = m;
+            }
+
+            for (size_t k = 0; k < n; k++) {
+                checked++;
+                if (!check_edges(&s, on, off, minutes[k]) && failed++ < 5) {
+                    printf("  MISMATCH on=%u off=%u m=%u\n", on, off, minutes[k]);
+                }
+            }
+        }
+    }
+
+    return report("Edges: all schedules x edge minutes", checked, failed);
+}
+
+// Quarter-hour ON/OFF grid, every minute of the day
+static int test_grace_all_minutes(void) {
+    unsigned long checked = 0, failed = 0;
+    io_schedule_t s;
+
+    for (uint16_t on = 0; on < SCHED_MINUTES_IN_DAY; on += 15) {
+        for (uint16_t off = 0; off < SCHED_MINUTES_IN_DAY; off += 15) {
+            io_schedule_compile(&s, on / 60, on % 60, off / 60, off % 60);
+
+            for (uint16_t m = 0; m < SCHED_MINUTES_IN_DAY; m++) {
+                checked++;
+                if (!check_edges(&s, on, off, m) && failed++ < 5) {
+                    printf("  MISMATCH on=%u off=%u m=%u\n", on, off, m);
+                }
+            }
+        }
+    }
+
+    return report("Edges: quarter-hour schedules x all minutes", checked, failed);
+}
+
+// Arbitrary bitmaps with many edges vs brute-force minute scan
+static int test_search_random(void) {
+    unsigned long checked = 0, failed = 0;
+    io_schedule_t s;
+    srand(1234);
+
+    for (int round = 0; round < 200; round++) {
+        // Vary density so sparse, dense and single-bit maps appear
+        int density = 1 + round % 64;
+        memset(&s, 0, sizeof(s));
+        for (int m = 0; m < SCHED_MINUTES_IN_DAY; m++) {
+            if (rand() % 128 < density) {
+                s.bits[m / 32] |= 1u << (31 - m % 32);
+            }
+        }
+
+        for (int m = 0; m < SCHED_MINUTES_IN_DAY; m++) {
+            for (int rising = 0; rising <= 1; rising++) {
+                checked++;
+                if (io_schedule_next_edge(&s, m, rising) !=
+                        brute_next_edge(&s, m, rising) ||
+                    io_schedule_since_edge(&s, m, rising) !=
+                        brute_since_edge(&s, m, rising)) {
+                    if (failed++ < 5) {
+                        printf("  MISMATCH round=%d m=%d rising=%d\n",
+                               round, m, rising);
+                    }
+                }
+            }
+        }
+    }
+
+    return report("Search: random bitmaps vs brute force", checked, failed);
+}
+
+// ============ MAIN TEST SUITE ============
+int main() {
+    int total_tests = 0;
+    int passed_tests = 0;
+
+    total_tests++; passed_tests += test_state_exhaustive();
+    total_tests++; passed_tests += test_grace_all_schedules();
+    total_tests++; passed_tests += test_grace_all_minutes();
+    total_tests++; passed_tests += test_search_random();
+
+    // ============ SUMMARY ============
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║%*sTEST SUMMARY%*s║\n", 46/2, "", (46+1)/ 2, "");
+    printf("║══════════════════════════════════════════════════════════║\n");
+    printf("║  Total tests   : %-39d ║\n", total_tests);
+    printf("║  Passed        : %-39d ║\n", passed_tests);
+    printf("║  Failed        : %-39d ║\n", total_tests - passed_tests);
+    printf("║  Success rate  : %-39.f ║\n",
+        (float)passed_tests / total_tests * 100);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+
+    return (passed_tests == total_tests) ? 0 : 1; // Indicate failure
+}
@@ -1,63 +1,16 @@
-#include <stdio.h>
-#include <stdint.h>
-#include <string.h>
-#include <assert.h>
-#include <stdbool.h>
+#include "global.h"
+#include "host_shims.h"
 
-// ============ ORIGINAL FUNCTION (for reference) ============
-/*
-void io_pin_trigger(
-    uint8_t enable, uint8_t current_state,
-    uint8_t on_hr, uint8_t on_min,
-    uint8_t off_hr, uint8_t off_min,
-    uint16_t current_hr, uint16_t current_min,
-    uint16_t grace_min, bool on_boot,
-    uint16_t address, const char *relay_str
-) {
-    if (!enable) {
-        return;
-    }
-
-    const uint16_t MINUTES_IN_DAY = 24 * 60;
-    uint16_t on_total_mins = on_hr * 60 + on_min;
-    uint16_t off_total_mins = off_hr * 60 + off_min;
-    uint16_t total_mins = current_hr * 60 + current_min;
+// ============ HOST SETUP ============
+// Drives the real io_pin_reconcile() from esp_node.cpp through the host
+// shims. A boot starts with no evaluation yet, a grace period of N min
+// is a last evaluation N + 1 min ago, so edges in the last N min replay.
 
-    uint8_t desired_state = current_state;
-
-    if (on_total_mins == off_total_mins) {
-        return;
-    
-    } else if (!on_boot) {
-        uint16_t minutes_since_on = 
-            (total_mins - on_total_mins + MINUTES_IN_DAY) % MINUTES_IN_DAY;
-        uint16_t minutes_since_off = 
-            (total_mins - off_total_mins + MINUTES_IN_DAY) % MINUTES_IN_DAY;
-
-        if (!current_state && (minutes_since_on <= grace_min)) {
-            desired_state = 1;
-
-        } else if (current_state && (minutes_since_off <= grace_min)) {
-            desired_state = 0;
-        }
-
-    } else {
-        if (on_total_mins < off_total_mins) {
-            desired_state = ((total_mins >= on_total_mins) &&
-                             (total_mins < off_total_mins));
-
-        } else {
-            desired_state = ((total_mins >= on_total_mins) ||
-                             (total_mins < off_total_mins));
-        }
-    }
+SemaphoreHandle_t xVPMutex = NULL;
+QueueHandle_t xHMIUpdateQueue = NULL;
+EventGroupHandle_t eventGroup = NULL;
 
-    if (current_state != desired_state) {
-        printf("[TRIGGER] %s -> %s (boot=%d)\n", 
-               relay_str, desired_state ? "ON" : "OFF", on_boot);
-    }
-}
-*/
+#define DAY_START 1735689600UL // 2025-01-01 00:00 local
 
 // ============ TEST LOGIC FUNCTION ============
 bool compute_trigger_result(
@@ -74,75 +27,33 @@ bool compute_trigger_result(
            current_hr, current_min, current_state ? "ON" : "OFF");
     printf("│  Grace: %d min, Boot: %s, Enable: %s\n",
            grace_min, on_boot ? "yes" : "no", enable ? "yes" : "no");
-    
-    if (!enable) {
-        printf("│  Result: DISABLED (no action)\n");
-        printf("└────────────────────────────────────────\n");
-        *would_trigger = false;
-        *new_state = current_state;
-        return true;
-    }
-
-    const uint16_t MINUTES_IN_DAY = 24 * 60;
-    uint16_t on_total_mins = on_hr * 60 + on_min;
-    uint16_t off_total_mins = off_hr * 60 + off_min;
-    uint16_t total_mins = current_hr * 60 + current_min;
 
-    uint8_t desired_state = current_state;
-
-    if (on_total_mins == off_total_mins) {
-        printf("│  Logic: ON==OFF -> disabled schedule (no action)\n");
-        printf("│  Result: DISABLED (schedule has zero duration)\n");
-        printf("└────────────────────────────────────────\n");
-        *would_trigger = false;
-        *new_state = current_state;
-        return true;
-    }
+    uint32_t local_epoch = DAY_START + current_hr * 3600 + current_min * 60;
+    time_snapshot_t now;
+    time_set_epoch(local_epoch - TIME_LOCAL_OFFSET);
+    time_now(&now);
 
+    io_schedule_t schedule;
+    io_schedule_compile(&schedule, on_hr, on_min, off_hr, off_min);
+    io_reconcile_t rec = {0};
     if (!on_boot) {
-        uint16_t minutes_since_on = 
-            (total_mins - on_total_mins + MINUTES_IN_DAY) % MINUTES_IN_DAY;
-        uint16_t minutes_since_off = 
-            (total_mins - off_total_mins + MINUTES_IN_DAY) % MINUTES_IN_DAY;
-
-        if (!current_state && (minutes_since_on <= grace_min)) {
-            desired_state = 1;
-            printf("│  Logic: Within grace after ON (%d <= %d min)\n", 
-                   minutes_since_on, grace_min);
-            
-        } else if (current_state && (minutes_since_off <= grace_min)) {
-            desired_state = 0;
-            printf("│  Logic: Within grace after OFF (%d <= %d min)\n", 
-                   minutes_since_off, grace_min);
-
-        } else {
-            printf("│  Logic: No trigger needed, or outside the grace period\n");
-        }
-
-    } else {
-        if (on_total_mins < off_total_mins) {
-            bool should_be_on = (total_mins >= on_total_mins) && 
-                                (total_mins < off_total_mins);
-            desired_state = should_be_on;
-            printf("│  Logic: Same-day schedule, should be %s\n",
-                   should_be_on ? "ON" : "OFF");
+        rec.last_epoch = local_epoch - (grace_min + 1) * 60;
+    }
 
-        } else {
-            bool should_be_on = (total_mins >= on_total_mins) || 
-                                (total_mins < off_total_mins);
-            desired_state = should_be_on;
-            printf("│  Logic: Overnight schedule, should be %s\n",
-                   should_be_on ? "ON" : "OFF");
-        }
+    vp.light_state = current_state;
+    io_pin_reconcile(enable, current_state, &schedule, &now, &rec,
+                     VP_LIGHT_STATE, "Light");
+    hmi_update_item_t item;
+    while (xQueueReceive(xHMIUpdateQueue, &item, 0) == pdPASS) {
+        // Stands in for TaskHMI
     }
 
-    bool trigger = (current_state != desired_state);
-    *would_trigger = trigger;
-    *new_state = desired_state;
-    
-    if (trigger) {
+    *would_trigger = vp.light_state != current_state;
+    *new_state = vp.light_state;
+
+    if (*would_trigger) {
         printf("│  Result: TRIGGER %s -> %s\n", 
-               current_state ? "ON" : "OFF", desired_state ? "ON" : "OFF");
+               current_state ? "ON" : "OFF", *new_state ? "ON" : "OFF");
 
     } else {
         printf("│  Result: NO CHANGE (already %s)\n", 
@@ -199,6 +110,12 @@ bool run_test_case(TestCase* tc, int test_num) {
 
 // ============ MAIN TEST SUITE ============
 int main() {
+    host_serial_quiet(true);
+    xVPMutex = xSemaphoreCreateMutex();
+    xHMIUpdateQueue = xQueueCreate(64, sizeof(hmi_update_item_t));
+    eventGroup = xEventGroupCreate();
+    memset(&vp, 0, sizeof(vp));
+
     TestCase test_suite[] = {
         // === BASIC FUNCTIONALITY ===
         {
@@ -0,0 +1,420 @@
+#include "global.h"
+#include "host_shims.h"
+#include <esp_partition.h>
+#include <esp_system.h>
+#include <arpa/inet.h>
+#include <chrono>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+// ============ HOST SETUP ============
+// The journal partition is the emulated NOR flash in host_shims.cpp.
+// A reboot is journal_begin() again with a new reset reason, TaskLog
+// is stood in for by journal_flush() calls.
+
+SemaphoreHandle_t xVPMutex = NULL;
+QueueHandle_t xHMIUpdateQueue = NULL;
+EventGroupHandle_t eventGroup = NULL;
+
+static uint16_t api_port = 0;
+
+static void string_sink(const char *text, size_t len, void *ctx) {
+    ((std::string *)ctx)->append(text, len);
+}
+
+static std::string dump(uint32_t since) {
+    std::string text;
+    journal_write(string_sink, &text, since);
+    return text;
+}
+
+// Records of a dump, header skipped
+typedef struct {
+    unsigned long seq;
+    unsigned boot;
+    char type[8];
+    char event[12];
+    long value;
+    char detail[16];
+} row_t;
+
+static std::vector<row_t> rows(const std::string &text) {
+    std::vector<row_t> out;
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find('\n', start);
+        std::string line = text.substr(start, end - start);
+        start = end + 1;
+        row_t r;
+        unsigned long up, epoch;
+        if (line[0] != '#' &&
+            sscanf(line.c_str(), "%lu %u %lu %lu %7s %11s %ld %15s", &r.seq, &r.boot, &up,
+                   &epoch, r.type, r.event, &r.value, r.detail) == 8) {
+            out.push_back(r);
+        }
+    }
+    return out;
+}
+
+// Sequence numbers strictly ascending by one
+static bool contiguous(const std::vector<row_t> &r) {
+    for (size_t i = 1; i < r.size(); i++) {
+        if (r[i].seq != r[i - 1].seq + 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void reboot(int reason) {
+    host_reset_reason_set(reason);
+    journal_begin();
+    journal_flush();
+}
+
+static uint32_t dropped(void) {
+    return __atomic_load_n(&metric_journal_dropped.value, __ATOMIC_RELAXED);
+}
+
+// === Client ===
+// One request polled the way TaskWiFi does, the body in `body`
+static int http_get(const char *path, std::string *body) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(api_port);
+    if (connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    char req[200];
+    int len = snprintf(req, sizeof(req), "GET %s HTTP/1.1\r\nHost: node\r\n\r\n", path);
+    send(fd, req, len, 0);
+
+    std::string reply;
+    char buf[2048];
+    for (int spins = 0; spins < 100000; spins++) {
+        vp_http_poll();
+        ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n > 0) {
+            reply.append(buf, n);
+        } else if (n == 0) {
+            break;
+        }
+    }
+    close(fd);
+
+    int status = 0;
+    sscanf(reply.c_str(), "HTTP/1.1 %d", &status);
+    size_t split = reply.find("\r\n\r\n");
+    *body = split == std::string::npos ? "" : reply.substr(split + 4);
+    return status;
+}
+
+// ============ TEST HELPERS ============
+static int total_tests = 0;
+static int passed_tests = 0;
+
+static void report(const char *name, bool passed, const char *detail) {
+    total_tests++;
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║ TEST #%02d: %-46s ║\n", total_tests, name);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+    printf("  %s\n", detail);
+    printf("  Result:   %s\n", passed ? "PASS" : "FAIL");
+    if (passed) passed_tests++;
+}
+
+// ============ MAIN TEST SUITE ============
+int main() {
+    host_serial_quiet(true);
+    host_clock_set_us(1000000);
+    char detail[300];
+    const uint32_t per_sector = SPI_FLASH_SEC_SIZE / sizeof(journal_record_t);
+    const uint32_t sectors = HOST_FLASH_SIZE / SPI_FLASH_SEC_SIZE;
+
+    xVPMutex = xSemaphoreCreateMutex();
+    xHMIUpdateQueue = xQueueCreate(64, sizeof(hmi_update_item_t));
+    eventGroup = xEventGroupCreate();
+
+    memset(&vp, 0, sizeof(vp));
+    strcpy(vp.hostname, "E-1A2B");
+    vp_save_values();
+    io_schedule_init();
+    time_set_epoch(1760780000);
+
+    // === FIRST BOOT ===
+    {
+        host_reset_reason_set(ESP_RST_POWERON);
+        bool started = journal_begin();
+        size_t written = journal_flush();
+        std::vector<row_t> r = rows(dump(0));
+
+        snprintf(detail, sizeof(detail), "begin %s, %u written, first record %s %s boot %u seq %lu",
+                 started ? "ok" : "failed", (unsigned)written, r.empty() ? "-" : r[0].type,
+                 r.empty() ? "-" : r[0].event, r.empty() ? 0 : r[0].boot,
+                 r.empty() ? 0 : r[0].seq);
+        report("Blank partition starts at boot 1",
+               started && written == 1 && r.size() == 1 && r[0].seq == 1 && r[0].boot == 1 &&
+               strcmp(r[0].type, "boot") == 0 && strcmp(r[0].event, "POWERON") == 0 &&
+               strcmp(r[0].detail, FW_VERSION) == 0, detail);
+    }
+
+    // === EVENTS AND A WATCHDOG RESET ===
+    {
+        journal_relay(LIGHT_RELAY, 1);
+        journal_relay(LIGHT_RELAY, 1); // Full HMI refresh, same level
+        journal_relay(FAN_RELAY, 0);
+        wifi_on_link_change(WIFI_LINK_UP, WIFI_LINK_CONNECTING);
+        wifi_on_link_change(WIFI_LINK_BACKOFF, WIFI_LINK_UP);
+        wifi_on_link_change(WIFI_LINK_CONNECTING, WIFI_LINK_BACKOFF); // Retry, not logged
+        journal_log(JOURNAL_OTA, JOURNAL_OTA_FAILED, 4, NULL);
+        journal_flush();
+        reboot(ESP_RST_TASK_WDT);
+
+        std::string text = dump(0);
+        std::vector<row_t> r = rows(text);
+        bool relays = text.find(" relay ON 23 light\n") != std::string::npos &&
+                      text.find(" relay OFF 21 fan\n") != std::string::npos;
+        bool wifi = text.find(" wifi UP 1 -\n") != std::string::npos &&
+                    text.find(" wifi BACKOFF 2 -\n") != std::string::npos;
+        bool ota = text.find(" ota FAILED 4 -\n") != std::string::npos;
+        bool boot = !r.empty() && strcmp(r.back().event, "TASK_WDT") == 0 && r.back().boot == 2;
+        snprintf(detail, sizeof(detail),
+                 "%u records, relays %s, wifi %s, ota %s, last %s %s boot %u",
+                 (unsigned)r.size(), relays ? "ok" : "wrong", wifi ? "ok" : "wrong",
+                 ota ? "ok" : "missing", r.empty() ? "-" : r.back().type,
+                 r.empty() ? "-" : r.back().event, r.empty() ? 0 : r.back().boot);
+        report("Reboot keeps events, reason recorded",
+               r.size() == 7 && contiguous(r) && relays && wifi && ota && boot, detail);
+    }
+
+    // === SECTOR ROTATION ===
+    {
+        host_flash_stats_t before, after;
+        host_flash_stats(&before);
+        const uint32_t total = sectors * per_sector * 4;
+        for (uint32_t i = 0; i < total; i++) {
+            journal_log(JOURNAL_RELAY, i & 1, WATER_RELAY, "water");
+            if (i % JOURNAL_QUEUE_LEN == JOURNAL_QUEUE_LEN - 1) {
+                journal_flush();
+            }
+        }
+        journal_flush();
+        host_flash_stats(&after);
+
+        unsigned long lo = ~0UL, hi = 0;
+        for (uint32_t s = 0; s < sectors; s++) {
+            unsigned long n = after.sector_erases[s] - before.sector_erases[s];
+            lo = n < lo ? n : lo;
+            hi = n > hi ? n : hi;
+        }
+        std::vector<row_t> r = rows(dump(0));
+        reboot(ESP_RST_SW);
+        std::vector<row_t> again = rows(dump(0));
+
+        snprintf(detail, sizeof(detail),
+                 "%lu records, erases per sector %lu..%lu, kept %u (%lu..%lu), next %lu",
+                 (unsigned long)total, lo, hi, (unsigned)r.size(), r.empty() ? 0 : r[0].seq,
+                 r.empty() ? 0 : r.back().seq, again.empty() ? 0 : again.back().seq);
+        report("Sectors wear evenly, oldest dropped",
+               hi - lo <= 1 && lo >= 3 && contiguous(r) &&
+               r.size() > (sectors - 1) * per_sector && r.size() <= sectors * per_sector &&
+               !again.empty() && again.back().seq == r.back().seq + 1 &&
+               strcmp(again.back().event, "SW") == 0, detail);
+    }
+
+    // === TORN WRITE ===
+    {
+        journal_log(JOURNAL_RELAY, 1, LIGHT_RELAY, "light");
+        journal_flush();
+        journal_log(JOURNAL_OTA, JOURNAL_OTA_START, 0, "sketch");
+        host_flash_tear_next_write(13); // Power cut mid-record
+        journal_flush();
+        reboot(ESP_RST_BROWNOUT);
+
+        std::vector<row_t> r = rows(dump(0));
+        size_t n = r.size();
+        bool tail = n >= 2 && strcmp(r[n - 2].event, "ON") == 0 &&
+                    strcmp(r[n - 1].event, "BROWNOUT") == 0;
+        bool started = false;
+        for (const row_t &row : r) {
+            started |= strcmp(row.event, "START") == 0;
+        }
+        snprintf(detail, sizeof(detail), "last two %s, %s, torn record %s, sequence %s",
+                 n >= 2 ? r[n - 2].event : "-", n ? r[n - 1].event : "-",
+                 started ? "listed" : "skipped", contiguous(r) ? "contiguous" : "broken");
+        report("Torn record skipped after power cut", tail && !started && contiguous(r), detail);
+    }
+
+    // === FOREIGN PARTITION CONTENTS ===
+    {
+        host_flash_fill(0x5A);
+        reboot(ESP_RST_POWERON);
+        std::vector<row_t> r = rows(dump(0));
+        host_flash_stats_t stats;
+        host_flash_stats(&stats);
+        snprintf(detail, sizeof(detail), "%u records, seq %lu boot %u, %lu erase(s)",
+                 (unsigned)r.size(), r.empty() ? 0 : r[0].seq, r.empty() ? 0 : r[0].boot,
+                 stats.erases);
+        report("Garbage partition is reinitialised",
+               r.size() == 1 && r[0].seq == 1 && r[0].boot == 1 && stats.erases == 1, detail);
+    }
+
+    // === CALLERS NEVER WAIT ON FLASH ===
+    {
+        host_flash_set_latency(60, 45000); // Flash word write and sector erase
+        uint32_t drops = dropped();
+        int64_t start = host_clock_us();
+        auto wall = std::chrono::steady_clock::now();
+        int queued = 0;
+        for (int i = 0; i < JOURNAL_QUEUE_LEN + 4; i++) {
+            queued += journal_log(JOURNAL_RELAY, i & 1, FAN_RELAY, "fan");
+        }
+        double ns = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - wall).count() / (JOURNAL_QUEUE_LEN + 4);
+        int64_t log_us = host_clock_us() - start;
+
+        start = host_clock_us();
+        size_t written = journal_flush();
+        int64_t flush_us = host_clock_us() - start;
+        host_flash_set_latency(0, 0);
+
+        snprintf(detail, sizeof(detail),
+                 "queued %d, dropped %lu, %.0f ns and %lld flash us per call, flush %lld us",
+                 queued, (unsigned long)(dropped() - drops), ns, (long long)log_us,
+                 (long long)flush_us);
+        report("Logging never waits on flash",
+               queued == JOURNAL_QUEUE_LEN && dropped() - drops == 4 && log_us == 0 &&
+               written == JOURNAL_QUEUE_LEN && flush_us >= 60 * JOURNAL_QUEUE_LEN, detail);
+    }
+
+    // === HTTP AND SERIAL ===
+    {
+        vp_http_begin();
+        api_port = host_tcp_port(VP_HTTP_PORT);
+        std::string all, since;
+        int s1 = http_get("/journal", &all);
+        int s2 = http_get("/journal?since=10", &since);
+        std::vector<row_t> r_all = rows(all);
+        std::vector<row_t> r_since = rows(since);
+
+        std::string serial;
+        host_serial_set_hook(string_sink, &serial);
+        host_serial_input("jour");
+        journal_console_poll();
+        host_serial_input("nal 15\r\nhelp\n");
+        journal_console_poll();
+        host_serial_set_hook(NULL, NULL);
+        std::vector<row_t> r_serial = rows(serial);
+
+        snprintf(detail, sizeof(detail),
+                 "GET %d %u records, ?since=10 %d %u records, serial %u records from %lu",
+                 s1, (unsigned)r_all.size(), s2, (unsigned)r_since.size(),
+                 (unsigned)r_serial.size(), r_serial.empty() ? 0 : r_serial[0].seq);
+        report("Dump over HTTP and serial",
+               s1 == 200 && all.compare(0, 6, "# seq ") == 0 && r_all.size() == 17 &&
+               s2 == 200 && r_since.size() == 7 && r_since[0].seq == 11 &&
+               r_serial.size() == 2 && r_serial[0].seq == 16 && serial == dump(15), detail);
+    }
+
+    // === PAGES ===
+    {
+        for (int i = 0; i < 3 * VP_HTTP_JOURNAL_PAGE; i++) {
+            journal_log(JOURNAL_RELAY, i & 1, LIGHT_RELAY, "light");
+            if (i % JOURNAL_QUEUE_LEN == JOURNAL_QUEUE_LEN - 1) {
+                journal_flush();
+            }
+        }
+        journal_flush();
+        std::vector<row_t> expect = rows(dump(0));
+
+        // Follow the "# more" line from the oldest record on
+        std::vector<row_t> got;
+        size_t pages = 0, largest = 0;
+        unsigned long reads_last = 0;
+        bool ok = true;
+        char path[48] = "/journal";
+        for (; pages < 100 && path[0]; pages++) {
+            host_flash_stats_t before, after;
+            host_flash_stats(&before);
+            std::string body;
+            ok = ok && http_get(path, &body) == 200;
+            host_flash_stats(&after);
+            reads_last = after.reads - before.reads;
+
+            std::vector<row_t> page = rows(body);
+            largest = page.size() > largest ? page.size() : largest;
+            got.insert(got.end(), page.begin(), page.end());
+            size_t more = body.find("# more ");
+            path[0] = '\0';
+            if (more != std::string::npos) {
+                sscanf(body.c_str() + more, "# more %47s", path);
+            }
+        }
+
+        snprintf(detail, sizeof(detail),
+                 "%u pages of up to %u, %u of %u records, last page %lu flash reads",
+                 (unsigned)pages, (unsigned)largest, (unsigned)got.size(),
+                 (unsigned)expect.size(), reads_last);
+        report("Paged over HTTP, cursor skips old sectors",
+               ok && largest == VP_HTTP_JOURNAL_PAGE && got.size() == expect.size() &&
+               contiguous(got) && got.back().seq == expect.back().seq &&
+               pages == (expect.size() + VP_HTTP_JOURNAL_PAGE - 1) / VP_HTTP_JOURNAL_PAGE &&
+               reads_last < 2 * SPI_FLASH_SEC_SIZE / sizeof(journal_record_t) +
+                                2 * HOST_FLASH_SIZE / SPI_FLASH_SEC_SIZE, detail);
+    }
+
+    // === SERIAL PAGES ===
+    {
+        std::string serial;
+        host_serial_set_hook(string_sink, &serial);
+        host_serial_input("journal\n");
+        journal_console_poll();
+        size_t first = rows(serial).size();
+        int polls = 1;
+        for (size_t seen = 0; polls < 100 && serial.size() != seen; polls++) {
+            seen = serial.size();
+            journal_console_poll();
+        }
+        host_serial_set_hook(NULL, NULL);
+
+        std::string expect = dump(0);
+        snprintf(detail, sizeof(detail), "%u records, %u on the first loop, %d loops",
+                 (unsigned)rows(serial).size(), (unsigned)first, polls);
+        report("Serial dump goes out a page per TaskLog loop",
+               first == JOURNAL_CONSOLE_PAGE && serial == expect &&
+               polls >= (int)(rows(expect).size() / JOURNAL_CONSOLE_PAGE), detail);
+    }
+
+    // === EXPOSITION ===
+    {
+        std::string text;
+        metrics_write(string_sink, &text);
+        char series[80];
+        snprintf(series, sizeof(series), "\n" METRICS_PREFIX "journal_dropped_total %lu\n",
+                 (unsigned long)dropped());
+        bool found = text.find(series) != std::string::npos;
+        bool total = text.find("\n" METRICS_PREFIX "journal_records_total ") != std::string::npos;
+        snprintf(detail, sizeof(detail), "dropped series %s, records series %s",
+                 found ? "found" : "missing", total ? "found" : "missing");
+        report("Journal counters on /metrics", found && total, detail);
+    }
+
+    // ============ SUMMARY ============
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║%*sTEST SUMMARY%*s║\n", 46/2, "", (46+1)/ 2, "");
+    printf("║══════════════════════════════════════════════════════════║\n");
+    printf("║  Total tests   : %-39d ║\n", total_tests);
+    printf("║  Passed        : %-39d ║\n", passed_tests);
+    printf("║  Failed        : %-39d ║\n", total_tests - passed_tests);
+    printf("║  Success rate  : %-39.f ║\n",
+        (float)passed_tests / total_tests * 100);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+
+    return (passed_tests == total_tests) ? 0 : 1; // Indicate failure
+}
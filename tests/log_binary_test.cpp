@@ -0,0 +1,201 @@
+#include "global.h"
+#include "host_shims.h"
+#include <chrono>
+#include <unistd.h>
+
+// ============ HOST SETUP ============
+// Built with -DLOG_BINARY=1 like a production unit. Drained records are
+// written to a capture file and decoded with scripts/log_decode.py
+// against this test's own executable, the same way the firmware ELF is
+// used for a field capture. Run from the repository root.
+
+#if !LOG_BINARY
+#error "Build with -DLOG_BINARY=1"
+#endif
+
+SemaphoreHandle_t xVPMutex = NULL;
+QueueHandle_t xHMIUpdateQueue = NULL;
+EventGroupHandle_t eventGroup = NULL;
+
+static const char *capture_path = "/tmp/log_binary_capture.bin";
+static char elf_path[512];
+
+static void string_sink(const char *text, size_t len, void *ctx) {
+    ((std::string *)ctx)->append(text, len);
+}
+
+static void null_sink(const char *text, size_t len, void *ctx) {
+}
+
+static std::string drain_all(void) {
+    std::string raw;
+    while (log_ring_drain(string_sink, &raw) > 0) {
+    }
+    return raw;
+}
+
+// === Decoder round trip ===
+static std::string decode(const std::string &raw) {
+    FILE *f = fopen(capture_path, "wb");
+    if (f == NULL) {
+        return "";
+    }
+    fwrite(raw.data(), 1, raw.size(), f);
+    fclose(f);
+
+    std::string cmd = std::string("python3 scripts/log_decode.py ") + elf_path + " " +
+                      capture_path + " 2>&1";
+    FILE *p = popen(cmd.c_str(), "r");
+    if (p == NULL) {
+        return "";
+    }
+    std::string text;
+    char buf[256];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), p)) > 0) {
+        text.append(buf, n);
+    }
+    pclose(p);
+    return text;
+}
+
+// Logs a line and appends what printf makes of it to `expected`
+#define LOG_AND_EXPECT(expected, ...) do { \
+    char line_[LOG_LINE_MAX]; \
+    snprintf(line_, sizeof(line_), __VA_ARGS__); \
+    (expected) += line_; \
+    debug_printf(__VA_ARGS__); \
+} while (0)
+
+// ============ TEST HELPERS ============
+static int total_tests = 0;
+static int passed_tests = 0;
+
+static void report(const char *name, bool passed, const char *detail) {
+    total_tests++;
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║ TEST #%02d: %-46s ║\n", total_tests, name);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+    printf("  %s\n", detail);
+    printf("  Result:   %s\n", passed ? "PASS" : "FAIL");
+    if (passed) passed_tests++;
+}
+
+// ============ MAIN TEST SUITE ============
+int main() {
+    host_serial_quiet(true);
+    host_clock_set_us(1000000);
+    char detail[400];
+
+    ssize_t len = readlink("/proc/self/exe", elf_path, sizeof(elf_path) - 1);
+    elf_path[len > 0 ? len : 0] = '\0';
+
+    xVPMutex = xSemaphoreCreateMutex();
+    xHMIUpdateQueue = xQueueCreate(64, sizeof(hmi_update_item_t));
+    eventGroup = xEventGroupCreate();
+
+    memset(&vp, 0, sizeof(vp));
+    strcpy(vp.hostname, "E-1A2B");
+    vp_save_values();
+    io_schedule_init();
+
+    // === ARGUMENT TYPES ===
+    {
+        std::string expected;
+        char name[12] = "E-1A2B";
+        int64_t offset_ms = -1234567890123LL;
+        LOG_AND_EXPECT(expected, "[TEST] ints %d %u %ld %lu\n", -42, 4000000000u, -7L, 7UL);
+        LOG_AND_EXPECT(expected, "[TEST] hex 0x%04X %x %02u:%02u\n", 0x1A, 255u, 6, 5);
+        LOG_AND_EXPECT(expected, "[TEST] wide %+lld ms, %llu\n", (long long)offset_ms,
+                       18000000000000000000ULL);
+        LOG_AND_EXPECT(expected, "[TEST] str %s [%-5s] [%5s] %c\n", name, "ab", "cd", 'Z');
+        LOG_AND_EXPECT(expected, "[TEST] float %.2f %d%%\n", 21.456, 50);
+        LOG_AND_EXPECT(expected, "[TEST] short %hu %hhd\n", (unsigned short)65535, (signed char)-3);
+        std::string raw = drain_all();
+        std::string text = decode(raw);
+
+        snprintf(detail, sizeof(detail), "%u record bytes for %u text bytes, decoded %s",
+                 (unsigned)raw.size(), (unsigned)expected.size(),
+                 text == expected ? "identical" : text.c_str());
+        report("Records decode to the printf text", text == expected && raw[0] == LOG_BIN_MARK,
+               detail);
+    }
+
+    // === FIRMWARE CALL SITES ===
+    {
+        hmi_on_event("1110", 1, "", "");                 // Light auto, info line
+        time_set_epoch_us(5000000);                      // Rejected, warning with %lld
+        hmi_update_item_t msg;
+        while (xQueueReceive(xHMIUpdateQueue, &msg, 0) == pdTRUE) {
+        }
+        std::string text = decode(drain_all());
+
+        bool hmi = text.find("[HMI] Light auto setting changed to ENABLED\n") != std::string::npos;
+        bool time = text.find("[TIME] Rejected epoch 5\n") != std::string::npos;
+        snprintf(detail, sizeof(detail), "hmi line %s, time line %s",
+                 hmi ? "found" : "missing", time ? "found" : "missing");
+        report("Firmware lines through the decoder", hmi && time, detail);
+    }
+
+    // === CONSOLE TEXT, NOISE AND DROPS ===
+    {
+        for (int i = 0; i < LOG_SLOTS + 3; i++) {
+            debug_printf("[TEST] fill %d\n", i);
+        }
+        std::string raw = "ets Jun  8 2016 00:22:57\r\nrst:0x1 (POWERON_RESET)\r\n";
+        raw += "\x1e\x05" "junk\n";                     // Marker without a record
+        raw += drain_all();
+        std::string text = decode(raw);
+
+        bool boot = text.compare(0, 52, raw, 0, 52) == 0;
+        bool junk = text.find("junk\n") != std::string::npos;
+        bool last = text.find("[TEST] fill 31\n") != std::string::npos &&
+                    text.find("[TEST] fill 32\n") == std::string::npos;
+        bool note = text.find("[LOG] 3 line(s) dropped\n") != std::string::npos;
+        snprintf(detail, sizeof(detail), "boot text %s, stray marker %s, last line %s, note %s",
+                 boot ? "kept" : "lost", junk ? "skipped" : "lost", last ? "ok" : "wrong",
+                 note ? "decoded" : "missing");
+        report("Plain console bytes pass through", boot && junk && last && note, detail);
+    }
+
+    // === COST AGAINST TEXT ===
+    {
+        const int rounds = 200000;
+        const char *ssid = "GrowRoom-2G";
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            log_ring_write("[WiFi] Attempting to connect to: %s (try %u)\n", ssid, (unsigned)i);
+            if (i % 16 == 15) log_ring_drain(null_sink, NULL);
+        }
+        double text_ns = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count() / rounds;
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            log_ring_record("[WiFi] Attempting to connect to: %s (try %u)\n", ssid, (unsigned)i);
+            if (i % 16 == 15) log_ring_drain(null_sink, NULL);
+        }
+        double bin_ns = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count() / rounds;
+
+        log_ring_record("[WiFi] Attempting to connect to: %s (try %u)\n", ssid, 3u);
+        std::string raw = drain_all();
+        snprintf(detail, sizeof(detail),
+                 "text %.1f ns, binary %.1f ns per line, record %u bytes for 48 text bytes",
+                 text_ns, bin_ns, (unsigned)raw.size());
+        report("Binary record cheaper than printf", bin_ns < text_ns && raw.size() < 48, detail);
+    }
+
+    // ============ SUMMARY ============
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║%*sTEST SUMMARY%*s║\n", 46/2, "", (46+1)/ 2, "");
+    printf("║══════════════════════════════════════════════════════════║\n");
+    printf("║  Total tests   : %-39d ║\n", total_tests);
+    printf("║  Passed        : %-39d ║\n", passed_tests);
+    printf("║  Failed        : %-39d ║\n", total_tests - passed_tests);
+    printf("║  Success rate  : %-39.f ║\n",
+        (float)passed_tests / total_tests * 100);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+
+    return (passed_tests == total_tests) ? 0 : 1; // Indicate failure
+}
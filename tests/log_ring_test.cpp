@@ -0,0 +1,246 @@
+#include "global.h"
+#include "host_shims.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// ============ HOST SETUP ============
+// Lines are drained to a string sink instead of Serial. The ring is
+// shared by every test, each one drains what it wrote before the next.
+
+SemaphoreHandle_t xVPMutex = NULL;
+QueueHandle_t xHMIUpdateQueue = NULL;
+EventGroupHandle_t eventGroup = NULL;
+
+static void string_sink(const char *text, size_t len, void *ctx) {
+    ((std::string *)ctx)->append(text, len);
+}
+
+static std::string drain_all(void) {
+    std::string text;
+    while (log_ring_drain(string_sink, &text) > 0) {
+    }
+    return text;
+}
+
+static uint32_t dropped(void) {
+    return __atomic_load_n(&metric_log_dropped.value, __ATOMIC_RELAXED);
+}
+
+static uint32_t lines(void) {
+    return __atomic_load_n(&metric_log_lines.value, __ATOMIC_RELAXED);
+}
+
+// Arguments of a stripped level must not be evaluated
+static int evaluated = 0;
+
+static int bump(void) {
+    return ++evaluated;
+}
+
+// === Console that stops inside the first line ===
+static std::atomic<bool> sink_entered(false);
+static std::atomic<bool> sink_release(false);
+
+static void stalled_sink(const char *text, size_t len, void *ctx) {
+    sink_entered = true;
+    while (!sink_release) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ((std::string *)ctx)->append(text, len);
+}
+
+// ============ TEST HELPERS ============
+static int total_tests = 0;
+static int passed_tests = 0;
+
+static void report(const char *name, bool passed, const char *detail) {
+    total_tests++;
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║ TEST #%02d: %-46s ║\n", total_tests, name);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+    printf("  %s\n", detail);
+    printf("  Result:   %s\n", passed ? "PASS" : "FAIL");
+    if (passed) passed_tests++;
+}
+
+// ============ MAIN TEST SUITE ============
+int main() {
+    host_serial_quiet(true);
+    char detail[300];
+
+    // === ORDER AND TRUNCATION ===
+    {
+        std::string big(2 * LOG_LINE_MAX, 'x');
+        debug_printf("[TEST] first %d\n", 1);
+        debug_println("[TEST] second");
+        debug_printf("[TEST] %s\n", big.c_str());
+        std::string text = drain_all();
+
+        const char *head = "[TEST] first 1\n[TEST] second\n";
+        size_t cut = text.find("[TEST] xx");
+        std::string last = cut == std::string::npos ? "" : text.substr(cut);
+        snprintf(detail, sizeof(detail), "%u bytes drained, long line kept %u of %u bytes",
+                 (unsigned)text.size(), (unsigned)last.size(), (unsigned)(big.size() + 8));
+        report("Lines drained in order, long line cut",
+               text.compare(0, strlen(head), head) == 0 && cut == strlen(head) &&
+               last.size() == LOG_LINE_MAX - 1 && last.back() == '\n', detail);
+    }
+
+    // === FULL RING ===
+    {
+        uint32_t before = dropped();
+        for (int i = 0; i < LOG_SLOTS + 10; i++) {
+            debug_printf("[TEST] fill %d\n", i);
+        }
+        std::string text;
+        size_t drained = log_ring_drain(string_sink, &text);
+        std::string again;
+        log_ring_drain(string_sink, &again);
+
+        bool note = text.size() > 0 &&
+                    text.find("[LOG] 10 line(s) dropped\n") == text.size() - 25;
+        snprintf(detail, sizeof(detail), "drained %u, dropped +%lu, note %s, repeated %s",
+                 (unsigned)drained, (unsigned long)(dropped() - before),
+                 note ? "last" : "missing", again.empty() ? "no" : "yes");
+        report("Overflow drops and counts lines",
+               drained == LOG_SLOTS && dropped() - before == 10 && note &&
+               text.find("fill 0\n") != std::string::npos &&
+               text.find("fill 32\n") == std::string::npos && again.empty(), detail);
+    }
+
+    // === COMPILE-TIME LEVELS ===
+    {
+        uint32_t before = lines();
+        evaluated = 0;
+        debug_errorf("[TEST] error %d\n", bump());
+        debug_warnf("[TEST] warn %d\n", bump());
+        debug_printf("[TEST] info %d\n", bump());
+        debug_verbosef("[TEST] verbose %d\n", bump());
+        std::string text = drain_all();
+
+        snprintf(detail, sizeof(detail), "LOG_LEVEL %d, lines +%lu, arguments evaluated %d",
+                 LOG_LEVEL, (unsigned long)(lines() - before), evaluated);
+        report("Levels above LOG_LEVEL compiled out",
+               LOG_LEVEL == LOG_LEVEL_INFO && lines() - before == 3 && evaluated == 3 &&
+               text == "[TEST] error 1\n[TEST] warn 2\n[TEST] info 3\n", detail);
+    }
+
+    // === CONCURRENT PRODUCERS ===
+    {
+        const int producers = 4;
+        const int per_producer = 5000;
+        uint32_t lines_before = lines();
+        uint32_t dropped_before = dropped();
+        std::atomic<int> running(producers);
+        std::string text;
+
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; p++) {
+            threads.emplace_back([p, &running] {
+                for (int i = 0; i < per_producer; i++) {
+                    log_ring_write("P%d %d\n", p, i);
+                    if (i % 8 == 7) {
+                        std::this_thread::sleep_for(std::chrono::microseconds(20));
+                    }
+                }
+                running--;
+            });
+        }
+        while (running > 0) {
+            log_ring_drain(string_sink, &text);
+        }
+        for (auto &t : threads) {
+            t.join();
+        }
+        text += drain_all();
+
+        // Every line whole, each producer in its own order
+        int next[producers] = { 0 };
+        uint32_t received = 0;
+        bool ordered = true;
+        size_t start = 0;
+        while (start < text.size()) {
+            size_t end = text.find('\n', start);
+            std::string line = text.substr(start, end - start);
+            start = end + 1;
+            int p, i;
+            if (line.compare(0, 5, "[LOG]") == 0) {
+                continue;
+            }
+            if (sscanf(line.c_str(), "P%d %d", &p, &i) != 2 || p < 0 || p >= producers ||
+                i < next[p]) {
+                ordered = false;
+                break;
+            }
+            next[p] = i + 1;
+            received++;
+        }
+        uint32_t lost = dropped() - dropped_before;
+        snprintf(detail, sizeof(detail), "%d x %d lines: received %lu, dropped %lu, queued %lu",
+                 producers, per_producer, (unsigned long)received, (unsigned long)lost,
+                 (unsigned long)(lines() - lines_before));
+        report("Lock-free with 4 producers", ordered &&
+               received + lost == (uint32_t)(producers * per_producer) &&
+               lines() - lines_before == received, detail);
+    }
+
+    // === WRITERS NEVER WAIT ON THE CONSOLE ===
+    {
+        const int rounds = 1000;
+        uint32_t before = dropped();
+        std::string text;
+        debug_printf("[TEST] console stalls here\n");
+        std::thread console([&text] { log_ring_drain(stalled_sink, &text); });
+        while (!sink_entered) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            debug_printf("[TEST] stalled %d\n", i);
+        }
+        double ns = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count() / rounds;
+        uint32_t lost = dropped() - before;
+        sink_release = true;
+        console.join();
+        text += drain_all();
+
+        snprintf(detail, sizeof(detail), "%.1f ns per line, %lu of %d dropped while stalled",
+                 ns, (unsigned long)lost, rounds);
+        report("Stalled console does not block",
+               lost == (uint32_t)(rounds - (LOG_SLOTS - 1)) && ns < 5000 &&
+               text.find("[TEST] stalled 30\n") != std::string::npos, detail);
+    }
+
+    // === EXPOSITION ===
+    {
+        std::string text;
+        metrics_write([](const char *t, size_t len, void *ctx) {
+            ((std::string *)ctx)->append(t, len);
+        }, &text);
+        char series[80];
+        snprintf(series, sizeof(series), "\n" METRICS_PREFIX "log_dropped_total %lu\n",
+                 (unsigned long)dropped());
+        bool found = text.find(series) != std::string::npos;
+        bool total = text.find("\n" METRICS_PREFIX "log_lines_total ") != std::string::npos;
+        snprintf(detail, sizeof(detail), "dropped series %s, lines series %s",
+                 found ? "found" : "missing", total ? "found" : "missing");
+        report("Log counters on /metrics", found && total, detail);
+    }
+
+    // ============ SUMMARY ============
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║%*sTEST SUMMARY%*s║\n", 46/2, "", (46+1)/ 2, "");
+    printf("║══════════════════════════════════════════════════════════║\n");
+    printf("║  Total tests   : %-39d ║\n", total_tests);
+    printf("║  Passed        : %-39d ║\n", passed_tests);
+    printf("║  Failed        : %-39d ║\n", total_tests - passed_tests);
+    printf("║  Success rate  : %-39.f ║\n",
+        (float)passed_tests / total_tests * 100);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+
+    return (passed_tests == total_tests) ? 0 : 1; // Indicate failure
+}
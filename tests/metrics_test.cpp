@@ -0,0 +1,344 @@
+#include "global.h"
+#include "host_shims.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// ============ HOST SETUP ============
+// The registry is read back through metrics_write() and through a real
+// loopback GET /metrics, with the counters bumped from host threads the
+// way several FreeRTOS tasks on both cores would.
+
+SemaphoreHandle_t xVPMutex = NULL;
+QueueHandle_t xHMIUpdateQueue = NULL;
+EventGroupHandle_t eventGroup = NULL;
+
+static uint16_t api_port = 0;
+
+// === Exposition capture ===
+static void capture(const char *text, size_t len, void *ctx) {
+    ((std::string *)ctx)->append(text, len);
+}
+
+static std::string exposition(void) {
+    std::string out;
+    metrics_write(capture, &out);
+    return out;
+}
+
+// Value of the sample line starting with `series`, -1 when absent
+static long sample(const std::string &text, const char *series) {
+    std::string key = std::string(METRICS_PREFIX) + series + " ";
+    size_t pos = text.find("\n" + key);
+    if (pos == std::string::npos) {
+        return -1;
+    }
+    return strtol(text.c_str() + pos + 1 + key.size(), NULL, 10);
+}
+
+// Every line is a comment or `name[{labels}] value`
+static bool well_formed(const std::string &text, char *why, size_t why_len) {
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos) {
+            snprintf(why, why_len, "unterminated last line");
+            return false;
+        }
+        std::string line = text.substr(start, end - start);
+        start = end + 1;
+
+        if (line.rfind("# HELP ", 0) == 0 || line.rfind("# TYPE ", 0) == 0) {
+            continue;
+        }
+        size_t name_end = line.find_first_of("{ ");
+        size_t space = line.rfind(' ');
+        bool named = line.rfind(METRICS_PREFIX, 0) == 0 && name_end != std::string::npos;
+        bool labels = name_end == std::string::npos || line[name_end] == ' ' ||
+                      line.find("} ", name_end) == space - 1;
+        char *tail;
+        strtod(line.c_str() + space + 1, &tail);
+        if (!named || !labels || *tail != '\0' || space + 1 == line.size()) {
+            snprintf(why, why_len, "bad line \"%s\"", line.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+// === Client ===
+static int http_get(const char *path, std::string *head, std::string *body) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(api_port);
+    if (connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    char req[128];
+    int len = snprintf(req, sizeof(req), "GET %s HTTP/1.1\r\nHost: node\r\n\r\n", path);
+    send(fd, req, len, 0);
+
+    std::string reply;
+    char buf[2048];
+    for (int spins = 0; spins < 100000; spins++) {
+        vp_http_poll();
+        ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n > 0) {
+            reply.append(buf, n);
+        } else if (n == 0) {
+            break;
+        }
+    }
+    close(fd);
+
+    int status = 0;
+    sscanf(reply.c_str(), "HTTP/1.1 %d", &status);
+    size_t split = reply.find("\r\n\r\n");
+    *head = split == std::string::npos ? reply : reply.substr(0, split);
+    *body = split == std::string::npos ? "" : reply.substr(split + 4);
+    return status;
+}
+
+static void idle_task(void *param) {
+}
+
+// ============ TEST HELPERS ============
+static int total_tests = 0;
+static int passed_tests = 0;
+
+static void report(const char *name, bool passed, const char *detail) {
+    total_tests++;
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║ TEST #%02d: %-46s ║\n", total_tests, name);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+    printf("  %s\n", detail);
+    printf("  Result:   %s\n", passed ? "PASS" : "FAIL");
+    if (passed) passed_tests++;
+}
+
+// ============ MAIN TEST SUITE ============
+int main() {
+    host_serial_quiet(true);
+    host_clock_set_us(0);
+    char detail[240];
+
+    xVPMutex = xSemaphoreCreateMutex();
+    xHMIUpdateQueue = xQueueCreate(15, sizeof(hmi_update_item_t));
+    eventGroup = xEventGroupCreate();
+
+    memset(&vp, 0, sizeof(vp));
+    strcpy(vp.hostname, "E-1A2B");
+    io_schedule_init();
+
+    // === EXPOSITION FORMAT ===
+    {
+        metric_add(&metric_hmi_frames_tx, 42);
+        metric_set(&metric_sched_last_us, -7);
+        const uint32_t waits[] = { 0, 5, 50, 5000, 2000000 };
+        for (uint32_t w : waits) {
+            metric_observe(&metric_vp_mutex_wait, w);
+        }
+        std::string text = exposition();
+        char why[120] = "ok";
+        bool formed = well_formed(text, why, sizeof(why));
+
+        long le1 = sample(text, "vp_mutex_wait_us_bucket{le=\"1\"}");
+        long le100 = sample(text, "vp_mutex_wait_us_bucket{le=\"100\"}");
+        long le1000 = sample(text, "vp_mutex_wait_us_bucket{le=\"1000\"}");
+        long le1s = sample(text, "vp_mutex_wait_us_bucket{le=\"1000000\"}");
+        long inf = sample(text, "vp_mutex_wait_us_bucket{le=\"+Inf\"}");
+        long count = sample(text, "vp_mutex_wait_us_count");
+        long sum = sample(text, "vp_mutex_wait_us_sum");
+        snprintf(detail, sizeof(detail),
+                 "%s, %u bytes, tx %ld, last %ld, buckets %ld/%ld/%ld/%ld/%ld, "
+                 "count %ld, sum %ld",
+                 why, (unsigned)text.size(), sample(text, "hmi_frames_sent_total"),
+                 sample(text, "sched_last_us"), le1, le100, le1000, le1s, inf, count, sum);
+        report("Prometheus text exposition",
+               formed &&
+               text.find("# TYPE " METRICS_PREFIX "hmi_frames_sent_total counter\n") !=
+                   std::string::npos &&
+               text.find("# TYPE " METRICS_PREFIX "vp_mutex_wait_us histogram\n") !=
+                   std::string::npos &&
+               sample(text, "hmi_frames_sent_total") == 42 &&
+               sample(text, "sched_last_us") == -7 &&
+               le1 == 1 && le100 == 3 && le1000 == 3 && le1s == 4 && inf == 5 &&
+               count == 5 && sum == 2005055, detail);
+    }
+
+    // === FIRMWARE HOOKS ===
+    {
+        long nvs_before = sample(exposition(), "nvs_writes_total");
+        long waits_before = sample(exposition(), "vp_mutex_wait_us_count");
+        if (vp_lock()) {
+            vp_save_values();
+            vp_unlock();
+        }
+        hmi_update_value(VP_LIGHT_STATE);
+        hmi_update_value(VP_FAN_STATE);
+        std::string text = exposition();
+        snprintf(detail, sizeof(detail), "NVS puts +%ld of %u items, waits +%ld, queue %ld",
+                 sample(text, "nvs_writes_total") - nvs_before, (unsigned)num_vp_items,
+                 sample(text, "vp_mutex_wait_us_count") - waits_before,
+                 sample(text, "hmi_queue_depth"));
+        report("Counters follow the firmware",
+               sample(text, "nvs_writes_total") - nvs_before == (long)num_vp_items &&
+               sample(text, "vp_mutex_wait_us_count") - waits_before == 1 &&
+               sample(text, "hmi_queue_depth") == 2, detail);
+        hmi_update_item_t msg;
+        while (xQueueReceive(xHMIUpdateQueue, &msg, 0) == pdTRUE) {
+        }
+    }
+
+    // === CLOCK DISCIPLINE ===
+    {
+        long jumps_before = sample(exposition(), "time_jumps_total");
+        time_set_epoch(1741608000);
+        time_set_epoch(1741608000 + 3600); // Resync an hour ahead
+        time_discipline(1500);
+        time_discipline_stats_t stats;
+        time_discipline_stats(&stats);
+        std::string text = exposition();
+        snprintf(detail, sizeof(detail), "drift %ld ppb, offset %ld us, slew %ld us, jumps +%ld",
+                 sample(text, "time_drift_ppb"), sample(text, "time_offset_us"),
+                 sample(text, "time_slew_pending_us"),
+                 sample(text, "time_jumps_total") - jumps_before);
+        report("Clock discipline exported",
+               sample(text, "time_drift_ppb") == stats.freq_ppb &&
+               sample(text, "time_offset_us") == stats.offset_us &&
+               sample(text, "time_slew_pending_us") == 1500 &&
+               sample(text, "time_jumps_total") - jumps_before == 1 &&
+               sample(text, "ntp_sync_interval_seconds") ==
+                   (long)(ntp_sync_interval_get() / 1000) &&
+               text.find("# TYPE " METRICS_PREFIX "time_jumps_total counter\n") !=
+                   std::string::npos, detail);
+    }
+
+    // === CONCURRENT UPDATES ===
+    {
+        const int threads = 4;
+        const uint32_t per_thread = 250000;
+        uint32_t rx_before = metric_hmi_frames_rx.value;
+        uint32_t wait_before = metric_vp_mutex_wait.buckets[1];
+
+        std::vector<std::thread> pool;
+        for (int t = 0; t < threads; t++) {
+            pool.emplace_back([&] {
+                for (uint32_t i = 0; i < per_thread; i++) {
+                    metric_inc(&metric_hmi_frames_rx);
+                    metric_observe(&metric_vp_mutex_wait, 7);
+                }
+            });
+        }
+        for (std::thread &t : pool) {
+            t.join();
+        }
+
+        uint32_t rx = metric_hmi_frames_rx.value - rx_before;
+        uint32_t waits = metric_vp_mutex_wait.buckets[1] - wait_before;
+        snprintf(detail, sizeof(detail), "%d threads x %lu: counter %lu, bucket %lu",
+                 threads, (unsigned long)per_thread, (unsigned long)rx, (unsigned long)waits);
+        report("No lost updates across threads",
+               rx == threads * per_thread && waits == threads * per_thread, detail);
+    }
+
+    // === UPDATE COST ===
+    // Timings are reported only, a loaded runner or a debug build would
+    // fail any fixed bound. The pass is on every update landing.
+    {
+        const int rounds = 2000000;
+        uint32_t evals_before = metric_sched_evals.value;
+        uint32_t observed_before = metric_count(&metric_vp_mutex_wait);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            metric_inc(&metric_sched_evals);
+        }
+        double inc_ns = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count() / rounds;
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            metric_observe(&metric_vp_mutex_wait, (uint32_t)i & 0xFFFF);
+        }
+        double observe_ns = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count() / rounds;
+
+        start = std::chrono::steady_clock::now();
+        std::string text;
+        for (int i = 0; i < 1000; i++) {
+            text.clear();
+            metrics_write(capture, &text);
+        }
+        double write_us = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count() / 1000;
+
+        uint32_t evals = metric_sched_evals.value - evals_before;
+        uint32_t observed = metric_count(&metric_vp_mutex_wait) - observed_before;
+        snprintf(detail, sizeof(detail),
+                 "metric_inc %.1f ns, metric_observe %.1f ns, metrics_write %.1f us (%u B)",
+                 inc_ns, observe_ns, write_us, (unsigned)text.size());
+        report("Hot path cost", evals == (uint32_t)rounds && observed == (uint32_t)rounds &&
+               !text.empty(), detail);
+    }
+
+    // === GET /metrics ===
+    {
+        TaskHandle_t handles[3] = { NULL, NULL, NULL };
+        xTaskCreatePinnedToCore(idle_task, "HMI_Task", 4096, NULL, 1, &handles[0], 1);
+        xTaskCreatePinnedToCore(idle_task, "WiFi_Task", 4096, NULL, 1, &handles[1], 0);
+        xTaskCreatePinnedToCore(idle_task, "Sync_Task", 4096, NULL, 1, &handles[2], 1);
+        metrics_register_task("hmi", handles[0]);
+        metrics_register_task("wifi", handles[1]);
+        metrics_register_task("sync", handles[2]);
+
+        vp_http_begin();
+        api_port = host_tcp_port(VP_HTTP_PORT);
+        std::string head, body;
+        int status = http_get("/metrics", &head, &body);
+
+        const char *required[] = {
+            "hmi_queue_depth ", "hmi_frames_sent_total ", "hmi_frames_received_total ",
+            "hmi_updates_total ", "vp_mutex_wait_us_bucket{", "nvs_writes_total ",
+            "sched_evaluations_total ", "heap_free_bytes ", "heap_largest_free_block_bytes ",
+            "task_stack_free_min_bytes{task=\"hmi\"} ",
+            "task_stack_free_min_bytes{task=\"wifi\"} ",
+            "task_stack_free_min_bytes{task=\"sync\"} ",
+        };
+        const char *missing = "none";
+        for (const char *name : required) {
+            if (body.find(std::string("\n" METRICS_PREFIX) + name) == std::string::npos) {
+                missing = name;
+                break;
+            }
+        }
+        char why[120] = "ok";
+        bool formed = well_formed(body, why, sizeof(why));
+        snprintf(detail, sizeof(detail), "%d, %u bytes, missing %s, %s", status,
+                 (unsigned)body.size(), missing, why);
+        report("GET /metrics over the VP API",
+               status == 200 && formed && strcmp(missing, "none") == 0 &&
+               head.find("Content-Type: text/plain; version=0.0.4") != std::string::npos,
+               detail);
+    }
+
+    // ============ SUMMARY ============
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║%*sTEST SUMMARY%*s║\n", 46/2, "", (46+1)/ 2, "");
+    printf("║══════════════════════════════════════════════════════════║\n");
+    printf("║  Total tests   : %-39d ║\n", total_tests);
+    printf("║  Passed        : %-39d ║\n", passed_tests);
+    printf("║  Failed        : %-39d ║\n", total_tests - passed_tests);
+    printf("║  Success rate  : %-39.f ║\n",
+        (float)passed_tests / total_tests * 100);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+
+    return (passed_tests == total_tests) ? 0 : 1; // Indicate failure
+}
@@ -0,0 +1,360 @@
+#include "global.h"
+#include "host_shims.h"
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ============ HOST SETUP ============
+// The bridge against the in-process broker, polled the way TaskWiFi
+// does on the virtual clock, with the HMI queue drained in between.
+
+SemaphoreHandle_t xVPMutex = NULL;
+QueueHandle_t xHMIUpdateQueue = NULL;
+EventGroupHandle_t eventGroup = NULL;
+
+// === Broker side ===
+typedef struct {
+    std::string topic;
+    std::string payload;
+    bool retained;
+} message_t;
+
+static std::vector<message_t> received;
+static bool keep_payloads = true;
+
+static void on_publish(const char *topic, const uint8_t *payload, size_t len,
+                       bool retained, void *ctx) {
+    if (keep_payloads) {
+        received.push_back({ topic, std::string((const char *)payload, len), retained });
+    }
+}
+
+// Delta messages received since `from`
+static std::vector<std::string> deltas(size_t from) {
+    std::vector<std::string> out;
+    for (size_t i = from; i < received.size(); i++) {
+        if (received[i].topic == "grow/E-1A2B/delta") {
+            out.push_back(received[i].payload);
+        }
+    }
+    return out;
+}
+
+static unsigned long seq_of(const std::string &msg) {
+    return strtoul(msg.c_str() + strlen("{\"seq\":"), NULL, 10);
+}
+
+static unsigned long count_of(const std::string &s, const char *what) {
+    unsigned long n = 0;
+    for (size_t pos = s.find(what); pos != std::string::npos; pos = s.find(what, pos + 1)) {
+        n++;
+    }
+    return n;
+}
+
+// Seqs rise by one from message to message
+static bool in_order(const std::vector<std::string> &msgs) {
+    for (size_t i = 1; i < msgs.size(); i++) {
+        if (seq_of(msgs[i]) != seq_of(msgs[i - 1]) + 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void hmi_drain(void) {
+    hmi_update_item_t msg;
+    while (xQueueReceive(xHMIUpdateQueue, &msg, 0) == pdTRUE) {
+        uint8_t pin = io_pin_map(msg.address);
+        if (msg.type == HMI_UPDATE_VALUE && pin != 0) {
+            digitalWrite(pin, vp_get_value(msg.address));
+        }
+    }
+}
+
+// === TaskWiFi stand-in ===
+static void run_ms(uint32_t ms, bool link_up) {
+    for (uint32_t t = 0; t < ms; t += 100) {
+        mqtt_bridge_poll(millis(), link_up);
+        hmi_drain();
+        host_clock_advance_us(100 * 1000);
+    }
+}
+
+// A panel edit: value under the mutex, as TaskHMI does
+static void panel_set(uint16_t address, uint8_t value) {
+    xSemaphoreTake(xVPMutex, portMAX_DELAY);
+    vp_set_value(address, value);
+    xSemaphoreGive(xVPMutex);
+}
+
+// ============ TEST HELPERS ============
+static int total_tests = 0;
+static int passed_tests = 0;
+
+static void report(const char *name, bool passed, const char *detail) {
+    total_tests++;
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║ TEST #%02d: %-46s ║\n", total_tests, name);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+    printf("  %s\n", detail);
+    printf("  Result:   %s\n", passed ? "PASS" : "FAIL");
+    if (passed) passed_tests++;
+}
+
+// ============ MAIN TEST SUITE ============
+int main() {
+    host_serial_quiet(true);
+    host_clock_set_us(0);
+    char detail[240];
+
+    xVPMutex = xSemaphoreCreateMutex();
+    xHMIUpdateQueue = xQueueCreate(64, sizeof(hmi_update_item_t));
+    eventGroup = xEventGroupCreate();
+    time_set_epoch(1741608000);
+
+    memset(&vp, 0, sizeof(vp));
+    strcpy(vp.hostname, "E-1A2B");
+    strcpy(vp.wifi_ssid, "greenhouse");
+    strcpy(vp.wifi_pswd, "secret123");
+    strcpy(vp.holder_signal, "Signal strength");
+    vp.total_cycle = 15;
+    vp.light_on_hr = 6;
+    vp.light_on_min = 30;
+    vp.light_off_hr = 20;
+    vp.water_interval_hr = 2;
+    vp.water_duration_sec = 10;
+    vp_save_values();
+    io_schedule_init();
+
+    host_mqtt_set_hook(on_publish, NULL);
+    bool listening = host_mqtt_listen(MQTT_BROKER, MQTT_BROKER_PORT);
+    mqtt_bridge_begin();
+
+    // === FIRST CONNECT ===
+    {
+        run_ms(1000, true);
+        std::vector<std::string> msgs = deltas(0);
+        std::string all;
+        for (const std::string &m : msgs) all += m;
+        bool online = !received.empty() && received[0].topic == "grow/E-1A2B/status" &&
+                      received[0].payload == "online" && received[0].retained;
+        bool sized = true;
+        for (const std::string &m : msgs) sized = sized && m.size() <= MQTT_MSG_MAX;
+        unsigned long vps = count_of(all, "\":") - 4 * msgs.size(); // seq, t, full, d
+        snprintf(detail, sizeof(detail), "broker %s, status %s, %u delta(s), %lu VPs, password %d",
+                 listening ? "listening" : "not bound", online ? "online" : "missing",
+                 (unsigned)msgs.size(), vps, all.find("1430") != std::string::npos);
+        report("Connect: online status, full snapshot",
+               listening && online && msgs.size() >= 1 && sized && in_order(msgs) &&
+               count_of(all, "\"full\":true") == msgs.size() &&
+               vps == num_vp_items - 1 &&
+               all.find("\"1120\":6") != std::string::npos &&
+               all.find("\"t\":1741608000") != std::string::npos &&
+               all.find("1430") == std::string::npos, detail);
+    }
+
+    // === COALESCED DELTA ===
+    {
+        size_t from = received.size();
+        panel_set(VP_LIGHT_ON_HR, 7);
+        panel_set(VP_LIGHT_ON_HR, 8);
+        panel_set(VP_LIGHT_ON_HR, 9);
+        panel_set(VP_FAN_AUTO, 1);
+        panel_set(VP_FAN_AUTO, 1); // Same value, no change
+        run_ms(MQTT_PUBLISH_MS, true);
+        std::vector<std::string> msgs = deltas(from);
+        std::string text = msgs.empty() ? "" : msgs[0];
+
+        // Nothing changed, nothing sent
+        size_t quiet = received.size();
+        run_ms(MQTT_PUBLISH_MS, true);
+        snprintf(detail, sizeof(detail), "%u message(s): %s, then %u while quiet",
+                 (unsigned)msgs.size(), text.c_str(), (unsigned)(received.size() - quiet));
+        report("Changes in one period are one delta",
+               msgs.size() == 1 && text.find("\"d\":{\"1120\":9,\"1310\":1}}") != std::string::npos &&
+               text.find("full") == std::string::npos && received.size() == quiet, detail);
+    }
+
+    // === COMMANDS ===
+    {
+        size_t from = received.size();
+        host_mqtt_inject("grow/E-1A2B/cmd", "{\"1100\":1,\"1130\":15}");
+        host_mqtt_inject("grow/E-1A2B/cmd", "{\"1120\":12,\"1140\":30}");
+        host_mqtt_inject("grow/other/cmd", "{\"1100\":0}");
+        run_ms(MQTT_PUBLISH_MS, true);
+
+        std::string acks;
+        for (size_t i = from; i < received.size(); i++) {
+            if (received[i].topic == "grow/E-1A2B/ack") acks += received[i].payload + " ";
+        }
+        std::vector<std::string> msgs = deltas(from);
+        std::string echo = msgs.empty() ? "" : msgs[0];
+        mqtt_stats_t stats;
+        mqtt_bridge_stats(&stats);
+        snprintf(detail, sizeof(detail), "acks %s| relay %u, on %02u:%02u, echo %s",
+                 acks.c_str(), host_gpio_level(LIGHT_RELAY), vp.light_on_hr,
+                 vp.light_on_min, echo.c_str());
+        report("Commands apply as a batch and echo back",
+               acks.find("{\"changed\":2}") != std::string::npos &&
+               acks.find("{\"error\":") != std::string::npos &&
+               stats.commands == 1 && stats.rejected == 1 &&
+               vp.light_state == 1 && host_gpio_level(LIGHT_RELAY) == 1 &&
+               vp.light_on_hr == 9 && vp.light_on_min == 15 &&
+               echo.find("\"1100\":1") != std::string::npos &&
+               echo.find("\"1130\":15") != std::string::npos, detail);
+    }
+
+    // === OFFLINE SPILL AND REPLAY ===
+    {
+        const int batches = 60;
+        mqtt_stats_t before, offline, after;
+        host_nvs_stats_t nvs_before, nvs_after;
+        mqtt_bridge_stats(&before);
+        host_nvs_stats(&nvs_before);
+
+        unsigned long last_seq = seq_of(deltas(0).back());
+        host_mqtt_set_broker(false);
+        size_t from = received.size();
+        bool will = !received.empty() && received.back().payload == "offline";
+        for (int i = 0; i < batches; i++) {
+            panel_set(VP_FAN_ON_MIN, (uint8_t)(i % 60));
+            panel_set(VP_GROWTH_DAY, (uint8_t)i);
+            run_ms(MQTT_PUBLISH_MS, true);
+        }
+        mqtt_bridge_stats(&offline);
+        host_nvs_stats(&nvs_after);
+
+        host_mqtt_set_broker(true);
+        run_ms(MQTT_RETRY_MS + 1000, true);
+        mqtt_bridge_stats(&after);
+        std::vector<std::string> msgs = deltas(from);
+        snprintf(detail, sizeof(detail),
+                 "will %d, %lu queued, %lu spilled to %u segment(s), %lu NVS commits | replayed %u, in order %d, left %lu",
+                 will, (unsigned long)(offline.batches - before.batches),
+                 (unsigned long)(offline.spilled - before.spilled), offline.spill_count,
+                 nvs_after.commits - nvs_before.commits, (unsigned)msgs.size(),
+                 in_order(msgs), (unsigned long)after.ring_used);
+        report("Offline backlog spills and replays in order",
+               will && offline.spilled > before.spilled && offline.spill_count > 0 &&
+               offline.dropped == 0 && msgs.size() == offline.batches - before.batches &&
+               in_order(msgs) && seq_of(msgs[0]) == last_seq + 1 && after.spill_count == 0 &&
+               after.ring_used == 0 && !mqtt_bridge_busy(), detail);
+    }
+
+    // === FLASH CEILING AND REBOOT ===
+    {
+        const int batches = 400;
+        host_mqtt_set_broker(false);
+        size_t from = received.size();
+        for (int i = 0; i < batches; i++) {
+            panel_set(VP_FAN_ON_MIN, (uint8_t)(i % 60));
+            panel_set(VP_GROWTH_DAY, (uint8_t)(i % 100));
+            run_ms(MQTT_PUBLISH_MS, true);
+        }
+        mqtt_stats_t full;
+        mqtt_bridge_stats(&full);
+        uint32_t meta = vp_load_u32(MQTT_SPILL_KEY, 0);
+
+        // Boot again with the flash backlog only
+        mqtt_bridge_begin();
+        mqtt_stats_t booted;
+        mqtt_bridge_stats(&booted);
+
+        host_mqtt_set_broker(true);
+        run_ms(MQTT_RETRY_MS + 2000, true);
+        std::vector<std::string> msgs = deltas(from);
+        std::string all;
+        for (const std::string &m : msgs) all += m;
+        snprintf(detail, sizeof(detail),
+                 "%u segment(s) in NVS, %lu dropped, after boot %u | replayed %u, in order %d, resync %d",
+                 (unsigned)(meta & 0xFF), (unsigned long)full.dropped, booted.spill_count,
+                 (unsigned)msgs.size(), in_order(msgs),
+                 all.find("\"full\":true") != std::string::npos);
+        report("Flash ceiling drops oldest, survives reboot",
+               (meta & 0xFF) == MQTT_SPILL_SEGMENTS && full.dropped > 0 &&
+               booted.spill_count == MQTT_SPILL_SEGMENTS && in_order(msgs) &&
+               all.find("\"full\":true") != std::string::npos &&
+               msgs.size() + full.dropped >= (size_t)batches, detail);
+    }
+
+    // === THROUGHPUT AND MEMORY ===
+    {
+        const int rounds = 20000;
+        keep_payloads = false;
+        host_mqtt_stats_t before, after;
+        host_mqtt_stats(&before);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            panel_set(VP_FAN_ON_MIN, (uint8_t)(i % 60));
+            panel_set(VP_WATER_ON_MIN, (uint8_t)(i % 59));
+            host_clock_advance_us(MQTT_PUBLISH_MS * 1000LL);
+            mqtt_bridge_poll(millis(), true);
+        }
+        double secs = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+        host_mqtt_stats(&after);
+        keep_payloads = true;
+
+        unsigned long sent = after.publishes - before.publishes;
+        size_t ram = MQTT_RING_BYTES + MQTT_SPILL_BYTES + MQTT_MSG_MAX + sizeof(vp_values_t);
+        snprintf(detail, sizeof(detail),
+                 "%.0f batches/s, %lu B avg | RAM %u B, flash %u B",
+                 rounds / secs, (after.bytes - before.bytes) / (sent ? sent : 1),
+                 (unsigned)ram, (unsigned)(MQTT_SPILL_SEGMENTS * MQTT_SPILL_BYTES));
+        report("Batch throughput and memory ceilings",
+               sent == (unsigned long)rounds && rounds / secs > 1000, detail);
+    }
+
+    // === SLOW BROKER LOOKUP ===
+    {
+        host_mqtt_set_broker(false);
+        run_ms(1000, true);
+        host_dns_set_delay_ms(2000);
+        host_mqtt_set_broker(true);
+
+        uint32_t start = millis();
+        uint32_t up_ms = 0;
+        bool busy = false;
+        double worst_ms = 0;
+        while (up_ms == 0 && millis() - start < MQTT_RETRY_MS + 5000) {
+            auto t0 = std::chrono::steady_clock::now();
+            mqtt_bridge_poll(millis(), true);
+            double ms = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - t0).count();
+            worst_ms = ms > worst_ms ? ms : worst_ms;
+            busy = busy || mqtt_bridge_busy();
+
+            mqtt_stats_t stats;
+            mqtt_bridge_stats(&stats);
+            if (stats.connected) {
+                up_ms = millis() - start;
+            }
+            hmi_drain();
+            host_clock_advance_us(10 * 1000); // MQTT_POLL_MS while busy
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        host_dns_set_delay_ms(0);
+
+        snprintf(detail, sizeof(detail),
+                 "2 s lookup: up after %lu ms, busy %d, longest poll %.2f ms",
+                 (unsigned long)up_ms, busy, worst_ms);
+        report("Connect never blocks the poll",
+               up_ms >= 2000 && busy && worst_ms < 50, detail);
+    }
+
+    // ============ SUMMARY ============
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║%*sTEST SUMMARY%*s║\n", 46/2, "", (46+1)/ 2, "");
+    printf("║══════════════════════════════════════════════════════════║\n");
+    printf("║  Total tests   : %-39d ║\n", total_tests);
+    printf("║  Passed        : %-39d ║\n", passed_tests);
+    printf("║  Failed        : %-39d ║\n", total_tests - passed_tests);
+    printf("║  Success rate  : %-39.f ║\n",
+        (float)passed_tests / total_tests * 100);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+
+    return (passed_tests == total_tests) ? 0 : 1; // Indicate failure
+}
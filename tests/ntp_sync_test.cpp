@@ -0,0 +1,355 @@
+#include "global.h"
+#include "host_shims.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+// ============ VIRTUAL CLOCK ============
+#define TRUE_EPOCH_US 1735669800000000LL // Server time at virtual 0
+#define LOOP_PERIOD_MS 500 // TaskWiFi loop period
+
+static int64_t true_time_us(void) {
+    return TRUE_EPOCH_US + host_clock_us();
+}
+
+// ============ STAND-IN NTP SERVER ============
+typedef enum {
+    SERVER_OK,
+    SERVER_SILENT,  // Never answers
+    SERVER_KOD,     // Kiss-o'-Death, stratum 0
+    SERVER_STALE    // Answers with the wrong originate stamp
+} ServerMode;
+
+class StandInServer {
+public:
+    StandInServer() {
+        fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(fd_, (sockaddr *)&addr, sizeof(addr));
+        socklen_t len = sizeof(addr);
+        getsockname(fd_, (sockaddr *)&addr, &len);
+        port_ = ntohs(addr.sin_port);
+        thread_ = std::thread([this] { run(); });
+    }
+
+    ~StandInServer() {
+        stop_ = true;
+        thread_.join();
+        close(fd_);
+    }
+
+    uint16_t port() const { return port_; }
+    std::atomic<int> mode{SERVER_OK};
+    std::atomic<long long> offset_us{0}; // Server clock error vs truth
+    std::atomic<int> requests{0};
+
+private:
+    static void put_stamp(uint8_t *p, int64_t unix_us) {
+        uint64_t sec = (uint64_t)(unix_us / 1000000) + NTP_UNIX_OFFSET;
+        uint64_t frac = ((uint64_t)(unix_us % 1000000) << 32) / 1000000;
+        for (int i = 0; i < 4; i++) {
+            p[i] = (uint8_t)(sec >> (24 - 8 * i));
+            p[4 + i] = (uint8_t)(frac >> (24 - 8 * i));
+        }
+    }
+
+    void run() {
+        while (!stop_) {
+            pollfd pfd = { fd_, POLLIN, 0 };
+            if (poll(&pfd, 1, 5) <= 0) {
+                continue;
+            }
+
+            uint8_t req[NTP_PACKET_SIZE];
+            sockaddr_in from = {};
+            socklen_t from_len = sizeof(from);
+            ssize_t len = recvfrom(fd_, req, sizeof(req), 0, (sockaddr *)&from, &from_len);
+            if (len < NTP_PACKET_SIZE) {
+                continue;
+            }
+            requests++;
+
+            int m = mode;
+            if (m == SERVER_SILENT) {
+                continue;
+            }
+
+            uint8_t reply[NTP_PACKET_SIZE] = {0};
+            int64_t now = true_time_us() + offset_us;
+            reply[0] = 0x24; // LI 0, version 4, mode 4 (server)
+            reply[1] = m == SERVER_KOD ? 0 : 2;
+            memcpy(&reply[24], &req[40], 8);
+            if (m == SERVER_STALE) {
+                reply[31] ^= 0xFF;
+            }
+            put_stamp(&reply[32], now);
+            put_stamp(&reply[40], now);
+            sendto(fd_, reply, sizeof(reply), 0, (sockaddr *)&from, from_len);
+        }
+    }
+
+    int fd_;
+    uint16_t port_;
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
+
+// ============ TaskWiFi STAND-IN ============
+typedef struct {
+    unsigned long rounds;
+    unsigned long failures;
+    ntp_sync_result_t last;
+} RoundLog;
+
+static RoundLog round_log;
+static double max_poll_ms = 0;
+static unsigned long polls = 0;
+static bool clock_moved_in_poll = false;
+
+static void on_round(const ntp_sync_result_t *result) {
+    round_log.rounds++;
+    if (!result->ok) {
+        round_log.failures++;
+    }
+    round_log.last = *result;
+}
+
+// Mirrors the TaskWiFi loop: poll, then sleep one loop period, or
+// NTP_POLL_MS while a reply is due
+static void run_wifi_loop(uint32_t virtual_ms) {
+    int64_t end = host_clock_us() + (int64_t)virtual_ms * 1000;
+    while (host_clock_us() < end) {
+        int64_t before = host_clock_us();
+        auto t0 = std::chrono::steady_clock::now();
+        ntp_sync_poll();
+        polls++;
+        double ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - t0).count();
+
+        if (ms > max_poll_ms) max_poll_ms = ms;
+        if (host_clock_us() != before) clock_moved_in_poll = true;
+
+        if (ntp_sync_busy()) {
+            host_clock_advance_us(NTP_POLL_MS * 1000);
+            usleep(300); // Let the server thread answer
+        } else {
+            host_clock_advance_us(LOOP_PERIOD_MS * 1000);
+        }
+    }
+}
+
+// Runs loops until `rounds` more rounds have completed
+static void run_rounds(unsigned long rounds) {
+    unsigned long target = round_log.rounds + rounds;
+    for (int guard = 0; guard < 2000 && round_log.rounds < target; guard++) {
+        run_wifi_loop(LOOP_PERIOD_MS);
+    }
+}
+
+static int64_t clock_error_us(void) {
+    return time_epoch_us() - true_time_us();
+}
+
+// ============ TEST HELPERS ============
+static int total_tests = 0;
+static int passed_tests = 0;
+
+static void report(const char *name, bool passed, const char *detail) {
+    total_tests++;
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║ TEST #%02d: %-46s ║\n", total_tests, name);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+    printf("  %s\n", detail);
+    printf("  Result:   %s\n", passed ? "PASS" : "FAIL");
+    if (passed) passed_tests++;
+}
+
+// ============ MAIN TEST SUITE ============
+int main() {
+    host_serial_quiet(true);
+    host_clock_set_us(1000000);
+
+    StandInServer primary, secondary, tertiary;
+    host_udp_map("primary.test", primary.port());
+    host_udp_map("secondary.test", secondary.port());
+    host_udp_map("tertiary.test", tertiary.port());
+
+    static const char *const servers[] = {
+        "primary.test", "secondary.test", "tertiary.test"
+    };
+    ntp_sync_begin(servers, 3, 60 * 1000, on_round);
+    char detail[160];
+
+    // === COLD START ===
+    {
+        bool was_valid = time_is_valid();
+        int64_t start = host_clock_us();
+        run_rounds(1);
+        int64_t err = clock_error_us();
+        double took_ms = (host_clock_us() - start) / 1000.0;
+        snprintf(detail, sizeof(detail),
+                 "valid %d->%d, error %+.1f ms, stepped %d, %.0f ms virtual",
+                 was_valid, time_is_valid(), err / 1000.0,
+                 round_log.last.stepped, took_ms);
+        report("Cold start sets the clock",
+               !was_valid && time_is_valid() && round_log.last.ok &&
+               round_log.last.stepped && llabs(err) < 20000 && took_ms < 1000,
+               detail);
+    }
+
+    // === FAILOVER ===
+    {
+        primary.mode = SERVER_SILENT;
+        ntp_sync_request();
+        run_rounds(1);
+        snprintf(detail, sizeof(detail),
+                 "ok %d, replies %u, winner %u, primary requests %d",
+                 round_log.last.ok, round_log.last.replies,
+                 round_log.last.server, primary.requests.load());
+        report("Silent primary fails over",
+               round_log.last.ok && round_log.last.replies == 2 &&
+               round_log.last.server != 0, detail);
+    }
+
+    {
+        primary.mode = SERVER_KOD;
+        secondary.mode = SERVER_STALE;
+        host_udp_map("tertiary.test", 0); // DNS miss
+        ntp_sync_request();
+        run_rounds(1);
+        snprintf(detail, sizeof(detail), "ok %d, replies %u",
+                 round_log.last.ok, round_log.last.replies);
+        report("KoD, stale and unresolvable rejected",
+               !round_log.last.ok && round_log.last.replies == 0, detail);
+    }
+
+    // === BACKOFF ===
+    {
+        unsigned long failures = round_log.failures;
+        int64_t start = host_clock_us();
+        run_wifi_loop(40 * 1000);
+        unsigned long rounds = round_log.failures - failures;
+        snprintf(detail, sizeof(detail),
+                 "%lu failed rounds in %.0f s (2+4+8+16 s backoff)",
+                 rounds, (host_clock_us() - start) / 1e6);
+        report("All servers down backs off", rounds >= 3 && rounds <= 5, detail);
+    }
+
+    // === SMOOTHING ===
+    {
+        primary.mode = SERVER_OK;
+        secondary.mode = SERVER_OK;
+        host_udp_map("tertiary.test", tertiary.port());
+        run_rounds(1); // Recover, retry is already pending
+
+        uint32_t jumps = time_jump_count_get();
+        time_adjust_us(-60000); // Local clock 60 ms behind
+        ntp_sync_request();
+        run_rounds(1);
+        int64_t applied = round_log.last.applied_us;
+        bool stepped = round_log.last.stepped;
+
+        // Slew runs at TIME_SLEW_PPM, watch the clock never go backwards
+        bool monotonic = true;
+        int64_t prev = time_epoch_us();
+        for (int i = 0; i < 400; i++) {
+            run_wifi_loop(LOOP_PERIOD_MS);
+            int64_t cur = time_epoch_us();
+            monotonic = monotonic && cur >= prev;
+            prev = cur;
+        }
+        int64_t err = clock_error_us();
+        snprintf(detail, sizeof(detail),
+                 "slewed %+.1f ms, residual %+.1f ms, monotonic %d, jumps %lu",
+                 applied / 1000.0, err / 1000.0, monotonic,
+                 (unsigned long)(time_jump_count_get() - jumps));
+        report("Small offset is slewed, not stepped",
+               !stepped && applied > 45000 && applied < 75000 && monotonic &&
+               llabs(err) < 15000 && time_jump_count_get() == jumps, detail);
+    }
+
+    {
+        uint32_t jumps = time_jump_count_get();
+        primary.offset_us = secondary.offset_us = tertiary.offset_us = 5000000;
+        ntp_sync_request();
+        run_rounds(1);
+        int64_t err = clock_error_us() - 5000000;
+        snprintf(detail, sizeof(detail), "stepped %d, error %+.1f ms, jumps %lu",
+                 round_log.last.stepped, err / 1000.0,
+                 (unsigned long)(time_jump_count_get() - jumps));
+        report("Large offset steps the clock",
+               round_log.last.stepped && llabs(err) < 20000 &&
+               time_jump_count_get() == jumps + 1, detail);
+    }
+
+    // === DRIFT ===
+    {
+        host_clock_set_drift_ppm(40); // Fast crystal
+        run_wifi_loop(4 * 3600 * 1000);
+        time_discipline_stats_t stats;
+        time_discipline_stats(&stats);
+        int64_t err = clock_error_us() - 5000000;
+        snprintf(detail, sizeof(detail),
+                 "freq %+ld ppb, locked %d, interval %lu s, error %+.1f ms",
+                 (long)stats.freq_ppb, stats.locked,
+                 (unsigned long)(ntp_sync_interval_get() / 1000), err / 1000.0);
+        report("Interval grows once drift is characterised",
+               stats.locked && labs(stats.freq_ppb + 40000) < 2000 &&
+               ntp_sync_interval_get() > 60 * 1000 && llabs(err) < 15000,
+               detail);
+    }
+
+    // === SLOW DNS ===
+    {
+        host_dns_set_delay_ms(400); // Nothing cached, every name goes out
+        host_udp_map("tertiary.test", 0);
+        unsigned long start_polls = polls;
+        int64_t start = host_clock_us();
+        ntp_sync_request();
+        run_rounds(1);
+        double took_ms = (host_clock_us() - start) / 1000.0;
+        unsigned long round_polls = polls - start_polls;
+        host_dns_set_delay_ms(0);
+        host_udp_map("tertiary.test", tertiary.port());
+        snprintf(detail, sizeof(detail),
+                 "ok %d, replies %u, %.0f ms virtual, %lu polls, longest %.3f ms",
+                 round_log.last.ok, round_log.last.replies, took_ms, round_polls,
+                 max_poll_ms);
+        report("Slow DNS is polled for, not waited on",
+               round_log.last.ok && round_log.last.replies == 2 &&
+               took_ms >= 3 * 400 && took_ms < 3 * 400 + 2 * NTP_REPLY_TIMEOUT_MS &&
+               round_polls > 3 * 400 / NTP_POLL_MS / 2 &&
+               max_poll_ms < LOOP_PERIOD_MS / 10.0, detail);
+    }
+
+    // === NON-BLOCKING ===
+    {
+        snprintf(detail, sizeof(detail),
+                 "longest poll %.3f ms wall, clock moved inside poll: %s",
+                 max_poll_ms, clock_moved_in_poll ? "yes" : "no");
+        report("Poll never blocks the TaskWiFi loop",
+               max_poll_ms < LOOP_PERIOD_MS / 10.0 && !clock_moved_in_poll, detail);
+    }
+
+    ntp_sync_stop();
+
+    // ============ SUMMARY ============
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║%*sTEST SUMMARY%*s║\n", 46/2, "", (46+1)/ 2, "");
+    printf("║══════════════════════════════════════════════════════════║\n");
+    printf("║  Total tests   : %-39d ║\n", total_tests);
+    printf("║  Passed        : %-39d ║\n", passed_tests);
+    printf("║  Failed        : %-39d ║\n", total_tests - passed_tests);
+    printf("║  Success rate  : %-39.f ║\n",
+        (float)passed_tests / total_tests * 100);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+
+    return (passed_tests == total_tests) ? 0 : 1; // Indicate failure
+}
@@ -0,0 +1,294 @@
+#include "global.h"
+#include "host_shims.h"
+#include <chrono>
+
+// ============ HOST SIMULATOR ============
+// Runs the real scheduler (esp_node.cpp) against a virtual clock. Each
+// simulated TaskSync tick is followed by a TaskHMI drain, so relay GPIO
+// levels follow the same path as on the board.
+
+SemaphoreHandle_t xVPMutex = NULL;
+QueueHandle_t xHMIUpdateQueue = NULL;
+EventGroupHandle_t eventGroup = NULL;
+
+#define SIM_START_EPOCH 1735669800UL // UTC of 2025-01-01 00:00 local
+#define SIM_QUEUE_LENGTH 64
+
+typedef struct {
+    FILE *out;
+    uint32_t lines;
+} SimTrace;
+
+static SimTrace trace = { NULL, 0 };
+
+// True simulated time, independent of what the firmware clock believes
+static uint32_t sim_epoch(void) {
+    return SIM_START_EPOCH + (uint32_t)(host_clock_us() / 1000000);
+}
+
+static void trace_line(const char *what) {
+    uint32_t t = sim_epoch() - SIM_START_EPOCH;
+    fprintf(trace.out, "D+%03lu %02lu:%02lu:%02lu %s\n",
+            (unsigned long)(t / 86400),
+            (unsigned long)(t / 3600 % 24),
+            (unsigned long)(t / 60 % 60),
+            (unsigned long)(t % 60), what);
+    trace.lines++;
+}
+
+static void on_gpio(uint8_t pin, uint8_t level, void *ctx) {
+    static uint8_t last[40];
+    (void)ctx;
+    if (last[pin] == level) {
+        return; // Rewrite of the same level, not a transition
+    }
+    last[pin] = level;
+
+    const char *name = pin == LIGHT_RELAY ? "LIGHT" :
+                       pin == WATER_RELAY ? "SPRAY" :
+                       pin == FAN_RELAY ? "FAN" : "PIN";
+    char line[32];
+    snprintf(line, sizeof(line), "%s %s", name, level ? "ON" : "OFF");
+    trace_line(line);
+}
+
+static void on_hmi(uint16_t address, const char *text, uint8_t value, void *ctx) {
+    (void)text;
+    (void)ctx;
+    if (address == VP_GROWTH_DAY) {
+        char line[32];
+        snprintf(line, sizeof(line), "GROWTH DAY %u", value);
+        trace_line(line);
+    }
+}
+
+// === TaskHMI stand-in ===
+static void sim_hmi_drain(void) {
+    hmi_update_item_t msg;
+    while (xQueueReceive(xHMIUpdateQueue, &msg, 0) == pdTRUE) {
+        if (msg.type == HMI_UPDATE_VALUE) {
+            uint8_t val = vp_get_value(msg.address);
+            hmi.setVP(msg.address, val);
+
+            uint8_t pin = io_pin_map(msg.address);
+            if (pin != 0) {
+                digitalWrite(pin, val);
+            }
+        }
+    }
+}
+
+// === TaskSync stand-in ===
+static void sim_tick(void) {
+    time_snapshot_t now;
+    if (time_now(&now) && xSemaphoreTake(xVPMutex, portMAX_DELAY) == pdTRUE) {
+        io_automation_run(&now);
+        xSemaphoreGive(xVPMutex);
+    }
+    sim_hmi_drain();
+    log_ring_flush(); // TaskLog stand-in, --verbose console
+}
+
+// ============ SCENARIO ============
+static void sim_setup(void) {
+    memset(&vp, 0, sizeof(vp));
+    vp.total_cycle = 90;
+    vp.growth_day = 1;
+
+    vp.light_auto = 1;
+    vp.light_on_hr = 6;   vp.light_off_hr = 20;
+
+    vp.fan_auto = 1;
+    vp.fan_on_hr = 22;    vp.fan_on_min = 30;
+    vp.fan_off_hr = 4;    vp.fan_off_min = 15;   // Overnight
+
+    vp.water_auto = 1;
+    vp.water_on_hr = 7;   vp.water_off_hr = 19;
+    vp.water_interval_hr = 3;
+    vp.water_duration_sec = 20;
+
+    vp_save_values();
+    io_schedule_init();
+    growth_init();
+    time_set_epoch(SIM_START_EPOCH);
+}
+
+// Day 10: TaskSync stalls 05:30-14:00 and must catch up
+static bool sim_stalled(uint32_t t) {
+    const uint32_t D = 86400;
+    return t >= 10 * D + 5 * 3600 + 1800 && t < 10 * D + 14 * 3600;
+}
+
+// Scripted disturbances, checked once per simulated minute
+static void sim_events(uint32_t t) {
+    const uint32_t D = 86400;
+
+    // Day 20: bad server puts the clock 2 h ahead, fixed at 12:00
+    if (t == 20 * D + 3 * 3600) {
+        time_set_epoch(sim_epoch() + 7200);
+        trace_line("CLOCK +7200");
+    } else if (t == 20 * D + 12 * 3600) {
+        time_set_epoch(sim_epoch());
+        trace_line("CLOCK SYNC");
+    }
+
+    // Day 30: operator restarts the cycle count at day 25
+    if (t == 30 * D + 9 * 3600) {
+        trace_line("HMI GROWTH DAY 25");
+        hmi.inject(VP_GROWTH_DAY, 25, "");
+    }
+
+    // Day 45: operator switches the light off by hand at noon
+    if (t == 45 * D + 12 * 3600) {
+        trace_line("HMI LIGHT OFF");
+        hmi.inject(VP_LIGHT_STATE, 0, "");
+    }
+
+    // Day 60: light auto disabled for a day, then re-enabled
+    if (t == 60 * D + 10 * 3600) {
+        trace_line("HMI LIGHT AUTO OFF");
+        hmi.inject(VP_LIGHT_AUTO, 0, "");
+    } else if (t == 61 * D + 10 * 3600) {
+        trace_line("HMI LIGHT AUTO ON");
+        hmi.inject(VP_LIGHT_AUTO, 1, "");
+    }
+}
+
+// ============ GOLDEN FILE ============
+static int compare_golden(const char *actual_path, const char *golden_path) {
+    FILE *a = fopen(actual_path, "r");
+    FILE *g = fopen(golden_path, "r");
+    if (!a || !g) {
+        printf("  Cannot open %s\n", a ? golden_path : actual_path);
+        if (a) fclose(a);
+        if (g) fclose(g);
+        return -1;
+    }
+
+    char la[128], lg[128];
+    int line = 0, diff = 0;
+    for (;;) {
+        char *ra = fgets(la, sizeof(la), a);
+        char *rg = fgets(lg, sizeof(lg), g);
+        line++;
+        if (!ra && !rg) break;
+        if (!ra || !rg || strcmp(la, lg) != 0) {
+            printf("  First difference at line %d\n", line);
+            printf("    golden: %s", rg ? lg : "<end>\n");
+            printf("    actual: %s", ra ? la : "<end>\n");
+            diff = 1;
+            break;
+        }
+    }
+
+    fclose(a);
+    fclose(g);
+    return diff;
+}
+
+// ============ MAIN ============
+static void usage(const char *prog) {
+    printf("Usage: %s [--days N] [--tick-ms N] [--trace FILE]\n"
+           "          [--golden FILE | --write-golden FILE] [--verbose]\n", prog);
+}
+
+int main(int argc, char **argv) {
+    uint32_t days = 90;
+    uint32_t tick_ms = 500;
+    const char *trace_path = "/tmp/grow_sim_trace.txt"; // Out of the tree
+    const char *golden = NULL;
+    bool write_golden = false;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--days") && i + 1 < argc) {
+            days = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--tick-ms") && i + 1 < argc) {
+            tick_ms = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--trace") && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (!strcmp(argv[i], "--golden") && i + 1 < argc) {
+            golden = argv[++i];
+        } else if (!strcmp(argv[i], "--write-golden") && i + 1 < argc) {
+            golden = argv[++i];
+            write_golden = true;
+        } else if (!strcmp(argv[i], "--verbose")) {
+            verbose = true;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (tick_ms == 0 || 1000 % tick_ms != 0) {
+        printf("--tick-ms must divide 1000\n");
+        return 2;
+    }
+
+    trace.out = fopen(write_golden ? golden : trace_path, "w");
+    if (!trace.out) {
+        perror("trace");
+        return 2;
+    }
+
+    host_serial_quiet(!verbose);
+    host_gpio_set_hook(on_gpio, NULL);
+    host_hmi_set_hook(on_hmi, NULL);
+    xVPMutex = xSemaphoreCreateMutex();
+    xHMIUpdateQueue = xQueueCreate(SIM_QUEUE_LENGTH, sizeof(hmi_update_item_t));
+    hmi.hmiCallBack(hmi_on_event);
+
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║ GROW CYCLE SIMULATION: %3lu days, %4lu ms tick%*s║\n",
+           (unsigned long)days, (unsigned long)tick_ms, 11, "");
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+
+    sim_setup();
+
+    const uint32_t ticks_per_sec = 1000 / tick_ms;
+    const uint64_t total_sec = (uint64_t)days * 86400;
+    uint64_t ticks = 0;
+    auto wall_start = std::chrono::steady_clock::now();
+
+    for (uint32_t t = 0; t < total_sec; t++) {
+        if (t % 60 == 0) {
+            sim_events(t);
+        }
+        bool stalled = sim_stalled(t);
+
+        for (uint32_t k = 0; k < ticks_per_sec; k++) {
+            if (!stalled) {
+                sim_tick();
+                ticks++;
+            }
+            host_clock_advance_us((int64_t)tick_ms * 1000);
+        }
+    }
+    sim_tick();
+
+    double wall_sec = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - wall_start).count();
+    fclose(trace.out);
+
+    host_nvs_stats_t nvs;
+    host_nvs_stats(&nvs);
+
+    printf("  Simulated     : %llu s (%lu days)\n",
+           (unsigned long long)total_sec, (unsigned long)days);
+    printf("  Ticks         : %llu\n", (unsigned long long)ticks);
+    printf("  Wall time     : %.2f s\n", wall_sec);
+    printf("  Throughput    : %.0f simulated s per wall s\n",
+           wall_sec > 0 ? total_sec / wall_sec : 0.0);
+    printf("  Trace lines   : %lu -> %s\n",
+           (unsigned long)trace.lines, write_golden ? golden : trace_path);
+    printf("  NVS puts      : %lu (%lu changed a value)\n", nvs.puts, nvs.writes);
+    printf("  Clock jumps   : %lu\n", (unsigned long)time_jump_count_get());
+
+    int result = 0;
+    if (golden && !write_golden) {
+        result = compare_golden(trace_path, golden);
+        printf("  Golden        : %s\n", result == 0 ? "MATCH" : "MISMATCH");
+    }
+
+    printf("  Result:   %s\n", result == 0 ? "PASS" : "FAIL");
+    return result == 0 ? 0 : 1;
+}
@@ -0,0 +1,251 @@
+#include "global.h"
+#include "host_shims.h"
+#include <esp_system.h>
+#include <chrono>
+#include <thread>
+
+// ============ HOST SETUP ============
+// The four firmware tasks are stood in for by run(), which steps the
+// clock 1 ms at a time, beats each task on its period and polls like
+// TaskSupervisor. The hang is a real task blocked on xVPMutex.
+
+SemaphoreHandle_t xVPMutex = NULL;
+QueueHandle_t xHMIUpdateQueue = NULL;
+EventGroupHandle_t eventGroup = NULL;
+
+static bool sync_hung = false;  // TaskSync stops beating
+static uint32_t sync_late_ms = 0; // Added to every 4th sync loop
+static volatile int hung_state = 0; // 1 blocked on the mutex, 2 finished
+
+static void run(uint32_t ms) {
+    static uint32_t next_wifi = 0, next_sync = 0, next_log = 0, next_poll = 0, sync_loops = 0;
+    for (uint32_t i = 0; i < ms; i++) {
+        host_clock_advance_us(1000);
+        uint32_t now = millis();
+        supervisor_beat(supervisor_hmi_id);
+        if ((int32_t)(now - next_wifi) >= 0) {
+            supervisor_beat(supervisor_wifi_id);
+            next_wifi = now + TASK_PERIOD_WIFI_MS;
+        }
+        if (!sync_hung && (int32_t)(now - next_sync) >= 0) {
+            supervisor_beat(supervisor_sync_id);
+            next_sync = now + TASK_PERIOD_SYNC_MS + (++sync_loops % 4 == 0 ? sync_late_ms : 0);
+        }
+        if ((int32_t)(now - next_log) >= 0) {
+            supervisor_beat(supervisor_log_id);
+            next_log = now + TASK_PERIOD_LOG_MS;
+        }
+        if ((int32_t)(now - next_poll) >= 0) {
+            supervisor_poll();
+            next_poll = now + SUPERVISOR_PERIOD_MS;
+        }
+    }
+}
+
+// TaskSync waiting forever on a mutex someone never gives back
+static void TaskHung(void *pvParameters) {
+    supervisor_beat(supervisor_sync_id);
+    hung_state = 1;
+    xSemaphoreTake(xVPMutex, portMAX_DELAY);
+    xSemaphoreGive(xVPMutex);
+    supervisor_beat(supervisor_sync_id);
+    hung_state = 2;
+    vTaskDelete(NULL);
+}
+
+static void string_sink(const char *text, size_t len, void *ctx) {
+    ((std::string *)ctx)->append(text, len);
+}
+
+static std::string exposition(void) {
+    std::string text;
+    metrics_write(string_sink, &text);
+    return text;
+}
+
+// Value of one exposed series, -1 when missing
+static long series(const std::string &text, const char *name) {
+    std::string key = std::string("\n" METRICS_PREFIX) + name + " ";
+    size_t at = text.find(key);
+    return at == std::string::npos ? -1 : strtol(text.c_str() + at + key.size(), NULL, 10);
+}
+
+static unsigned long feeds(void) {
+    host_wdt_stats_t stats;
+    host_wdt_stats(&stats);
+    return stats.feeds;
+}
+
+// ============ TEST HELPERS ============
+static int total_tests = 0;
+static int passed_tests = 0;
+
+static void report(const char *name, bool passed, const char *detail) {
+    total_tests++;
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║ TEST #%02d: %-46s ║\n", total_tests, name);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+    printf("  %s\n", detail);
+    printf("  Result:   %s\n", passed ? "PASS" : "FAIL");
+    if (passed) passed_tests++;
+}
+
+// ============ MAIN TEST SUITE ============
+int main() {
+    host_serial_quiet(true);
+    host_clock_set_us(1000000);
+    char detail[300];
+
+    xVPMutex = xSemaphoreCreateMutex();
+    xHMIUpdateQueue = xQueueCreate(64, sizeof(hmi_update_item_t));
+    eventGroup = xEventGroupCreate();
+
+    memset(&vp, 0, sizeof(vp));
+    vp_save_values();
+    host_reset_reason_set(ESP_RST_POWERON);
+    journal_begin();
+    journal_flush();
+
+    // === ON-TIME TASKS ===
+    {
+        supervisor_begin();
+        supervisor_hmi_id = supervisor_register("hmi", TASK_PERIOD_HMI_MS, TASK_DEADLINE_HMI_MS);
+        supervisor_wifi_id = supervisor_register("wifi", TASK_PERIOD_WIFI_MS, TASK_DEADLINE_WIFI_MS);
+        supervisor_sync_id = supervisor_register("sync", TASK_PERIOD_SYNC_MS, TASK_DEADLINE_SYNC_MS);
+        supervisor_log_id = supervisor_register("log", TASK_PERIOD_LOG_MS, TASK_DEADLINE_LOG_MS);
+        int spare = supervisor_register("spare", 1000, 3600000); // Fills the last slot
+        int none = supervisor_register("none", 1000, 1000);
+        run(10000);
+
+        host_wdt_stats_t stats;
+        host_wdt_stats(&stats);
+        snprintf(detail, sizeof(detail),
+                 "ids %d %d %d %d %d, sixth %d, %lu feeds in 10 s, timeout %u s, panic %s, %s",
+                 supervisor_hmi_id, supervisor_wifi_id, supervisor_sync_id, supervisor_log_id,
+                 spare, none,
+                 stats.feeds, (unsigned)stats.timeout_s, stats.panic ? "on" : "off",
+                 host_wdt_expired() ? "expired" : "fed");
+        report("On-time tasks keep the watchdog fed",
+               supervisor_log_id == 3 && spare == 4 && none == -1 && stats.subscribed == 1 &&
+               stats.timeout_s == SUPERVISOR_WDT_S && stats.panic &&
+               stats.feeds == 10000 / SUPERVISOR_PERIOD_MS && !host_wdt_expired() &&
+               !supervisor_tripped(), detail);
+    }
+
+    // === LATE LOOPS ===
+    {
+        sync_late_ms = 30; // One loop in four runs 80 ms
+        run(8000);
+        sync_late_ms = 0;
+
+        std::string text = exposition();
+        long on_time = series(text, "task_jitter_ms_bucket{task=\"sync\",le=\"1\"}");
+        long late = series(text, "task_jitter_ms_bucket{task=\"sync\",le=\"50\"}") -
+                    series(text, "task_jitter_ms_bucket{task=\"sync\",le=\"20\"}");
+        long count = series(text, "task_jitter_ms_count{task=\"sync\"}");
+        long max = series(text, "task_loop_max_ms{task=\"sync\"}");
+        long hmi = series(text, "task_jitter_ms_count{task=\"hmi\"}") -
+                   series(text, "task_jitter_ms_bucket{task=\"hmi\",le=\"1\"}");
+        snprintf(detail, sizeof(detail),
+                 "sync %ld loops, %ld on time, %ld 30 ms late, longest %ld ms, hmi %ld late",
+                 count, on_time, late, max, hmi);
+        report("Late loops land in the jitter histogram",
+               count > 0 && late >= 8000 / 230 && late <= 8000 / 230 + 1 && on_time + late == count && max == 80 &&
+               hmi == 0 && !supervisor_tripped(), detail);
+    }
+
+    // === HUNG TASK ===
+    {
+        std::string console;
+        log_ring_flush();
+        host_serial_set_hook(string_sink, &console);
+
+        unsigned long fed = feeds();
+        sync_hung = true;
+        xSemaphoreTake(xVPMutex, portMAX_DELAY);
+        xTaskCreatePinnedToCore(TaskHung, "TaskHung", 4096, NULL, 1, NULL, 1);
+        while (hung_state != 1) {
+            std::this_thread::yield();
+        }
+        uint32_t hung_ms = millis();
+        uint32_t tripped_ms = 0;
+        while (!supervisor_tripped() && millis() - hung_ms < 20000) {
+            run(1);
+            tripped_ms = millis();
+        }
+        unsigned long fed_before_trip = feeds() - fed;
+        bool held = !host_wdt_expired(); // Fed at the poll before the miss
+        run(SUPERVISOR_WDT_S * 1000);
+        bool expired = host_wdt_expired();
+        host_serial_set_hook(NULL, NULL);
+
+        std::string journal;
+        journal_write(string_sink, &journal, 0);
+        size_t last = journal.rfind('\n', journal.size() - 2);
+        std::string record = journal.substr(last + 1);
+        long gap = 0;
+        char type[12] = "", event[12] = "", task[12] = "";
+        sscanf(record.c_str(), "%*s %*s %*s %*s %11s %11s %ld %11s", type, event, &gap, task);
+        long missed = series(exposition(), "task_deadline_missed_total{task=\"sync\"}");
+
+        bool logged = console.find("[SUPERVISOR] sync missed its deadline") != std::string::npos &&
+                      console.find("Watchdog reset in 5 s") != std::string::npos &&
+                      console.find("hmi missed") == std::string::npos &&
+                      console.find("wifi missed") == std::string::npos;
+        snprintf(detail, sizeof(detail),
+                 "caught after %lu ms, %lu feeds meanwhile, journal \"%s %s %ld %s\", "
+                 "missed %ld, console %s, watchdog %s then %s",
+                 (unsigned long)(tripped_ms - hung_ms), fed_before_trip, type, event, gap, task,
+                 missed, logged ? "ok" : "wrong", held ? "held" : "expired",
+                 expired ? "expired" : "held");
+        report("Hung task stops the feeds and is logged",
+               supervisor_tripped() && tripped_ms - hung_ms > TASK_DEADLINE_SYNC_MS &&
+               tripped_ms - hung_ms <= TASK_DEADLINE_SYNC_MS + SUPERVISOR_PERIOD_MS &&
+               strcmp(type, "watchdog") == 0 && strcmp(event, "MISSED") == 0 &&
+               gap > TASK_DEADLINE_SYNC_MS && strcmp(task, "sync") == 0 && missed == 1 &&
+               logged && held && expired, detail);
+    }
+
+    // === RECOVERY STAYS TRIPPED ===
+    {
+        unsigned long fed = feeds();
+        xSemaphoreGive(xVPMutex);
+        while (hung_state != 2) {
+            std::this_thread::yield();
+        }
+        sync_hung = false;
+        run(5000);
+        long missed = series(exposition(), "task_deadline_missed_total{task=\"sync\"}");
+        snprintf(detail, sizeof(detail), "%lu feeds after recovery, missed %ld, %s",
+                 feeds() - fed, missed, host_wdt_expired() ? "reset pending" : "fed");
+        report("A late recovery does not cancel the reset",
+               feeds() == fed && missed == 1 && supervisor_tripped() && host_wdt_expired(),
+               detail);
+    }
+
+    // === BEAT COST ===
+    {
+        const int beats = 1000000;
+        auto wall = std::chrono::steady_clock::now();
+        for (int i = 0; i < beats; i++) {
+            supervisor_beat(supervisor_hmi_id);
+        }
+        double ns = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - wall).count() / beats;
+        snprintf(detail, sizeof(detail), "%.1f ns per supervisor_beat()", ns);
+        report("Heartbeat is cheap", ns < 500, detail);
+    }
+
+    // ============ SUMMARY ============
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║%*sTEST SUMMARY%*s║\n", 46/2, "", (46+1)/ 2, "");
+    printf("║══════════════════════════════════════════════════════════║\n");
+    printf("║  Total tests   : %-39d ║\n", total_tests);
+    printf("║  Passed        : %-39d ║\n", passed_tests);
+    printf("║  Failed        : %-39d ║\n", total_tests - passed_tests);
+    printf("║  Success rate  : %-39.f ║\n",
+        (float)passed_tests / total_tests * 100);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+
+    return (passed_tests == total_tests) ? 0 : 1; // Indicate failure
+}
@@ -0,0 +1,174 @@
+#include "global.h"
+#include "host_shims.h"
+
+// ============ VIRTUAL CLOCK ============
+#define TRUE_EPOCH_US 1735669800000000LL // True UTC at virtual 0
+#define SYNC_INTERVAL_SEC 600 // NTP_UPDATE_INTERVAL
+
+static int64_t true_time_us(void) {
+    return TRUE_EPOCH_US + host_clock_us();
+}
+
+static int64_t clock_error_us(void) {
+    return time_epoch_us() - true_time_us();
+}
+
+// Deterministic +-1 ms measurement noise
+static int64_t noise_us(void) {
+    return (int64_t)(rand() % 2001) - 1000;
+}
+
+typedef struct {
+    int64_t max_abs_err_us;   // Worst clock error seen between syncs
+    int64_t max_rate_ppm;     // Worst deviation from true rate, 1 s steps
+    bool monotonic;
+    uint32_t syncs;
+} RunStats;
+
+// Advances `seconds` of true time, one sync every `interval` seconds
+static void run_synced(uint32_t seconds, uint32_t interval, RunStats *st) {
+    int64_t prev = time_epoch_us();
+    for (uint32_t t = 1; t <= seconds; t++) {
+        host_clock_advance_us(1000000);
+        int64_t cur = time_epoch_us();
+
+        int64_t rate = (cur - prev) - 1000000; // ppm over one second
+        if (llabs(rate) > st->max_rate_ppm) st->max_rate_ppm = llabs(rate);
+        if (cur < prev) st->monotonic = false;
+        prev = cur;
+
+        if (interval && t % interval == 0) {
+            time_discipline(-clock_error_us() + noise_us());
+            st->syncs++;
+            prev = time_epoch_us();
+        }
+        int64_t err = llabs(clock_error_us());
+        if (err > st->max_abs_err_us) st->max_abs_err_us = err;
+    }
+}
+
+// ============ TEST HELPERS ============
+static int total_tests = 0;
+static int passed_tests = 0;
+
+static void report(const char *name, bool passed, const char *detail) {
+    total_tests++;
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║ TEST #%02d: %-46s ║\n", total_tests, name);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+    printf("  %s\n", detail);
+    printf("  Result:   %s\n", passed ? "PASS" : "FAIL");
+    if (passed) passed_tests++;
+}
+
+// ============ MAIN TEST SUITE ============
+int main() {
+    host_serial_quiet(true);
+    srand(7);
+    char detail[160];
+    time_discipline_stats_t stats;
+
+    host_clock_set_us(0);
+    time_set_epoch_us(true_time_us());
+
+    // === SLEW ===
+    {
+        RunStats st = { 0, 0, true, 0 };
+        uint32_t jumps = time_jump_count_get();
+        time_discipline(-100000); // 100 ms ahead, below the step limit
+        run_synced(300, 0, &st);
+        snprintf(detail, sizeof(detail),
+                 "rate error max %lld ppm, residual %+.2f ms, jumps %lu",
+                 (long long)st.max_rate_ppm, clock_error_us() / 1000.0,
+                 (unsigned long)(time_jump_count_get() - jumps));
+        report("100 ms error slews at the bounded rate",
+               st.monotonic && st.max_rate_ppm <= TIME_SLEW_PPM + 1 &&
+               llabs(clock_error_us() + 100000) < 100 &&
+               time_jump_count_get() == jumps, detail);
+
+        // Undo the deliberate error for the next cases
+        time_set_epoch_us(true_time_us());
+    }
+
+    // === DRIFT LEARNING ===
+    const double drifts[] = { 40.0, -25.0, 110.0 };
+    for (double ppm : drifts) {
+        host_clock_set_drift_ppm(ppm);
+        RunStats warm = { 0, 0, true, 0 };
+        run_synced(6 * 3600, SYNC_INTERVAL_SEC, &warm);
+
+        RunStats st = { 0, 0, true, 0 };
+        run_synced(6 * 3600, SYNC_INTERVAL_SEC, &st);
+        time_discipline_stats(&stats);
+
+        double learned = -stats.freq_ppb / 1000.0;
+        snprintf(detail, sizeof(detail),
+                 "learned %+.2f ppm, locked %d, max error %.2f ms over %lu syncs",
+                 learned, stats.locked, st.max_abs_err_us / 1000.0,
+                 (unsigned long)st.syncs);
+        char name[64];
+        snprintf(name, sizeof(name), "Learns %+.0f ppm crystal", ppm);
+        report(name,
+               fabs(learned - ppm) < 2.0 && stats.locked && st.monotonic &&
+               st.max_abs_err_us < 5000, detail);
+    }
+
+    // === HOLDOVER ===
+    {
+        // Last crystal is 110 ppm, uncorrected that is 792 ms in 2 h
+        RunStats st = { 0, 0, true, 0 };
+        run_synced(2 * 3600, 0, &st);
+        snprintf(detail, sizeof(detail),
+                 "error after 2 h without sync %+.2f ms (uncorrected %.0f ms)",
+                 clock_error_us() / 1000.0, 110e-6 * 7200 * 1000);
+        report("Learned drift holds time without NTP",
+               llabs(clock_error_us()) < 10000, detail);
+        time_discipline(-clock_error_us());
+    }
+
+    // === TEMPERATURE CHANGE ===
+    {
+        host_clock_set_drift_ppm(95.0); // Crystal cooled down
+        RunStats first = { 0, 0, true, 0 };
+        run_synced(SYNC_INTERVAL_SEC, SYNC_INTERVAL_SEC, &first);
+        bool unlocked = !time_drift_locked();
+
+        RunStats st = { 0, 0, true, 0 };
+        run_synced(6 * 3600, SYNC_INTERVAL_SEC, &st);
+        time_discipline_stats(&stats);
+        snprintf(detail, sizeof(detail),
+                 "unlocked on change %d, relearned %+.2f ppm, locked %d",
+                 unlocked, -stats.freq_ppb / 1000.0, stats.locked);
+        report("Drift change drops lock and relearns",
+               unlocked && stats.locked &&
+               fabs(-stats.freq_ppb / 1000.0 - 95.0) < 2.0, detail);
+    }
+
+    // === STEP ===
+    {
+        uint32_t jumps = time_jump_count_get();
+        bool stepped = time_discipline(3000000 - clock_error_us());
+        time_discipline_stats(&stats);
+        snprintf(detail, sizeof(detail),
+                 "stepped %d, error %+.2f ms, frequency kept %+.2f ppm",
+                 stepped, (clock_error_us() - 3000000) / 1000.0,
+                 -stats.freq_ppb / 1000.0);
+        report("Large offset steps and keeps frequency",
+               stepped && time_jump_count_get() == jumps + 1 &&
+               llabs(clock_error_us() - 3000000) < 100 &&
+               fabs(-stats.freq_ppb / 1000.0 - 95.0) < 2.0, detail);
+    }
+
+    // ============ SUMMARY ============
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║%*sTEST SUMMARY%*s║\n", 46/2, "", (46+1)/ 2, "");
+    printf("║══════════════════════════════════════════════════════════║\n");
+    printf("║  Total tests   : %-39d ║\n", total_tests);
+    printf("║  Passed        : %-39d ║\n", passed_tests);
+    printf("║  Failed        : %-39d ║\n", total_tests - passed_tests);
+    printf("║  Success rate  : %-39.f ║\n",
+        (float)passed_tests / total_tests * 100);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+
+    return (passed_tests == total_tests) ? 0 : 1; // Indicate failure
+}
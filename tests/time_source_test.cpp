@@ -0,0 +1,196 @@
+#include "global.h"
+#include "host_shims.h"
+#include <chrono>
+
+// ============ HOST SETUP ============
+// Drives the panel RTC path the way TaskHMI does: request, listen, and
+// drain the HMI queue. Automation runs through the real esp_node.cpp.
+
+SemaphoreHandle_t xVPMutex = NULL;
+QueueHandle_t xHMIUpdateQueue = NULL;
+EventGroupHandle_t eventGroup = NULL;
+
+#define TRUE_EPOCH 1741608000LL // 2025-03-10 12:00 UTC, 17:30 local
+#define BOOT_LOCAL (TRUE_EPOCH + TIME_LOCAL_OFFSET)
+
+static int64_t true_epoch(void) {
+    return TRUE_EPOCH + host_clock_us() / 1000000;
+}
+
+static int64_t clock_error_ms(void) {
+    return (time_epoch_us() - TRUE_EPOCH * 1000000 - host_clock_us()) / 1000;
+}
+
+// === TaskHMI stand-in ===
+static unsigned long hmi_drain(void) {
+    hmi_update_item_t msg;
+    unsigned long rtc_updates = 0;
+    while (xQueueReceive(xHMIUpdateQueue, &msg, 0) == pdTRUE) {
+        if (msg.type == HMI_UPDATE_VALUE) {
+            uint8_t pin = io_pin_map(msg.address);
+            if (pin != 0) {
+                digitalWrite(pin, vp_get_value(msg.address));
+            }
+        } else if (msg.type == HMI_UPDATE_RTC) {
+            hmi_rtc_write();
+            rtc_updates++;
+        }
+    }
+    return rtc_updates;
+}
+
+static void boot_read_rtc(void) {
+    hmi_rtc_request();
+    hmi.listen();
+}
+
+// ============ TEST HELPERS ============
+static int total_tests = 0;
+static int passed_tests = 0;
+
+static void report(const char *name, bool passed, const char *detail) {
+    total_tests++;
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║ TEST #%02d: %-46s ║\n", total_tests, name);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+    printf("  %s\n", detail);
+    printf("  Result:   %s\n", passed ? "PASS" : "FAIL");
+    if (passed) passed_tests++;
+}
+
+// ============ MAIN TEST SUITE ============
+int main() {
+    host_serial_quiet(true);
+    host_clock_set_us(0);
+    char detail[160];
+
+    xVPMutex = xSemaphoreCreateMutex();
+    xHMIUpdateQueue = xQueueCreate(16, sizeof(hmi_update_item_t));
+    hmi.hmiCallBack(hmi_on_event);
+
+    memset(&vp, 0, sizeof(vp));
+    vp.total_cycle = 15;
+    vp.growth_day = 1;
+    vp.light_auto = 1;
+    vp.light_on_hr = 6;
+    vp.light_off_hr = 20;
+    io_schedule_init();
+    growth_init();
+
+    // === DEAD RTC ===
+    {
+        host_hmi_rtc_set(0); // Backup cell flat, panel reads 2000-01-01
+        boot_read_rtc();
+        snprintf(detail, sizeof(detail), "valid %d, source %s",
+                 time_is_valid(), time_source_name(time_source_get()));
+        report("Panel RTC that lost power is ignored",
+               !time_is_valid() && time_source_get() == TIME_SOURCE_NONE, detail);
+    }
+
+    // === OFFLINE BOOT ===
+    {
+        host_clock_advance_us(1200000);
+        host_hmi_rtc_set(BOOT_LOCAL + 1); // Whole seconds only
+
+        auto start = std::chrono::steady_clock::now();
+        boot_read_rtc();
+
+        // TaskSync's first pass once the time is valid
+        time_snapshot_t now;
+        bool valid = time_now(&now);
+        if (valid && xSemaphoreTake(xVPMutex, portMAX_DELAY) == pdTRUE) {
+            io_automation_run(&now);
+            xSemaphoreGive(xVPMutex);
+        }
+        hmi_drain();
+        double ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+
+        int64_t err_ms = clock_error_ms();
+        snprintf(detail, sizeof(detail),
+                 "source %s, error %+lld ms, light %s after %.3f ms, no WiFi",
+                 time_source_name(time_source_get()), (long long)err_ms,
+                 host_gpio_level(LIGHT_RELAY) ? "ON" : "OFF", ms);
+        report("Panel RTC gives valid time at boot",
+               valid && time_source_get() == TIME_SOURCE_RTC &&
+               err_ms >= -500 && err_ms <= 500 &&
+               host_gpio_level(LIGHT_RELAY) == 1 && ms < 50, detail);
+    }
+
+    // === NTP TAKES OVER ===
+    {
+        host_clock_advance_us(60000000);
+        bool taken = time_source_offer(TIME_SOURCE_NTP,
+            TRUE_EPOCH * 1000000 + host_clock_us() + 250000);
+
+        host_hmi_rtc_set(BOOT_LOCAL + 3600); // Panel an hour off
+        boot_read_rtc();
+        int64_t err_ms = clock_error_ms();
+        snprintf(detail, sizeof(detail),
+                 "NTP accepted %d, source %s, error after RTC reply %+lld ms",
+                 taken, time_source_name(time_source_get()), (long long)err_ms);
+        report("RTC never overrides NTP",
+               taken && time_source_get() == TIME_SOURCE_NTP &&
+               err_ms == 250, detail);
+    }
+
+    // === WRITE-BACK ===
+    {
+        unsigned long writes = host_hmi_rtc_writes();
+        hmi_update_rtc();
+        unsigned long queued = hmi_drain();
+
+        int64_t rtc_err = host_hmi_rtc_get() - (true_epoch() + TIME_LOCAL_OFFSET);
+        snprintf(detail, sizeof(detail),
+                 "queued %lu, panel writes %lu, RTC error %+lld s",
+                 queued, host_hmi_rtc_writes() - writes, (long long)rtc_err);
+        report("NTP time is written back to the panel",
+               queued == 1 && host_hmi_rtc_writes() == writes + 1 &&
+               rtc_err >= 0 && rtc_err <= 1, detail);
+    }
+
+    // === REPLY PARSING ===
+    {
+        struct {
+            const char *response;
+            bool valid;
+        } cases[] = {
+            { "5A A5 0C 83 00 10 04 19 03 0A 01 11 1E 00 00 ", true },
+            { "5A A5 0C 83 00 10 04 19 0D 0A 01 11 1E 00 00 ", false }, // Month 13
+            { "5A A5 0C 83 00 10 04 00 01 01 06 00 00 00 00 ", false }, // 2000
+            { "5A A5 0C 82 00 10 04 19 03 0A 01 11 1E 00 00 ", false }, // Write
+            { "5A A5 0C 83 10 00 04 19 03 0A 01 11 1E 00 00 ", false }, // VP
+            { "5A A5 0C 83 00 10 04 19 03 0A ", false },                // Short
+            { "", false },
+        };
+
+        int ok = 0;
+        const int count = sizeof(cases) / sizeof(cases[0]);
+        uint32_t epoch = 0;
+        for (int i = 0; i < count; i++) {
+            uint32_t e = 0;
+            if (hmi_rtc_parse(cases[i].response, &e) == cases[i].valid) {
+                ok++;
+            }
+            if (i == 0) epoch = e;
+        }
+        snprintf(detail, sizeof(detail),
+                 "%d/%d frames classified, 2025-03-10 17:30 local -> %lu",
+                 ok, count, (unsigned long)epoch);
+        report("RTC replies are validated",
+               ok == count && epoch == TRUE_EPOCH, detail);
+    }
+
+    // ============ SUMMARY ============
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║%*sTEST SUMMARY%*s║\n", 46/2, "", (46+1)/ 2, "");
+    printf("║══════════════════════════════════════════════════════════║\n");
+    printf("║  Total tests   : %-39d ║\n", total_tests);
+    printf("║  Passed        : %-39d ║\n", passed_tests);
+    printf("║  Failed        : %-39d ║\n", total_tests - passed_tests);
+    printf("║  Success rate  : %-39.f ║\n",
+        (float)passed_tests / total_tests * 100);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+
+    return (passed_tests == total_tests) ? 0 : 1; // Indicate failure
+}
@@ -0,0 +1,516 @@
+#include "global.h"
+#include "host_shims.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+// ============ HOST SETUP ============
+// Real loopback TCP clients against the VP API, with the server polled
+// the way TaskWiFi does and the HMI queue drained in between.
+
+SemaphoreHandle_t xVPMutex = NULL;
+QueueHandle_t xHMIUpdateQueue = NULL;
+EventGroupHandle_t eventGroup = NULL;
+
+static uint16_t api_port = 0;
+
+// === Heap use inside the server ===
+static bool count_allocs = false;
+static unsigned long allocs = 0;
+
+void *operator new(size_t size) {
+    if (count_allocs) allocs++;
+    void *p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+// === TaskHMI stand-in ===
+typedef struct {
+    unsigned long values;
+    unsigned long strings;
+    unsigned long alls;
+} hmi_counts_t;
+
+static hmi_counts_t hmi_drain(void) {
+    hmi_counts_t counts = { 0, 0, 0 };
+    hmi_update_item_t msg;
+    while (xQueueReceive(xHMIUpdateQueue, &msg, 0) == pdTRUE) {
+        if (msg.type == HMI_UPDATE_VALUE) {
+            counts.values++;
+            uint8_t pin = io_pin_map(msg.address);
+            if (pin != 0) {
+                digitalWrite(pin, vp_get_value(msg.address));
+            }
+        } else if (msg.type == HMI_UPDATE_STRING) {
+            counts.strings++;
+        } else if (msg.type == HMI_UPDATE_ALL) {
+            hmi_update_all_taken();
+            counts.alls++;
+        }
+    }
+    if (hmi_update_all_deferred()) {
+        counts.alls++;
+    }
+    return counts;
+}
+
+// TaskHMI as it runs, xVPMutex taken for every item it sends
+static volatile bool hmi_task_stop = false;
+static volatile bool hmi_task_done = false;
+static volatile bool hmi_task_stuck = false; // Mutex held by a sender waiting on the queue
+static volatile unsigned long hmi_task_bars = 0;
+static volatile unsigned long hmi_task_strs = 0;
+
+static void TaskHMILocking(void *pvParameters) {
+    hmi_update_item_t msg;
+    while (!hmi_task_stop) {
+        if (xQueueReceive(xHMIUpdateQueue, &msg, 0) != pdTRUE) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        hmi_task_bars += msg.address == VP_GROWTH_BAR;
+        hmi_task_strs += msg.address == VP_GROWTH_STR;
+        if (xSemaphoreTake(xVPMutex, pdMS_TO_TICKS(2000)) == pdTRUE) {
+            xSemaphoreGive(xVPMutex);
+        } else {
+            hmi_task_stuck = true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    hmi_task_done = true;
+    vTaskDelete(NULL);
+}
+
+// === Client ===
+// Sends one request and polls the server until it closes the reply.
+// Returns the status code, the body in `body`.
+static int http(const char *method, const char *path, const char *payload,
+                std::string *body) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(api_port);
+    if (connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    char req[1200];
+    int len = snprintf(req, sizeof(req),
+                       "%s %s HTTP/1.1\r\nHost: node\r\nContent-Length: %u\r\n\r\n%s",
+                       method, path, (unsigned)strlen(payload), payload);
+    send(fd, req, len, 0);
+
+    std::string reply;
+    char buf[2048];
+    for (int spins = 0; spins < 100000; spins++) {
+        count_allocs = true;
+        vp_http_poll();
+        count_allocs = false;
+
+        ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n > 0) {
+            reply.append(buf, n);
+        } else if (n == 0) {
+            break; // Server closed, reply complete
+        }
+    }
+    close(fd);
+
+    int status = 0;
+    sscanf(reply.c_str(), "HTTP/1.1 %d", &status);
+    size_t split = reply.find("\r\n\r\n");
+    *body = split == std::string::npos ? "" : reply.substr(split + 4);
+    while (!body->empty() && body->back() == '\n') body->pop_back();
+    return status;
+}
+
+// Connects and sends a GET without reading the reply, -1 on failure.
+// A small receive buffer makes the server's send buffer fill early.
+static int http_open_slow(const char *path) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int rcvbuf = 1024;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(api_port);
+    if (connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    char req[200];
+    int len = snprintf(req, sizeof(req), "GET %s HTTP/1.1\r\nHost: node\r\n\r\n", path);
+    send(fd, req, len, 0);
+    return fd;
+}
+
+// Longest vp_http_poll() of `polls`, in wall milliseconds
+static double poll_max_ms(int polls) {
+    double max_ms = 0;
+    for (int i = 0; i < polls; i++) {
+        auto t0 = std::chrono::steady_clock::now();
+        vp_http_poll();
+        double ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - t0).count();
+        max_ms = ms > max_ms ? ms : max_ms;
+    }
+    return max_ms;
+}
+
+static void string_sink(const char *text, size_t len, void *ctx) {
+    ((std::string *)ctx)->append(text, len);
+}
+
+static unsigned long count_of(const std::string &s, const char *what) {
+    unsigned long n = 0;
+    for (size_t pos = s.find(what); pos != std::string::npos; pos = s.find(what, pos + 1)) {
+        n++;
+    }
+    return n;
+}
+
+// ============ TEST HELPERS ============
+static int total_tests = 0;
+static int passed_tests = 0;
+
+static void report(const char *name, bool passed, const char *detail) {
+    total_tests++;
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║ TEST #%02d: %-46s ║\n", total_tests, name);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+    printf("  %s\n", detail);
+    printf("  Result:   %s\n", passed ? "PASS" : "FAIL");
+    if (passed) passed_tests++;
+}
+
+// ============ MAIN TEST SUITE ============
+int main() {
+    host_serial_quiet(true);
+    host_clock_set_us(0);
+    char detail[240];
+    std::string body;
+
+    xVPMutex = xSemaphoreCreateMutex();
+    xHMIUpdateQueue = xQueueCreate(64, sizeof(hmi_update_item_t));
+    eventGroup = xEventGroupCreate();
+
+    memset(&vp, 0, sizeof(vp));
+    strcpy(vp.hostname, "E-1A2B");
+    strcpy(vp.holder_ssid, "a\"b\\c");
+    strcpy(vp.wifi_ssid, "greenhouse");
+    strcpy(vp.wifi_pswd, "secret123");
+    vp.total_cycle = 15;
+    vp.growth_day = 1;
+    vp.light_on_hr = 6;
+    vp.light_on_min = 30;
+    vp.light_off_hr = 20;
+    vp.water_interval_hr = 2;
+    vp.water_duration_sec = 10;
+    vp_save_values();
+    io_schedule_init();
+
+    vp_http_begin();
+    api_port = host_tcp_port(VP_HTTP_PORT);
+
+    // === BULK READ ===
+    {
+        int status = http("GET", "/vp", "", &body);
+        bool shape = body.size() > 2 && body.front() == '{' && body.back() == '}';
+        snprintf(detail, sizeof(detail), "%d, %u bytes, %lu keys, escaped %d, password %d",
+                 status, (unsigned)body.size(), count_of(body, "\":"),
+                 body.find("\"1500\":\"a\\\"b\\\\c\"") != std::string::npos,
+                 body.find("1430") != std::string::npos);
+        report("GET /vp streams every readable VP",
+               status == 200 && shape && count_of(body, "\":") == num_vp_items - 1 &&
+               body.find("\"1120\":6,") != std::string::npos &&
+               body.find("\"1010\":\"E-1A2B\"") != std::string::npos &&
+               body.find("\"1500\":\"a\\\"b\\\\c\"") != std::string::npos &&
+               body.find("1430") == std::string::npos, detail);
+    }
+
+    // === SINGLE READ AND ERRORS ===
+    {
+        std::string one, missing, secret, path;
+        int s1 = http("GET", "/vp/1130", "", &one);
+        int s2 = http("GET", "/vp/9999", "", &missing);
+        int s3 = http("GET", "/vp/1430", "", &secret);
+        int s4 = http("POST", "/vp", "", &body);
+        int s5 = http("GET", "/nope", "", &path);
+        snprintf(detail, sizeof(detail), "%d %s | %d %s | %d %s | %d | %d",
+                 s1, one.c_str(), s2, missing.c_str(), s3, secret.c_str(), s4, s5);
+        report("GET /vp/{addr} and error replies",
+               s1 == 200 && one == "{\"1130\":30}" && s2 == 404 && s3 == 403 &&
+               s4 == 405 && s5 == 404, detail);
+    }
+
+    // === SINGLE WRITE ===
+    {
+        host_nvs_stats_t before, after;
+        host_nvs_stats(&before);
+        int status = http("PUT", "/vp/1100", "1", &body);
+        host_nvs_stats(&after);
+        hmi_counts_t hmi = hmi_drain();
+        snprintf(detail, sizeof(detail),
+                 "%d %s, light %u, relay %u, NVS commits %lu, HMI values %lu",
+                 status, body.c_str(), vp.light_state, host_gpio_level(LIGHT_RELAY),
+                 after.commits - before.commits, hmi.values);
+        report("PUT /vp/{addr} acts like a panel edit",
+               status == 200 && body == "{\"changed\":1}" && vp.light_state == 1 &&
+               host_gpio_level(LIGHT_RELAY) == 1 &&
+               after.commits - before.commits == 1 && hmi.values == 1, detail);
+    }
+
+    // === BULK WRITE ===
+    {
+        host_nvs_stats_t before, after;
+        host_nvs_stats(&before);
+        int status = http("PUT", "/vp",
+                          "{\"1120\": 7, \"1130\": 15, \"1140\": 21, \"1150\": 45,"
+                          " \"1210\": 1, \"1420\": \"barn\"}", &body);
+        host_nvs_stats(&after);
+        hmi_counts_t hmi = hmi_drain();
+
+        // Reboot, the batch is in flash
+        memset(&vp, 0, sizeof(vp));
+        vp_load_values();
+        snprintf(detail, sizeof(detail),
+                 "%d %s, NVS commits %lu, HMI %lu values %lu strings, after reboot %02u:%02u-%02u:%02u '%s'",
+                 status, body.c_str(), after.commits - before.commits, hmi.values,
+                 hmi.strings, vp.light_on_hr, vp.light_on_min, vp.light_off_hr,
+                 vp.light_off_min, vp.wifi_ssid);
+        report("Bulk PUT: one NVS session, one HMI batch",
+               status == 200 && body == "{\"changed\":6}" &&
+               after.commits - before.commits <= 2 && // VP table + WiFi record
+               hmi.values == 5 && hmi.strings == 1 &&
+               vp.light_on_hr == 7 && vp.light_off_min == 45 && vp.water_auto == 1 &&
+               strcmp(vp.wifi_ssid, "barn") == 0, detail);
+    }
+
+    // === ALL OR NOTHING ===
+    {
+        host_nvs_stats_t before, after;
+        host_nvs_stats(&before);
+        std::string range, readonly, syntax;
+        int s1 = http("PUT", "/vp", "{\"1120\":8,\"1140\":25}", &range);
+        int s2 = http("PUT", "/vp", "{\"1120\":8,\"1000\":\"12:00\"}", &readonly);
+        int s3 = http("PUT", "/vp", "{\"1120\":8,", &syntax);
+        host_nvs_stats(&after);
+        hmi_counts_t hmi = hmi_drain();
+        snprintf(detail, sizeof(detail), "%d %s | %d %s | %d %s | on_hr %u, NVS writes %lu, HMI %lu",
+                 s1, range.c_str(), s2, readonly.c_str(), s3, syntax.c_str(),
+                 vp.light_on_hr, after.writes - before.writes, hmi.values + hmi.strings);
+        report("Invalid batch changes nothing",
+               s1 == 400 && s2 == 403 && s3 == 400 && vp.light_on_hr == 7 &&
+               after.writes == before.writes && hmi.values + hmi.strings == 0, detail);
+    }
+
+    // === LARGE BATCH AND NO-OP ===
+    {
+        int s1 = http("PUT", "/vp",
+                      "{\"1220\":5,\"1230\":1,\"1240\":18,\"1250\":2,\"1260\":3,"
+                      "\"1270\":20,\"1320\":8,\"1330\":4,\"1340\":22,\"1350\":6}", &body);
+        std::string again; // Queued before TaskHMI sent the first
+        int s3 = http("PUT", "/vp",
+                      "{\"1220\":6,\"1230\":2,\"1240\":19,\"1250\":3,\"1260\":4,"
+                      "\"1270\":21,\"1320\":9,\"1330\":5,\"1340\":23,\"1350\":7}", &again);
+        hmi_counts_t hmi = hmi_drain();
+        host_nvs_stats_t before, after;
+        host_nvs_stats(&before);
+        std::string same;
+        int s2 = http("PUT", "/vp/1260", "4", &same);
+        host_nvs_stats(&after);
+        snprintf(detail, sizeof(detail),
+                 "%d %s, %d %s, HMI %lu full / %lu single | same value %d %s, NVS commits %lu",
+                 s1, body.c_str(), s3, again.c_str(), hmi.alls, hmi.values, s2, same.c_str(),
+                 after.commits - before.commits);
+        report("Large batches share one full refresh",
+               s1 == 200 && body == "{\"changed\":10}" && s3 == 200 &&
+               again == "{\"changed\":10}" && hmi.alls == 1 &&
+               hmi.values == 0 && s2 == 200 && same == "{\"changed\":0}" &&
+               after.commits == before.commits, detail);
+    }
+
+    // === FULL REFRESH WITH A FULL QUEUE ===
+    {
+        hmi_update_item_t filler = { HMI_UPDATE_VALUE, VP_LIGHT_AUTO, TRACE_NONE };
+        while (xQueueSend(xHMIUpdateQueue, &filler, 0) == pdTRUE) {
+        }
+        int s1 = http("PUT", "/vp",
+                      "{\"1220\":5,\"1230\":1,\"1240\":18,\"1250\":2,\"1260\":3,"
+                      "\"1270\":20,\"1320\":8,\"1330\":4,\"1340\":22,\"1350\":6}", &body);
+        size_t changed = 0; // An MQTT command, same path
+        const char json[] = "{\"1220\":6,\"1230\":2,\"1240\":19,\"1250\":3,\"1260\":4,"
+                            "\"1270\":21,\"1320\":9,\"1330\":5,\"1340\":23,\"1350\":7}";
+        int s2 = vp_http_apply_json(json, sizeof(json) - 1, &changed);
+        hmi_counts_t hmi = hmi_drain();
+        snprintf(detail, sizeof(detail), "%d %s | mqtt %d, %u changed | HMI %lu full, %lu filler",
+                 s1, body.c_str(), s2, (unsigned)changed, hmi.alls, hmi.values);
+        report("Full queue defers the refresh, never blocks",
+               s1 == 200 && body == "{\"changed\":10}" && s2 == 0 && changed == 10 &&
+               hmi.alls == 1 && hmi.values == 64, detail);
+    }
+
+    // === DERIVED VPS WITH A FULL QUEUE ===
+    {
+        xTaskCreatePinnedToCore(TaskHMILocking, "TaskHMI", 4096, NULL, 3, NULL, 1);
+
+        hmi_update_item_t filler = { HMI_UPDATE_VALUE, VP_LIGHT_AUTO, TRACE_NONE };
+        while (xQueueSend(xHMIUpdateQueue, &filler, 0) == pdTRUE) {
+        }
+        int s1 = http("PUT", "/vp", "{\"1030\":30,\"1040\":15}", &body);
+        while (uxQueueMessagesWaiting(xHMIUpdateQueue) > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        hmi_task_stop = true;
+        while (!hmi_task_done) {
+            std::this_thread::yield();
+        }
+        snprintf(detail, sizeof(detail), "%d %s, bar %u \"%s\", queued bar %lu text %lu, %s",
+                 s1, body.c_str(), vp.growth_bar, vp.growth_str, hmi_task_bars, hmi_task_strs,
+                 hmi_task_stuck ? "mutex held while queueing" : "queued unlocked");
+        report("Derived VPs queue after the mutex",
+               s1 == 200 && body == "{\"changed\":2}" && hmi_task_bars >= 1 &&
+               hmi_task_strs >= 1 && !hmi_task_stuck, detail);
+    }
+
+    // === CREDENTIALS ===
+    {
+        std::string short_pswd, empty_ssid, open_net, wpa;
+        int s1 = http("PUT", "/vp/1430", "\"1234567\"", &short_pswd);
+        int s2 = http("PUT", "/vp", "{\"1420\":\"\",\"1430\":\"longenough\"}", &empty_ssid);
+        bool kept = strcmp(vp.wifi_ssid, "barn") == 0 && strcmp(vp.wifi_pswd, "secret123") == 0;
+
+        // The MQTT command topic goes through the same checks
+        size_t changed = 0;
+        const char json[] = "{\"1430\":\"abc\"}";
+        int s3 = vp_http_apply_json(json, sizeof(json) - 1, &changed);
+        int s4 = http("PUT", "/vp/1430", "\"\"", &open_net);
+        int s5 = http("PUT", "/vp/1430", "\"longenough\"", &wpa);
+        hmi_drain();
+        snprintf(detail, sizeof(detail), "%d %s | %d %s | mqtt %d %s | open %d | wpa %d, kept %d",
+                 s1, short_pswd.c_str(), s2, empty_ssid.c_str(), s3, vp_http_error(), s4, s5,
+                 kept);
+        report("WiFi credentials follow the portal's rules",
+               s1 == 400 && s2 == 400 && s3 == 400 && changed == 0 && kept &&
+               s4 == 200 && s5 == 200 && strcmp(vp.wifi_pswd, "longenough") == 0, detail);
+    }
+
+    // === SLOW READER ===
+    {
+        // Lock sites and a few supervised tasks, for a long exposition
+        for (int i = 0; i < 40; i++) {
+            if (vp_lock()) {
+                vp_unlock();
+            }
+        }
+        std::string expect;
+        metrics_write(string_sink, &expect);
+
+        int fd = http_open_slow("/metrics");
+        vp_http_stats_t before, stalled;
+        vp_http_stats(&before);
+        double max_ms = poll_max_ms(200);
+        bool busy = vp_http_busy();
+        vp_http_stats(&stalled);
+
+        // Now read it all, the reply resumes where it stopped
+        std::string reply;
+        char buf[512];
+        for (int spins = 0; spins < 100000; spins++) {
+            vp_http_poll();
+            ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+            if (n > 0) {
+                reply.append(buf, n);
+            } else if (n == 0) {
+                break;
+            }
+        }
+        close(fd);
+        size_t split = reply.find("\r\n\r\n");
+        std::string text = split == std::string::npos ? "" : reply.substr(split + 4);
+
+        snprintf(detail, sizeof(detail),
+                 "%lu of %u bytes sent while stalled, busy %d, longest poll %.3f ms, "
+                 "%lu of %lu lines",
+                 (unsigned long)(stalled.bytes_out - before.bytes_out), (unsigned)reply.size(),
+                 busy, max_ms, count_of(text, "\n"), count_of(expect, "\n"));
+        report("Slow reader never stalls the poll",
+               busy && stalled.bytes_out - before.bytes_out < reply.size() &&
+               max_ms < 5 && count_of(text, "\n") == count_of(expect, "\n") &&
+               count_of(text, "# TYPE ") == count_of(expect, "# TYPE ") && !vp_http_busy(),
+               detail);
+    }
+
+    {
+        int fd = http_open_slow("/metrics");
+        poll_max_ms(20);
+        bool busy = vp_http_busy();
+        host_clock_advance_us((VP_HTTP_TIMEOUT_MS + 1) * 1000LL);
+        poll_max_ms(1);
+        bool dropped = !vp_http_busy();
+        close(fd);
+        int status = http("GET", "/vp/1120", "", &body);
+        snprintf(detail, sizeof(detail), "busy %d, dropped after %d ms %d, next %d %s",
+                 busy, VP_HTTP_TIMEOUT_MS, dropped, status, body.c_str());
+        report("Stalled reader dropped after the timeout",
+               busy && dropped && status == 200 && body.find("{\"1120\":") == 0, detail);
+    }
+
+    // === THROUGHPUT ===
+    {
+        const int rounds = 2000;
+        vp_http_stats_t before, after;
+        vp_http_stats(&before);
+        allocs = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        int ok = 0;
+        for (int i = 0; i < rounds; i++) {
+            ok += http("GET", "/vp", "", &body) == 200;
+        }
+        double get_s = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+        unsigned long get_allocs = allocs;
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            ok += http("PUT", "/vp/1110", (i & 1) ? "0" : "1", &body) == 200;
+            hmi_drain();
+        }
+        double put_s = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+        vp_http_stats(&after);
+
+        snprintf(detail, sizeof(detail),
+                 "GET /vp %.0f req/s (%lu B each), PUT %.0f req/s, %.2f server allocs/GET",
+                 rounds / get_s,
+                 (unsigned long)(after.bytes_out - before.bytes_out) / (2 * rounds),
+                 rounds / put_s, (double)get_allocs / rounds);
+        report("Loopback request throughput",
+               ok == 2 * rounds && rounds / get_s > 200 && rounds / put_s > 200 &&
+               // The accepted socket handle, and now and then the host
+               // mutex's queue, nothing from the reply itself
+               get_allocs < 2UL * rounds, detail);
+    }
+
+    // ============ SUMMARY ============
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║%*sTEST SUMMARY%*s║\n", 46/2, "", (46+1)/ 2, "");
+    printf("║══════════════════════════════════════════════════════════║\n");
+    printf("║  Total tests   : %-39d ║\n", total_tests);
+    printf("║  Passed        : %-39d ║\n", passed_tests);
+    printf("║  Failed        : %-39d ║\n", total_tests - passed_tests);
+    printf("║  Success rate  : %-39.f ║\n",
+        (float)passed_tests / total_tests * 100);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+
+    return (passed_tests == total_tests) ? 0 : 1; // Indicate failure
+}
@@ -0,0 +1,241 @@
+#include "global.h"
+#include "host_shims.h"
+#include <chrono>
+#include <thread>
+
+// ============ HOST SETUP ============
+// Holds are timed on the virtual clock. The test advances it inside a
+// hold, and the NVS shim charges a flash write and commit time, so the
+// firmware paths that save under xVPMutex show up over budget the way
+// they do on the board.
+
+SemaphoreHandle_t xVPMutex = NULL;
+QueueHandle_t xHMIUpdateQueue = NULL;
+EventGroupHandle_t eventGroup = NULL;
+
+// Sites that still save to NVS under the mutex. Shrink this list as the
+// critical sections are fixed, a new entry is a regression.
+static const char *known_over_budget[] = {
+    "hmi_on_event",     // vp_sync_item() writes the touched VP
+    "vp_http_apply",    // vp_save_items() for a PUT
+};
+
+// === Call sites under test ===
+static void hold_for(int64_t us) {
+    if (vp_lock()) {
+        host_clock_advance_us(us);
+        vp_unlock();
+    }
+}
+
+static void quick(void) {
+    if (vp_lock()) {
+        vp_unlock();
+    }
+}
+
+static volatile bool waiter_done = false;
+
+static void waiter(void *param) {
+    if (vp_lock()) {
+        vp_unlock();
+    }
+    waiter_done = true;
+}
+
+static const vp_lock_site_t *site_of(const char *func) {
+    for (const vp_lock_site_t *site = vp_lock_sites(); site; site = site->next) {
+        if (strcmp(site->func, func) == 0) {
+            return site;
+        }
+    }
+    return NULL;
+}
+
+static bool known(const char *func) {
+    for (const char *name : known_over_budget) {
+        if (strcmp(name, func) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void hmi_discard(void) {
+    hmi_update_item_t msg;
+    while (xQueueReceive(xHMIUpdateQueue, &msg, 0) == pdTRUE) {
+    }
+}
+
+// ============ TEST HELPERS ============
+static int total_tests = 0;
+static int passed_tests = 0;
+
+static void report(const char *name, bool passed, const char *detail) {
+    total_tests++;
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║ TEST #%02d: %-46s ║\n", total_tests, name);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+    printf("  %s\n", detail);
+    printf("  Result:   %s\n", passed ? "PASS" : "FAIL");
+    if (passed) passed_tests++;
+}
+
+// ============ MAIN TEST SUITE ============
+int main() {
+    host_serial_quiet(true);
+    host_clock_set_us(1000000);
+    char detail[400];
+
+    xVPMutex = xSemaphoreCreateMutex();
+    xHMIUpdateQueue = xQueueCreate(64, sizeof(hmi_update_item_t));
+    eventGroup = xEventGroupCreate();
+
+    memset(&vp, 0, sizeof(vp));
+    strcpy(vp.hostname, "E-1A2B");
+    vp.total_cycle = 15;
+    vp.growth_day = 1;
+    vp.light_on_hr = 6;
+    vp.light_off_hr = 20;
+    vp_save_values();
+    io_schedule_init();
+
+    // === PER-SITE HOLDS ===
+    {
+        uint32_t overruns = vp_lock_overruns();
+        hold_for(200);
+        hold_for(VP_LOCK_BUDGET_US + 1500);
+        quick();
+        const vp_lock_site_t *held = site_of("hold_for");
+        const vp_lock_site_t *fast = site_of("quick");
+        snprintf(detail, sizeof(detail),
+                 "hold_for: %lu holds, %lu us, max %lu, over %lu | quick: max %lu, over %lu | "
+                 "overruns +%lu",
+                 held ? (unsigned long)held->holds : 0, held ? (unsigned long)held->hold_us : 0,
+                 held ? (unsigned long)held->hold_max_us : 0,
+                 held ? (unsigned long)held->over_budget : 0,
+                 fast ? (unsigned long)fast->hold_max_us : 0,
+                 fast ? (unsigned long)fast->over_budget : 0,
+                 (unsigned long)(vp_lock_overruns() - overruns));
+        report("Hold time and budget per call site",
+               held && fast && held->holds == 2 &&
+               held->hold_us == 200 + VP_LOCK_BUDGET_US + 1500 &&
+               held->hold_max_us == VP_LOCK_BUDGET_US + 1500 && held->over_budget == 1 &&
+               fast->holds == 1 && fast->hold_max_us == 0 && fast->over_budget == 0 &&
+               vp_lock_overruns() - overruns == 1 &&
+               strstr(held->file, "vp_lock_test.cpp") != NULL, detail);
+    }
+
+    // === WAIT UNDER CONTENTION ===
+    {
+        uint32_t waits = metric_count(&metric_vp_mutex_wait);
+        if (vp_lock()) {
+            xTaskCreatePinnedToCore(waiter, "waiter", 4096, NULL, 1, NULL, 0);
+            std::this_thread::sleep_for(std::chrono::milliseconds(20)); // Blocked by now
+            host_clock_advance_us(3000);
+            vp_unlock();
+        }
+        while (!waiter_done) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        const vp_lock_site_t *site = site_of("waiter");
+        snprintf(detail, sizeof(detail), "waiter: wait %lu us, max %lu | histogram +%lu",
+                 site ? (unsigned long)site->wait_us : 0,
+                 site ? (unsigned long)site->wait_max_us : 0,
+                 (unsigned long)(metric_count(&metric_vp_mutex_wait) - waits));
+        report("Wait charged to the waiting site",
+               site && site->wait_us == 3000 && site->wait_max_us == 3000 &&
+               metric_count(&metric_vp_mutex_wait) - waits == 2, detail);
+    }
+
+    // === FIRMWARE PATHS AGAINST THE BUDGET ===
+    {
+        host_nvs_set_latency(1500, 8000); // Flash write and commit, order of magnitude
+        hmi_on_event("1100", 1, "", "");  // Light switch
+        hmi_on_event("1120", 7, "", "");  // Light ON hour
+        size_t changed = 0;
+        const char *bulk = "{\"1130\":15,\"1140\":21}";
+        vp_http_apply_json(bulk, strlen(bulk), &changed);
+        wifi_on_link_change(WIFI_LINK_CONNECTING, WIFI_LINK_OFF);
+        hmi_discard();
+        host_nvs_set_latency(0, 0);
+
+        char list[300] = "";
+        size_t used = 0;
+        bool regressed = false;
+        for (const vp_lock_site_t *site = vp_lock_sites(); site; site = site->next) {
+            if (site->over_budget == 0 || strstr(site->file, "vp_lock_test.cpp")) {
+                continue;
+            }
+            const char *file = strrchr(site->file, '/');
+            used += snprintf(list + used, sizeof(list) - used, "%s%s (%s:%u) %lu us",
+                             used ? ", " : "", site->func, file ? file + 1 : site->file,
+                             site->line, (unsigned long)site->hold_max_us);
+            if (!known(site->func)) {
+                regressed = true;
+            }
+            if (used >= sizeof(list)) break;
+        }
+        const vp_lock_site_t *link = site_of("wifi_on_link_change");
+        snprintf(detail, sizeof(detail), "budget %u us, %lu changed, over: %s | link max %lu us",
+                 VP_LOCK_BUDGET_US, (unsigned long)changed, list,
+                 link ? (unsigned long)link->hold_max_us : 0);
+        const vp_lock_site_t *touch = site_of("hmi_on_event");
+        report("Only known sites over budget",
+               !regressed && touch && touch->over_budget == 2 && changed == 2 &&
+               link && link->over_budget == 0, detail);
+    }
+
+    // === EXPOSITION ===
+    {
+        std::string text;
+        metrics_write([](const char *t, size_t len, void *ctx) {
+            ((std::string *)ctx)->append(t, len);
+        }, &text);
+        const vp_lock_site_t *held = site_of("hold_for");
+        char series[160];
+        snprintf(series, sizeof(series),
+                 "\n" METRICS_PREFIX "vp_lock_hold_us_max{site=\"vp_lock_test.cpp:%u\","
+                 "func=\"hold_for\"} %u\n", held ? held->line : 0, VP_LOCK_BUDGET_US + 1500);
+        bool found = text.find(series) != std::string::npos;
+        bool totals = text.find("\n" METRICS_PREFIX "vp_lock_over_budget_total{") !=
+                      std::string::npos;
+        snprintf(detail, sizeof(detail), "hold max series %s, over budget series %s",
+                 found ? "found" : "missing", totals ? "found" : "missing");
+        report("Per-site series on /metrics", found && totals, detail);
+    }
+
+    // === COST ===
+    {
+        const int rounds = 1000000;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            quick();
+        }
+        double lock_ns = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count() / rounds;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            xSemaphoreTake(xVPMutex, portMAX_DELAY);
+            xSemaphoreGive(xVPMutex);
+        }
+        double raw_ns = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count() / rounds;
+        snprintf(detail, sizeof(detail), "vp_lock/vp_unlock %.1f ns, raw take/give %.1f ns",
+                 lock_ns, raw_ns);
+        report("Profiling overhead", lock_ns < raw_ns + 1000, detail);
+    }
+
+    // ============ SUMMARY ============
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║%*sTEST SUMMARY%*s║\n", 46/2, "", (46+1)/ 2, "");
+    printf("║══════════════════════════════════════════════════════════║\n");
+    printf("║  Total tests   : %-39d ║\n", total_tests);
+    printf("║  Passed        : %-39d ║\n", passed_tests);
+    printf("║  Failed        : %-39d ║\n", total_tests - passed_tests);
+    printf("║  Success rate  : %-39.f ║\n",
+        (float)passed_tests / total_tests * 100);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+
+    return (passed_tests == total_tests) ? 0 : 1; // Indicate failure
+}
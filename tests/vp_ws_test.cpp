@@ -0,0 +1,352 @@
+#include "global.h"
+#include "host_shims.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+// ============ HOST SETUP ============
+// Real loopback WebSocket clients against the stream, with the server
+// polled the way TaskWiFi does.
+
+SemaphoreHandle_t xVPMutex = NULL;
+QueueHandle_t xHMIUpdateQueue = NULL;
+EventGroupHandle_t eventGroup = NULL;
+
+static uint16_t ws_port = 0;
+
+static void poll_ws(int times) {
+    for (int i = 0; i < times; i++) {
+        vp_ws_poll(millis());
+    }
+}
+
+// A panel edit: value under the mutex, as TaskHMI does
+static void panel_set(uint16_t address, uint8_t value) {
+    xSemaphoreTake(xVPMutex, portMAX_DELAY);
+    vp_set_value(address, value);
+    xSemaphoreGive(xVPMutex);
+}
+
+// === Client ===
+typedef struct {
+    int fd;
+    std::string in; // Unparsed bytes
+} ws_client_t;
+
+static int ws_connect(int rcvbuf) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // Frames go out at once
+    if (rcvbuf > 0) {
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    }
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(ws_port);
+    if (connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void ws_read(ws_client_t *c) {
+    char buf[4096];
+    ssize_t n;
+    while ((n = recv(c->fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+        c->in.append(buf, n);
+    }
+}
+
+// Sends a request and returns the status line and headers
+static std::string ws_open(ws_client_t *c, const char *request) {
+    send(c->fd, request, strlen(request), 0);
+    for (int spins = 0; spins < 200; spins++) {
+        poll_ws(1);
+        ws_read(c);
+        size_t end = c->in.find("\r\n\r\n");
+        if (end != std::string::npos) {
+            std::string head = c->in.substr(0, end);
+            c->in.erase(0, end + 4);
+            return head;
+        }
+    }
+    return "";
+}
+
+static std::string upgrade_request(const char *path, const char *key) {
+    char req[400];
+    snprintf(req, sizeof(req),
+             "GET %s HTTP/1.1\r\nHost: E-1A2B.local:8081\r\nUpgrade: websocket\r\n"
+             "Connection: Upgrade\r\nSec-WebSocket-Key: %s\r\n"
+             "Sec-WebSocket-Version: 13\r\nUser-Agent: a browser with a rather long "
+             "user agent string that does not fit in the header line buffer at all\r\n\r\n",
+             path, key);
+    return req;
+}
+
+// Next complete server frame, opcode in `op`, false when none yet
+static bool ws_frame(ws_client_t *c, uint8_t *op, std::string *payload) {
+    if (c->in.size() < 2) return false;
+    const uint8_t *p = (const uint8_t *)c->in.data();
+    size_t len = p[1] & 0x7F, head = 2;
+    if (len == 126) {
+        if (c->in.size() < 4) return false;
+        len = (size_t)p[2] << 8 | p[3];
+        head = 4;
+    }
+    if (c->in.size() < head + len) return false;
+    *op = p[0] & 0x0F;
+    *payload = c->in.substr(head, len);
+    c->in.erase(0, head + len);
+    return true;
+}
+
+// Frames from a few polls
+static std::vector<std::string> ws_frames(ws_client_t *c, int polls) {
+    std::vector<std::string> out;
+    uint8_t op;
+    std::string payload;
+    for (int i = 0; i < polls; i++) {
+        poll_ws(1);
+        ws_read(c);
+        while (ws_frame(c, &op, &payload)) {
+            out.push_back(payload);
+        }
+    }
+    return out;
+}
+
+// Masked client frame
+static void ws_send(ws_client_t *c, uint8_t op, const char *payload) {
+    uint8_t frame[140];
+    size_t len = strlen(payload);
+    const uint8_t mask[4] = { 0x12, 0x34, 0x56, 0x78 };
+    frame[0] = 0x80 | op;
+    frame[1] = 0x80 | (uint8_t)len;
+    memcpy(frame + 2, mask, 4);
+    for (size_t i = 0; i < len; i++) frame[6 + i] = payload[i] ^ mask[i % 4];
+    send(c->fd, frame, 6 + len, 0);
+}
+
+static unsigned long count_of(const std::string &s, const char *what) {
+    unsigned long n = 0;
+    for (size_t pos = s.find(what); pos != std::string::npos; pos = s.find(what, pos + 1)) {
+        n++;
+    }
+    return n;
+}
+
+static std::string joined(const std::vector<std::string> &frames) {
+    std::string all;
+    for (const std::string &f : frames) all += f;
+    return all;
+}
+
+// ============ TEST HELPERS ============
+static int total_tests = 0;
+static int passed_tests = 0;
+
+static void report(const char *name, bool passed, const char *detail) {
+    total_tests++;
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║ TEST #%02d: %-46s ║\n", total_tests, name);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+    printf("  %s\n", detail);
+    printf("  Result:   %s\n", passed ? "PASS" : "FAIL");
+    if (passed) passed_tests++;
+}
+
+// ============ MAIN TEST SUITE ============
+int main() {
+    host_serial_quiet(true);
+    host_clock_set_us(0);
+    char detail[240];
+
+    xVPMutex = xSemaphoreCreateMutex();
+    xHMIUpdateQueue = xQueueCreate(64, sizeof(hmi_update_item_t));
+    eventGroup = xEventGroupCreate();
+
+    memset(&vp, 0, sizeof(vp));
+    strcpy(vp.hostname, "E-1A2B");
+    strcpy(vp.wifi_ssid, "greenhouse");
+    strcpy(vp.wifi_pswd, "secret123");
+    vp.light_on_hr = 6;
+    vp.light_on_min = 30;
+
+    vp_ws_begin();
+    ws_port = host_tcp_port(VP_WS_PORT);
+
+    // === HANDSHAKE ===
+    ws_client_t a = { ws_connect(0), "" };
+    {
+        // RFC 6455 section 1.3 example
+        std::string head = ws_open(&a, upgrade_request("/vp", "dGhlIHNhbXBsZSBub25jZQ==").c_str());
+        ws_client_t bad = { ws_connect(0), "" };
+        std::string bad_head = ws_open(&bad, "GET /vp HTTP/1.1\r\nHost: x\r\n\r\n");
+        ws_client_t path = { ws_connect(0), "" };
+        std::string path_head = ws_open(&path, upgrade_request("/", "dGhlIHNhbXBsZSBub25jZQ==").c_str());
+        close(bad.fd);
+        close(path.fd);
+        snprintf(detail, sizeof(detail), "%.34s | %.24s | %.24s",
+                 head.c_str(), bad_head.c_str(), path_head.c_str());
+        report("Upgrade with the RFC 6455 accept key",
+               head.find("HTTP/1.1 101") == 0 &&
+               head.find("Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=") != std::string::npos &&
+               bad_head.find("HTTP/1.1 400") == 0 && path_head.find("HTTP/1.1 400") == 0, detail);
+    }
+
+    // === SNAPSHOT ON OPEN ===
+    {
+        std::vector<std::string> frames = ws_frames(&a, 5);
+        std::string all = joined(frames);
+        bool shaped = true;
+        for (const std::string &f : frames) {
+            shaped = shaped && f.front() == '{' && f.back() == '}' && f.size() <= VP_WS_TX_MAX - 4;
+        }
+        snprintf(detail, sizeof(detail), "%u frame(s), %lu VPs, password %d",
+                 (unsigned)frames.size(), count_of(all, "\":"),
+                 all.find("1430") != std::string::npos);
+        report("Every readable VP on open",
+               frames.size() >= 1 && shaped && count_of(all, "\":") == num_vp_items - 1 &&
+               all.find("\"1120\":6") != std::string::npos &&
+               all.find("1430") == std::string::npos, detail);
+    }
+
+    // === DELTAS TO SEVERAL CLIENTS ===
+    ws_client_t others[VP_WS_MAX_CLIENTS - 1];
+    {
+        for (ws_client_t &c : others) {
+            c = { ws_connect(0), "" };
+            ws_open(&c, upgrade_request("/vp?id=1", "x3JJHMbDL1EzLkh9GBhXDw==").c_str());
+            ws_frames(&c, 5); // Snapshot
+        }
+        ws_client_t extra = { ws_connect(0), "" };
+        std::string extra_head = ws_open(&extra, upgrade_request("/vp", "x3JJHMbDL1EzLkh9GBhXDw==").c_str());
+        close(extra.fd);
+
+        panel_set(VP_LIGHT_ON_HR, 7);
+        panel_set(VP_LIGHT_ON_HR, 8);
+        panel_set(VP_FAN_AUTO, 1);
+        std::vector<std::string> fa = ws_frames(&a, 3);
+        bool same = true;
+        for (ws_client_t &c : others) {
+            std::vector<std::string> fc = ws_frames(&c, 3);
+            same = same && fc == fa;
+        }
+        vp_ws_stats_t stats;
+        vp_ws_stats(&stats);
+        snprintf(detail, sizeof(detail), "%s, %u open, all alike %d | 5th: %.28s",
+                 joined(fa).c_str(), stats.open, same, extra_head.c_str());
+        report("Deltas reach every client, 5th is refused",
+               fa.size() == 1 && fa[0] == "{\"1120\":8,\"1310\":1}" && same &&
+               stats.open == VP_WS_MAX_CLIENTS && extra_head.find("HTTP/1.1 503") == 0, detail);
+    }
+
+    // === BACKPRESSURE ===
+    {
+        // Replace one client with one that stops reading
+        close(others[0].fd);
+        poll_ws(2);
+        ws_client_t slow = { ws_connect(2048), "" };
+        ws_open(&slow, upgrade_request("/vp", "dGhlIHNhbXBsZSBub25jZQ==").c_str());
+        ws_frames(&slow, 5);
+
+        const int rounds = 20000;
+        vp_ws_stats_t before, after;
+        vp_ws_stats(&before);
+        int fast_frames = 0;
+        std::string fast_last;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 1; i <= rounds; i++) {
+            panel_set(VP_LIGHT_ON_MIN, (uint8_t)(i % 60));
+            panel_set(VP_FAN_ON_MIN, (uint8_t)(i % 59));
+            poll_ws(1);
+            if (i % 8 == 0) {
+                // The fast client keeps up
+                ws_read(&a);
+                uint8_t op;
+                std::string payload;
+                while (ws_frame(&a, &op, &payload)) {
+                    fast_frames++;
+                    fast_last = payload;
+                }
+            }
+            for (int k = 1; k < VP_WS_MAX_CLIENTS - 1; k++) {
+                ws_read(&others[k]);
+                others[k].in.clear();
+            }
+        }
+        double secs = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+
+        // The slow reader catches up, ends on the latest values
+        std::vector<std::string> drained;
+        for (int i = 0; i < 200; i++) {
+            std::vector<std::string> f = ws_frames(&slow, 1);
+            drained.insert(drained.end(), f.begin(), f.end());
+        }
+        vp_ws_stats(&after);
+        std::string last = drained.empty() ? "" : drained.back();
+        char want[40];
+        snprintf(want, sizeof(want), "{\"1130\":%u,\"1330\":%u}", rounds % 60, rounds % 59);
+        snprintf(detail, sizeof(detail),
+                 "%.0f polls/s, slow client %u frames for %d rounds, last %s, coalesced %lu, client buffers %u B",
+                 rounds / secs, (unsigned)drained.size(), rounds, last.c_str(),
+                 (unsigned long)(after.coalesced - before.coalesced),
+                 (unsigned)(VP_WS_TX_MAX + VP_WS_RX_MAX + VP_WS_LINE_MAX));
+        report("Slow reader coalesces, others keep up",
+               last == want && drained.size() < (size_t)rounds / 2 &&
+               fast_frames > rounds / 16 && after.coalesced > before.coalesced &&
+               after.open == VP_WS_MAX_CLIENTS && after.dropped == before.dropped, detail);
+        close(slow.fd);
+    }
+
+    // === CONTROL FRAMES ===
+    {
+        ws_frames(&a, 5); // Deltas still in flight
+        ws_send(&a, 0x9, "hi");
+        ws_send(&a, 0x1, "ignored");
+        uint8_t op = 0;
+        std::string payload;
+        for (int i = 0; i < 20 && !ws_frame(&a, &op, &payload); i++) {
+            poll_ws(1);
+            ws_read(&a);
+        }
+        bool pong = op == 0xA && payload == "hi";
+
+        ws_send(&a, 0x8, "\x03\xe8");
+        uint8_t close_op = 0;
+        std::string reason;
+        for (int i = 0; i < 20 && !ws_frame(&a, &close_op, &reason); i++) {
+            poll_ws(1);
+            ws_read(&a);
+        }
+        vp_ws_stats_t stats;
+        vp_ws_stats(&stats);
+        snprintf(detail, sizeof(detail), "pong %d, close reply %d, open %u",
+                 pong, close_op == 0x8, stats.open);
+        report("Ping answered, close echoed",
+               pong && close_op == 0x8 && stats.open == VP_WS_MAX_CLIENTS - 2, detail);
+        close(a.fd);
+    }
+
+    // ============ SUMMARY ============
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║%*sTEST SUMMARY%*s║\n", 46/2, "", (46+1)/ 2, "");
+    printf("║══════════════════════════════════════════════════════════║\n");
+    printf("║  Total tests   : %-39d ║\n", total_tests);
+    printf("║  Passed        : %-39d ║\n", passed_tests);
+    printf("║  Failed        : %-39d ║\n", total_tests - passed_tests);
+    printf("║  Success rate  : %-39.f ║\n",
+        (float)passed_tests / total_tests * 100);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+
+    return (passed_tests == total_tests) ? 0 : 1; // Indicate failure
+}
@@ -0,0 +1,355 @@
+#include "global.h"
+#include "host_shims.h"
+#include <chrono>
+#include <vector>
+
+// ============ HOST SETUP ============
+// Runs the WiFi state machine the way TaskWiFi does, against the
+// emulated access point. Every poll is timed: none may block the loop.
+
+SemaphoreHandle_t xVPMutex = NULL;
+QueueHandle_t xHMIUpdateQueue = NULL;
+EventGroupHandle_t eventGroup = NULL;
+
+#define STEP_MS 10
+
+typedef struct {
+    wifi_link_state_t state;
+    wifi_link_state_t prev;
+    uint32_t at_ms;
+} transition_t;
+
+static std::vector<transition_t> transitions;
+static double poll_max_ms = 0;
+
+static void on_link_change(wifi_link_state_t state, wifi_link_state_t prev) {
+    transitions.push_back({ state, prev, (uint32_t)millis() });
+}
+
+static unsigned long wifi_begins(void) {
+    host_wifi_stats_t stats;
+    host_wifi_stats(&stats);
+    return stats.begins;
+}
+
+static bool link_bit(void) {
+    return (xEventGroupGetBits(eventGroup) & WIFI_CONNECTED_BIT) != 0;
+}
+
+// === TaskWiFi stand-in ===
+static void run_ms(uint32_t ms) {
+    for (uint32_t t = 0; t < ms; t += STEP_MS) {
+        host_wifi_service();
+
+        auto start = std::chrono::steady_clock::now();
+        wifi_link_poll(0);
+        double took = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+        if (took > poll_max_ms) poll_max_ms = took;
+
+        vTaskDelay(pdMS_TO_TICKS(STEP_MS));
+    }
+}
+
+// Runs until `state` is entered, up to `limit_ms`
+static bool run_until(wifi_link_state_t state, uint32_t limit_ms) {
+    for (uint32_t t = 0; t < limit_ms; t += STEP_MS) {
+        run_ms(STEP_MS);
+        if (wifi_link_state() == state) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Beacon loss on a reachable AP, returns the reconnect time in ms
+static uint32_t bounce(const uint8_t bssid[6], uint8_t channel) {
+    host_wifi_set_bssid(bssid, channel);
+    uint32_t start = millis();
+    run_until(WIFI_LINK_UP, 60000);
+    return millis() - start;
+}
+
+// ============ TEST HELPERS ============
+static int total_tests = 0;
+static int passed_tests = 0;
+
+static void report(const char *name, bool passed, const char *detail) {
+    total_tests++;
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║ TEST #%02d: %-46s ║\n", total_tests, name);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+    printf("  %s\n", detail);
+    printf("  Result:   %s\n", passed ? "PASS" : "FAIL");
+    if (passed) passed_tests++;
+}
+
+// ============ MAIN TEST SUITE ============
+int main() {
+    host_serial_quiet(true);
+    host_clock_set_us(0);
+    char detail[160];
+
+    xVPMutex = xSemaphoreCreateMutex();
+    xHMIUpdateQueue = xQueueCreate(16, sizeof(hmi_update_item_t));
+    eventGroup = xEventGroupCreate();
+
+    memset(&vp, 0, sizeof(vp));
+    vp.wifi_state = 1;
+    strcpy(vp.wifi_ssid, "greenhouse");
+    strcpy(vp.wifi_pswd, "secret");
+
+    time_set_epoch(1741608000); // Lease times need a valid clock
+    host_wifi_set_ap(true, 800);
+    wifi_link_begin(on_link_change);
+
+    // === FIRST CONNECT ===
+    {
+        bool up = run_until(WIFI_LINK_UP, 5000);
+        snprintf(detail, sizeof(detail),
+                 "state %s after %lu ms, bit %d, attempts %lu",
+                 wifi_link_state_name(wifi_link_state()),
+                 (unsigned long)millis(), link_bit(),
+                 (unsigned long)wifi_link_attempts());
+        report("Connects without a blocking wait",
+               up && link_bit() && wifi_link_attempts() == 1 &&
+               millis() < 1000, detail);
+    }
+
+    // === LINK DROP ===
+    {
+        uint32_t attempts = wifi_link_attempts();
+        host_wifi_set_ap(false, 800);
+        host_wifi_service();
+        bool bit_after_event = link_bit();
+        run_ms(STEP_MS);
+
+        snprintf(detail, sizeof(detail),
+                 "bit %d after the event, state %s, new attempts %lu",
+                 bit_after_event, wifi_link_state_name(wifi_link_state()),
+                 (unsigned long)(wifi_link_attempts() - attempts));
+        report("Drop clears the bit and retries at once",
+               !bit_after_event && wifi_link_state() == WIFI_LINK_CONNECTING &&
+               wifi_link_attempts() == attempts + 1, detail);
+    }
+
+    // === BACKOFF ===
+    {
+        transitions.clear();
+        run_ms(10 * 60 * 1000); // AP stays down
+
+        // Gap from each failure to the next attempt
+        int short_waits = 0;
+        int long_waits = 0;
+        int bad_waits = 0;
+        uint32_t backoff_at = 0;
+        bool in_backoff = false;
+        for (const transition_t &tr : transitions) {
+            if (tr.state == WIFI_LINK_BACKOFF) {
+                backoff_at = tr.at_ms;
+                in_backoff = true;
+            } else if (tr.state == WIFI_LINK_CONNECTING && in_backoff) {
+                uint32_t gap = tr.at_ms - backoff_at;
+                if (gap >= WIFI_BACKOFF_MIN_MS && gap < WIFI_BACKOFF_MAX_MS + STEP_MS) {
+                    short_waits++;
+                } else if (gap >= WIFI_STA_RETRY_DELAY &&
+                           gap < WIFI_STA_RETRY_DELAY + STEP_MS) {
+                    long_waits++;
+                } else {
+                    bad_waits++;
+                }
+                in_backoff = false;
+            }
+        }
+        snprintf(detail, sizeof(detail),
+                 "%d random waits, %d long waits, %d out of range, max poll %.3f ms",
+                 short_waits, long_waits, bad_waits, poll_max_ms);
+        report("Failed attempts back off, loop keeps running",
+               short_waits >= WIFI_STA_MAX_RETRY - 1 && long_waits >= 1 &&
+               bad_waits == 0 && poll_max_ms < 5, detail);
+    }
+
+    // === AP RETURNS ===
+    {
+        host_wifi_set_ap(true, 800);
+        uint32_t start = millis();
+        bool up = run_until(WIFI_LINK_UP, WIFI_STA_RETRY_DELAY + 20000);
+        snprintf(detail, sizeof(detail), "state %s after %lu ms, bit %d",
+                 wifi_link_state_name(wifi_link_state()),
+                 (unsigned long)(millis() - start), link_bit());
+        report("Reconnects once the AP is back", up && link_bit(), detail);
+    }
+
+    // === ATTEMPT TIMEOUT ===
+    {
+        host_wifi_set_ap(false, 800);
+        host_wifi_service();
+        host_wifi_set_ap(true, 60000); // Associates, DHCP never answers
+        transitions.clear();
+        run_ms(WIFI_FAST_TIMEOUT_MS + WIFI_CONNECT_TIMEOUT_MS + 1000);
+
+        // Cached AP first, then the full scan attempt
+        bool timed_out = false;
+        for (const transition_t &tr : transitions) {
+            if (tr.prev == WIFI_LINK_CONNECTING && tr.state == WIFI_LINK_BACKOFF) {
+                timed_out = tr.at_ms - transitions.front().at_ms >=
+                            WIFI_FAST_TIMEOUT_MS + WIFI_CONNECT_TIMEOUT_MS;
+            }
+        }
+        snprintf(detail, sizeof(detail), "state %s, timed out after %u + %u ms: %d",
+                 wifi_link_state_name(wifi_link_state()),
+                 WIFI_FAST_TIMEOUT_MS, WIFI_CONNECT_TIMEOUT_MS, timed_out);
+        report("Stalled attempt times out",
+               timed_out && wifi_link_state() == WIFI_LINK_BACKOFF, detail);
+    }
+
+    // === DISABLED FROM THE HMI ===
+    {
+        host_wifi_set_ap(true, 800);
+        run_until(WIFI_LINK_UP, 20000);
+
+        vp.wifi_state = 0;
+        run_ms(STEP_MS);
+        unsigned long begins = wifi_begins();
+        run_ms(60000);
+        snprintf(detail, sizeof(detail), "state %s, bit %d, begins in 60 s %lu",
+                 wifi_link_state_name(wifi_link_state()), link_bit(),
+                 wifi_begins() - begins);
+        report("WiFi switched off stays off",
+               wifi_link_state() == WIFI_LINK_OFF && !link_bit() &&
+               wifi_begins() == begins, detail);
+    }
+
+    // === PORTAL HOLD ===
+    {
+        vp.wifi_state = 1;
+        wifi_link_hold(true);
+        unsigned long begins = wifi_begins();
+        run_ms(60000);
+        bool held = wifi_link_state() == WIFI_LINK_HOLD &&
+                    wifi_begins() == begins;
+
+        wifi_link_hold(false);
+        bool up = run_until(WIFI_LINK_UP, 5000);
+        snprintf(detail, sizeof(detail),
+                 "held %d with no attempts, up %d after release", held, up);
+        report("Hold lends the radio to the portal", held && up, detail);
+    }
+
+    // === FAST RECONNECT ===
+    const uint8_t ap1[6] = { 0x24, 0x0A, 0xC4, 0x12, 0x34, 0x56 };
+    const uint8_t ap2[6] = { 0x24, 0x0A, 0xC4, 0x65, 0x43, 0x21 };
+    {
+        host_wifi_set_timing(2500, 300, 1500); // Scan, association, DHCP
+
+        // Baseline without the cache
+        wifi_link_forget();
+        uint32_t scan_ms = bounce(ap1, 6);
+
+        host_wifi_stats_t before, after;
+        host_nvs_stats_t nvs_before, nvs_after;
+        host_wifi_stats(&before);
+        host_nvs_stats(&nvs_before);
+        for (int i = 0; i < 20; i++) {
+            bounce(ap1, 6);
+        }
+        host_wifi_stats(&after);
+        host_nvs_stats(&nvs_after);
+
+        wifi_link_stats_t stats;
+        wifi_link_stats(&stats);
+        snprintf(detail, sizeof(detail),
+                 "scan %lu ms, cached p50 %lu p90 %lu ms, scans %lu, DHCP %lu, NVS writes %lu",
+                 (unsigned long)scan_ms, (unsigned long)stats.fast.p50_ms,
+                 (unsigned long)stats.fast.p90_ms, after.scans - before.scans,
+                 after.dhcp_requests - before.dhcp_requests,
+                 nvs_after.writes - nvs_before.writes);
+        report("Reconnect skips the scan and DHCP",
+               scan_ms >= 4300 && stats.fast.samples >= 20 &&
+               stats.fast.p90_ms <= 400 && after.scans == before.scans &&
+               after.dhcp_requests == before.dhcp_requests &&
+               nvs_after.writes == nvs_before.writes, detail);
+    }
+
+    // === AP REPLACED ===
+    {
+        wifi_link_stats_t before, after;
+        wifi_link_stats(&before);
+        uint32_t moved_ms = bounce(ap2, 11); // New AP on another channel
+        uint32_t next_ms = bounce(ap2, 11);
+        wifi_link_stats(&after);
+
+        wifi_link_cache_t record;
+        bool saved = vp_load_blob(WIFI_CACHE_KEY, &record, sizeof(record)) &&
+                     memcmp(record.bssid, ap2, 6) == 0 && record.channel == 11;
+        snprintf(detail, sizeof(detail),
+                 "fallback %lu ms, fallbacks %lu, next %lu ms, cache updated %d",
+                 (unsigned long)moved_ms,
+                 (unsigned long)(after.fast_misses - before.fast_misses),
+                 (unsigned long)next_ms, saved);
+        report("Moved AP falls back to a scan",
+               wifi_link_state() == WIFI_LINK_UP &&
+               after.fast_misses == before.fast_misses + 1 &&
+               next_ms <= 400 && saved, detail);
+    }
+
+    // === LEASE RENEWAL ===
+    {
+        host_wifi_stats_t before, after;
+        host_wifi_stats(&before);
+        host_wifi_set_lease(20 * 60); // Short lease from this renewal on
+        host_clock_advance_us((int64_t)HOST_WIFI_LEASE_S / 2 * 1000000);
+        run_ms(3000);
+        host_wifi_stats(&after);
+        bool renewed = after.dhcp_requests == before.dhcp_requests + 1 &&
+                       wifi_link_state() == WIFI_LINK_UP;
+
+        wifi_link_stats_t s1, s2;
+        wifi_link_stats(&s1);
+        uint32_t ms = bounce(ap2, 11);
+        wifi_link_stats(&s2);
+        snprintf(detail, sizeof(detail),
+                 "DHCP renewed %d in place, next reconnect %lu ms reusing it %d",
+                 renewed, (unsigned long)ms, s2.dhcp_skipped == s1.dhcp_skipped + 1);
+        report("Old lease is renewed by DHCP",
+               renewed && s2.dhcp_skipped == s1.dhcp_skipped + 1, detail);
+    }
+
+    // === GRANTED LEASE ===
+    {
+        wifi_link_cache_t record;
+        bool saved = vp_load_blob(WIFI_CACHE_KEY, &record, sizeof(record));
+
+        host_wifi_stats_t before, mid, after;
+        host_wifi_stats(&before);
+        host_clock_advance_us((int64_t)(20 * 60 / 2 - 60) * 1000000);
+        run_ms(3000);
+        host_wifi_stats(&mid);
+        host_clock_advance_us(60 * 1000000LL);
+        run_ms(3000);
+        host_wifi_stats(&after);
+        snprintf(detail, sizeof(detail),
+                 "lease %lu s saved %d, DHCP +%lu at 9 min, +%lu at 10 min",
+                 saved ? (unsigned long)record.lease_s : 0UL, saved,
+                 mid.dhcp_requests - before.dhcp_requests,
+                 after.dhcp_requests - mid.dhcp_requests);
+        report("Reuse ends at half the granted lease",
+               saved && record.lease_s == 20 * 60 &&
+               mid.dhcp_requests == before.dhcp_requests &&
+               after.dhcp_requests == mid.dhcp_requests + 1 &&
+               wifi_link_state() == WIFI_LINK_UP, detail);
+    }
+
+    // ============ SUMMARY ============
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║%*sTEST SUMMARY%*s║\n", 46/2, "", (46+1)/ 2, "");
+    printf("║══════════════════════════════════════════════════════════║\n");
+    printf("║  Total tests   : %-39d ║\n", total_tests);
+    printf("║  Passed        : %-39d ║\n", passed_tests);
+    printf("║  Failed        : %-39d ║\n", total_tests - passed_tests);
+    printf("║  Success rate  : %-39.f ║\n",
+        (float)passed_tests / total_tests * 100);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+
+    return (passed_tests == total_tests) ? 0 : 1; // Indicate failure
+}
@@ -0,0 +1,285 @@
+#include "global.h"
+#include "host_shims.h"
+#include <chrono>
+
+// ============ HOST SETUP ============
+// Runs the TaskWiFi loop with the portal open, and the scheduler and
+// TaskHMI drain in the same loop, the way they interleave on the board.
+
+SemaphoreHandle_t xVPMutex = NULL;
+QueueHandle_t xHMIUpdateQueue = NULL;
+EventGroupHandle_t eventGroup = NULL;
+
+#define BOOT_LOCAL 1741588190LL // 2025-03-10 06:29:50 local
+#define STEP_MS 20
+
+static double poll_max_ms = 0;
+static unsigned long loops = 0;
+static unsigned long relay_on_loop = 0; // Loop the light relay closed
+
+// === TaskHMI stand-in ===
+static void hmi_drain(void) {
+    hmi_update_item_t msg;
+    while (xQueueReceive(xHMIUpdateQueue, &msg, 0) == pdTRUE) {
+        if (msg.type == HMI_UPDATE_VALUE) {
+            uint8_t pin = io_pin_map(msg.address);
+            if (pin != 0) {
+                digitalWrite(pin, vp_get_value(msg.address));
+            }
+        }
+    }
+}
+
+// === TaskWiFi + TaskSync stand-in ===
+static void run_ms(uint32_t ms) {
+    for (uint32_t t = 0; t < ms; t += STEP_MS) {
+        auto start = std::chrono::steady_clock::now();
+        wifi_portal_poll();
+        host_wifi_service();
+        wifi_link_poll(0);
+        double took = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+        if (took > poll_max_ms) poll_max_ms = took;
+
+        // Scheduler pass every 500 ms
+        if (loops % (500 / STEP_MS) == 0) {
+            time_snapshot_t now;
+            if (time_now(&now) && xSemaphoreTake(xVPMutex, portMAX_DELAY) == pdTRUE) {
+                io_automation_run(&now);
+                xSemaphoreGive(xVPMutex);
+            }
+        }
+        hmi_drain();
+        if (!relay_on_loop && host_gpio_level(LIGHT_RELAY)) {
+            relay_on_loop = loops;
+        }
+
+        loops++;
+        vTaskDelay(pdMS_TO_TICKS(STEP_MS));
+    }
+}
+
+static bool run_until_up(uint32_t limit_ms) {
+    for (uint32_t t = 0; t < limit_ms; t += STEP_MS) {
+        run_ms(STEP_MS);
+        if (wifi_link_state() == WIFI_LINK_UP) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ============ TEST HELPERS ============
+static int total_tests = 0;
+static int passed_tests = 0;
+
+static void report(const char *name, bool passed, const char *detail) {
+    total_tests++;
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║ TEST #%02d: %-46s ║\n", total_tests, name);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+    printf("  %s\n", detail);
+    printf("  Result:   %s\n", passed ? "PASS" : "FAIL");
+    if (passed) passed_tests++;
+}
+
+// ============ MAIN TEST SUITE ============
+int main() {
+    host_serial_quiet(true);
+    host_clock_set_us(0);
+    char detail[200];
+
+    xVPMutex = xSemaphoreCreateMutex();
+    xHMIUpdateQueue = xQueueCreate(64, sizeof(hmi_update_item_t));
+    eventGroup = xEventGroupCreate();
+
+    // First boot: no SSID, so main.cpp enables AP mode
+    memset(&vp, 0, sizeof(vp));
+    strcpy(vp.hostname, "E-1A2B");
+    strcpy(vp.holder_ip, "IP Address");
+    strcpy(vp.holder_signal, "Signal Strength");
+    vp.wifi_ap_state = 1;
+    vp.total_cycle = 15;
+    vp.growth_day = 1;
+    vp.light_auto = 1;
+    vp.light_on_hr = 6;
+    vp.light_on_min = 30;
+    vp.light_off_hr = 20;
+    time_set_epoch(BOOT_LOCAL - TIME_LOCAL_OFFSET);
+    io_schedule_init();
+    growth_init();
+
+    host_wifi_set_ap(true, 800);
+    wifi_portal_begin();
+    wifi_link_begin(wifi_on_link_change);
+
+    // === PORTAL OPENS ===
+    {
+        run_ms(2000);
+        host_portal_stats_t ps;
+        host_portal_stats(&ps);
+        snprintf(detail, sizeof(detail),
+                 "active %d, link %s, HMI '%s' '%s' '%s', %lu loops, max poll %.3f ms",
+                 ps.active, wifi_link_state_name(wifi_link_state()),
+                 vp.holder_signal, vp.pswd_and_signal, vp.ip_address,
+                 loops, poll_max_ms);
+        report("Portal opens without blocking the loop",
+               ps.active && ps.opens == 1 && wifi_link_state() == WIFI_LINK_HOLD &&
+               strcmp(vp.pswd_and_signal, WIFI_AP_PSWD) == 0 &&
+               strcmp(vp.ip_address, "192.168.4.1") == 0 &&
+               loops >= 2000 / STEP_MS && poll_max_ms < 5, detail);
+    }
+
+    // === SCHEDULER KEEPS RUNNING ===
+    {
+        run_ms(10000); // Light due on at 06:30:00, 8 s from here
+        unsigned long due_loop = 10000 / STEP_MS; // 06:30:00
+        long late_ms = ((long)relay_on_loop - (long)due_loop) * STEP_MS;
+        snprintf(detail, sizeof(detail), "light relay %s, %ld ms after the schedule",
+                 host_gpio_level(LIGHT_RELAY) ? "ON" : "OFF", late_ms);
+        report("Relays switch on time with the portal open",
+               host_gpio_level(LIGHT_RELAY) == 1 && late_ms >= 0 && late_ms <= 500,
+               detail);
+    }
+
+    // === PROGRESS ON THE HMI ===
+    {
+        char countdown[sizeof(vp.holder_ip)];
+        strcpy(countdown, vp.holder_ip);
+
+        host_portal_join(1);
+        run_ms(300000); // Longer than the timeout, phone stays on
+        char joined[sizeof(vp.holder_ip)];
+        strcpy(joined, vp.holder_ip);
+        host_portal_stats_t ps;
+        host_portal_stats(&ps);
+
+        host_portal_join(0);
+        run_ms(1000);
+        snprintf(detail, sizeof(detail), "'%s', then '%s' for 5 min (open %d), then '%s'",
+                 countdown, joined, ps.active, vp.holder_ip);
+        report("Countdown and joined phone on the HMI",
+               strcmp(countdown, "Setup 2:49") == 0 && // Last poll 11.98 s in
+               strcmp(joined, "Phone joined") == 0 && ps.active &&
+               strcmp(vp.holder_ip, "Setup 2:59") == 0, detail);
+    }
+
+    // === BAD INPUT ===
+    {
+        host_nvs_stats_t before, after;
+        host_nvs_stats(&before);
+        host_portal_submit("greenhouse", "short");
+        run_ms(STEP_MS * 2);
+        host_nvs_stats(&after);
+
+        wifi_cred_t cred;
+        snprintf(detail, sizeof(detail), "open %d, HMI '%s', NVS writes %lu, record %d",
+                 wifi_portal_active(), vp.holder_ip, after.writes - before.writes,
+                 vp_load_blob(WIFI_CRED_KEY, &cred, sizeof(cred)));
+        report("Invalid password is rejected, portal stays",
+               wifi_portal_active() && strcmp(vp.holder_ip, "Check password") == 0 &&
+               after.writes == before.writes && vp.wifi_ssid[0] == '\0', detail);
+    }
+
+    // === SAVE AND CONNECT ===
+    {
+        host_portal_submit("greenhouse", "secret123");
+        run_ms(STEP_MS * 2);
+        bool closed = !wifi_portal_active();
+        bool up = run_until_up(5000);
+
+        wifi_cred_t cred;
+        bool record = vp_load_blob(WIFI_CRED_KEY, &cred, sizeof(cred)) &&
+                      strcmp(cred.ssid, "greenhouse") == 0 &&
+                      strcmp(cred.pswd, "secret123") == 0;
+        snprintf(detail, sizeof(detail),
+                 "closed %d, record %d, SSID '%s', STA %d AP %d, up %d, HMI '%s' '%s' '%s'",
+                 closed, record, vp.wifi_ssid, vp.wifi_state, vp.wifi_ap_state, up,
+                 vp.holder_ip, vp.holder_signal, vp.pswd_and_signal);
+        report("Saved credentials commit and connect",
+               closed && record && strcmp(vp.wifi_pswd, "secret123") == 0 &&
+               vp.wifi_state == 1 && vp.wifi_ap_state == 0 && up &&
+               strcmp(vp.holder_ip, "IP Address") == 0 &&
+               strcmp(vp.pswd_and_signal, "Connected") == 0, detail);
+    }
+
+    // === POWER CUT DURING SAVE ===
+    {
+        // Record committed, VP keys still hold the old network
+        wifi_cred_t cred;
+        memset(&cred, 0, sizeof(cred));
+        strcpy(cred.ssid, "barn");
+        strcpy(cred.pswd, "hayloft99");
+        vp_save_blob(WIFI_CRED_KEY, &cred, sizeof(cred));
+
+        // Reboot
+        memset(vp.wifi_ssid, 0, sizeof(vp.wifi_ssid));
+        vp_load_values();
+        char before[sizeof(vp.wifi_ssid)];
+        strcpy(before, vp.wifi_ssid);
+        wifi_portal_recover();
+        char repaired[sizeof(vp.wifi_ssid)];
+        strcpy(repaired, vp.wifi_ssid);
+
+        // Reboot again, the repair itself is saved
+        memset(vp.wifi_ssid, 0, sizeof(vp.wifi_ssid));
+        vp_load_values();
+        snprintf(detail, sizeof(detail), "VP keys '%s' -> '%s', after reboot '%s'/'%s'",
+                 before, repaired, vp.wifi_ssid, vp.wifi_pswd);
+        report("Interrupted save is repaired at boot",
+               strcmp(before, "greenhouse") == 0 && strcmp(repaired, "barn") == 0 &&
+               strcmp(vp.wifi_ssid, "barn") == 0 &&
+               strcmp(vp.wifi_pswd, "hayloft99") == 0, detail);
+    }
+
+    // === HMI EDIT ===
+    {
+        hmi_on_event("1420", 0, "orchard", "");
+        hmi_on_event("1430", 0, "apples123", "");
+
+        vp_load_values();
+        wifi_portal_recover();
+        snprintf(detail, sizeof(detail), "after reboot '%s'/'%s'",
+                 vp.wifi_ssid, vp.wifi_pswd);
+        report("Credentials edited on the panel survive reboot",
+               strcmp(vp.wifi_ssid, "orchard") == 0 &&
+               strcmp(vp.wifi_pswd, "apples123") == 0, detail);
+    }
+
+    // === TIMEOUT AND CANCEL ===
+    {
+        vp.wifi_ap_state = 1;
+        run_ms(1000);
+        bool opened = wifi_portal_active();
+        run_ms(WIFI_AP_TIMEOUT * 1000);
+        bool timed_out = !wifi_portal_active() && vp.wifi_ap_state == 0 &&
+                         vp.wifi_state == 1;
+        bool up = run_until_up(20000);
+
+        vp.wifi_ap_state = 1;
+        run_ms(1000);
+        bool reopened = wifi_portal_active();
+        vp.wifi_ap_state = 0;
+        run_ms(STEP_MS);
+        bool cancelled = !wifi_portal_active();
+
+        snprintf(detail, sizeof(detail),
+                 "opened %d, timed out %d, reconnected %d, reopened %d, cancelled %d",
+                 opened, timed_out, up, reopened, cancelled);
+        report("Timeout and HMI cancel close the portal",
+               opened && timed_out && up && reopened && cancelled, detail);
+    }
+
+    // ============ SUMMARY ============
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║%*sTEST SUMMARY%*s║\n", 46/2, "", (46+1)/ 2, "");
+    printf("║══════════════════════════════════════════════════════════║\n");
+    printf("║  Total tests   : %-39d ║\n", total_tests);
+    printf("║  Passed        : %-39d ║\n", passed_tests);
+    printf("║  Failed        : %-39d ║\n", total_tests - passed_tests);
+    printf("║  Success rate  : %-39.f ║\n",
+        (float)passed_tests / total_tests * 100);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+
+    return (passed_tests == total_tests) ? 0 : 1; // Indicate failure
+}
@@ -0,0 +1,240 @@
+#include "global.h"
+#include "host_shims.h"
+
+// ============ HOST SETUP ============
+// Feeds noisy RSSI into the sampler as TaskWiFi polls it, and counts
+// the string updates that would go out to the panel.
+
+SemaphoreHandle_t xVPMutex = NULL;
+QueueHandle_t xHMIUpdateQueue = NULL;
+
+#define LOOP_MS 500 // TaskWiFi period when idle
+
+static uint32_t rng = 12345;
+
+// Uniform noise in [-span, +span] dB, repeatable
+static int noise(int span) {
+    rng = rng * 1103515245u + 12345u;
+    return (int)((rng >> 16) % (2 * span + 1)) - span;
+}
+
+// === /metrics capture ===
+static void capture(const char *text, size_t len, void *ctx) {
+    ((std::string *)ctx)->append(text, len);
+}
+
+// Value of the sample line starting with `series`, -999 when absent
+static long sample(const std::string &text, const char *series) {
+    std::string key = std::string(METRICS_PREFIX) + series + " ";
+    size_t pos = text.find("\n" + key);
+    if (pos == std::string::npos) {
+        return -999;
+    }
+    return strtol(text.c_str() + pos + 1 + key.size(), NULL, 10);
+}
+
+// === TaskHMI stand-in ===
+static unsigned long hmi_updates(void) {
+    hmi_update_item_t msg;
+    unsigned long count = 0;
+    while (xQueueReceive(xHMIUpdateQueue, &msg, 0) == pdTRUE) {
+        if (msg.type == HMI_UPDATE_STRING && msg.address == VP_PSWD_AND_SIGNAL) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// Level of a single raw sample, what an unfiltered display would show
+static int raw_level(int dbm) {
+    if (dbm >= -55) return WIFI_SIGNAL_EXCELLENT;
+    if (dbm >= -67) return WIFI_SIGNAL_GOOD;
+    if (dbm >= -75) return WIFI_SIGNAL_FAIR;
+    if (dbm >= -85) return WIFI_SIGNAL_WEAK;
+    return WIFI_SIGNAL_POOR;
+}
+
+typedef struct {
+    unsigned long updates;    // Pushed by the sampler
+    unsigned long raw_changes; // Unfiltered level changes
+} run_result_t;
+
+// Runs TaskWiFi loops for `ms` with RSSI `mean` +- `span`
+static run_result_t run(uint32_t ms, int mean, int span) {
+    run_result_t result = { 0, 0 };
+    static int last_raw = -1;
+    static uint32_t next_sample = 0;
+
+    for (uint32_t t = 0; t < ms; t += LOOP_MS) {
+        // The radio's reading moves about once per sample period
+        if ((int32_t)(millis() - next_sample) >= 0) {
+            int dbm = mean + noise(span);
+            host_wifi_set_rssi((int8_t)dbm);
+            if (last_raw >= 0 && raw_level(dbm) != last_raw) {
+                result.raw_changes++;
+            }
+            last_raw = raw_level(dbm);
+            next_sample = millis() + WIFI_RSSI_SAMPLE_MS;
+        }
+
+        wifi_signal_poll(millis());
+        result.updates += hmi_updates();
+        vTaskDelay(pdMS_TO_TICKS(LOOP_MS));
+    }
+    return result;
+}
+
+// ============ TEST HELPERS ============
+static int total_tests = 0;
+static int passed_tests = 0;
+
+static void report(const char *name, bool passed, const char *detail) {
+    total_tests++;
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║ TEST #%02d: %-46s ║\n", total_tests, name);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+    printf("  %s\n", detail);
+    printf("  Result:   %s\n", passed ? "PASS" : "FAIL");
+    if (passed) passed_tests++;
+}
+
+// ============ MAIN TEST SUITE ============
+int main() {
+    host_serial_quiet(true);
+    host_clock_set_us(0);
+    char detail[160];
+
+    xVPMutex = xSemaphoreCreateMutex();
+    xHMIUpdateQueue = xQueueCreate(64, sizeof(hmi_update_item_t));
+
+    memset(&vp, 0, sizeof(vp));
+    strcpy(vp.pswd_and_signal, "Connected");
+
+    // Associated link
+    host_wifi_set_ap(true, 0);
+    host_wifi_set_rssi(-60);
+    WiFi.begin("greenhouse", "secret123");
+    host_wifi_service();
+    wifi_signal_reset();
+
+    // === FIRST SAMPLE ===
+    {
+        wifi_signal_poll(millis());
+        unsigned long updates = hmi_updates();
+        snprintf(detail, sizeof(detail), "HMI '%s', %lu update", vp.pswd_and_signal, updates);
+        report("Level replaces 'Connected' at once",
+               strcmp(vp.pswd_and_signal, "Good") == 0 && updates == 1, detail);
+    }
+
+    // === SAMPLE INTERVAL ===
+    {
+        wifi_signal_stats_t before, after;
+        wifi_signal_stats(&before);
+        for (int i = 0; i < 500; i++) {
+            vTaskDelay(pdMS_TO_TICKS(20)); // Portal-rate polling
+            wifi_signal_poll(millis());
+        }
+        wifi_signal_stats(&after);
+        snprintf(detail, sizeof(detail), "%lu samples in 10 s of 20 ms polls",
+                 (unsigned long)(after.samples - before.samples));
+        report("Samples at the configured interval",
+               after.samples - before.samples == 10000 / WIFI_RSSI_SAMPLE_MS, detail);
+    }
+
+    // === STEADY NOISE ===
+    {
+        run_result_t r = run(60 * 60 * 1000, -62, 6);
+        snprintf(detail, sizeof(detail),
+                 "-62 +-6 dBm for 1 h: %lu updates, unfiltered would be %lu",
+                 r.updates, r.raw_changes);
+        report("Noise inside a band sends nothing",
+               r.updates == 0 && strcmp(vp.pswd_and_signal, "Good") == 0, detail);
+    }
+
+    // === ON A BAND EDGE ===
+    {
+        run_result_t r = run(60 * 60 * 1000, -67, 5);
+        snprintf(detail, sizeof(detail),
+                 "-67 +-5 dBm for 1 h: %lu updates, unfiltered would be %lu",
+                 r.updates, r.raw_changes);
+        report("Hysteresis holds the level on an edge",
+               r.updates <= 2 && r.raw_changes > 100, detail);
+    }
+
+    // === STEP CHANGE ===
+    {
+        run(60 * 1000, -50, 0);
+        hmi_updates();
+        uint32_t start = millis();
+        uint32_t settled = 0;
+        unsigned long updates = 0;
+        while (millis() - start < 120000) {
+            run_result_t r = run(LOOP_MS, -80, 0);
+            updates += r.updates;
+            if (!settled && strcmp(vp.pswd_and_signal, "Weak") == 0) {
+                settled = millis() - start;
+            }
+        }
+        snprintf(detail, sizeof(detail),
+                 "-50 -> -80 dBm: 'Weak' after %lu ms, %lu updates on the way",
+                 (unsigned long)settled, updates);
+        report("Real change shows within seconds",
+               settled > 0 && settled <= 20000 && updates <= 3, detail);
+    }
+
+    // === HISTORY ===
+    {
+        int8_t history[WIFI_RSSI_HISTORY_LEN + 8];
+        size_t n = wifi_signal_history(history, sizeof(history));
+        wifi_signal_stats_t stats;
+        wifi_signal_stats(&stats);
+
+        int8_t tail[4];
+        size_t m = wifi_signal_history(tail, 4);
+        snprintf(detail, sizeof(detail),
+                 "%u entries, oldest %d dBm, newest %d dBm, last 4 newest %d, avg now %d",
+                 (unsigned)n, history[0], history[n - 1], tail[m - 1], stats.rssi_avg);
+        report("Per-minute RSSI history for metrics",
+               n == WIFI_RSSI_HISTORY_LEN && m == 4 &&
+               history[n - 1] == tail[3] && history[n - 1] == -80 &&
+               history[0] >= -72 && history[0] <= -62, detail);
+    }
+
+    // === METRICS ===
+    {
+        int8_t history[WIFI_RSSI_HISTORY_LEN];
+        size_t n = wifi_signal_history(history, WIFI_RSSI_HISTORY_LEN);
+        wifi_signal_stats_t stats;
+        wifi_signal_stats(&stats);
+        std::string text;
+        metrics_write(capture, &text);
+
+        char oldest[64];
+        snprintf(oldest, sizeof(oldest), "wifi_rssi_history_dbm{minutes_ago=\"%u\"}",
+                 (unsigned)(n - 1));
+        snprintf(detail, sizeof(detail), "rssi %ld dBm, level %ld, minute 0 %ld, minute %u %ld",
+                 sample(text, "wifi_rssi_dbm"), sample(text, "wifi_signal_level"),
+                 sample(text, "wifi_rssi_history_dbm{minutes_ago=\"0\"}"),
+                 (unsigned)(n - 1), sample(text, oldest));
+        report("Signal exported on /metrics",
+               sample(text, "wifi_rssi_dbm") == stats.rssi_avg &&
+               sample(text, "wifi_signal_level") == WIFI_SIGNAL_WEAK &&
+               sample(text, "wifi_rssi_history_dbm{minutes_ago=\"0\"}") == history[n - 1] &&
+               sample(text, oldest) == history[0] &&
+               text.find("# TYPE " METRICS_PREFIX "wifi_rssi_history_dbm gauge\n") !=
+                   std::string::npos, detail);
+    }
+
+    // ============ SUMMARY ============
+    printf("\n╔══════════════════════════════════════════════════════════╗\n");
+    printf("║%*sTEST SUMMARY%*s║\n", 46/2, "", (46+1)/ 2, "");
+    printf("║══════════════════════════════════════════════════════════║\n");
+    printf("║  Total tests   : %-39d ║\n", total_tests);
+    printf("║  Passed        : %-39d ║\n", passed_tests);
+    printf("║  Failed        : %-39d ║\n", total_tests - passed_tests);
+    printf("║  Success rate  : %-39.f ║\n",
+        (float)passed_tests / total_tests * 100);
+    printf("╚══════════════════════════════════════════════════════════╝\n");
+
+    return (passed_tests == total_tests) ? 0 : 1; // Indicate failure
+}